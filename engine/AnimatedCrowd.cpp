@@ -0,0 +1,228 @@
+#include "AnimatedCrowd.h"
+#include "AnimationClip.h"
+#include "AssetManager.h"
+#include "InstanceCuller.h"
+#include "JobSystem.h"
+#include "Skeleton.h"
+#include "VertexBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// Characters a job animates at a time
+static const size_t sBatchSize = 32;
+
+// Bindings of the skinning matrices of this and the last frame in shaders/skinnedVS.glsl
+static const unsigned int sBoneBinding = 0;
+static const unsigned int sPreviousBoneBinding = 1;
+
+// Location of the character index in shaders/skinnedVS.glsl, after the bone weights
+static const unsigned int sCharacterIndexLocation = 4;
+
+AnimatedCrowd::AnimatedCrowd(VertexBuffer *vBuffer, Skeleton *skeleton, const std::vector<AnimationClip *> &clips, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                             size_t maxCharacters)
+    : RenderObj(), mSkeleton(skeleton), mClips(clips), mCharacterMin(boundsMin), mCharacterMax(boundsMax), mMaxCharacters(maxCharacters), mCurrent(0), mUploadedCount(0),
+      mCpuTime(0.0f)
+{
+    // The bounds stay empty until the first character is added
+    mVertexBuffer = vBuffer;
+    mInstanceCuller = new InstanceCuller(mVertexBuffer, boundsMin, boundsMax, maxCharacters, sCharacterIndexLocation);
+    mCharacters.reserve(maxCharacters);
+    mSkinningMatrices.resize(maxCharacters * mSkeleton->GetBoneCount());
+
+    glGenBuffers(2, mBoneBufferIDs);
+    for (unsigned int bufferID : mBoneBufferIDs)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mSkinningMatrices.size() * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+AnimatedCrowd::~AnimatedCrowd()
+{
+    std::cout << "Delete animated crowd" << std::endl;
+
+    glDeleteBuffers(2, mBoneBufferIDs);
+    for (auto clip : mClips)
+    {
+        delete clip;
+    }
+    delete mSkeleton;
+    delete mInstanceCuller;
+    delete mVertexBuffer;
+}
+
+size_t AnimatedCrowd::AddCharacter(const glm::mat4 &model, size_t clip, float time)
+{
+    if (mCharacters.size() == mMaxCharacters)
+    {
+        std::cout << "Animated crowd is full" << std::endl;
+        return mMaxCharacters;
+    }
+
+    Character character;
+    character.model = model;
+    character.clip = static_cast<uint32_t>(clip);
+    character.time = time;
+    character.fadeClip = character.clip;
+    character.fadeTime = time;
+    character.fade = 1.0f;
+    character.fadeSpeed = 0.0f;
+    mCharacters.emplace_back(character);
+    mInstanceCuller->AddInstance(model);
+    GrowBounds(model);
+    return mCharacters.size() - 1;
+}
+
+void AnimatedCrowd::SetCharacter(size_t index, const glm::mat4 &model)
+{
+    mCharacters[index].model = model;
+    mInstanceCuller->SetInstance(index, model);
+    GrowBounds(model);
+}
+
+void AnimatedCrowd::CrossFade(size_t index, size_t clip, float duration)
+{
+    // A fade that is cut short starts over from the clip it was fading into
+    Character &character = mCharacters[index];
+    character.fadeClip = character.clip;
+    character.fadeTime = character.time;
+    character.clip = static_cast<uint32_t>(clip);
+    character.time = 0.0f;
+    character.fade = duration > 0.0f ? 0.0f : 1.0f;
+    character.fadeSpeed = duration > 0.0f ? 1.0f / duration : 0.0f;
+}
+
+void AnimatedCrowd::GrowBounds(const glm::mat4 &model)
+{
+    if (!HasBounds())
+    {
+        mBoundsMin = glm::vec3(model[3]);
+        mBoundsMax = glm::vec3(model[3]);
+    }
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec3 position = glm::vec3(corner & 1 ? mCharacterMax.x : mCharacterMin.x, corner & 2 ? mCharacterMax.y : mCharacterMin.y, corner & 4 ? mCharacterMax.z : mCharacterMin.z);
+        glm::vec3 world = glm::vec3(model * glm::vec4(position, 1.0f));
+        mBoundsMin = glm::min(mBoundsMin, world);
+        mBoundsMax = glm::max(mBoundsMax, world);
+    }
+}
+
+void AnimatedCrowd::AnimateCharacters(size_t begin, size_t end, float deltaTime)
+{
+    // Poses are reused by every character of the batch
+    Pose pose, fadePose;
+    size_t boneCount = mSkeleton->GetBoneCount();
+    for (size_t i = begin; i < end; ++i)
+    {
+        Character &character = mCharacters[i];
+        const AnimationClip *clip = mClips[character.clip];
+        character.time = std::fmod(character.time + deltaTime, clip->GetDuration());
+        clip->Sample(character.time, pose);
+
+        // The pose of the old clip keeps playing while it fades out
+        if (character.fade < 1.0f)
+        {
+            const AnimationClip *fadeClip = mClips[character.fadeClip];
+            character.fadeTime = std::fmod(character.fadeTime + deltaTime, fadeClip->GetDuration());
+            character.fade = std::min(character.fade + deltaTime * character.fadeSpeed, 1.0f);
+            fadeClip->Sample(character.fadeTime, fadePose);
+            AnimationClip::Blend(fadePose, pose, character.fade, pose);
+        }
+
+        mSkeleton->ComputeSkinningMatrices(pose, character.model, &mSkinningMatrices[i * boneCount]);
+    }
+}
+
+void AnimatedCrowd::Update(float deltaTime)
+{
+    if (mCharacters.empty())
+    {
+        return;
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    // The characters are independent, each batch writes only the matrices of its own
+    auto animate = [this, deltaTime](size_t begin, size_t end)
+    {
+        AnimateCharacters(begin, end, deltaTime);
+    };
+    JobSystem *jobs = JobSystem::Get();
+    if (jobs)
+    {
+        jobs->ParallelFor(mCharacters.size(), sBatchSize, animate);
+    }
+    else
+    {
+        animate(0, mCharacters.size());
+    }
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    mCpuTime = static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6);
+
+    // The buffer of the last frame becomes the previous one, and this frame's matrices go into the other
+    size_t boneCount = mSkeleton->GetBoneCount();
+    mCurrent = 1 - mCurrent;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBoneBufferIDs[mCurrent]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mCharacters.size() * boneCount * sizeof(glm::mat4), mSkinningMatrices.data());
+    if (mUploadedCount < mCharacters.size())
+    {
+        size_t offset = mUploadedCount * boneCount;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBoneBufferIDs[1 - mCurrent]);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset * sizeof(glm::mat4), (mCharacters.size() * boneCount - offset) * sizeof(glm::mat4), &mSkinningMatrices[offset]);
+        mUploadedCount = mCharacters.size();
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void AnimatedCrowd::Draw()
+{
+    if (mCharacters.empty())
+    {
+        return;
+    }
+
+    mShader->SetActive();
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        mTextures[i]->SetActive();
+    }
+
+    // The matrices already hold the character's model matrix. They are bound once the cull
+    // shader is done with the bindings
+    mShader->SetInt("boneCount"_id, static_cast<int>(mSkeleton->GetBoneCount()));
+    mInstanceCuller->Cull();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sBoneBinding, mBoneBufferIDs[mCurrent]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sPreviousBoneBinding, mBoneBufferIDs[1 - mCurrent]);
+    mInstanceCuller->DrawVisible();
+}
+
+void AnimatedCrowd::DrawDepth()
+{
+    if (mCharacters.empty())
+    {
+        return;
+    }
+
+    // The depth shader skins the vertices the same way without the outputs of the shading pass
+    AssetManager *am = AssetManager::Get();
+    Shader *depthShader = am->LoadShader("skinnedDepth"_id);
+    if (!depthShader)
+    {
+        depthShader = new Shader("shaders/skinnedVS.glsl", "shaders/depthFS.glsl", "#define DEPTH_ONLY\n");
+        am->SaveShader("skinnedDepth"_id, depthShader);
+    }
+    depthShader->SetActive();
+    depthShader->SetMat4("viewProj"_id, GetDepthViewProj());
+    depthShader->SetInt("boneCount"_id, static_cast<int>(mSkeleton->GetBoneCount()));
+    mInstanceCuller->Cull(GetDepthViewProj());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sBoneBinding, mBoneBufferIDs[mCurrent]);
+    mInstanceCuller->DrawVisible();
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "RenderObj.h"
+
+class AnimationClip;
+class InstanceCuller;
+class Skeleton;
+
+// AnimatedCrowd draws many characters that share a skinned mesh, its Skeleton and a set of
+// AnimationClips as a single RenderObj. Every character plays a clip and can cross-fade into
+// another. Each frame the characters are split into batches on the JobSystem's workers, which
+// sample and blend their poses four bones at a time and compute their skinning matrices with
+// the model matrix already applied. The matrices of all characters are uploaded into one
+// storage buffer. Like an InstancedMesh, the characters are culled on the GPU by an
+// InstanceCuller against the camera or the depth pass's view, so every shadow map only
+// draws the characters inside of it, and shaders/skinnedVS.glsl picks the character's
+// matrices by the instance index of the draw command. The buffer of the last frame is kept
+// for the motion vectors, the two buffers swap every frame.
+class AnimatedCrowd : public RenderObj
+{
+public:
+    //   AnimatedCrowd constructor, takes ownership of the vertex buffer, skeleton and clips:
+    // - VertexBuffer* for the skinned mesh
+    // - Skeleton* for the mesh's skeleton
+    // - const std::vector<AnimationClip*>& for the clips of the skeleton
+    // - const glm::vec3& for the minimum corner of the box a character stays in while it is animated
+    // - const glm::vec3& for the maximum corner of the box
+    // - size_t for the maximum number of characters
+    AnimatedCrowd(VertexBuffer *vBuffer, Skeleton *skeleton, const std::vector<AnimationClip *> &clips, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                  size_t maxCharacters);
+    ~AnimatedCrowd();
+
+    // The characters are placed with AddCharacter/SetCharacter, not by the RenderObj's transform
+    void Update(float deltaTime) override;
+    void Draw() override;
+    void DrawDepth() override;
+
+    //   AddCharacter adds a character and returns its index, or returns the maximum number of
+    //   characters if the crowd is full:
+    // - const glm::mat4& for the character's model matrix
+    // - size_t for the clip it plays
+    // - float for the seconds into the clip it starts at
+    size_t AddCharacter(const glm::mat4 &model, size_t clip, float time = 0.0f);
+
+    //   SetCharacter moves a character, the bounds of the crowd only grow:
+    // - size_t for the character's index
+    // - const glm::mat4& for the character's model matrix
+    void SetCharacter(size_t index, const glm::mat4 &model);
+
+    //   CrossFade blends a character from the pose of its clip into another clip:
+    // - size_t for the character's index
+    // - size_t for the clip to play
+    // - float for the seconds the blend takes
+    void CrossFade(size_t index, size_t clip, float duration);
+
+    // Getter for the clip a character plays, or fades into
+    size_t GetClip(size_t index) const { return mCharacters[index].clip; }
+
+    // Getter for the number of characters
+    size_t GetCharacterCount() const { return mCharacters.size(); }
+
+    // Getter for the milliseconds the last animation of the characters took on the CPU
+    float GetCpuTime() const { return mCpuTime; }
+
+private:
+    struct Character
+    {
+        glm::mat4 model;
+
+        // Clip played and the seconds into it
+        uint32_t clip;
+        float time;
+
+        // Clip faded out of, the seconds into it, how far the fade is from 0 to 1 and how far it moves per second
+        uint32_t fadeClip;
+        float fadeTime;
+        float fade;
+        float fadeSpeed;
+    };
+
+    //   AnimateCharacters moves a batch of characters on in their clips and computes their skinning matrices:
+    // - size_t for the first and one past the last character
+    // - float for the seconds since the last frame
+    void AnimateCharacters(size_t begin, size_t end, float deltaTime);
+
+    //   GrowBounds grows the bounds of the crowd to a character:
+    // - const glm::mat4& for the character's model matrix
+    void GrowBounds(const glm::mat4 &model);
+
+    Skeleton *mSkeleton;
+    std::vector<AnimationClip *> mClips;
+
+    // Culls the characters by the box they stay in and draws the visible ones
+    InstanceCuller *mInstanceCuller;
+
+    glm::vec3 mCharacterMin;
+    glm::vec3 mCharacterMax;
+
+    size_t mMaxCharacters;
+    std::vector<Character> mCharacters;
+
+    // Skinning matrices of every bone of every character, character after character
+    std::vector<glm::mat4> mSkinningMatrices;
+
+    // The two buffers of skinning matrices, mCurrent holds this frame's, the other the last frame's
+    unsigned int mBoneBufferIDs[2];
+    int mCurrent;
+
+    // Characters both buffers hold, a new character is written into both so it starts without motion
+    size_t mUploadedCount;
+
+    float mCpuTime;
+};
@@ -0,0 +1,248 @@
+#include "AnimationClip.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ANIMATION_CLIP_SSE
+#endif
+
+// Value of one unit of a quantized rotation component
+static const float sRotationStep = 1.0f / 32767.0f;
+
+void Pose::Resize(size_t count)
+{
+    // The padding bones keep an identity transform
+    boneCount = count;
+    size_t padded = (count + 3) & ~size_t(3);
+    rotationX.resize(padded, 0.0f), rotationY.resize(padded, 0.0f), rotationZ.resize(padded, 0.0f), rotationW.resize(padded, 1.0f);
+    translationX.resize(padded, 0.0f), translationY.resize(padded, 0.0f), translationZ.resize(padded, 0.0f);
+}
+
+#ifdef ANIMATION_CLIP_SSE
+//   Nlerp interpolates 4 quaternions at once and normalizes them, the same operations in the same
+//   order as the scalar version so both give the same poses:
+// - 4 __m128& for the rotations at weight 0 and the result
+// - 4 __m128 for the rotations at weight 1
+// - __m128 for the weight
+static inline void Nlerp(__m128 &x, __m128 &y, __m128 &z, __m128 &w, __m128 toX, __m128 toY, __m128 toZ, __m128 toW, __m128 weight)
+{
+    // q and -q are the same rotation, the one on the side of the first takes the short way
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, toX), _mm_mul_ps(y, toY)), _mm_mul_ps(z, toZ)), _mm_mul_ps(w, toW));
+    __m128 sign = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+    toX = _mm_xor_ps(toX, sign), toY = _mm_xor_ps(toY, sign), toZ = _mm_xor_ps(toZ, sign), toW = _mm_xor_ps(toW, sign);
+
+    x = _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(toX, x), weight));
+    y = _mm_add_ps(y, _mm_mul_ps(_mm_sub_ps(toY, y), weight));
+    z = _mm_add_ps(z, _mm_mul_ps(_mm_sub_ps(toZ, z), weight));
+    w = _mm_add_ps(w, _mm_mul_ps(_mm_sub_ps(toW, w), weight));
+
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+    x = _mm_div_ps(x, length), y = _mm_div_ps(y, length), z = _mm_div_ps(z, length), w = _mm_div_ps(w, length);
+}
+
+// Converts 4 signed 16 bit keys to floats
+static inline __m128 LoadSigned(const int16_t *keys)
+{
+    __m128i values = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(keys));
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16));
+}
+
+// Converts 4 unsigned 16 bit keys to floats
+static inline __m128 LoadUnsigned(const uint16_t *keys)
+{
+    __m128i values = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(keys));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, _mm_setzero_si128()));
+}
+#else
+//   Nlerp interpolates a quaternion and normalizes it:
+// - 4 float& for the rotation at weight 0 and the result
+// - 4 float for the rotation at weight 1
+// - float for the weight
+static inline void Nlerp(float &x, float &y, float &z, float &w, float toX, float toY, float toZ, float toW, float weight)
+{
+    // q and -q are the same rotation, the one on the side of the first takes the short way
+    if (x * toX + y * toY + z * toZ + w * toW < 0.0f)
+    {
+        toX = -toX, toY = -toY, toZ = -toZ, toW = -toW;
+    }
+
+    x = x + (toX - x) * weight;
+    y = y + (toY - y) * weight;
+    z = z + (toZ - z) * weight;
+    w = w + (toW - w) * weight;
+
+    float length = std::sqrt(x * x + y * y + z * z + w * w);
+    x = x / length, y = y / length, z = z / length, w = w / length;
+}
+#endif
+
+AnimationClip::AnimationClip(size_t boneCount, float sampleRate, const std::vector<glm::quat> &rotations, const std::vector<glm::vec3> &translations)
+    : mBoneCount(boneCount), mPaddedCount((boneCount + 3) & ~size_t(3)), mFrameCount(0), mSampleRate(sampleRate)
+{
+    if (boneCount == 0 || rotations.size() % boneCount != 0 || translations.size() != rotations.size())
+    {
+        std::cout << "Animation clip has " << rotations.size() << " rotations and " << translations.size() << " translations for " << boneCount << " bones" << std::endl;
+        return;
+    }
+    mFrameCount = rotations.size() / boneCount;
+
+    // The padding bones keep the identity rotation and no translation
+    mRotations.assign(mFrameCount * mPaddedCount * 4, 0);
+    mTranslations.assign(mFrameCount * mPaddedCount * 3, 0);
+    mTranslationMin.assign(mPaddedCount * 3, 0.0f);
+    mTranslationStep.assign(mPaddedCount * 3, 0.0f);
+    for (size_t frame = 0; frame < mFrameCount; ++frame)
+    {
+        int16_t *keys = &mRotations[frame * mPaddedCount * 4];
+        for (size_t bone = 0; bone < mPaddedCount; ++bone)
+        {
+            glm::quat rotation = bone < boneCount ? glm::normalize(rotations[frame * boneCount + bone]) : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            glm::vec4 components = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+            for (int c = 0; c < 4; ++c)
+            {
+                keys[c * mPaddedCount + bone] = static_cast<int16_t>(std::round(std::clamp(components[c], -1.0f, 1.0f) * 32767.0f));
+            }
+        }
+    }
+
+    // Each axis of each bone's translation is spread over the 16 bits from its smallest to its largest value
+    for (size_t bone = 0; bone < boneCount; ++bone)
+    {
+        glm::vec3 minimum = translations[bone], maximum = translations[bone];
+        for (size_t frame = 1; frame < mFrameCount; ++frame)
+        {
+            minimum = glm::min(minimum, translations[frame * boneCount + bone]);
+            maximum = glm::max(maximum, translations[frame * boneCount + bone]);
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float step = (maximum[axis] - minimum[axis]) / 65535.0f;
+            mTranslationMin[axis * mPaddedCount + bone] = minimum[axis];
+            mTranslationStep[axis * mPaddedCount + bone] = step;
+            for (size_t frame = 0; frame < mFrameCount; ++frame)
+            {
+                float key = step > 0.0f ? (translations[frame * boneCount + bone][axis] - minimum[axis]) / step : 0.0f;
+                mTranslations[(frame * 3 + axis) * mPaddedCount + bone] = static_cast<uint16_t>(std::round(std::clamp(key, 0.0f, 65535.0f)));
+            }
+        }
+    }
+}
+
+AnimationClip::~AnimationClip()
+{
+    std::cout << "Delete animation clip" << std::endl;
+}
+
+void AnimationClip::Sample(float time, Pose &pose) const
+{
+    pose.Resize(mBoneCount);
+    if (mFrameCount == 0)
+    {
+        return;
+    }
+
+    // Wrap the time into the clip, the frame after the last one is the first
+    float frameCount = static_cast<float>(mFrameCount);
+    float frame = time * mSampleRate;
+    frame -= std::floor(frame / frameCount) * frameCount;
+    size_t first = std::min(static_cast<size_t>(frame), mFrameCount - 1);
+    size_t second = first + 1 < mFrameCount ? first + 1 : 0;
+    float weight = std::clamp(frame - static_cast<float>(first), 0.0f, 1.0f);
+
+    const int16_t *fromRotations = &mRotations[first * mPaddedCount * 4];
+    const int16_t *toRotations = &mRotations[second * mPaddedCount * 4];
+    const uint16_t *fromTranslations = &mTranslations[first * mPaddedCount * 3];
+    const uint16_t *toTranslations = &mTranslations[second * mPaddedCount * 3];
+    float *rotations[4] = {pose.rotationX.data(), pose.rotationY.data(), pose.rotationZ.data(), pose.rotationW.data()};
+    float *translations[3] = {pose.translationX.data(), pose.translationY.data(), pose.translationZ.data()};
+    size_t p = mPaddedCount;
+
+#ifdef ANIMATION_CLIP_SSE
+    __m128 weights = _mm_set1_ps(weight);
+    __m128 rotationStep = _mm_set1_ps(sRotationStep);
+    for (size_t b = 0; b < p; b += 4)
+    {
+        __m128 x = _mm_mul_ps(LoadSigned(fromRotations + b), rotationStep);
+        __m128 y = _mm_mul_ps(LoadSigned(fromRotations + p + b), rotationStep);
+        __m128 z = _mm_mul_ps(LoadSigned(fromRotations + p * 2 + b), rotationStep);
+        __m128 w = _mm_mul_ps(LoadSigned(fromRotations + p * 3 + b), rotationStep);
+        Nlerp(x, y, z, w, _mm_mul_ps(LoadSigned(toRotations + b), rotationStep), _mm_mul_ps(LoadSigned(toRotations + p + b), rotationStep),
+              _mm_mul_ps(LoadSigned(toRotations + p * 2 + b), rotationStep), _mm_mul_ps(LoadSigned(toRotations + p * 3 + b), rotationStep), weights);
+        _mm_storeu_ps(rotations[0] + b, x);
+        _mm_storeu_ps(rotations[1] + b, y);
+        _mm_storeu_ps(rotations[2] + b, z);
+        _mm_storeu_ps(rotations[3] + b, w);
+
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            __m128 minimum = _mm_loadu_ps(&mTranslationMin[axis * p + b]);
+            __m128 step = _mm_loadu_ps(&mTranslationStep[axis * p + b]);
+            __m128 from = _mm_add_ps(minimum, _mm_mul_ps(LoadUnsigned(fromTranslations + axis * p + b), step));
+            __m128 to = _mm_add_ps(minimum, _mm_mul_ps(LoadUnsigned(toTranslations + axis * p + b), step));
+            _mm_storeu_ps(translations[axis] + b, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), weights)));
+        }
+    }
+#else
+    for (size_t b = 0; b < p; ++b)
+    {
+        float x = fromRotations[b] * sRotationStep;
+        float y = fromRotations[p + b] * sRotationStep;
+        float z = fromRotations[p * 2 + b] * sRotationStep;
+        float w = fromRotations[p * 3 + b] * sRotationStep;
+        Nlerp(x, y, z, w, toRotations[b] * sRotationStep, toRotations[p + b] * sRotationStep, toRotations[p * 2 + b] * sRotationStep, toRotations[p * 3 + b] * sRotationStep, weight);
+        rotations[0][b] = x, rotations[1][b] = y, rotations[2][b] = z, rotations[3][b] = w;
+
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            float minimum = mTranslationMin[axis * p + b];
+            float step = mTranslationStep[axis * p + b];
+            float from = minimum + fromTranslations[axis * p + b] * step;
+            float to = minimum + toTranslations[axis * p + b] * step;
+            translations[axis][b] = from + (to - from) * weight;
+        }
+    }
+#endif
+}
+
+void AnimationClip::Blend(const Pose &from, const Pose &to, float weight, Pose &pose)
+{
+    pose.Resize(from.boneCount);
+    size_t padded = pose.rotationX.size();
+
+#ifdef ANIMATION_CLIP_SSE
+    __m128 weights = _mm_set1_ps(weight);
+    for (size_t b = 0; b < padded; b += 4)
+    {
+        __m128 x = _mm_loadu_ps(&from.rotationX[b]);
+        __m128 y = _mm_loadu_ps(&from.rotationY[b]);
+        __m128 z = _mm_loadu_ps(&from.rotationZ[b]);
+        __m128 w = _mm_loadu_ps(&from.rotationW[b]);
+        Nlerp(x, y, z, w, _mm_loadu_ps(&to.rotationX[b]), _mm_loadu_ps(&to.rotationY[b]), _mm_loadu_ps(&to.rotationZ[b]), _mm_loadu_ps(&to.rotationW[b]), weights);
+        _mm_storeu_ps(&pose.rotationX[b], x);
+        _mm_storeu_ps(&pose.rotationY[b], y);
+        _mm_storeu_ps(&pose.rotationZ[b], z);
+        _mm_storeu_ps(&pose.rotationW[b], w);
+
+        __m128 fromX = _mm_loadu_ps(&from.translationX[b]);
+        __m128 fromY = _mm_loadu_ps(&from.translationY[b]);
+        __m128 fromZ = _mm_loadu_ps(&from.translationZ[b]);
+        _mm_storeu_ps(&pose.translationX[b], _mm_add_ps(fromX, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&to.translationX[b]), fromX), weights)));
+        _mm_storeu_ps(&pose.translationY[b], _mm_add_ps(fromY, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&to.translationY[b]), fromY), weights)));
+        _mm_storeu_ps(&pose.translationZ[b], _mm_add_ps(fromZ, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&to.translationZ[b]), fromZ), weights)));
+    }
+#else
+    for (size_t b = 0; b < padded; ++b)
+    {
+        float x = from.rotationX[b], y = from.rotationY[b], z = from.rotationZ[b], w = from.rotationW[b];
+        Nlerp(x, y, z, w, to.rotationX[b], to.rotationY[b], to.rotationZ[b], to.rotationW[b], weight);
+        pose.rotationX[b] = x, pose.rotationY[b] = y, pose.rotationZ[b] = z, pose.rotationW[b] = w;
+
+        float fromX = from.translationX[b], fromY = from.translationY[b], fromZ = from.translationZ[b];
+        pose.translationX[b] = fromX + (to.translationX[b] - fromX) * weight;
+        pose.translationY[b] = fromY + (to.translationY[b] - fromY) * weight;
+        pose.translationZ[b] = fromZ + (to.translationZ[b] - fromZ) * weight;
+    }
+#endif
+}
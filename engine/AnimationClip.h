@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Transforms of every bone of a skeleton relative to its parent, as a structure of arrays padded
+// to a multiple of 4 bones so the sampling and blending move 4 bones at a time
+struct Pose
+{
+    //   Resize makes room for the bones of a skeleton:
+    // - size_t for the number of bones
+    void Resize(size_t boneCount);
+
+    size_t boneCount = 0;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> translationX, translationY, translationZ;
+};
+
+// AnimationClip holds the keyframes of an animation of a skeleton, sampled at a fixed rate so
+// the keys around a time are found without a search. The keys are quantized to 16 bits per
+// component: rotations as signed normalized quaternions, translations spread over the range
+// each bone covers in the clip. That is half the memory of floats, and a few hundred clips for
+// a crowd stay in the cache. The keys of a frame are stored like a Pose, x of every bone then
+// y and so on, so sampling decodes and interpolates 4 bones at a time with SSE.
+// Clips loop, the last key blends into the first.
+class AnimationClip
+{
+public:
+    //   AnimationClip constructor, quantizes the keyframes:
+    // - size_t for the number of bones
+    // - float for the keyframes per second
+    // - const std::vector<glm::quat>& for the rotations of every bone of every frame, frame after frame
+    // - const std::vector<glm::vec3>& for the translations in the same order
+    AnimationClip(size_t boneCount, float sampleRate, const std::vector<glm::quat> &rotations, const std::vector<glm::vec3> &translations);
+    ~AnimationClip();
+
+    // Getters for the number of bones and keyframes, and the seconds before the clip loops
+    size_t GetBoneCount() const { return mBoneCount; }
+    size_t GetFrameCount() const { return mFrameCount; }
+    float GetDuration() const { return mFrameCount / mSampleRate; }
+
+    // Getter for the bytes of the quantized keys
+    size_t GetMemorySize() const { return mRotations.size() * sizeof(int16_t) + mTranslations.size() * sizeof(uint16_t); }
+
+    //   Sample interpolates the keys around a time into a pose:
+    // - float for the time in seconds, wrapped into the clip
+    // - Pose& for the pose, resized to the clip's bones
+    void Sample(float time, Pose &pose) const;
+
+    //   Blend interpolates between two poses of the same skeleton, the output can be one of them:
+    // - const Pose& for the pose at weight 0
+    // - const Pose& for the pose at weight 1
+    // - float for the weight
+    // - Pose& for the blended pose
+    static void Blend(const Pose &from, const Pose &to, float weight, Pose &pose);
+
+private:
+    size_t mBoneCount;
+
+    // Bones rounded up to a multiple of 4
+    size_t mPaddedCount;
+    size_t mFrameCount;
+    float mSampleRate;
+
+    // Signed normalized rotations, 4 rows of mPaddedCount per frame
+    std::vector<int16_t> mRotations;
+
+    // Unsigned normalized translations, 3 rows of mPaddedCount per frame
+    std::vector<uint16_t> mTranslations;
+
+    // Smallest translation of each bone in the clip and the step of one unit of its keys, 3 rows of mPaddedCount
+    std::vector<float> mTranslationMin;
+    std::vector<float> mTranslationStep;
+};
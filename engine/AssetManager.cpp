@@ -1,9 +1,14 @@
 #include "AssetManager.h"
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include "JobSystem.h"
 
 AssetManager *AssetManager::sManager = nullptr;
 
 AssetManager::AssetManager()
+    : mShaderCache(nullptr), mTextureCache(nullptr), mTexturePacker(nullptr), mTextureResidency(nullptr), mTextureStreamer(nullptr), mMainThread(std::this_thread::get_id())
 {
     if (sManager)
     {
@@ -14,6 +19,12 @@ AssetManager::AssetManager()
         sManager = this;
         mShaderCache = new Cache<Shader>(this);
         mTextureCache = new Cache<Texture>(this);
+        mTexturePacker = new TexturePacker();
+        mTextureStreamer = new TextureStreamer();
+        if (TextureResidency::IsSupported())
+        {
+            mTextureResidency = new TextureResidency();
+        }
     }
 }
 
@@ -22,10 +33,142 @@ AssetManager::~AssetManager()
     std::cout << "Delete asset manager" << std::endl;
     sManager = nullptr;
     Clear();
+
+    delete mShaderCache;
+    delete mTextureCache;
+    delete mTexturePacker;
+    delete mTextureResidency;
+    delete mTextureStreamer;
 }
 
 void AssetManager::Clear()
 {
+    // Handles have to be non-resident before their textures are deleted
+    if (mTextureResidency)
+    {
+        mTextureResidency->Clear();
+    }
+    mTextureStreamer->Clear();
     mShaderCache->Clear();
     mTextureCache->Clear();
+    mTexturePacker->Clear();
+
+    // Free any images that were decoded but never uploaded
+    std::lock_guard<std::mutex> lock(mUploadMutex);
+    for (auto &u : mPendingUploads)
+    {
+        Texture::FreeImage(u.image);
+    }
+    mPendingUploads.clear();
+}
+
+std::shared_future<Texture *> AssetManager::LoadTextureAsync(std::string_view textureFile)
+{
+    StringId id(textureFile);
+
+    // Hold the loading lock while checking the cache so that a texture finishing
+    // its upload between the two checks can't be loaded a second time
+    std::lock_guard<std::mutex> lock(mLoadingMutex);
+
+    if (Texture *texture = mTextureCache->Get(id))
+    {
+        std::promise<Texture *> ready;
+        ready.set_value(texture);
+        return ready.get_future().share();
+    }
+
+    // Share the load that is already in flight
+    if (std::shared_future<Texture *> *loading = mLoadingTextures.Find(id))
+    {
+        return *loading;
+    }
+
+    auto promise = std::make_shared<std::promise<Texture *>>();
+    std::shared_future<Texture *> future = promise->get_future().share();
+    mLoadingTextures.Insert(id, future);
+
+    // Decode the image on a worker thread, then queue it for upload
+    std::string name(textureFile);
+    JobSystem::Get()->Schedule([this, name, promise]()
+                               {
+                                   ImageData image = Texture::DecodeImage(name);
+                                   {
+                                       std::lock_guard<std::mutex> lock(mUploadMutex);
+                                       mPendingUploads.push_back({name, image, promise});
+                                   }
+                                   mUploadCondition.notify_all(); });
+
+    return future;
+}
+
+Texture *AssetManager::WaitTexture(const std::shared_future<Texture *> &texture)
+{
+    // Other threads can't upload, they wait for the main thread to do it
+    if (std::this_thread::get_id() != mMainThread)
+    {
+        return texture.get();
+    }
+
+    while (texture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mUploadMutex);
+            mUploadCondition.wait(lock, [this]()
+                                  { return !mPendingUploads.empty(); });
+        }
+        ProcessUploads();
+    }
+    return texture.get();
+}
+
+void AssetManager::ProcessUploads()
+{
+    std::vector<PendingUpload> uploads;
+    {
+        std::lock_guard<std::mutex> lock(mUploadMutex);
+        uploads.swap(mPendingUploads);
+    }
+
+    for (auto &u : uploads)
+    {
+        Texture *texture = new Texture(u.name, u.image);
+        Texture::FreeImage(u.image);
+        mTextureStreamer->Add(texture);
+
+        // Cache the texture before it stops being tracked as loading
+        StringId id(u.name);
+        {
+            std::lock_guard<std::mutex> lock(mLoadingMutex);
+            mTextureCache->StoreCache(id, texture);
+            mLoadingTextures.Erase(id);
+        }
+        u.promise->set_value(texture);
+    }
+}
+
+std::string AssetManager::GetCachePath(std::string_view fileName)
+{
+    // The platform's cache directory of the user, or the temporary directory if there's none
+    std::filesystem::path directory;
+#ifdef _WIN32
+    if (const char *localAppData = std::getenv("LOCALAPPDATA"))
+        directory = localAppData;
+#else
+    if (const char *cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome)
+        directory = cacheHome;
+    else if (const char *home = std::getenv("HOME"); home && *home)
+        directory = std::filesystem::path(home) / ".cache";
+#endif
+    std::error_code error;
+    if (directory.empty())
+        directory = std::filesystem::temp_directory_path(error);
+    directory /= "GraphicsEngine";
+
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        std::cout << "Can't create the cache directory " << directory.string() << ": " << error.message() << std::endl;
+        return "";
+    }
+    return (directory / fileName).string();
 }
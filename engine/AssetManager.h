@@ -1,12 +1,28 @@
 #pragma once
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 #include "Cache.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "TexturePacker.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
 
 // The AssetManager is a singleton class that helps load assets on demand
 // and cache them so that subsequent loads will return the cached asset
 // instead of having to load them again. This manager provides functions
 // to help save/load assets on when needed.
+// Textures can be requested from any thread. Image decoding runs on the
+// JobSystem's worker threads, and concurrent requests for the same file
+// share a single load. The OpenGL upload of a decoded image happens on the
+// main thread whenever ProcessUploads() is called, which uploads only the
+// coarse mipmap levels and lets the TextureStreamer add the finer ones.
 class AssetManager
 {
 public:
@@ -19,15 +35,62 @@ public:
     // Returns the static AssetManager
     static AssetManager *Get() { return sManager; }
 
-    // Save/load for shader cache
-    void SaveShader(const std::string &shaderName, Shader *shader) { mShaderCache->StoreCache(shaderName, shader); }
-    Shader *LoadShader(const std::string &shaderName) { return mShaderCache->Get(shaderName); }
+    // Save/load for shader cache. Names hashed with the _id suffix are looked up without any runtime hashing
+    void SaveShader(StringId shaderName, Shader *shader) { mShaderCache->StoreCache(shaderName, shader); }
+    Shader *LoadShader(StringId shaderName) { return mShaderCache->Get(shaderName); }
 
-    // Save/load for texture cache
-    void SaveTexture(const std::string &textureName, Texture *texture) { mTextureCache->StoreCache(textureName, texture); }
-    Texture *LoadTexture(const std::string &textureName) { return mTextureCache->Get(textureName); }
+    // Save/find for texture cache. FindTexture only returns already loaded textures
+    void SaveTexture(StringId textureName, Texture *texture) { mTextureCache->StoreCache(textureName, texture); }
+    Texture *FindTexture(StringId textureName) { return mTextureCache->Get(textureName); }
+
+    //   LoadTextureAsync returns a future to a texture, starting a load on a worker
+    //   thread if the texture is not cached or already loading. Safe to call from any thread:
+    // - std::string_view for the file path of the texture
+    std::shared_future<Texture *> LoadTextureAsync(std::string_view textureFile);
+
+    //   LoadTexture returns a cached texture or loads it, blocking until it is ready.
+    //   On the main thread this processes uploads while waiting, so it never returns nullptr:
+    // - std::string_view for the file path of the texture
+    Texture *LoadTexture(std::string_view textureFile) { return WaitTexture(LoadTextureAsync(textureFile)); }
+
+    //   WaitTexture blocks until a texture future is ready and returns the texture.
+    //   On the main thread this processes uploads while waiting:
+    // - const std::shared_future<Texture*>& for the texture's future
+    Texture *WaitTexture(const std::shared_future<Texture *> &texture);
+
+    //   LoadTextureLayer loads a texture like LoadTexture and packs it into the
+    //   TextureArray of its size and format. Must be called on the main thread:
+    // - std::string_view for the file path of the texture
+    TextureLayer LoadTextureLayer(std::string_view textureFile) { return mTexturePacker->Pack(LoadTexture(textureFile)); }
+
+    // Getter for the packer that owns the texture arrays
+    TexturePacker *GetTexturePacker() { return mTexturePacker; }
+
+    // Getter for the bindless texture handles, nullptr if ARB_bindless_texture is not supported
+    TextureResidency *GetTextureResidency() { return mTextureResidency; }
+
+    // Getter for the streamer of the loaded textures' mipmap levels
+    TextureStreamer *GetTextureStreamer() { return mTextureStreamer; }
+
+    // Creates OpenGL textures for all images that finished decoding and
+    // completes their futures. Must be called on the main thread.
+    void ProcessUploads();
+
+    //   GetCachePath returns the path of a file in the user's cache directory, creating
+    //   the directory if needed. Files generated from the assets are written there instead of
+    //   next to the assets. Returns an empty string if the directory can't be created:
+    // - std::string_view for the name of the file
+    static std::string GetCachePath(std::string_view fileName);
 
 private:
+    // A decoded image that is waiting to be uploaded on the main thread
+    struct PendingUpload
+    {
+        std::string name;
+        ImageData image;
+        std::shared_ptr<std::promise<Texture *>> promise;
+    };
+
     // Singleton
     static AssetManager *sManager;
 
@@ -36,4 +99,29 @@ private:
 
     // Texture cache
     Cache<Texture> *mTextureCache;
+
+    // Texture arrays of the packed textures
+    TexturePacker *mTexturePacker;
+
+    // Bindless handles of the textures, only created when the context supports them
+    TextureResidency *mTextureResidency;
+
+    // Streams the mipmap levels of every texture loaded from a file
+    TextureStreamer *mTextureStreamer;
+
+    // Futures of textures that are currently loading, used to share a single load between requests
+    FlatMap<std::shared_future<Texture *>> mLoadingTextures;
+
+    // Mutex guarding mLoadingTextures
+    std::mutex mLoadingMutex;
+
+    // Decoded images waiting for upload
+    std::vector<PendingUpload> mPendingUploads;
+
+    // Mutex and condition variable guarding mPendingUploads
+    std::mutex mUploadMutex;
+    std::condition_variable mUploadCondition;
+
+    // The thread that owns the OpenGL context
+    std::thread::id mMainThread;
 };
@@ -0,0 +1,133 @@
+#include "AtlasAllocator.h"
+
+AtlasAllocator::AtlasAllocator(int size, int minTileSize)
+    : mSize(size), mUsedArea(0)
+{
+    int levelCount = 1;
+    while ((size >> (levelCount - 1)) > minTileSize)
+    {
+        ++levelCount;
+    }
+    mNodes.resize(levelCount);
+    for (int level = 0; level < levelCount; ++level)
+    {
+        mNodes[level].assign(static_cast<size_t>(1) << (2 * level), NodeState::Free);
+    }
+}
+
+AtlasTile AtlasAllocator::GetTile(int level, int index) const
+{
+    int width = 1 << level;
+    AtlasTile tile;
+    tile.size = mSize >> level;
+    tile.x = (index % width) * tile.size;
+    tile.y = (index / width) * tile.size;
+    tile.level = level;
+    return tile;
+}
+
+void AtlasAllocator::FindFree(int level, int index, int targetLevel, int &bestLevel, int &bestIndex) const
+{
+    NodeState state = mNodes[level][index];
+    if (state == NodeState::Free)
+    {
+        if (level > bestLevel)
+        {
+            bestLevel = level;
+            bestIndex = index;
+        }
+        return;
+    }
+    if (state == NodeState::Used || level == targetLevel)
+    {
+        return;
+    }
+
+    // Children of a node are the 2 by 2 nodes below it in the next level
+    int width = 1 << level;
+    int child = (index / width) * 2 * (width * 2) + (index % width) * 2;
+    int childIndices[4] = {child, child + 1, child + width * 2, child + width * 2 + 1};
+    for (int i = 0; i < 4 && bestLevel != targetLevel; ++i)
+    {
+        FindFree(level + 1, childIndices[i], targetLevel, bestLevel, bestIndex);
+    }
+}
+
+AtlasTile AtlasAllocator::Allocate(int size)
+{
+    // Deepest level whose nodes are still large enough
+    int targetLevel = 0;
+    while (targetLevel + 1 < static_cast<int>(mNodes.size()) && (mSize >> (targetLevel + 1)) >= size)
+    {
+        ++targetLevel;
+    }
+    if ((mSize >> targetLevel) < size)
+    {
+        return AtlasTile();
+    }
+
+    int level = -1, index = -1;
+    FindFree(0, 0, targetLevel, level, index);
+    if (level < 0)
+    {
+        return AtlasTile();
+    }
+
+    // Split the node down to the requested size, always continuing in the first child
+    while (level < targetLevel)
+    {
+        mNodes[level][index] = NodeState::Split;
+        int width = 1 << level;
+        int child = (index / width) * 2 * (width * 2) + (index % width) * 2;
+        ++level;
+        for (int c : {child, child + 1, child + width * 2, child + width * 2 + 1})
+        {
+            mNodes[level][c] = NodeState::Free;
+        }
+        index = child;
+    }
+    mNodes[level][index] = NodeState::Used;
+
+    AtlasTile tile = GetTile(level, index);
+    mUsedArea += static_cast<int64_t>(tile.size) * tile.size;
+    return tile;
+}
+
+void AtlasAllocator::Free(AtlasTile &tile)
+{
+    if (tile.level < 0)
+    {
+        return;
+    }
+    int level = tile.level;
+    int width = 1 << level;
+    int index = (tile.y / tile.size) * width + tile.x / tile.size;
+    mNodes[level][index] = NodeState::Free;
+    mUsedArea -= static_cast<int64_t>(tile.size) * tile.size;
+    tile.level = -1;
+
+    // Merge into the parent while all 4 siblings are free
+    while (level > 0)
+    {
+        width = 1 << level;
+        int first = (index / width) / 2 * 2 * width + (index % width) / 2 * 2;
+        const std::vector<NodeState> &nodes = mNodes[level];
+        if (nodes[first] != NodeState::Free || nodes[first + 1] != NodeState::Free || nodes[first + width] != NodeState::Free ||
+            nodes[first + width + 1] != NodeState::Free)
+        {
+            break;
+        }
+        index = (index / width) / 2 * (width / 2) + (index % width) / 2;
+        --level;
+        mNodes[level][index] = NodeState::Free;
+    }
+}
+
+void AtlasAllocator::Clear()
+{
+    for (auto &nodes : mNodes)
+    {
+        nodes.assign(nodes.size(), NodeState::Free);
+    }
+    mUsedArea = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A square region of an atlas handed out by an AtlasAllocator
+struct AtlasTile
+{
+    int x = 0;
+    int y = 0;
+    int size = 0;
+
+    // Depth of the tile's node in the quadtree, -1 if the tile is not allocated
+    int level = -1;
+};
+
+// AtlasAllocator packs power of two squares into a square atlas with a quadtree. Every
+// node is free, used, or split into four children of half its size. A request takes the
+// smallest free node that fits and splits it down to the requested size, so small tiles
+// fill the gaps left by earlier splits before a large node is broken up. Freeing a tile
+// merges its node back into its parent once all four siblings are free.
+class AtlasAllocator
+{
+public:
+    //   AtlasAllocator constructor:
+    // - int for the size of the atlas, a power of two
+    // - int for the size of the smallest tile, a power of two
+    AtlasAllocator(int size, int minTileSize);
+
+    //   Allocate returns a free tile of at least the given size, rounded up to a power of two.
+    //   The tile's level is -1 if the atlas has no room for it:
+    // - int for the size of the tile
+    AtlasTile Allocate(int size);
+
+    //   Free gives a tile back and merges the free nodes around it:
+    // - AtlasTile& for the tile, its level is set to -1
+    void Free(AtlasTile &tile);
+
+    // Frees every tile
+    void Clear();
+
+    // Getters for the size of the atlas and the number of texels in used tiles
+    int GetSize() const { return mSize; }
+    int64_t GetUsedArea() const { return mUsedArea; }
+
+private:
+    enum class NodeState : uint8_t
+    {
+        Free,
+        Used,
+        Split
+    };
+
+    //   FindFree searches the subtree of a node for the smallest free node at or above a level,
+    //   keeping the best one found in bestLevel and bestIndex:
+    // - int for the level and index of the node
+    // - int for the deepest level that is large enough
+    void FindFree(int level, int index, int targetLevel, int &bestLevel, int &bestIndex) const;
+
+    //   GetTile returns the tile covered by a node:
+    // - int for the level and index of the node
+    AtlasTile GetTile(int level, int index) const;
+
+    int mSize;
+
+    // States of the nodes of every level, a level has 4 times the nodes of its parent.
+    // A node's index is its row times the level's width plus its column
+    std::vector<std::vector<NodeState>> mNodes;
+
+    int64_t mUsedArea;
+};
@@ -1,12 +1,17 @@
 #pragma once
-#include <string>
-#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include "FlatMap.h"
+#include "StringId.h"
 
 class AssetManager;
 
 // Cache is a template class used by the AssetManager.
 // It helps store assets into its respective templated map
-// for on demand storing and loading.
+// for on demand storing and loading. Assets are keyed by
+// a StringId so a load is a single integer probe into a FlatMap.
+// The map is guarded by a reader/writer lock so assets can be
+// stored and looked up from worker threads.
 template <class T>
 class Cache
 {
@@ -23,23 +28,23 @@ public:
 
     //   StoreCache takes in a key value pair that stores
     //   into the templated asset's asset map
-    // - const std::string& for the key name
+    // - StringId for the key name
     // - T* for the templated asset
-    void StoreCache(const std::string &key, T *asset)
+    void StoreCache(StringId key, T *asset)
     {
-        if (mAssetMap.find(key) == mAssetMap.end())
-        {
-            mAssetMap[key] = asset;
-        }
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        mAssetMap.Insert(key, asset);
     }
 
     //   Get() returns a templated cached asset by name
-    // - const std::string& for the asset's key
-    T *Get(const std::string &name)
+    // - StringId for the asset's key
+    T *Get(StringId name)
     {
-        if (mAssetMap.find(name) != mAssetMap.end())
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        T **asset = mAssetMap.Find(name);
+        if (asset)
         {
-            return mAssetMap[name];
+            return *asset;
         }
         return nullptr;
     }
@@ -47,17 +52,19 @@ public:
     // Clears each element in the asset map
     void Clear()
     {
-        for (auto a : mAssetMap)
-        {
-            delete a.second;
-        }
-        mAssetMap.clear();
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        mAssetMap.ForEach([](T *a)
+                          { delete a; });
+        mAssetMap.Clear();
     }
 
 private:
     // Pointer to a static AssetManager
     AssetManager *mManager;
 
-    // Unordered map for the cached assets
-    std::unordered_map<std::string, T *> mAssetMap;
+    // Open-addressing map for the cached assets
+    FlatMap<T *> mAssetMap;
+
+    // Reader/writer lock for the asset map
+    std::shared_mutex mMutex;
 };
@@ -0,0 +1,220 @@
+#include "CascadedShadows.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "JobSystem.h"
+#include "RenderObj.h"
+
+// Uniform binding of the sun and texture unit of the cascades in shaders/lighting.glsl
+static const unsigned int sParamsBinding = 1;
+static const int sShadowUnit = 5;
+
+// How far towards the sun from a cascade's sphere objects still cast into it
+static const float sCasterDistance = 50.0f;
+
+// Blend from uniform to logarithmic split distances, logarithmic keeps the texel size on screen even
+static const float sSplitBlend = 0.75f;
+
+// Sun layout of the SunParams uniform buffer (std140)
+struct GpuSunParams
+{
+    glm::mat4 worldToShadow[CascadedShadows::sMaxCascades];
+    // View depth each cascade reaches, and the world size of its texels
+    glm::vec4 splits;
+    glm::vec4 texelSizes;
+    // Direction the light travels in, w is the number of cascades
+    glm::vec4 direction;
+    glm::vec4 color;
+};
+
+CascadedShadows::CascadedShadows(int cascadeCount, int size, float shadowDistance)
+    : mCascadeCount(std::clamp(cascadeCount, 1, static_cast<int>(sMaxCascades))), mSize(size), mShadowDistance(shadowDistance), mSunDirection(0.0f, -1.0f, 0.0f),
+      mSunColor(0.0f), mLightView(1.0f), mTextureID(0), mFramebufferID(0), mParamsBufferID(0)
+{
+    for (int i = 0; i < sMaxCascades; ++i)
+    {
+        mCascadeMin[i] = glm::vec3(0.0f);
+        mCascadeMax[i] = glm::vec3(0.0f);
+        mCascadeViewProj[i] = glm::mat4(1.0f);
+    }
+
+    // Linear filtering of a comparison averages the 4 nearest results
+    glGenTextures(1, &mTextureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, size, size, mCascadeCount);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Depth only framebuffer, each cascade's layer is attached while it is rendered
+    glGenFramebuffers(1, &mFramebufferID);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenBuffers(1, &mParamsBufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, mParamsBufferID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuSunParams), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+CascadedShadows::~CascadedShadows()
+{
+    std::cout << "Delete cascaded shadows" << std::endl;
+
+    glDeleteTextures(1, &mTextureID);
+    glDeleteFramebuffers(1, &mFramebufferID);
+    glDeleteBuffers(1, &mParamsBufferID);
+}
+
+void CascadedShadows::SetSun(const glm::vec3 &direction, const glm::vec3 &color)
+{
+    mSunDirection = glm::normalize(direction);
+    mSunColor = color;
+
+    // Any up vector works as long as it isn't parallel to the sun
+    glm::vec3 up = std::abs(mSunDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    mLightView = glm::lookAt(glm::vec3(0.0f), mSunDirection, up);
+}
+
+void CascadedShadows::CullCascade(int cascade, const std::vector<RenderObj *> &objects, const std::vector<glm::vec4> &spheres)
+{
+    std::vector<RenderObj *> &casters = mCasters[cascade];
+    casters.clear();
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        // Objects without bounds are always drawn
+        if (spheres[i].w >= 0.0f)
+        {
+            glm::vec3 center = glm::vec3(mLightView * glm::vec4(glm::vec3(spheres[i]), 1.0f));
+            glm::vec3 outside = glm::max(mCascadeMin[cascade] - center, center - mCascadeMax[cascade]);
+            if (glm::max(outside.x, glm::max(outside.y, outside.z)) > spheres[i].w)
+            {
+                continue;
+            }
+        }
+        casters.emplace_back(objects[i]);
+    }
+}
+
+void CascadedShadows::Update(const glm::mat4 &view, const glm::mat4 &projection, const std::vector<RenderObj *> &objects)
+{
+    // Near and far plane distance of the perspective projection
+    float nearDistance = projection[3][2] / (projection[2][2] - 1.0f);
+    float farDistance = std::min(projection[3][2] / (projection[2][2] + 1.0f), mShadowDistance);
+
+    // Squared tangent of the angle between the view axis and a corner of the frustum
+    float cornerSlope = 1.0f / (projection[0][0] * projection[0][0]) + 1.0f / (projection[1][1] * projection[1][1]);
+    glm::mat4 inverseView = glm::inverse(view);
+
+    GpuSunParams params = {};
+    float sliceNear = nearDistance;
+    for (int i = 0; i < mCascadeCount; ++i)
+    {
+        float t = static_cast<float>(i + 1) / mCascadeCount;
+        float sliceFar = glm::mix(nearDistance + (farDistance - nearDistance) * t, nearDistance * std::pow(farDistance / nearDistance, t), sSplitBlend);
+
+        // Smallest sphere around the slice, its center is on the view axis where the near and
+        // far corners are equally far, or at the far plane when the slice is wide
+        float centerDepth = std::min((sliceNear + sliceFar) * 0.5f * (1.0f + cornerSlope), sliceFar);
+        float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + sliceFar * sliceFar * cornerSlope);
+        // Rounding up keeps rounding errors from resizing the cascade from frame to frame
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // Moving the cascade by whole texels keeps its texels on the same world positions
+        float texelSize = 2.0f * radius / mSize;
+        glm::vec3 center = glm::vec3(mLightView * inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+        center.x = std::floor(center.x / texelSize) * texelSize;
+        center.y = std::floor(center.y / texelSize) * texelSize;
+
+        // Light space looks down -z, the casters between the cascade and the sun are at larger z
+        mCascadeMin[i] = center - glm::vec3(radius);
+        mCascadeMax[i] = center + glm::vec3(radius, radius, radius + sCasterDistance);
+        glm::mat4 ortho = glm::ortho(mCascadeMin[i].x, mCascadeMax[i].x, mCascadeMin[i].y, mCascadeMax[i].y, -mCascadeMax[i].z, -mCascadeMin[i].z);
+        mCascadeViewProj[i] = ortho * mLightView;
+
+        glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+        params.worldToShadow[i] = bias * mCascadeViewProj[i];
+        params.splits[i] = sliceFar;
+        params.texelSizes[i] = texelSize;
+        sliceNear = sliceFar;
+    }
+    params.direction = glm::vec4(mSunDirection, static_cast<float>(mCascadeCount));
+    params.color = glm::vec4(mSunColor, 1.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, mParamsBufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GpuSunParams), &params);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Each cascade culls the objects on its own job
+    std::vector<glm::vec4> spheres(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        spheres[i] = objects[i]->GetBoundingSphere();
+    }
+    JobSystem *jobs = JobSystem::Get();
+    if (jobs)
+    {
+        jobs->ParallelFor(mCascadeCount, 1, [this, &objects, &spheres](size_t begin, size_t end)
+                          {
+                              for (size_t cascade = begin; cascade < end; ++cascade)
+                              {
+                                  CullCascade(static_cast<int>(cascade), objects, spheres);
+                              } });
+    }
+    else
+    {
+        for (int cascade = 0; cascade < mCascadeCount; ++cascade)
+        {
+            CullCascade(cascade, objects, spheres);
+        }
+    }
+
+    // Remember the framebuffer, viewport and fill mode the frame is drawn with
+    int previousFramebuffer = 0;
+    int previousViewport[4];
+    int polygonMode[2];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
+    glViewport(0, 0, mSize, mSize);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    // Push the depth away from the sun along the slope of each triangle against shadow acne
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    for (int i = 0; i < mCascadeCount; ++i)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTextureID, 0, i);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        RenderObj::SetDepthViewProj(mCascadeViewProj[i]);
+        for (auto o : mCasters[i])
+        {
+            o->DrawDepth();
+        }
+    }
+
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 0, 0, 0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void CascadedShadows::Bind()
+{
+    glActiveTexture(GL_TEXTURE0 + sShadowUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glActiveTexture(GL_TEXTURE0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, sParamsBinding, mParamsBufferID);
+}
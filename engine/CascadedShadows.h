@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+class RenderObj;
+
+// CascadedShadows lights the scene with a sun and its cascaded shadow maps. The view
+// frustum up to the shadow distance is cut into 2 to 4 slices, close slices shorter than
+// far ones, and each slice gets its own orthographic shadow map from the sun, so the
+// shadow's texels are small near the camera and large far away. A cascade covers the
+// bounding sphere of its slice, which does not change as the camera turns, and its origin
+// is snapped to whole texels, so shadow edges don't shimmer as the camera moves.
+// Every cascade culls the objects against its own box on the JobSystem's workers, all
+// cascades in parallel, and draws the casters it kept with the depth only shaders.
+// Shaders that include shaders/lighting.glsl read the sun from uniform binding 1 and
+// the cascades from texture unit 5.
+class CascadedShadows
+{
+public:
+    // Most cascades a sun can have
+    static const int sMaxCascades = 4;
+
+    //   CascadedShadows constructor, creates the shadow maps. Must be called on the main thread:
+    // - int for the number of cascades, clamped to 1 to sMaxCascades
+    // - int for the size of each cascade's shadow map in texels
+    // - float for the distance from the camera the shadows reach
+    CascadedShadows(int cascadeCount = 4, int size = 2048, float shadowDistance = 60.0f);
+    ~CascadedShadows();
+
+    //   SetSun sets the sun's light:
+    // - const glm::vec3& for the direction the light travels in
+    // - const glm::vec3& for the color times intensity
+    void SetSun(const glm::vec3 &direction, const glm::vec3 &color);
+
+    //   Update fits the cascades to this frame's camera, culls the objects for every cascade
+    //   and renders their shadow maps. Called once per frame after the objects moved:
+    // - const glm::mat4& for the camera's view matrix
+    // - const glm::mat4& for the camera's perspective projection matrix
+    // - const std::vector<RenderObj*>& for the objects that cast shadows
+    void Update(const glm::mat4 &view, const glm::mat4 &projection, const std::vector<RenderObj *> &objects);
+
+    // Binds the sun and the shadow maps read by shaders/lighting.glsl
+    void Bind();
+
+    // Getters for the number of cascades and the objects each one drew in the last Update
+    int GetCascadeCount() const { return mCascadeCount; }
+    size_t GetCasterCount(int cascade) const { return mCasters[cascade].size(); }
+
+private:
+    //   CullCascade keeps the objects that can cast a shadow into a cascade:
+    // - int for the cascade
+    // - const std::vector<RenderObj*>& for the objects
+    // - const std::vector<glm::vec4>& for the world bounding sphere of each object
+    void CullCascade(int cascade, const std::vector<RenderObj *> &objects, const std::vector<glm::vec4> &spheres);
+
+    int mCascadeCount;
+    int mSize;
+    float mShadowDistance;
+
+    glm::vec3 mSunDirection;
+    glm::vec3 mSunColor;
+
+    // Sun's rotation, light space looks down -z along the sun's direction
+    glm::mat4 mLightView;
+
+    // Light space bounds of each cascade, min corner in xyz and max corner
+    glm::vec3 mCascadeMin[sMaxCascades];
+    glm::vec3 mCascadeMax[sMaxCascades];
+    glm::mat4 mCascadeViewProj[sMaxCascades];
+
+    // Objects each cascade draws
+    std::vector<RenderObj *> mCasters[sMaxCascades];
+
+    // Array texture with a layer per cascade, framebuffer to render its layers and uniform buffer of the sun
+    unsigned int mTextureID;
+    unsigned int mFramebufferID;
+    unsigned int mParamsBufferID;
+};
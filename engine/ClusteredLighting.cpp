@@ -0,0 +1,425 @@
+#include "ClusteredLighting.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glad/glad.h>
+#include "AssetManager.h"
+#include "JobSystem.h"
+#include "Shader.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLUSTERED_LIGHTING_SSE
+#endif
+
+// Clusters along the width, height and depth of the view frustum, 16 by 9 tiles fit a 16:9 screen
+static const int sClusterCountX = 16;
+static const int sClusterCountY = 9;
+static const int sClusterCountZ = 24;
+
+// A cluster keeps at most this many lights, the lights with the lowest indices
+static const uint32_t sMaxLightsPerCluster = 128;
+
+// Work group size of shaders/lightClusterCS.glsl
+static const unsigned int sClusterGroupSize = 64;
+
+// Uniform buffer binding and storage buffer bindings of shaders/lighting.glsl and shaders/lightClusterCS.glsl
+static const unsigned int sParamsBinding = 0;
+static const unsigned int sLightBinding = 4;
+static const unsigned int sRangeBinding = 5;
+static const unsigned int sIndexBinding = 6;
+static const unsigned int sGridBinding = 7;
+
+// Layout of the LightingParams uniform block (std140)
+struct LightingParams
+{
+    uint32_t clusterCount[3];
+    uint32_t lightCount;
+    float near;
+    float far;
+    float sliceScale;
+    float sliceBias;
+    float tileSize[4];
+    glm::vec4 ambient;
+};
+
+// Light layout of the Lights storage buffer (std430)
+struct GpuLight
+{
+    glm::vec4 positionRadius;
+
+    // Color times intensity, w is the light's shadow slot or -1
+    glm::vec4 color;
+};
+
+// Header of the ClusterGrid storage buffer (std430), followed by the min and max corner of every cluster
+struct GpuGridHeader
+{
+    uint32_t indexCount;
+    uint32_t clusterCount;
+    uint32_t maxLightsPerCluster;
+    uint32_t pad;
+};
+
+bool ClusteredLighting::sUseCompute = false;
+
+// Grows a buffer to hold at least size bytes by doubling its capacity, then writes the data at its start
+static void UploadBuffer(GLenum target, unsigned int bufferID, size_t &capacity, const void *data, size_t size)
+{
+    glBindBuffer(target, bufferID);
+    if (size > capacity)
+    {
+        while (capacity < size)
+        {
+            capacity *= 2;
+        }
+        glBufferData(target, capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (data && size > 0)
+    {
+        glBufferSubData(target, 0, size, data);
+    }
+    glBindBuffer(target, 0);
+}
+
+ClusteredLighting::ClusteredLighting()
+    : mAmbient(0.0f), mProjection(0.0f), mWidth(0), mHeight(0), mNear(0.0f), mFar(0.0f), mSliceScale(0.0f), mSliceBias(0.0f), mTileWidth(1), mTileHeight(1),
+      mParamsBufferID(0), mLightBufferID(0), mRangeBufferID(0), mIndexBufferID(0), mLightCapacity(sizeof(GpuLight) * 64), mRangeCapacity(sizeof(uint32_t) * 2 * 64),
+      mIndexCapacity(sizeof(uint32_t) * 1024), mGridBufferID(0), mGridDirty(true)
+{
+    glGenBuffers(1, &mParamsBufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, mParamsBufferID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightingParams), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // The storage buffers start small and double when they are full, a buffer is never empty so it can always be bound
+    unsigned int *buffers[] = {&mLightBufferID, &mRangeBufferID, &mIndexBufferID};
+    size_t capacities[] = {mLightCapacity, mRangeCapacity, mIndexCapacity};
+    for (int i = 0; i < 3; ++i)
+    {
+        glGenBuffers(1, buffers[i]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacities[i], nullptr, GL_DYNAMIC_DRAW);
+    }
+    glGenBuffers(1, &mGridBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    mSliceIndices.resize(sClusterCountZ);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+    std::cout << "Delete clustered lighting" << std::endl;
+
+    glDeleteBuffers(1, &mParamsBufferID);
+    glDeleteBuffers(1, &mLightBufferID);
+    glDeleteBuffers(1, &mRangeBufferID);
+    glDeleteBuffers(1, &mIndexBufferID);
+    glDeleteBuffers(1, &mGridBufferID);
+}
+
+size_t ClusteredLighting::AddLight(const PointLight &light)
+{
+    mLights.emplace_back(light);
+    mShadowSlots.emplace_back(-1);
+    return mLights.size() - 1;
+}
+
+void ClusteredLighting::UpdateClusters(const glm::mat4 &projection, int width, int height)
+{
+    if (projection == mProjection && width == mWidth && height == mHeight)
+    {
+        return;
+    }
+    mProjection = projection;
+    mWidth = width;
+    mHeight = height;
+
+    // Planes of a perspective projection: [2][2] = -(f + n) / (f - n) and [3][2] = -2fn / (f - n)
+    mNear = projection[3][2] / (projection[2][2] - 1.0f);
+    mFar = projection[3][2] / (projection[2][2] + 1.0f);
+
+    // Slice of a depth d is floor(log(d) * scale + bias), every slice covers the same ratio of depths
+    float logRatio = std::log(mFar / mNear);
+    mSliceScale = sClusterCountZ / logRatio;
+    mSliceBias = -sClusterCountZ * std::log(mNear) / logRatio;
+
+    mTileWidth = std::max((width + sClusterCountX - 1) / sClusterCountX, 1);
+    mTileHeight = std::max((height + sClusterCountY - 1) / sClusterCountY, 1);
+
+    size_t clusterCount = static_cast<size_t>(sClusterCountX) * sClusterCountY * sClusterCountZ;
+    mClusterMin.resize(clusterCount);
+    mClusterMax.resize(clusterCount);
+    mSliceNear.resize(sClusterCountZ);
+    mSliceFar.resize(sClusterCountZ);
+
+    // Points on the near plane through the corners of the tiles
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    std::vector<glm::vec3> corners((sClusterCountX + 1) * (sClusterCountY + 1));
+    for (int y = 0; y <= sClusterCountY; ++y)
+    {
+        for (int x = 0; x <= sClusterCountX; ++x)
+        {
+            glm::vec4 ndc = glm::vec4(2.0f * x * mTileWidth / width - 1.0f, 2.0f * y * mTileHeight / height - 1.0f, -1.0f, 1.0f);
+            glm::vec4 point = inverseProjection * ndc;
+            corners[y * (sClusterCountX + 1) + x] = glm::vec3(point) / point.w;
+        }
+    }
+
+    for (int z = 0; z < sClusterCountZ; ++z)
+    {
+        mSliceNear[z] = mNear * std::pow(mFar / mNear, static_cast<float>(z) / sClusterCountZ);
+        mSliceFar[z] = mNear * std::pow(mFar / mNear, static_cast<float>(z + 1) / sClusterCountZ);
+        for (int y = 0; y < sClusterCountY; ++y)
+        {
+            for (int x = 0; x < sClusterCountX; ++x)
+            {
+                // Bounds of the tile's 4 corner rays where they cross the slice's near and far depths
+                glm::vec3 boundsMin = glm::vec3(1e30f);
+                glm::vec3 boundsMax = glm::vec3(-1e30f);
+                for (int corner = 0; corner < 4; ++corner)
+                {
+                    const glm::vec3 &ray = corners[(y + corner / 2) * (sClusterCountX + 1) + x + corner % 2];
+                    for (float depth : {mSliceNear[z], mSliceFar[z]})
+                    {
+                        glm::vec3 point = ray * (depth / -ray.z);
+                        boundsMin = glm::min(boundsMin, point);
+                        boundsMax = glm::max(boundsMax, point);
+                    }
+                }
+                size_t cluster = (static_cast<size_t>(z) * sClusterCountY + y) * sClusterCountX + x;
+                mClusterMin[cluster] = boundsMin;
+                mClusterMax[cluster] = boundsMax;
+            }
+        }
+    }
+    mGridDirty = true;
+}
+
+void ClusteredLighting::BinSlice(size_t slice)
+{
+    std::vector<uint32_t> &indices = mSliceIndices[slice];
+    indices.clear();
+
+    // Lights that reach into the slice's depth range, found four at a time
+    std::vector<uint32_t> candidates;
+    float sliceNear = mSliceNear[slice];
+    float sliceFar = mSliceFar[slice];
+    for (size_t base = 0; base < mLightX.size(); base += 4)
+    {
+        int mask = 0;
+#ifdef CLUSTERED_LIGHTING_SSE
+        __m128 depth = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&mLightZ[base]));
+        __m128 radius = _mm_loadu_ps(&mLightRadius[base]);
+        mask = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(depth, radius), _mm_set1_ps(sliceNear)),
+                                          _mm_cmple_ps(_mm_sub_ps(depth, radius), _mm_set1_ps(sliceFar))));
+#else
+        for (size_t j = 0; j < 4; ++j)
+        {
+            float depth = -mLightZ[base + j];
+            mask |= (depth + mLightRadius[base + j] >= sliceNear && depth - mLightRadius[base + j] <= sliceFar) << j;
+        }
+#endif
+        for (size_t j = 0; j < 4; ++j)
+        {
+            if (mask & (1 << j))
+            {
+                candidates.push_back(static_cast<uint32_t>(base + j));
+            }
+        }
+    }
+
+    // Candidate spheres as structure of arrays, padded with spheres that touch nothing
+    size_t paddedCount = (candidates.size() + 3) & ~size_t(3);
+    std::vector<float> cx(paddedCount, 1e18f), cy(paddedCount, 0.0f), cz(paddedCount, 0.0f), cr(paddedCount, 0.0f);
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        cx[i] = mLightX[candidates[i]], cy[i] = mLightY[candidates[i]], cz[i] = mLightZ[candidates[i]];
+        cr[i] = mLightRadius[candidates[i]] * mLightRadius[candidates[i]];
+    }
+
+    size_t firstCluster = slice * sClusterCountX * sClusterCountY;
+    for (size_t cluster = firstCluster; cluster < firstCluster + sClusterCountX * sClusterCountY; ++cluster)
+    {
+        const glm::vec3 &boundsMin = mClusterMin[cluster];
+        const glm::vec3 &boundsMax = mClusterMax[cluster];
+        uint32_t offset = static_cast<uint32_t>(indices.size());
+        uint32_t count = 0;
+        for (size_t base = 0; base < paddedCount && count < sMaxLightsPerCluster; base += 4)
+        {
+            // A sphere touches the bounds if the closest point of the bounds is within its radius
+            int mask = 0;
+#ifdef CLUSTERED_LIGHTING_SSE
+            __m128 x = _mm_loadu_ps(&cx[base]);
+            __m128 y = _mm_loadu_ps(&cy[base]);
+            __m128 z = _mm_loadu_ps(&cz[base]);
+            __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.x), x), _mm_sub_ps(x, _mm_set1_ps(boundsMax.x))), _mm_setzero_ps());
+            __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.y), y), _mm_sub_ps(y, _mm_set1_ps(boundsMax.y))), _mm_setzero_ps());
+            __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.z), z), _mm_sub_ps(z, _mm_set1_ps(boundsMax.z))), _mm_setzero_ps());
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(&cr[base])));
+#else
+            for (size_t j = 0; j < 4; ++j)
+            {
+                glm::vec3 center = glm::vec3(cx[base + j], cy[base + j], cz[base + j]);
+                glm::vec3 delta = glm::max(glm::max(boundsMin - center, center - boundsMax), glm::vec3(0.0f));
+                mask |= (glm::dot(delta, delta) <= cr[base + j]) << j;
+            }
+#endif
+            for (size_t j = 0; j < 4 && count < sMaxLightsPerCluster; ++j)
+            {
+                if (mask & (1 << j))
+                {
+                    indices.push_back(candidates[base + j]);
+                    ++count;
+                }
+            }
+        }
+        mRanges[cluster * 2] = offset;
+        mRanges[cluster * 2 + 1] = count;
+    }
+}
+
+void ClusteredLighting::Update(const glm::mat4 &view, const glm::mat4 &projection, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+    UpdateClusters(projection, width, height);
+    size_t clusterCount = GetClusterCount();
+
+    // Lights in world space for the shading, the clusters are tested in view space
+    std::vector<GpuLight> gpuLights(mLights.size());
+    for (size_t i = 0; i < mLights.size(); ++i)
+    {
+        const PointLight &light = mLights[i];
+        gpuLights[i] = {glm::vec4(light.position, light.radius), glm::vec4(light.color * light.intensity, static_cast<float>(mShadowSlots[i]))};
+    }
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, mLightBufferID, mLightCapacity, gpuLights.data(), gpuLights.size() * sizeof(GpuLight));
+
+    LightingParams params;
+    params.clusterCount[0] = sClusterCountX, params.clusterCount[1] = sClusterCountY, params.clusterCount[2] = sClusterCountZ;
+    params.lightCount = static_cast<uint32_t>(mLights.size());
+    params.near = mNear, params.far = mFar;
+    params.sliceScale = mSliceScale, params.sliceBias = mSliceBias;
+    params.tileSize[0] = static_cast<float>(mTileWidth), params.tileSize[1] = static_cast<float>(mTileHeight);
+    params.tileSize[2] = 0.0f, params.tileSize[3] = 0.0f;
+    params.ambient = glm::vec4(mAmbient, 0.0f);
+    glBindBuffer(GL_UNIFORM_BUFFER, mParamsBufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(params), &params);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (sUseCompute)
+    {
+        BinLightsCompute(view);
+        return;
+    }
+
+    // View space spheres, padded with spheres that touch nothing
+    size_t paddedCount = (mLights.size() + 3) & ~size_t(3);
+    mLightX.assign(paddedCount, 0.0f), mLightY.assign(paddedCount, 0.0f), mLightZ.assign(paddedCount, 1e18f);
+    mLightRadius.assign(paddedCount, 0.0f);
+    for (size_t i = 0; i < mLights.size(); ++i)
+    {
+        glm::vec3 center = glm::vec3(view * glm::vec4(mLights[i].position, 1.0f));
+        mLightX[i] = center.x, mLightY[i] = center.y, mLightZ[i] = center.z;
+        mLightRadius[i] = mLights[i].radius;
+    }
+
+    // Each slice is binned by its own job into its own list
+    mRanges.resize(clusterCount * 2);
+    JobSystem *jobs = JobSystem::Get();
+    if (jobs)
+    {
+        jobs->ParallelFor(sClusterCountZ, 1, [this](size_t begin, size_t end)
+                          {
+                              for (size_t slice = begin; slice < end; ++slice)
+                              {
+                                  BinSlice(slice);
+                              } });
+    }
+    else
+    {
+        for (size_t slice = 0; slice < sClusterCountZ; ++slice)
+        {
+            BinSlice(slice);
+        }
+    }
+
+    // The clusters of a slice follow each other, so the lists are joined slice by slice
+    mIndices.clear();
+    size_t clustersPerSlice = static_cast<size_t>(sClusterCountX) * sClusterCountY;
+    for (size_t slice = 0; slice < sClusterCountZ; ++slice)
+    {
+        uint32_t sliceOffset = static_cast<uint32_t>(mIndices.size());
+        for (size_t cluster = slice * clustersPerSlice; cluster < (slice + 1) * clustersPerSlice; ++cluster)
+        {
+            mRanges[cluster * 2] += sliceOffset;
+        }
+        mIndices.insert(mIndices.end(), mSliceIndices[slice].begin(), mSliceIndices[slice].end());
+    }
+
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, mRangeBufferID, mRangeCapacity, mRanges.data(), mRanges.size() * sizeof(uint32_t));
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, mIndexBufferID, mIndexCapacity, mIndices.data(), mIndices.size() * sizeof(uint32_t));
+}
+
+void ClusteredLighting::BinLightsCompute(const glm::mat4 &view)
+{
+    // The bin shader is owned by the AssetManager
+    AssetManager *am = AssetManager::Get();
+    Shader *binShader = am->LoadShader("lightCluster"_id);
+    if (!binShader)
+    {
+        binShader = new Shader("shaders/lightClusterCS.glsl");
+        am->SaveShader("lightCluster"_id, binShader);
+    }
+
+    // Room for every cluster's range and the longest lists, the GPU never reports how many indices it wrote
+    size_t clusterCount = GetClusterCount();
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, mRangeBufferID, mRangeCapacity, nullptr, clusterCount * 2 * sizeof(uint32_t));
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, mIndexBufferID, mIndexCapacity, nullptr, clusterCount * sMaxLightsPerCluster * sizeof(uint32_t));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mGridBufferID);
+    if (mGridDirty)
+    {
+        std::vector<glm::vec4> bounds(clusterCount * 2);
+        for (size_t i = 0; i < clusterCount; ++i)
+        {
+            bounds[i * 2] = glm::vec4(mClusterMin[i], 0.0f);
+            bounds[i * 2 + 1] = glm::vec4(mClusterMax[i], 0.0f);
+        }
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuGridHeader) + bounds.size() * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuGridHeader), bounds.size() * sizeof(glm::vec4), bounds.data());
+        mGridDirty = false;
+    }
+    // The shader reserves each cluster's indices by counting up from zero
+    GpuGridHeader header = {0, static_cast<uint32_t>(clusterCount), sMaxLightsPerCluster, 0};
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), &header);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Remember the current shader, the bin shader replaces it while dispatching
+    int currentShader = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentShader);
+
+    Bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sGridBinding, mGridBufferID);
+
+    binShader->SetActive();
+    binShader->SetMat4("view"_id, view);
+    binShader->SetUInt("lightCount"_id, static_cast<unsigned int>(mLights.size()));
+    glDispatchCompute(static_cast<GLuint>((clusterCount + sClusterGroupSize - 1) / sClusterGroupSize), 1, 1);
+
+    // Make the lists visible to the fragment shaders
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(currentShader);
+}
+
+void ClusteredLighting::Bind()
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, sParamsBinding, mParamsBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sLightBinding, mLightBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sRangeBinding, mRangeBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sIndexBinding, mIndexBufferID);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A point light, lights everything within its radius
+struct PointLight
+{
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float intensity;
+
+    // Lights that cast shadows get tiles in the ShadowAtlas
+    bool castsShadows = false;
+};
+
+// ClusteredLighting lights the scene with thousands of point lights. The view frustum is cut
+// into a grid of clusters, screen tiles split into slices that grow exponentially with depth,
+// and every frame each cluster gets the list of lights whose sphere touches its bounds.
+// Fragment shaders that include shaders/lighting.glsl find their cluster from their window
+// position and depth and only loop over that cluster's lights.
+// Binning runs on the CPU, a slice of clusters per job on the JobSystem's workers testing
+// four lights at a time with SSE. The optional compute path bins on the GPU instead, so
+// the light lists never leave video memory.
+class ClusteredLighting
+{
+public:
+    // ClusteredLighting constructor, creates the GPU buffers. Must be called on the main thread
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    //   AddLight adds a light and returns its index:
+    // - const PointLight& for the light
+    size_t AddLight(const PointLight &light);
+
+    //   SetLight replaces a light, used to move or recolor it:
+    // - size_t for the index of the light
+    // - const PointLight& for the new light
+    void SetLight(size_t index, const PointLight &light) { mLights[index] = light; }
+
+    // Getters for a light and the number of lights
+    const PointLight &GetLight(size_t index) const { return mLights[index]; }
+    size_t GetLightCount() const { return mLights.size(); }
+
+    // Removes every light
+    void ClearLights()
+    {
+        mLights.clear();
+        mShadowSlots.clear();
+    }
+
+    //   SetShadowSlot sets where the shadow of a light is in the ShadowAtlas' tiles:
+    // - size_t for the index of the light
+    // - int for the shadow's slot, -1 for a light without shadow
+    void SetShadowSlot(size_t index, int slot) { mShadowSlots[index] = slot; }
+
+    // Sets the light every surface gets without any point light
+    void SetAmbient(const glm::vec3 &ambient) { mAmbient = ambient; }
+
+    // Switches between binning the lights on the CPU and with the compute shader
+    static void SetUseCompute(bool useCompute) { sUseCompute = useCompute; }
+    static bool GetUseCompute() { return sUseCompute; }
+
+    //   Update bins the lights into the clusters of this frame's camera and uploads the lists,
+    //   called once per frame before drawing:
+    // - const glm::mat4& for the view matrix
+    // - const glm::mat4& for the perspective projection matrix
+    // - int for the width and height of the framebuffer in pixels
+    void Update(const glm::mat4 &view, const glm::mat4 &projection, int width, int height);
+
+    // Binds the uniform and storage buffers read by shaders/lighting.glsl
+    void Bind();
+
+    // Getters for the number of clusters, and the offset and count in the light indices
+    // of each cluster and the light indices of the last CPU binning
+    size_t GetClusterCount() const { return mClusterMin.size(); }
+    const std::vector<uint32_t> &GetClusterRanges() const { return mRanges; }
+    const std::vector<uint32_t> &GetLightIndices() const { return mIndices; }
+
+private:
+    //   UpdateClusters computes the view space bounds of every cluster when the projection or size changed:
+    // - const glm::mat4& for the projection matrix
+    // - int for the width and height of the framebuffer in pixels
+    void UpdateClusters(const glm::mat4 &projection, int width, int height);
+
+    //   BinSlice writes the light lists of every cluster of a slice, with offsets from the start of the slice:
+    // - size_t for the slice
+    void BinSlice(size_t slice);
+
+    //   BinLightsCompute bins the lights with the compute shader into the storage buffers:
+    // - const glm::mat4& for the view matrix
+    void BinLightsCompute(const glm::mat4 &view);
+
+    std::vector<PointLight> mLights;
+    glm::vec3 mAmbient;
+
+    // Shadow slot of each light, -1 for no shadow
+    std::vector<int> mShadowSlots;
+
+    // Projection and framebuffer size the clusters were computed for
+    glm::mat4 mProjection;
+    int mWidth;
+    int mHeight;
+
+    // Near and far plane distance, and the scale and bias from log(depth) to the slice
+    float mNear;
+    float mFar;
+    float mSliceScale;
+    float mSliceBias;
+
+    // Tile size in pixels
+    int mTileWidth;
+    int mTileHeight;
+
+    // View space bounds of each cluster, and the depth range of each slice
+    std::vector<glm::vec3> mClusterMin;
+    std::vector<glm::vec3> mClusterMax;
+    std::vector<float> mSliceNear;
+    std::vector<float> mSliceFar;
+
+    // View space light spheres as structure of arrays, padded to a multiple of 4 lights
+    std::vector<float> mLightX, mLightY, mLightZ, mLightRadius;
+
+    // Light indices found by each slice's job
+    std::vector<std::vector<uint32_t>> mSliceIndices;
+
+    // Offset and count pairs of each cluster, and the light indices they point into
+    std::vector<uint32_t> mRanges;
+    std::vector<uint32_t> mIndices;
+
+    // Uniform buffer of the grid parameters, and storage buffers of the lights, ranges and indices
+    unsigned int mParamsBufferID;
+    unsigned int mLightBufferID;
+    unsigned int mRangeBufferID;
+    unsigned int mIndexBufferID;
+    size_t mLightCapacity;
+    size_t mRangeCapacity;
+    size_t mIndexCapacity;
+
+    // Cluster bounds and index counter of the compute shader, rewritten when the clusters change
+    unsigned int mGridBufferID;
+    bool mGridDirty;
+
+    static bool sUseCompute;
+};
@@ -2,12 +2,37 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "AssetManager.h"
+#include "MeshOptimizer.h"
+#include "OcclusionCuller.h"
 #include "VertexBuffer.h"
 #include "Shader.h"
 #include "Texture.h"
 #include <iostream>
 
+// Corners and triangles of the cube for occlusion culling
+static const glm::vec3 sOccluderPositions[] = {glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f),
+                                               glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f)};
+static const uint32_t sOccluderIndices[] = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 4, 2, 2, 4, 6,
+                                            1, 3, 5, 3, 7, 5, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7};
+
 Cube::Cube() : RenderObj()
+{
+    mBoundsMin = glm::vec3(-0.5f);
+    mBoundsMax = glm::vec3(0.5f);
+
+    mVertexBuffer = CreateVertexBuffer();
+
+    // Every face maps the whole texture onto a unit square
+    mUvDensity = 1.0f;
+
+    AssetManager *am = AssetManager::Get();
+
+    // Load or get the cached textures, waiting on any loads still in flight
+    mTextures.emplace_back(am->LoadTexture("assets/textures/container.jpg"));
+    mTextures.emplace_back(am->LoadTexture("assets/textures/awesomeface.png"));
+}
+
+VertexBuffer *Cube::CreateVertexBuffer()
 {
     VertexTexture vertices[] = {glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec2(0.0f, 0.0f),
                                 glm::vec3(0.5f, -0.5f, -0.5f), glm::vec2(1.0f, 0.0f),
@@ -51,12 +76,22 @@ Cube::Cube() : RenderObj()
                                 glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec2(0.0f, 0.0f),
                                 glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec2(0.0f, 1.0f)};
 
-    mVertexBuffer = new VertexBuffer(vertices, 0, sizeof(vertices), 0, sizeof(vertices) / sizeof(VertexTexture), 0, Vertex::VertexTexture);
-
-    AssetManager *am = AssetManager::Get();
+    // Weld the duplicate corners into an index buffer and optimize the triangle/vertex order
+    std::vector<unsigned char> bytes(reinterpret_cast<unsigned char *>(vertices), reinterpret_cast<unsigned char *>(vertices) + sizeof(vertices));
+    std::vector<uint32_t> indices;
+    size_t vertexCount = MeshOptimizer::Optimize(bytes, indices, sizeof(VertexTexture), "cube");
+    std::vector<uint16_t> shortIndices = MeshOptimizer::To16BitIndices(indices);
+
+    // Quantize the welded vertices to half float positions and 16-bit uvs (12 bytes instead of 20)
+    const VertexTexture *optimized = reinterpret_cast<const VertexTexture *>(bytes.data());
+    std::vector<VertexPackedTexture> packed;
+    packed.reserve(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        packed.push_back({HalfPosition(optimized[i].pos), UNormUV(optimized[i].uv)});
+    }
 
-    mTextures.emplace_back(am->LoadTexture("assets/textures/container.jpg"));
-    mTextures.emplace_back(am->LoadTexture("assets/textures/awesomeface.png"));
+    return new VertexBuffer(packed.data(), packed.size(), shortIndices.data(), shortIndices.size());
 }
 
 Cube::~Cube()
@@ -96,18 +131,16 @@ void Cube::Draw()
         mTextures[i]->SetActive();
     }
 
-    //   Query the location of uniform containing the model matrix in shader:
-    // - Supply with shader program
-    // - the name of the uniform
-    int modelLoc = glGetUniformLocation(mShader->GetID(), "model");
-
-    //   Send model matrix to GPU using glUniform with Matrix4fv as postfix:
-    // - Take the uniform's location
-    // - The number of matrices to send
-    // - Transpose matrix (column-major or row-major). GLM uses column by default (GL_FALSE)
-    // - The actual matrix data converted with glm::value_ptr
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(mModel));
+    //   Send model matrix to GPU. The uniform's location is looked up
+    //   by its compile time hashed name instead of glGetUniformLocation
+    mShader->SetMat4("model"_id, mModel);
+    mShader->SetMat4("previousModel"_id, mPreviousModel);
 
     // Draw the vertex buffer
     mVertexBuffer->Draw();
 }
+
+void Cube::AddOccluder(OcclusionCuller *culler)
+{
+    culler->AddOccluder(sOccluderPositions, sOccluderIndices, sizeof(sOccluderIndices) / sizeof(uint32_t), mModel);
+}
@@ -10,6 +10,10 @@ public:
 
     void Update(float deltaTime) override;
     void Draw() override;
+    void AddOccluder(OcclusionCuller *culler) override;
+
+    // Creates the vertex buffer of a unit cube centered on the origin, owned by the caller
+    static VertexBuffer *CreateVertexBuffer();
 
 private:
 };
\ No newline at end of file
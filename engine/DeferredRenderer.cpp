@@ -0,0 +1,108 @@
+#include "DeferredRenderer.h"
+#include <iostream>
+#include <glad/glad.h>
+#include "AssetManager.h"
+#include "RenderGraph.h"
+#include "Shader.h"
+
+// Texture units the lighting shader reads the G-buffer from
+static const int sAlbedoUnit = 0;
+static const int sNormalUnit = 1;
+static const int sDepthUnit = 2;
+
+DeferredRenderer::DeferredRenderer()
+    : mVertexArrayID(0)
+{
+    // Core profile draws need a vertex array even without attributes
+    glGenVertexArrays(1, &mVertexArrayID);
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    std::cout << "Delete deferred renderer" << std::endl;
+
+    glDeleteVertexArrays(1, &mVertexArrayID);
+}
+
+void DeferredRenderer::AddPasses(RenderGraph &graph, int targetColor, int targetDepth, int motion, int width, int height, const std::function<void()> &drawObjects, const glm::mat4 &viewProj)
+{
+    // Every target is read with texelFetch, one texel per pixel
+    int albedo = graph.CreateTexture("gAlbedo", width, height, GL_RGBA8);
+    int normal = graph.CreateTexture("gNormal", width, height, GL_RG16_SNORM);
+    int depth = graph.CreateTexture("gDepth", width, height, GL_DEPTH24_STENCIL8);
+
+    // The graph binds the G-buffer, cleared to no surface
+    size_t geometryPass = graph.AddPass("G-buffer", [drawObjects]()
+                                        {
+                                            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                                            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+                                            drawObjects(); });
+    graph.Write(geometryPass, albedo);
+    graph.Write(geometryPass, normal);
+    if (motion >= 0)
+    {
+        graph.Write(geometryPass, motion);
+    }
+    graph.Write(geometryPass, depth);
+
+    size_t lightingPass = graph.AddPass("Deferred lighting", [this, &graph, albedo, normal, depth, width, height, viewProj]()
+                                        { Light(graph, albedo, normal, depth, width, height, viewProj); });
+    graph.Read(lightingPass, albedo);
+    graph.Read(lightingPass, normal);
+    graph.Read(lightingPass, depth);
+    graph.Write(lightingPass, targetColor);
+    if (targetDepth != targetColor)
+    {
+        graph.Write(lightingPass, targetDepth);
+    }
+}
+
+void DeferredRenderer::Light(RenderGraph &graph, int albedo, int normal, int depth, int width, int height, const glm::mat4 &viewProj)
+{
+    // The lighting shader is owned by the AssetManager like the other shaders
+    AssetManager *am = AssetManager::Get();
+    Shader *lightingShader = am->LoadShader("deferredLighting"_id);
+    if (!lightingShader)
+    {
+        lightingShader = new Shader("shaders/fullscreenVS.glsl", "shaders/deferredLightingFS.glsl");
+        lightingShader->SetActive();
+        lightingShader->SetInt("gAlbedo"_id, sAlbedoUnit);
+        lightingShader->SetInt("gNormal"_id, sNormalUnit);
+        lightingShader->SetInt("gDepth"_id, sDepthUnit);
+        am->SaveShader("deferredLighting"_id, lightingShader);
+    }
+
+    // Copy the depth to the target the graph bound, pixels without depth keep the clear color
+    int framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, graph.GetFramebuffer({depth}));
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // The full screen triangle is always filled and neither tests nor writes depth
+    int polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE0 + sAlbedoUnit);
+    glBindTexture(GL_TEXTURE_2D, graph.GetTexture(albedo));
+    glActiveTexture(GL_TEXTURE0 + sNormalUnit);
+    glBindTexture(GL_TEXTURE_2D, graph.GetTexture(normal));
+    glActiveTexture(GL_TEXTURE0 + sDepthUnit);
+    glBindTexture(GL_TEXTURE_2D, graph.GetTexture(depth));
+
+    lightingShader->SetActive();
+    lightingShader->SetMat4("inverseViewProj"_id, glm::inverse(viewProj));
+    glBindVertexArray(mVertexArrayID);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0 + sDepthUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <functional>
+#include <glm/glm.hpp>
+
+class RenderGraph;
+
+// DeferredRenderer draws the objects into a G-buffer and lights every pixel once afterwards,
+// so scenes with a lot of overdraw only pay for the lighting of the surfaces that are seen.
+// The G-buffer is kept small: RGBA8 albedo, the normal folded into two snorm16 channels with
+// an octahedral encoding, and the depth, from which the lighting pass rebuilds positions.
+// The lighting pass reads the light lists of ClusteredLighting, so each pixel is shaded by the
+// lights of its cluster and the cost grows with pixels times the lights that touch them.
+// Objects draw into the G-buffer with their usual shaders compiled with "#define DEFERRED".
+// The G-buffer lives in the frame's RenderGraph, which hands its memory to later passes.
+class DeferredRenderer
+{
+public:
+    // DeferredRenderer constructor
+    DeferredRenderer();
+    ~DeferredRenderer();
+
+    //   AddPasses adds the G-buffer and lighting passes to a frame's render graph. The G-buffer
+    //   textures are transient, their memory goes back to the graph's pool once they are lit.
+    //   The lighting pass copies the depth to the target, so anything drawn forward
+    //   afterwards is still depth tested:
+    // - RenderGraph& for the frame's graph
+    // - int for the color and depth resources that are lit, both the backbuffer to light it
+    // - int for the motion resource the G-buffer pass writes too, or -1 for none
+    // - int for the width and height of the target in pixels
+    // - const std::function<void()>& draws the objects into the bound G-buffer
+    // - const glm::mat4& for the view projection matrix the objects are drawn with
+    void AddPasses(RenderGraph &graph, int targetColor, int targetDepth, int motion, int width, int height, const std::function<void()> &drawObjects, const glm::mat4 &viewProj);
+
+private:
+    //   Light draws the lit G-buffer into the bound target:
+    // - RenderGraph& for the frame's graph
+    // - int for the albedo, normal and depth resources
+    // - int for the width and height in pixels
+    // - const glm::mat4& for the view projection matrix the G-buffer was drawn with
+    void Light(RenderGraph &graph, int albedo, int normal, int depth, int width, int height, const glm::mat4 &viewProj);
+
+    // Vertex array of the full screen triangle, which has no vertex buffer
+    unsigned int mVertexArrayID;
+};
@@ -0,0 +1,137 @@
+#include "DepthPrepass.h"
+#include <iostream>
+#include <glad/glad.h>
+#include "RenderObj.h"
+
+// Frames of each choice a measurement of Auto mode times
+static const int sMeasureFrames = 16;
+
+// Frames between measurements of Auto mode, the scene may have changed by then
+static const int sMeasureInterval = 600;
+
+DepthPrepass::DepthPrepass(Mode mode)
+    : mMode(mode), mEnabled(false), mAutoEnabled(false), mFramesUntilMeasure(0), mMeasuredWith(0), mMeasuredWithout(0), mSumWith(0.0), mSumWithout(0.0),
+      mTimeWith(0.0f), mTimeWithout(0.0f), mQueryIndex(0), mMeasuring(false), mTiming(false)
+{
+    glGenQueries(sQueryCount, mQueryIDs);
+    for (int i = 0; i < sQueryCount; ++i)
+    {
+        mQueryWith[i] = false;
+        mQueryPending[i] = false;
+    }
+}
+
+DepthPrepass::~DepthPrepass()
+{
+    std::cout << "Delete depth prepass" << std::endl;
+
+    glDeleteQueries(sQueryCount, mQueryIDs);
+}
+
+void DepthPrepass::ReadQueries()
+{
+    for (int i = 0; i < sQueryCount; ++i)
+    {
+        if (!mQueryPending[i])
+        {
+            continue;
+        }
+        int available = 0;
+        glGetQueryObjectiv(mQueryIDs[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(mQueryIDs[i], GL_QUERY_RESULT, &nanoseconds);
+        mQueryPending[i] = false;
+        if (mQueryWith[i])
+        {
+            mSumWith += static_cast<double>(nanoseconds);
+            ++mMeasuredWith;
+        }
+        else
+        {
+            mSumWithout += static_cast<double>(nanoseconds);
+            ++mMeasuredWithout;
+        }
+    }
+}
+
+void DepthPrepass::Begin(const std::vector<RenderObj *> &objects, const glm::mat4 &viewProj)
+{
+    ReadQueries();
+
+    if (mMode == Mode::Auto)
+    {
+        if (mMeasuring && mMeasuredWith >= sMeasureFrames && mMeasuredWithout >= sMeasureFrames)
+        {
+            // Keep the faster choice until the next measurement
+            mTimeWith = static_cast<float>(mSumWith / mMeasuredWith * 1e-6);
+            mTimeWithout = static_cast<float>(mSumWithout / mMeasuredWithout * 1e-6);
+            mAutoEnabled = mTimeWith < mTimeWithout;
+            mMeasuring = false;
+            mFramesUntilMeasure = sMeasureInterval;
+        }
+        else if (!mMeasuring && --mFramesUntilMeasure <= 0)
+        {
+            mMeasuring = true;
+            mMeasuredWith = mMeasuredWithout = 0;
+            mSumWith = mSumWithout = 0.0;
+        }
+
+        // Alternate the choices while measuring, so both see the same scene
+        if (mMeasuring)
+        {
+            mAutoEnabled = !mAutoEnabled;
+        }
+    }
+    else
+    {
+        mMeasuring = false;
+    }
+
+    // A query still waiting for its result can't be reused, that frame is not timed
+    mTiming = mMeasuring && !mQueryPending[mQueryIndex];
+    if (mTiming)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, mQueryIDs[mQueryIndex]);
+    }
+
+    mEnabled = mMode == Mode::On || (mMode == Mode::Auto && mAutoEnabled);
+    if (!mEnabled)
+    {
+        return;
+    }
+
+    // Only depth is written, the fragment shader does nothing
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    RenderObj::SetDepthViewProj(viewProj);
+    for (auto o : objects)
+    {
+        o->DrawDepth();
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // Shade only the surfaces that won the depth test of the pre-pass
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+}
+
+void DepthPrepass::End()
+{
+    if (mEnabled)
+    {
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+
+    if (mTiming)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        mQueryWith[mQueryIndex] = mEnabled;
+        mQueryPending[mQueryIndex] = true;
+        mQueryIndex = (mQueryIndex + 1) % sQueryCount;
+        mTiming = false;
+    }
+}
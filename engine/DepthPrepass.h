@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+class RenderObj;
+
+// DepthPrepass draws the depth of the opaque objects with the position only shaders before
+// they are shaded, with color writes off. The shading pass then tests against that depth
+// with GL_LEQUAL and without depth writes, so every pixel runs the full fragment shader
+// once no matter how many surfaces overlap it. The vertex shaders of both passes declare
+// gl_Position invariant, so a surface's shaded fragments have the exact depth it wrote.
+// A pre-pass pays off with heavy fragment shaders and a lot of overdraw, and costs a second
+// geometry pass otherwise. In Auto mode the GPU time of the geometry is measured with timer
+// queries with and without the pre-pass every few seconds, and the faster one is kept.
+class DepthPrepass
+{
+public:
+    enum class Mode
+    {
+        Off,
+        On,
+        Auto
+    };
+
+    //   DepthPrepass constructor, creates the timer queries. Must be called on the main thread:
+    // - Mode for whether the pre-pass is drawn
+    DepthPrepass(Mode mode = Mode::Auto);
+    ~DepthPrepass();
+
+    // Setters and getters for the mode, and whether the current frame draws the pre-pass
+    void SetMode(Mode mode) { mMode = mode; }
+    Mode GetMode() const { return mMode; }
+    bool IsEnabled() const { return mEnabled; }
+
+    //   Begin starts timing the frame's geometry and draws the depth of the objects if the
+    //   pre-pass is enabled, leaving the depth test set up for the shading pass:
+    // - const std::vector<RenderObj*>& for the objects that are drawn this frame
+    // - const glm::mat4& for the view projection matrix
+    void Begin(const std::vector<RenderObj *> &objects, const glm::mat4 &viewProj);
+
+    // End restores the depth test and stops timing, called after the objects are shaded
+    void End();
+
+    // Getters for the average GPU time in milliseconds of the geometry with and without
+    // the pre-pass over the last measurement of Auto mode
+    float GetTimeWith() const { return mTimeWith; }
+    float GetTimeWithout() const { return mTimeWithout; }
+
+private:
+    //   ReadQueries collects the results of the timer queries that finished
+    void ReadQueries();
+
+    Mode mMode;
+    bool mEnabled;
+
+    // Choice of Auto mode, and the frames until it is measured again
+    bool mAutoEnabled;
+    int mFramesUntilMeasure;
+
+    // Frames measured so far of each choice, and their summed times in nanoseconds
+    int mMeasuredWith;
+    int mMeasuredWithout;
+    double mSumWith;
+    double mSumWithout;
+    float mTimeWith;
+    float mTimeWithout;
+
+    // Ring of timer queries, the GPU answers a few frames late. Each remembers if its frame drew the pre-pass
+    static const int sQueryCount = 4;
+    unsigned int mQueryIDs[sQueryCount];
+    bool mQueryWith[sQueryCount];
+    bool mQueryPending[sQueryCount];
+    int mQueryIndex;
+
+    // True while a measurement of Auto mode runs, and if the current frame is timed
+    bool mMeasuring;
+    bool mTiming;
+};
@@ -0,0 +1,135 @@
+#include "DepthPyramid.h"
+#include <algorithm>
+#include <iostream>
+#include "AssetManager.h"
+#include "Shader.h"
+
+// Work group size of shaders/depthPyramidCS.glsl on each axis
+static const int sReduceGroupSize = 8;
+
+// Size of level 0 for a framebuffer size: half of it rounded up to a power of two, so that
+// halving each level matches the mip sizes of OpenGL and every texel keeps covering
+// twice the pixels of a texel of the level below
+static int GetLevelZeroSize(int size)
+{
+    int levelSize = 1;
+    while (levelSize * 2 < size)
+    {
+        levelSize *= 2;
+    }
+    return levelSize;
+}
+
+DepthPyramid::DepthPyramid()
+    : mWidth(0), mHeight(0), mLevelWidth(0), mLevelHeight(0), mLevelCount(0), mDepthTextureID(0), mTextureID(0), mViewProj(1.0f)
+{
+}
+
+DepthPyramid::~DepthPyramid()
+{
+    std::cout << "Delete depth pyramid" << std::endl;
+
+    glDeleteTextures(1, &mDepthTextureID);
+    glDeleteTextures(1, &mTextureID);
+}
+
+void DepthPyramid::Resize(int width, int height)
+{
+    glDeleteTextures(1, &mDepthTextureID);
+    glDeleteTextures(1, &mTextureID);
+
+    mWidth = width;
+    mHeight = height;
+
+    mLevelWidth = GetLevelZeroSize(width);
+    mLevelHeight = GetLevelZeroSize(height);
+    int levelWidth = mLevelWidth, levelHeight = mLevelHeight;
+    mLevelCount = 1;
+    while (levelWidth > 1 || levelHeight > 1)
+    {
+        levelWidth = std::max(1, levelWidth / 2), levelHeight = std::max(1, levelHeight / 2);
+        ++mLevelCount;
+    }
+
+    glGenTextures(1, &mDepthTextureID);
+    glBindTexture(GL_TEXTURE_2D, mDepthTextureID);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // Immutable storage for every level, so single levels can be bound as images
+    glGenTextures(1, &mTextureID);
+    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexStorage2D(GL_TEXTURE_2D, mLevelCount, GL_R32F, mLevelWidth, mLevelHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void DepthPyramid::Build(int width, int height, const glm::mat4 &viewProj)
+{
+    // Minimized windows have no pixels
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+    if (width != mWidth || height != mHeight)
+    {
+        Resize(width, height);
+    }
+    mViewProj = viewProj;
+
+    // The reduce shader is owned by the AssetManager like the other shaders
+    AssetManager *am = AssetManager::Get();
+    Shader *reduceShader = am->LoadShader("depthPyramid"_id);
+    if (!reduceShader)
+    {
+        reduceShader = new Shader("shaders/depthPyramidCS.glsl");
+        am->SaveShader("depthPyramid"_id, reduceShader);
+    }
+
+    // Copy the depth of the framebuffer, a depth texture as target reads its depth buffer
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, mDepthTextureID);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    int drawShader = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &drawShader);
+
+    reduceShader->SetActive();
+    reduceShader->SetInt("source"_id, 0);
+
+    // Each level reduces the previous one, level 0 reduces the copied depth.
+    // Texels past the edge of the framebuffer repeat the edge and are never tested
+    int sourceWidth = width, sourceHeight = height;
+    int levelWidth = mLevelWidth, levelHeight = mLevelHeight;
+    for (int level = 0; level < mLevelCount; ++level)
+    {
+
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? mDepthTextureID : mTextureID);
+        glBindImageTexture(0, mTextureID, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        reduceShader->SetInt("sourceLevel"_id, level == 0 ? 0 : level - 1);
+        reduceShader->SetInt("sourceWidth"_id, sourceWidth);
+        reduceShader->SetInt("sourceHeight"_id, sourceHeight);
+        glDispatchCompute((levelWidth + sReduceGroupSize - 1) / sReduceGroupSize, (levelHeight + sReduceGroupSize - 1) / sReduceGroupSize, 1);
+
+        // The next level and the cull shaders read this one
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        sourceWidth = levelWidth, sourceHeight = levelHeight;
+        levelWidth = std::max(1, levelWidth / 2), levelHeight = std::max(1, levelHeight / 2);
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(drawShader);
+}
+
+void DepthPyramid::Bind(unsigned int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, mTextureID);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// DepthPyramid is a hierarchical depth buffer (Hi-Z) of the last rendered frame.
+// The depth of the default framebuffer is copied into a texture, then a compute shader
+// reduces it into a chain of mip levels where every texel holds the farthest depth of
+// the 2x2 texels under it. Level 0 is half the size of the framebuffer rounded up to a
+// power of two, so a texel of level n covers 2^(n+1) pixels on each axis. A box whose
+// nearest depth is behind the farthest depth of the few texels covering it is hidden by
+// what was drawn last frame.
+class DepthPyramid
+{
+public:
+    DepthPyramid();
+    ~DepthPyramid();
+
+    //   Build copies the depth of the framebuffer that is bound for reading and builds the
+    //   pyramid. Called after the frame is rendered, before the buffers are swapped:
+    // - int for the width of the framebuffer
+    // - int for the height of the framebuffer
+    // - const glm::mat4& for the view projection matrix the frame was rendered with
+    void Build(int width, int height, const glm::mat4 &viewProj);
+
+    //   Bind binds the pyramid's texture for texelFetch in a shader:
+    // - unsigned int for the texture unit
+    void Bind(unsigned int unit) const;
+
+    // False until the first frame is built
+    bool IsValid() const { return mTextureID != 0; }
+
+    // Getters for the framebuffer size, the size of level 0, the number of levels, and the view projection the pyramid was built with
+    int GetWidth() const { return mWidth; }
+    int GetHeight() const { return mHeight; }
+    int GetLevelWidth() const { return mLevelWidth; }
+    int GetLevelHeight() const { return mLevelHeight; }
+    int GetLevelCount() const { return mLevelCount; }
+    const glm::mat4 &GetViewProj() const { return mViewProj; }
+
+private:
+    // (Re)creates the textures for a framebuffer size
+    void Resize(int width, int height);
+
+    // Size of the framebuffer
+    int mWidth;
+    int mHeight;
+
+    // Size of level 0
+    int mLevelWidth;
+    int mLevelHeight;
+
+    int mLevelCount;
+
+    // Copy of the framebuffer's depth
+    unsigned int mDepthTextureID;
+
+    // R32F texture with the reduced levels
+    unsigned int mTextureID;
+
+    glm::mat4 mViewProj;
+};
@@ -0,0 +1,194 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glad/glad.h>
+#include "AssetManager.h"
+#include "RenderGraph.h"
+#include "Shader.h"
+
+// Share of the budget a lowered scale aims at, the timings are noisy and a few frames late
+static const float sHeadroom = 0.9f;
+
+// Frames in a row that must fit the budget at the next step before the scale rises
+static const int sRaiseFrames = 30;
+
+// Texture unit the upscale shader reads the scene from
+static const int sSceneUnit = 0;
+
+DynamicResolution::DynamicResolution(float budget, float minScale, float maxScale)
+    : mEnabled(true), mBudget(budget), mMinScale(minScale), mMaxScale(maxScale), mSharpness(0.5f), mScale(maxScale), mGpuTime(0.0f), mFramesUnderBudget(0),
+      mQueryIndex(0), mTiming(false), mSamplerID(0), mVertexArrayID(0)
+{
+    glGenQueries(sQueryCount, mBeginQueryIDs);
+    glGenQueries(sQueryCount, mEndQueryIDs);
+    for (int i = 0; i < sQueryCount; ++i)
+    {
+        mQueryScale[i] = 1.0f;
+        mQueryPending[i] = false;
+    }
+
+    glGenSamplers(1, &mSamplerID);
+    glSamplerParameteri(mSamplerID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(mSamplerID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(mSamplerID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(mSamplerID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Core profile draws need a vertex array even without attributes
+    glGenVertexArrays(1, &mVertexArrayID);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    std::cout << "Delete dynamic resolution" << std::endl;
+
+    glDeleteQueries(sQueryCount, mBeginQueryIDs);
+    glDeleteQueries(sQueryCount, mEndQueryIDs);
+    glDeleteSamplers(1, &mSamplerID);
+    glDeleteVertexArrays(1, &mVertexArrayID);
+}
+
+void DynamicResolution::SetScaleRange(float minScale, float maxScale)
+{
+    mMinScale = minScale;
+    mMaxScale = maxScale;
+    mScale = std::clamp(mScale, minScale, maxScale);
+    mFramesUnderBudget = 0;
+}
+
+void DynamicResolution::ReadQueries()
+{
+    // Oldest first, so the newest finished frame is the one kept
+    for (int k = 0; k < sQueryCount; ++k)
+    {
+        int i = (mQueryIndex + k) % sQueryCount;
+        if (!mQueryPending[i])
+        {
+            continue;
+        }
+        int available = 0;
+        glGetQueryObjectiv(mEndQueryIDs[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            continue;
+        }
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(mBeginQueryIDs[i], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(mEndQueryIDs[i], GL_QUERY_RESULT, &end);
+        mQueryPending[i] = false;
+
+        // Most of a frame's time goes to its pixels, which grow with the square of the scale
+        float ratio = GetScale() / mQueryScale[i];
+        mGpuTime = static_cast<float>(static_cast<double>(end - begin) * 1e-6) * ratio * ratio;
+
+        if (!mEnabled)
+        {
+            continue;
+        }
+        if (mGpuTime > mBudget)
+        {
+            // Drop at once to the step whose pixels fit the budget
+            float fit = mScale * std::sqrt(mBudget * sHeadroom / mGpuTime);
+            mScale = std::clamp(std::floor(fit / sScaleStep + 1e-3f) * sScaleStep, mMinScale, mMaxScale);
+            mFramesUnderBudget = 0;
+            continue;
+        }
+
+        // Rise a step once the frames would have fit the budget at it for a while
+        float next = std::min(std::round(mScale / sScaleStep + 1.0f) * sScaleStep, mMaxScale);
+        float growth = next / mScale;
+        if (next > mScale && mGpuTime * growth * growth < mBudget * sHeadroom)
+        {
+            if (++mFramesUnderBudget >= sRaiseFrames)
+            {
+                mScale = next;
+                mFramesUnderBudget = 0;
+            }
+        }
+        else
+        {
+            mFramesUnderBudget = 0;
+        }
+    }
+}
+
+void DynamicResolution::BeginFrame()
+{
+    ReadQueries();
+
+    // A query still waiting for its result can't be reused, that frame is not timed
+    mTiming = !mQueryPending[mQueryIndex];
+    if (mTiming)
+    {
+        glQueryCounter(mBeginQueryIDs[mQueryIndex], GL_TIMESTAMP);
+    }
+}
+
+void DynamicResolution::EndFrame()
+{
+    if (mTiming)
+    {
+        glQueryCounter(mEndQueryIDs[mQueryIndex], GL_TIMESTAMP);
+        mQueryScale[mQueryIndex] = GetScale();
+        mQueryPending[mQueryIndex] = true;
+        mQueryIndex = (mQueryIndex + 1) % sQueryCount;
+        mTiming = false;
+    }
+}
+
+void DynamicResolution::GetRenderSize(int width, int height, int &renderWidth, int &renderHeight) const
+{
+    float scale = GetScale();
+    renderWidth = std::max(1, static_cast<int>(width * scale + 0.5f));
+    renderHeight = std::max(1, static_cast<int>(height * scale + 0.5f));
+}
+
+void DynamicResolution::AddUpscalePass(RenderGraph &graph, int sceneColor, int backbuffer, int renderWidth, int renderHeight)
+{
+    size_t upscalePass = graph.AddPass("Upscale", [this, &graph, sceneColor, renderWidth, renderHeight]()
+                                       { Upscale(graph.GetTexture(sceneColor), renderWidth, renderHeight); });
+    graph.Read(upscalePass, sceneColor);
+    graph.Write(upscalePass, backbuffer);
+}
+
+void DynamicResolution::Upscale(unsigned int sceneTexture, int renderWidth, int renderHeight)
+{
+    // The upscale shader is owned by the AssetManager like the other shaders
+    AssetManager *am = AssetManager::Get();
+    Shader *upscaleShader = am->LoadShader("upscale"_id);
+    if (!upscaleShader)
+    {
+        upscaleShader = new Shader("shaders/fullscreenVS.glsl", "shaders/upscaleFS.glsl");
+        upscaleShader->SetActive();
+        upscaleShader->SetInt("scene"_id, sSceneUnit);
+        am->SaveShader("upscale"_id, upscaleShader);
+    }
+
+    // The graph set the viewport to the backbuffer
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // The full screen triangle is always filled and neither tests nor writes depth
+    int polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE0 + sSceneUnit);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glBindSampler(sSceneUnit, mSamplerID);
+
+    // Sharpen as much as the image was stretched, a scene at full size is copied as is
+    float stretch = std::max(static_cast<float>(viewport[2]) / renderWidth, static_cast<float>(viewport[3]) / renderHeight);
+    upscaleShader->SetActive();
+    upscaleShader->SetVec2("outputSize"_id, glm::vec2(static_cast<float>(viewport[2]), static_cast<float>(viewport[3])));
+    upscaleShader->SetFloat("sharpness"_id, mSharpness * std::clamp((stretch - 1.0f) * 2.0f, 0.0f, 1.0f));
+    glBindVertexArray(mVertexArrayID);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBindSampler(sSceneUnit, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
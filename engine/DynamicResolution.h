@@ -0,0 +1,102 @@
+#pragma once
+
+class RenderGraph;
+
+// DynamicResolution renders the scene below the window's resolution when the GPU can't
+// keep up, and scales it back up to the window with a sharpening filter. Every frame's
+// GPU time is measured with a pair of timestamp queries, which unlike time elapsed
+// queries can overlap the DepthPrepass' measurements. The results arrive a few frames
+// late and are corrected for the scale their frame was drawn at. A frame over the budget
+// lowers the scale right away, far enough that the pixels drawn fit the budget, so load
+// spikes cost resolution instead of frames. The scale only rises a step at a time after
+// the frames stayed well under the budget for a while, so it doesn't oscillate.
+// The scale moves in steps of sScaleStep, so the render graph's pooled targets of a scale
+// are reused instead of recreated each frame. The scene's targets are transient textures
+// of the frame's render graph; the upscale pass writes the backbuffer, so anything drawn
+// after it, such as the UI, is drawn at the window's resolution.
+class DynamicResolution
+{
+public:
+    // Steps the scale moves in
+    static constexpr float sScaleStep = 0.05f;
+
+    //   DynamicResolution constructor, creates the timer queries. Must be called on the main thread:
+    // - float for the GPU time budget of a frame in milliseconds
+    // - float for the lowest and highest scale of the window's width and height
+    DynamicResolution(float budget = 1000.0f / 60.0f, float minScale = 0.5f, float maxScale = 1.0f);
+    ~DynamicResolution();
+
+    // Setters and getters for whether the scene is rendered at the dynamic scale, the budget
+    // in milliseconds and the strength of the sharpening, 0 is a plain bilinear upscale
+    void SetEnabled(bool enabled) { mEnabled = enabled; }
+    bool IsEnabled() const { return mEnabled; }
+    void SetBudget(float budget) { mBudget = budget; }
+    float GetBudget() const { return mBudget; }
+    void SetSharpness(float sharpness) { mSharpness = sharpness; }
+
+    //   SetScaleRange sets the lowest and highest scale, the current one is moved into the range:
+    // - float for the lowest and highest scale of the window's width and height
+    void SetScaleRange(float minScale, float maxScale);
+    float GetSharpness() const { return mSharpness; }
+
+    // Getters for the current scale, 1 when disabled, and the last measured GPU time in milliseconds
+    float GetScale() const { return mEnabled ? mScale : 1.0f; }
+    float GetGpuTime() const { return mGpuTime; }
+
+    //   BeginFrame reads the timings that arrived, picks the frame's scale and starts timing
+    //   the frame. Called before the frame's first GPU work
+    void BeginFrame();
+
+    //   EndFrame stops timing the frame, called after its last GPU work
+    void EndFrame();
+
+    //   GetRenderSize returns the size the scene is rendered at this frame:
+    // - int for the width and height of the window in pixels
+    // - int& for the width and height of the scene in pixels
+    void GetRenderSize(int width, int height, int &renderWidth, int &renderHeight) const;
+
+    //   AddUpscalePass adds the pass that scales the scene up to the backbuffer:
+    // - RenderGraph& for the frame's graph
+    // - int for the resource of the scene's color
+    // - int for the backbuffer resource
+    // - int for the width and height of the scene in pixels
+    void AddUpscalePass(RenderGraph &graph, int sceneColor, int backbuffer, int renderWidth, int renderHeight);
+
+private:
+    //   ReadQueries collects the timings of the frames the GPU finished
+    void ReadQueries();
+
+    //   Upscale draws the scene's color into the bound backbuffer:
+    // - unsigned int for the scene's color texture
+    // - int for the width and height of the scene in pixels
+    void Upscale(unsigned int sceneTexture, int renderWidth, int renderHeight);
+
+    bool mEnabled;
+    float mBudget;
+    float mMinScale;
+    float mMaxScale;
+    float mSharpness;
+    float mScale;
+
+    // Last measured GPU time corrected to the current scale, and the frames in a row
+    // that came in well under the budget
+    float mGpuTime;
+    int mFramesUnderBudget;
+
+    // Ring of begin and end timestamps, the GPU answers a few frames late.
+    // Each remembers the scale its frame was drawn at
+    static const int sQueryCount = 4;
+    unsigned int mBeginQueryIDs[sQueryCount];
+    unsigned int mEndQueryIDs[sQueryCount];
+    float mQueryScale[sQueryCount];
+    bool mQueryPending[sQueryCount];
+    int mQueryIndex;
+
+    // True if the current frame is timed
+    bool mTiming;
+
+    // Linear sampler for the scene's color, pooled targets are nearest filtered,
+    // and the vertex array of the full screen triangle
+    unsigned int mSamplerID;
+    unsigned int mVertexArrayID;
+};
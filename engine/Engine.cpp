@@ -2,24 +2,51 @@
 #include <iostream>
 #include <cmath>
 #include <chrono>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "AnimatedCrowd.h"
 #include "AssetManager.h"
+#include "CascadedShadows.h"
+#include "ClusteredLighting.h"
+#include "DeferredRenderer.h"
+#include "DepthPrepass.h"
+#include "DynamicResolution.h"
+#include "JobSystem.h"
 #include "Shader.h"
 #include "Texture.h"
 #include "VertexFormats.h"
 #include "VertexBuffer.h"
 #include "RenderObj.h"
 #include "Cube.h"
+#include "DepthPyramid.h"
+#include "InstanceCuller.h"
+#include "InstancedMesh.h"
+#include "LodSelector.h"
+#include "Mannequin.h"
+#include "MeshImporter.h"
+#include "MeshletCuller.h"
+#include "Model.h"
+#include "OcclusionCuller.h"
+#include "PageFile.h"
+#include "ParticleSystem.h"
+#include "RenderGraph.h"
+#include "ShadowAtlas.h"
+#include "TemporalUpsampler.h"
+#include "Terrain.h"
+#include "TransparencyRenderer.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
+#include "VirtualTexture.h"
 
 // Define a window's dimensions
 #define WIDTH 1280
 #define HEIGHT 720
 
 Engine::Engine()
-    : mWindow(nullptr), mAssetManager(nullptr), // vBuffer(nullptr),
-      mTimer(0.0f), mFps(0), mIsWireFrame(false), mWirePrev(false)
+    : mWindow(nullptr), mJobSystem(nullptr), mAssetManager(nullptr), mOcclusionCuller(nullptr), mDepthPyramid(nullptr), mDeferredRenderer(nullptr), mTransparencyRenderer(nullptr), mDepthPrepass(nullptr), mRenderGraph(nullptr), mDynamicResolution(nullptr), mTemporalUpsampler(nullptr), mLighting(nullptr), mShadowAtlas(nullptr), mCascadedShadows(nullptr), mParticleSystem(nullptr), mCrowd(nullptr), // vBuffer(nullptr),
+      mCrowdSwitchAccumulator(0.0f), mCrowdSwitchCount(0), mView(1.0f), mViewProj(1.0f), mTimer(0.0f), mFps(0), mIsWireFrame(false), mWirePrev(false), mComputeCullPrev(false), mComputeLightPrev(false), mPrepassPrev(false), mResolutionPrev(false), mTemporalPrev(false), mParticlePrev(false)
 {
 }
 
@@ -28,7 +55,7 @@ Engine::~Engine()
     Shutdown();
 }
 
-bool Engine::Init()
+bool Engine::Init(RenderPath renderPath)
 {
     // Initialize the GLFW library
     glfwInit();
@@ -66,6 +93,9 @@ bool Engine::Init()
         return false;
     }
 
+    // Bindless textures are an extension, loaded with the same loader when the driver has them
+    TextureResidency::LoadExtension((GLADloadproc)glfwGetProcAddress);
+
     // Create viewport
     // Sets the location of lower left corner (0, 0)
     // Sets width/height of rendering window to the size of GLFW window size
@@ -89,26 +119,131 @@ bool Engine::Init()
     //     1, 2, 3  // second triangle
     // };
 
+    // JobSystem, created before the AssetManager since it loads assets on worker threads
+    mJobSystem = new JobSystem();
+
     // AssetManager
     mAssetManager = new AssetManager();
 
+    // Software occlusion culling, rasterizes occluders on the JobSystem's workers
+    mOcclusionCuller = new OcclusionCuller();
+
+    // Hi-Z of the last frame, built after each frame is rendered
+    mDepthPyramid = new DepthPyramid();
+
+    // Depth pre-pass, measures whether it pays off for the scene
+    mDepthPrepass = new DepthPrepass(DepthPrepass::Mode::Auto);
+
+    // Passes of each frame and the pool of their render targets
+    mRenderGraph = new RenderGraph();
+
+    // Renders the scene below the window's resolution when a frame takes longer than 60 fps allow
+    mDynamicResolution = new DynamicResolution(1000.0f / 60.0f, 0.5f, 1.0f);
+
+    // Reconstructs the window's resolution from jittered frames, off until toggled
+    mTemporalUpsampler = new TemporalUpsampler();
+
+    // Lights scattered over the field and the terrain, only the lights near a pixel are evaluated for it.
+    // A fixed seed keeps the same lights on every run
+    mLighting = new ClusteredLighting();
+    mLighting->SetAmbient(glm::vec3(0.35f));
+    uint32_t seed = 12345u;
+    auto random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    };
+    for (int i = 0; i < 2048; ++i)
+    {
+        PointLight light;
+        light.position = glm::vec3(-50.0f + 100.0f * random(), -3.8f + 3.0f * random(), -2.0f - 98.0f * random());
+        light.radius = 2.0f + 3.0f * random();
+        light.color = glm::vec3(0.2f + 0.8f * random(), 0.2f + 0.8f * random(), 0.2f + 0.8f * random());
+        light.intensity = 1.5f;
+        // Every 32nd light casts shadows
+        light.castsShadows = i % 32 == 0;
+        mLighting->AddLight(light);
+    }
+
+    // Lights among the cubes, so their shadows fall on each other
+    for (int i = 0; i < 4; ++i)
+    {
+        PointLight light;
+        light.position = glm::vec3(i % 2 ? 2.5f : -2.5f, i / 2 ? 1.5f : -1.5f, -3.0f);
+        light.radius = 8.0f;
+        light.color = glm::vec3(1.0f, 0.9f, 0.7f);
+        light.intensity = 4.0f;
+        light.castsShadows = true;
+        mLighting->AddLight(light);
+    }
+    mShadowAtlas = new ShadowAtlas();
+
+    // A low sun from the side, its shadows are split into cascades up to 60 units from the camera
+    mCascadedShadows = new CascadedShadows(4, 2048, 60.0f);
+    mCascadedShadows->SetSun(glm::vec3(0.4f, -1.0f, -0.6f), glm::vec3(0.5f, 0.45f, 0.4f));
+
+    // A fountain of sparks in front of the field and embers drifting up from the terrain behind it
+    mParticleSystem = new ParticleSystem(1 << 18);
+    ParticleEmitter sparks;
+    sparks.position = glm::vec3(-4.0f, -3.5f, -9.0f);
+    sparks.radius = 0.1f;
+    sparks.velocity = glm::vec3(0.0f, 7.0f, 0.0f);
+    sparks.spread = 1.5f;
+    sparks.startColor = glm::vec4(1.0f, 0.8f, 0.4f, 1.0f);
+    sparks.endColor = glm::vec4(1.0f, 0.2f, 0.0f, 0.0f);
+    sparks.startSize = 0.04f;
+    sparks.endSize = 0.02f;
+    sparks.lifetime = 2.0f;
+    sparks.drag = 0.2f;
+    sparks.rate = 80000.0f;
+    mParticleSystem->AddEmitter(sparks);
+
+    ParticleEmitter embers;
+    embers.position = glm::vec3(6.0f, -4.0f, -30.0f);
+    embers.radius = 8.0f;
+    embers.velocity = glm::vec3(0.0f, 1.5f, 0.0f);
+    embers.spread = 0.5f;
+    embers.startColor = glm::vec4(1.0f, 0.5f, 0.1f, 0.8f);
+    embers.endColor = glm::vec4(0.3f, 0.3f, 0.3f, 0.0f);
+    embers.startSize = 0.08f;
+    embers.endSize = 0.15f;
+    embers.lifetime = 4.0f;
+    embers.drag = 0.8f;
+    embers.rate = 20000.0f;
+    mParticleSystem->AddEmitter(embers);
+    mParticleSystem->SetGravity(glm::vec3(0.0f, -4.0f, 0.0f));
+
+    // The deferred path compiles the objects' shaders to write the G-buffer instead of lighting
+    const char *surfaceDefines = "";
+    if (renderPath == RenderPath::Deferred)
+    {
+        mDeferredRenderer = new DeferredRenderer();
+        surfaceDefines = "#define DEFERRED\n";
+    }
+
+    // Transparent objects are lit forward on either path and blended without sorting
+    mTransparencyRenderer = new TransparencyRenderer();
+
     // Shader
-    Shader *mShader = new Shader("shaders/texturedVS.glsl", "shaders/texturedFS.glsl");
+    Shader *mShader = new Shader("shaders/texturedVS.glsl", "shaders/texturedFS.glsl", surfaceDefines);
     mShader->SetActive();
 
     // Set each sampler to which texture unit it belongs to(only done once)
-    mShader->SetInt("textureSampler", 0);
-    mShader->SetInt("textureSampler2", 1);
+    mShader->SetInt("textureSampler"_id, 0);
+    mShader->SetInt("textureSampler2"_id, 1);
 
     // Cache/save the shader
-    mAssetManager->SaveShader("textured", mShader);
+    mAssetManager->SaveShader("textured"_id, mShader);
+
+    // Start loading the textures, both images are decoded in parallel on worker threads
+    mAssetManager->LoadTextureAsync("assets/textures/container.jpg");
+    mAssetManager->LoadTextureAsync("assets/textures/awesomeface.png");
 
-    // Create Textures
-    Texture *tex1 = new Texture("assets/textures/container.jpg");
-    Texture *tex2 = new Texture("assets/textures/awesomeface.png");
+    // Start importing the model, it is parsed on the workers while the rest of the scene is built
+    std::future<std::vector<MeshData>> torusMeshes = MeshImporter::LoadAsync("assets/models/torus.obj");
 
     // Vertex buffer
-    // vBuffer = new VertexBuffer(vertices, indices, sizeof(vertices), sizeof(indices), sizeof(vertices) / sizeof(VertexTexture), sizeof(indices) / sizeof(unsigned int), Vertex::VertexTexture);
+    // vBuffer = new VertexBuffer(vertices, sizeof(vertices) / sizeof(VertexTexture), indices, sizeof(indices) / sizeof(unsigned int));
 
     glm::vec3 cubePositions[] = {
         glm::vec3(0.0f, 0.0f, 0.0f),
@@ -127,9 +262,140 @@ bool Engine::Init()
         Cube *cube = new Cube();
         cube->SetPosition(cubePositions[i]);
         cube->SetShader(mShader);
+        // The cube in front hides the cubes behind it
+        cube->SetOccluder(i == 0);
         mObjects.emplace_back(cube);
     }
 
+    // Shader of the instanced meshes, reads the model matrix of each instance from a storage buffer
+    // and samples the textures from their bindless handles, or the texture arrays at the layers of the instance
+    const char *instancedFragmentShader = TextureResidency::IsSupported() ? "shaders/texturedBindlessFS.glsl" : "shaders/texturedArrayFS.glsl";
+    Shader *instancedShader = new Shader("shaders/instancedVS.glsl", instancedFragmentShader, surfaceDefines);
+    instancedShader->SetActive();
+    instancedShader->SetInt("textureSampler"_id, 0);
+    instancedShader->SetInt("textureSampler2"_id, 1);
+    mAssetManager->SaveShader("instanced"_id, instancedShader);
+
+    // A field of cubes below the camera, culled and drawn by the GPU in a single draw call
+    const int fieldSize = 64;
+    InstancedMesh *field = new InstancedMesh(Cube::CreateVertexBuffer(), glm::vec3(-0.5f), glm::vec3(0.5f), fieldSize * fieldSize);
+    field->SetShader(instancedShader);
+
+    // The textures have the same size, so without bindless textures they are packed into
+    // one array and the checkerboard of crates and walls still draws in a single call
+    mAssetManager->LoadTextureAsync("assets/textures/wall.jpg");
+    Texture *container = mAssetManager->LoadTexture("assets/textures/container.jpg");
+    Texture *wall = mAssetManager->LoadTexture("assets/textures/wall.jpg");
+    Texture *face = mAssetManager->LoadTexture("assets/textures/awesomeface.png");
+    for (int z = 0; z < fieldSize; ++z)
+    {
+        for (int x = 0; x < fieldSize; ++x)
+        {
+            glm::vec3 position = glm::vec3((x - fieldSize / 2) * 1.5f, -4.0f, -4.0f - z * 1.5f);
+            field->AddInstance(glm::translate(glm::mat4(1.0f), position), {(x + z) % 2 ? wall : container, face});
+        }
+    }
+    // The field and the terrain never move, so their shadows are cached
+    field->SetStatic(true);
+    mObjects.emplace_back(field);
+
+    // A row of glass crates floating between the cubes and the field, blended in any order
+    Shader *transparentShader = new Shader("shaders/instancedVS.glsl", instancedFragmentShader, "#define TRANSPARENT\n");
+    transparentShader->SetActive();
+    transparentShader->SetInt("textureSampler"_id, 0);
+    transparentShader->SetInt("textureSampler2"_id, 1);
+    transparentShader->SetFloat("opacity"_id, 0.4f);
+    mAssetManager->SaveShader("transparentInstanced"_id, transparentShader);
+
+    const int glassCount = 12;
+    InstancedMesh *glass = new InstancedMesh(Cube::CreateVertexBuffer(), glm::vec3(-0.5f), glm::vec3(0.5f), glassCount);
+    glass->SetShader(transparentShader);
+    for (int i = 0; i < glassCount; ++i)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((i - glassCount / 2) * 1.2f, -2.5f, -6.0f - (i % 3) * 0.6f));
+        glass->AddInstance(glm::scale(model, glm::vec3(0.9f)), {container, face});
+    }
+    glass->SetStatic(true);
+    glass->SetTransparent(true);
+    mObjects.emplace_back(glass);
+
+    // A crowd of mannequins on the field behind the glass crates, walking and waving in place.
+    // They are animated on the workers and skinned by the vertex shader in a single draw call
+    Shader *skinnedShader = new Shader("shaders/skinnedVS.glsl", "shaders/texturedFS.glsl", surfaceDefines);
+    skinnedShader->SetActive();
+    skinnedShader->SetInt("textureSampler"_id, 0);
+    skinnedShader->SetInt("textureSampler2"_id, 1);
+    mAssetManager->SaveShader("skinned"_id, skinnedShader);
+
+    const int crowdWidth = 40, crowdDepth = 25;
+    mCrowd = new AnimatedCrowd(Mannequin::CreateVertexBuffer(), Mannequin::CreateSkeleton(), {Mannequin::CreateWalkClip(), Mannequin::CreateWaveClip()},
+                               Mannequin::sBoundsMin, Mannequin::sBoundsMax, crowdWidth * crowdDepth);
+    mCrowd->SetShader(skinnedShader);
+    mCrowd->AddTexture(wall);
+    mCrowd->AddTexture(face);
+    for (int z = 0; z < crowdDepth; ++z)
+    {
+        for (int x = 0; x < crowdWidth; ++x)
+        {
+            // Each mannequin turns a little and starts at its own time, half of them wave
+            int i = z * crowdWidth + x;
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((x - crowdWidth / 2) * 1.5f, -3.5f, -9.0f - z * 1.5f));
+            model = glm::rotate(model, std::sin(i * 12.9898f) * 0.4f, glm::vec3(0.0f, 1.0f, 0.0f));
+            mCrowd->AddCharacter(glm::scale(model, glm::vec3(0.6f)), i % 2, std::fmod(i * 0.618f, 2.0f));
+        }
+    }
+    mObjects.emplace_back(mCrowd);
+
+    // A torus imported from a Wavefront .obj file beside the cubes, drawn at its level of detail.
+    // Its vertices carry a normal, so the textured shader reads the texture coordinate after it
+    Shader *modelShader = new Shader("shaders/texturedVS.glsl", "shaders/texturedFS.glsl", std::string(surfaceDefines) + "#define VERTEX_NORMALS\n");
+    modelShader->SetActive();
+    modelShader->SetInt("textureSampler"_id, 0);
+    modelShader->SetInt("textureSampler2"_id, 1);
+    mAssetManager->SaveShader("model"_id, modelShader);
+
+    Model *torus = new Model(torusMeshes.get());
+    torus->SetPosition(glm::vec3(4.0f, 1.0f, -6.0f));
+    torus->SetShader(modelShader);
+    torus->AddTexture(container);
+    torus->AddTexture(face);
+    torus->SetStatic(true);
+    mObjects.emplace_back(torus);
+
+    // A terrain under the field with a virtual texture, only the pages in view are kept in video memory.
+    // The page file is baked from a tiled image into the cache directory, again whenever the image is newer
+    const char *pageImage = "assets/textures/wall.jpg";
+    std::string pageFile = AssetManager::GetCachePath("terrain.vtpf");
+    std::error_code error;
+    bool pageFileReady = !pageFile.empty() && std::filesystem::exists(pageFile, error) &&
+                         std::filesystem::last_write_time(pageFile, error) >= std::filesystem::last_write_time(pageImage, error);
+    if (!pageFile.empty() && !pageFileReady)
+    {
+        ImageData image = Texture::DecodeImage(pageImage);
+        pageFileReady = PageFile::Bake(pageFile, image, 4, 128, 1);
+        Texture::FreeImage(image);
+        if (!pageFileReady)
+        {
+            // Don't leave a partly written file that would look up to date next time
+            std::filesystem::remove(pageFile, error);
+            std::cout << "Can't bake the page file " << pageFile << ", the terrain is left out" << std::endl;
+        }
+    }
+    Shader *virtualShader = new Shader("shaders/texturedVS.glsl", "shaders/virtualTextureFS.glsl", surfaceDefines);
+    mAssetManager->SaveShader("virtual"_id, virtualShader);
+    Shader *feedbackShader = new Shader("shaders/texturedVS.glsl", "shaders/virtualFeedbackFS.glsl");
+    mAssetManager->SaveShader("virtualFeedback"_id, feedbackShader);
+
+    if (pageFileReady)
+    {
+        Terrain *terrain = new Terrain(new VirtualTexture(pageFile), 100.0f, 16);
+        terrain->SetPosition(glm::vec3(0.0f, -4.55f, -50.0f));
+        terrain->SetShader(virtualShader);
+        terrain->SetFeedbackShader(feedbackShader);
+        terrain->SetStatic(true);
+        mObjects.emplace_back(terrain);
+    }
+
     return true;
 }
 
@@ -137,7 +403,15 @@ void Engine::Shutdown()
 {
     std::cout << "SHUTDOWN" << std::endl;
 
+    // Stop the workers first so no load is still running while the assets are deleted
+    delete mJobSystem;
+    mJobSystem = nullptr;
+
+    delete mOcclusionCuller;
+    mOcclusionCuller = nullptr;
+
     delete mAssetManager;
+    mAssetManager = nullptr;
 
     // Delete all objects
     for (auto o : mObjects)
@@ -145,6 +419,40 @@ void Engine::Shutdown()
         delete o;
     }
     mObjects.clear();
+    mCrowd = nullptr;
+
+    delete mDepthPyramid;
+    mDepthPyramid = nullptr;
+
+    delete mDepthPrepass;
+    mDepthPrepass = nullptr;
+
+    delete mRenderGraph;
+    mRenderGraph = nullptr;
+
+    delete mDynamicResolution;
+    mDynamicResolution = nullptr;
+
+    delete mTemporalUpsampler;
+    mTemporalUpsampler = nullptr;
+
+    delete mShadowAtlas;
+    mShadowAtlas = nullptr;
+
+    delete mCascadedShadows;
+    mCascadedShadows = nullptr;
+
+    delete mParticleSystem;
+    mParticleSystem = nullptr;
+
+    delete mLighting;
+    mLighting = nullptr;
+
+    delete mDeferredRenderer;
+    mDeferredRenderer = nullptr;
+
+    delete mTransparencyRenderer;
+    mTransparencyRenderer = nullptr;
 
     // Clean and delete all of GLFW's resources that were allocated
     glfwTerminate();
@@ -212,15 +520,84 @@ void Engine::ProcessInput(GLFWwindow *window)
     {
         mWirePrev = false;
     }
+
+    // Toggles meshlet culling between the CPU and the compute shader
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !mComputeCullPrev)
+    {
+        mComputeCullPrev = true;
+        MeshletCuller::SetUseCompute(!MeshletCuller::GetUseCompute());
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE && mComputeCullPrev)
+    {
+        mComputeCullPrev = false;
+    }
+
+    // Toggles light binning between the CPU and the compute shader
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && !mComputeLightPrev)
+    {
+        mComputeLightPrev = true;
+        ClusteredLighting::SetUseCompute(!ClusteredLighting::GetUseCompute());
+    }
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_RELEASE && mComputeLightPrev)
+    {
+        mComputeLightPrev = false;
+    }
+
+    // Cycles the depth pre-pass between measured, always and never
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !mPrepassPrev)
+    {
+        mPrepassPrev = true;
+        DepthPrepass::Mode mode = mDepthPrepass->GetMode();
+        mDepthPrepass->SetMode(mode == DepthPrepass::Mode::Auto ? DepthPrepass::Mode::On : (mode == DepthPrepass::Mode::On ? DepthPrepass::Mode::Off : DepthPrepass::Mode::Auto));
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE && mPrepassPrev)
+    {
+        mPrepassPrev = false;
+    }
+
+    // Toggles the dynamic resolution of the scene
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !mResolutionPrev)
+    {
+        mResolutionPrev = true;
+        mDynamicResolution->SetEnabled(!mDynamicResolution->IsEnabled());
+    }
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE && mResolutionPrev)
+    {
+        mResolutionPrev = false;
+    }
+
+    // Toggles temporal upsampling, which renders the scene at 50 to 70% of the window's resolution
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && !mTemporalPrev)
+    {
+        mTemporalPrev = true;
+        bool temporal = !mTemporalUpsampler->IsEnabled();
+        mTemporalUpsampler->SetEnabled(temporal);
+        mDynamicResolution->SetScaleRange(0.5f, temporal ? 0.7f : 1.0f);
+    }
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE && mTemporalPrev)
+    {
+        mTemporalPrev = false;
+    }
+
+    // Toggles the particle simulation between the compute shader and the CPU
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !mParticlePrev)
+    {
+        mParticlePrev = true;
+        mParticleSystem->SetUseCompute(!mParticleSystem->GetUseCompute());
+    }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE && mParticlePrev)
+    {
+        mParticlePrev = false;
+    }
 }
 
 void Engine::Update(float deltaTime)
 {
-    // Update the object
-    for (auto o : mObjects)
-    {
-        o->Update(deltaTime);
-    }
+    // Pick the scene's resolution from the GPU times of the last frames, and time this one
+    mDynamicResolution->BeginFrame();
+
+    // Upload any textures that finished loading in the background
+    mAssetManager->ProcessUploads();
 
     // View matrix
     glm::mat4 view = glm::mat4(1.0f);
@@ -232,29 +609,243 @@ void Engine::Update(float deltaTime)
     // Create a persepective matrix w/ 45 degree fov
     projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
 
-    // Read multiplication right-left
-    glm::mat4 viewProj = projection * view;
+    // Everything picked by size on screen follows the resolution the scene is rendered at
+    int width, height;
+    glfwGetFramebufferSize(mWindow, &width, &height);
+    mDynamicResolution->GetRenderSize(width, height, width, height);
+
+    // Read multiplication right-left. Temporal upsampling draws every frame with a sub-pixel
+    // offset, its motion vectors are measured without it
+    glm::mat4 viewProj = mTemporalUpsampler->Jitter(projection, width, height) * view;
+    mTemporalUpsampler->SetViewProj(projection * view);
+    mView = view;
+    mViewProj = viewProj;
+
+    // Objects pick their levels of detail against this frame's camera
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    LodSelector::SetView(cameraPosition, projection, static_cast<float>(height));
+    MeshletCuller::SetView(viewProj, cameraPosition);
+    InstanceCuller::SetView(viewProj, mDepthPyramid);
+
+    // Update the object, remembering where it was for the motion vectors
+    for (auto o : mObjects)
+    {
+        o->SavePreviousModelMatrix();
+        o->Update(deltaTime);
+    }
+
+    // Rasterize the occluders at their new positions for the occlusion tests in Render
+    mOcclusionCuller->BeginFrame(viewProj);
+    for (auto o : mObjects)
+    {
+        if (o->IsOccluder())
+        {
+            o->AddOccluder(mOcclusionCuller);
+        }
+    }
+    mOcclusionCuller->RasterizeOccluders();
+
+    // Request the mipmap levels the objects need at their new positions, then stream them within the budget
+    TextureStreamer *streamer = mAssetManager->GetTextureStreamer();
+    streamer->SetView(cameraPosition, projection, static_cast<float>(height));
+    for (auto o : mObjects)
+    {
+        o->RequestTextures(streamer);
+    }
+    streamer->Update();
+
+    // Bob the lights up and down, then render the shadows that changed and bin the lights into the
+    // clusters of this frame's camera. Lights with shadows stay still so their static depth stays cached
+    for (size_t i = 0; i < mLighting->GetLightCount(); ++i)
+    {
+        PointLight light = mLighting->GetLight(i);
+        if (light.castsShadows)
+        {
+            continue;
+        }
+        light.position.y += std::sin(mTimer * 2.0f + static_cast<float>(i)) * deltaTime;
+        mLighting->SetLight(i, light);
+    }
 
-    // Get location of viewProj in shader
-    int viewProjLoc = glGetUniformLocation(mAssetManager->Get()->LoadShader("textured")->GetID(), "viewProj");
-    // Update viewProj
-    glUniformMatrix4fv(viewProjLoc, 1, GL_FALSE, glm::value_ptr(viewProj));
+    // Transparent objects let the light through, only the opaque ones cast shadows
+    std::vector<RenderObj *> shadowCasters;
+    for (auto o : mObjects)
+    {
+        if (!o->IsTransparent())
+        {
+            shadowCasters.emplace_back(o);
+        }
+    }
+    mShadowAtlas->Update(mLighting, shadowCasters, view, projection, height);
+    mCascadedShadows->Update(view, projection, shadowCasters);
+    mLighting->Update(view, projection, width, height);
+
+    // Spawn and move the particles
+    mParticleSystem->Update(deltaTime);
+
+    // The mannequins of the crowd take turns switching between walking and waving, a hundred a
+    // second in a scattered order
+    mCrowdSwitchAccumulator += deltaTime * 100.0f;
+    for (; mCrowdSwitchAccumulator >= 1.0f; mCrowdSwitchAccumulator -= 1.0f)
+    {
+        size_t character = mCrowdSwitchCount++ * 7919 % mCrowd->GetCharacterCount();
+        mCrowd->CrossFade(character, 1 - mCrowd->GetClip(character), 0.5f);
+    }
+
+    // Update viewProj, both the shader and uniform are looked up by compile time hashed ids.
+    // Uniforms are set on the active program, so each shader is activated first
+    for (StringId id : {"textured"_id, "instanced"_id, "transparentInstanced"_id, "skinned"_id, "model"_id, "virtual"_id})
+    {
+        Shader *shader = mAssetManager->Get()->LoadShader(id);
+        shader->SetActive();
+        shader->SetMat4("viewProj"_id, viewProj);
+        shader->SetMat4("unjitteredViewProj"_id, mTemporalUpsampler->GetViewProj());
+        shader->SetMat4("previousViewProj"_id, mTemporalUpsampler->GetPreviousViewProj());
+    }
+    Shader *feedbackShader = mAssetManager->Get()->LoadShader("virtualFeedback"_id);
+    feedbackShader->SetActive();
+    feedbackShader->SetMat4("viewProj"_id, viewProj);
 }
 
 void Engine::Render()
 {
-    // Render
-    // Clear the screen at the start of each frame
-    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-    // Clear the color/depth buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    int width, height, renderWidth, renderHeight;
+    glfwGetFramebufferSize(mWindow, &width, &height);
+    mDynamicResolution->GetRenderSize(width, height, renderWidth, renderHeight);
 
-    // Loop through and draw all the objects
+    // Skip the objects hidden behind occluders, the transparent ones are drawn after the rest
+    std::vector<RenderObj *> visibleObjects;
+    std::vector<RenderObj *> transparentObjects;
     for (auto o : mObjects)
     {
-        o->Draw();
+        if (!o->IsOccluder() && o->HasBounds() && !mOcclusionCuller->IsVisible(o->GetBoundsMin(), o->GetBoundsMax(), o->GetModelMatrix()))
+        {
+            continue;
+        }
+        (o->IsTransparent() ? transparentObjects : visibleObjects).emplace_back(o);
+    }
+
+    // The frame is built as a render graph, which culls the passes nothing reads and
+    // lends the memory of transient targets to later passes
+    int backbuffer = mRenderGraph->ImportBackbuffer(width, height);
+
+    // At a dynamic resolution or with temporal upsampling the scene is drawn into its own
+    // targets and scaled up to the backbuffer at the end, otherwise straight into the
+    // backbuffer. Temporal upsampling also needs the motion of every pixel. Transparent
+    // objects are tested against the scene's depth from their own targets, which can't
+    // be combined with the backbuffer's depth, so they need the scene's targets too
+    bool temporal = mTemporalUpsampler->IsEnabled();
+    int sceneColor = backbuffer, sceneDepth = backbuffer, sceneMotion = -1;
+    if (mDynamicResolution->IsEnabled() || temporal || !transparentObjects.empty())
+    {
+        sceneColor = mRenderGraph->CreateTexture("Scene color", renderWidth, renderHeight, GL_RGBA8);
+        sceneDepth = mRenderGraph->CreateTexture("Scene depth", renderWidth, renderHeight, GL_DEPTH24_STENCIL8);
+    }
+    if (temporal)
+    {
+        sceneMotion = mRenderGraph->CreateTexture("Scene motion", renderWidth, renderHeight, GL_RG16F);
     }
 
+    // Draw the page requests of the virtual textures at low resolution before the frame
+    size_t feedbackPass = mRenderGraph->AddPass("Virtual texture feedback", [this]()
+                                                {
+                                                    for (auto o : mObjects)
+                                                    {
+                                                        o->DrawFeedback();
+                                                    } });
+    mRenderGraph->SetSideEffect(feedbackPass);
+
+    // Every lit shader reads the same lights and shadows. The depth is laid down first
+    // if it pays off, then all the visible objects are drawn
+    auto drawObjects = [this, visibleObjects]()
+    {
+        mLighting->Bind();
+        mShadowAtlas->Bind();
+        mCascadedShadows->Bind();
+
+        mDepthPrepass->Begin(visibleObjects, mViewProj);
+        for (auto o : visibleObjects)
+        {
+            o->Draw();
+        }
+        mDepthPrepass->End();
+    };
+
+    if (mDeferredRenderer)
+    {
+        // Draw into the G-buffer, then light every pixel once with the lights of its cluster
+        mDeferredRenderer->AddPasses(*mRenderGraph, sceneColor, sceneDepth, sceneMotion, renderWidth, renderHeight, drawObjects, mViewProj);
+    }
+    else
+    {
+        size_t forwardPass = mRenderGraph->AddPass("Forward", [drawObjects, sceneMotion]()
+                                                   {
+                                                       glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+                                                       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                                                       // Pixels without a surface didn't move
+                                                       if (sceneMotion >= 0)
+                                                       {
+                                                           const float noMotion[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                                                           glClearBufferfv(GL_COLOR, 1, noMotion);
+                                                       }
+                                                       drawObjects(); });
+        mRenderGraph->Write(forwardPass, sceneColor);
+        if (sceneMotion >= 0)
+        {
+            mRenderGraph->Write(forwardPass, sceneMotion);
+        }
+        if (sceneDepth != sceneColor)
+        {
+            mRenderGraph->Write(forwardPass, sceneDepth);
+        }
+    }
+
+    // Blend the transparent objects over the lit scene, lit forward with the same lights and shadows
+    if (!transparentObjects.empty())
+    {
+        mTransparencyRenderer->AddPasses(*mRenderGraph, sceneColor, sceneDepth, renderWidth, renderHeight, [this, transparentObjects]()
+                                         {
+                                             mLighting->Bind();
+                                             mShadowAtlas->Bind();
+                                             mCascadedShadows->Bind();
+                                             for (auto o : transparentObjects)
+                                             {
+                                                 o->Draw();
+                                             } });
+    }
+
+    // Blend the particles over the lit scene, testing them against its depth
+    size_t particlePass = mRenderGraph->AddPass("Particles", [this]()
+                                                { mParticleSystem->Draw(mView, mViewProj); });
+    mRenderGraph->Read(particlePass, sceneColor);
+    mRenderGraph->Write(particlePass, sceneColor);
+    if (sceneDepth != sceneColor)
+    {
+        mRenderGraph->Read(particlePass, sceneDepth);
+        mRenderGraph->Write(particlePass, sceneDepth);
+    }
+
+    // Reduce this frame's depth for the GPU occlusion tests of the next frame
+    size_t pyramidPass = mRenderGraph->AddPass("Depth pyramid", [this, sceneDepth, renderWidth, renderHeight]()
+                                               {
+                                                   glBindFramebuffer(GL_FRAMEBUFFER, mRenderGraph->GetFramebuffer({sceneDepth}));
+                                                   mDepthPyramid->Build(renderWidth, renderHeight, mViewProj); });
+    mRenderGraph->Read(pyramidPass, sceneDepth);
+    mRenderGraph->SetSideEffect(pyramidPass);
+
+    // Scale the scene up to the window, passes added after this one draw at the window's resolution
+    if (temporal)
+    {
+        mTemporalUpsampler->AddResolvePasses(*mRenderGraph, sceneColor, sceneDepth, sceneMotion, backbuffer, width, height);
+    }
+    else if (sceneColor != backbuffer)
+    {
+        mDynamicResolution->AddUpscalePass(*mRenderGraph, sceneColor, backbuffer, renderWidth, renderHeight);
+    }
+
+    mRenderGraph->Execute();
+    mDynamicResolution->EndFrame();
+
     //  Swap buffer that contains render info and outputs it to the screen
     glfwSwapBuffers(mWindow);
     // Check to see if any events are triggered (inputs) and updates the window state
@@ -2,12 +2,35 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <glm/glm.hpp>
 
+class AnimatedCrowd;
 class AssetManager;
+class CascadedShadows;
+class ClusteredLighting;
+class DeferredRenderer;
+class DepthPrepass;
+class DepthPyramid;
+class DynamicResolution;
+class JobSystem;
+class OcclusionCuller;
+class ParticleSystem;
 class Shader;
 class Texture;
 class VertexBuffer;
+class RenderGraph;
 class RenderObj;
+class ShadowAtlas;
+class TemporalUpsampler;
+class TransparencyRenderer;
+
+// How the objects are lit: forward lights each fragment as it is drawn, deferred draws
+// the objects into a G-buffer first and lights each pixel once
+enum class RenderPath
+{
+    Forward,
+    Deferred
+};
 
 // The main Engine class that controls the graphics. This class
 // drives the input processing of any controllers/mouse/keyboard inputs,
@@ -20,8 +43,9 @@ public:
     ~Engine();
 
     // Initializes the GLFW library, and any other things required for the engine.
+    // Takes the RenderPath the objects are drawn with.
     // Returns true if initialization was a success, false if not.
-    bool Init();
+    bool Init(RenderPath renderPath = RenderPath::Forward);
 
     // De-allocates any resources
     void Shutdown();
@@ -49,8 +73,58 @@ private:
     // Pointer to a GLFWwindow
     GLFWwindow *mWindow;
 
+    // Worker threads for background jobs such as asset loading
+    JobSystem *mJobSystem;
+
     AssetManager *mAssetManager;
 
+    // CPU occlusion culling of the objects behind occluders
+    OcclusionCuller *mOcclusionCuller;
+
+    // Depth of the last frame for the occlusion tests of the GPU culled instances
+    DepthPyramid *mDepthPyramid;
+
+    // G-buffer and lighting pass, only created for RenderPath::Deferred
+    DeferredRenderer *mDeferredRenderer;
+
+    // Order-independent blending of the transparent objects over the opaque ones
+    TransparencyRenderer *mTransparencyRenderer;
+
+    // Depth only pass before shading, kept when it measures faster
+    DepthPrepass *mDepthPrepass;
+
+    // Passes of the frame, and the pool of the render targets they share
+    RenderGraph *mRenderGraph;
+
+    // Scale of the scene's resolution, lowered when the GPU misses its frame budget
+    DynamicResolution *mDynamicResolution;
+
+    // Jittered rendering resolved over several frames, renders below the window's resolution
+    TemporalUpsampler *mTemporalUpsampler;
+
+    // Point lights binned into the clusters of the view frustum each frame
+    ClusteredLighting *mLighting;
+
+    // Shadows of the lights that cast them, packed into one depth atlas
+    ShadowAtlas *mShadowAtlas;
+
+    // Sun and its cascaded shadow maps
+    CascadedShadows *mCascadedShadows;
+
+    // Particles of the emitters, simulated by a compute shader or on the CPU
+    ParticleSystem *mParticleSystem;
+
+    // Skinned characters animated on the workers, owned by mObjects like the other objects
+    AnimatedCrowd *mCrowd;
+
+    // Fraction of a clip switch carried over between frames, and the number of switches so far
+    float mCrowdSwitchAccumulator;
+    size_t mCrowdSwitchCount;
+
+    // View and view projection matrices of the frame being rendered
+    glm::mat4 mView;
+    glm::mat4 mViewProj;
+
     // VertexBuffer *vBuffer;
 
     std::vector<RenderObj *> mObjects;
@@ -64,4 +138,14 @@ private:
     // Bools for toggling between wireframe/fill
     bool mIsWireFrame;
     bool mWirePrev;
+
+    // Bool for toggling meshlet culling between the CPU and the compute shader
+    bool mComputeCullPrev;
+
+    // Bool for toggling light binning between the CPU and the compute shader
+    bool mComputeLightPrev;
+    bool mPrepassPrev;
+    bool mResolutionPrev;
+    bool mTemporalPrev;
+    bool mParticlePrev;
 };
\ No newline at end of file
@@ -0,0 +1,207 @@
+#pragma once
+#include <vector>
+#include <iostream>
+#include "StringId.h"
+
+// FlatMap is an open-addressing hash map keyed by a StringId. All of the
+// slots live in one contiguous array and collisions are resolved with
+// linear probing, so a lookup is usually a single integer compare on
+// an already hashed key. The capacity is kept at a power of two and grows
+// once the map is over 70% full. In debug builds each slot also remembers
+// the name it was stored with, so two different names hashing to the same
+// StringId are reported instead of silently aliasing each other.
+template <class T>
+class FlatMap
+{
+public:
+    FlatMap() : mCount(0)
+    {
+    }
+
+    //   Insert stores a value by key if the key is not already in the map.
+    //   Returns true if the value was inserted, false if the key already exists:
+    // - StringId for the key
+    // - const T& for the value
+    bool Insert(StringId key, const T &value)
+    {
+        // Grow the slot array before it gets too full for linear probing
+        if ((mCount + 1) * 10 > mSlots.size() * 7)
+        {
+            Rehash(mSlots.empty() ? 16 : mSlots.size() * 2);
+        }
+
+        size_t index = FindSlot(key.GetHash());
+        Slot &slot = mSlots[index];
+        if (slot.used)
+        {
+            CheckCollision(index, key);
+            return false;
+        }
+
+        slot.key = key.GetHash();
+        slot.value = value;
+        slot.used = true;
+#ifndef NDEBUG
+        mNames[index] = std::string(key.GetName());
+#endif
+        ++mCount;
+        return true;
+    }
+
+    //   Find returns a pointer to the value stored by key, or nullptr if there is none:
+    // - StringId for the key
+    T *Find(StringId key)
+    {
+        if (mCount == 0)
+        {
+            return nullptr;
+        }
+
+        size_t index = FindSlot(key.GetHash());
+        if (!mSlots[index].used)
+        {
+            return nullptr;
+        }
+        CheckCollision(index, key);
+        return &mSlots[index].value;
+    }
+
+    const T *Find(StringId key) const
+    {
+        return const_cast<FlatMap *>(this)->Find(key);
+    }
+
+    //   Erase removes a key from the map. Returns true if the key was found:
+    // - StringId for the key
+    bool Erase(StringId key)
+    {
+        if (mCount == 0)
+        {
+            return false;
+        }
+
+        size_t index = FindSlot(key.GetHash());
+        if (!mSlots[index].used)
+        {
+            return false;
+        }
+
+        // Backward shift deletion: move any following entries of the probe
+        // sequence back so that lookups never have to skip over tombstones
+        size_t mask = mSlots.size() - 1;
+        size_t hole = index;
+        size_t next = (hole + 1) & mask;
+        while (mSlots[next].used)
+        {
+            size_t home = HomeSlot(mSlots[next].key);
+            // Only move the entry if its home slot is not between the hole and itself
+            if (((next - home) & mask) >= ((next - hole) & mask))
+            {
+                mSlots[hole] = mSlots[next];
+                mNames[hole] = mNames[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        mSlots[hole] = Slot();
+        mNames[hole].clear();
+        --mCount;
+        return true;
+    }
+
+    //   ForEach calls a function on every stored value:
+    // - Func taking a T& for each value
+    template <class Func>
+    void ForEach(Func func)
+    {
+        for (Slot &slot : mSlots)
+        {
+            if (slot.used)
+            {
+                func(slot.value);
+            }
+        }
+    }
+
+    // Removes every key from the map
+    void Clear()
+    {
+        mSlots.clear();
+        mNames.clear();
+        mCount = 0;
+    }
+
+    // Getter for the number of stored values
+    size_t Size() const { return mCount; }
+
+private:
+    // A single entry of the map
+    struct Slot
+    {
+        uint64_t key = 0;
+        T value = T();
+        bool used = false;
+    };
+
+    // Returns the first slot to probe for a hash. The upper bits are folded
+    // in since the capacity mask only keeps the lower bits
+    size_t HomeSlot(uint64_t hash) const
+    {
+        return static_cast<size_t>(hash ^ (hash >> 32)) & (mSlots.size() - 1);
+    }
+
+    // Returns the slot holding a hash, or the empty slot where it would be inserted
+    size_t FindSlot(uint64_t hash) const
+    {
+        size_t mask = mSlots.size() - 1;
+        size_t index = HomeSlot(hash);
+        while (mSlots[index].used && mSlots[index].key != hash)
+        {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    // Re-inserts every entry into a slot array of a new size
+    void Rehash(size_t newSize)
+    {
+        std::vector<Slot> oldSlots(newSize);
+        oldSlots.swap(mSlots);
+        std::vector<std::string> oldNames(newSize);
+        oldNames.swap(mNames);
+        for (size_t i = 0; i < oldSlots.size(); ++i)
+        {
+            if (oldSlots[i].used)
+            {
+                size_t index = FindSlot(oldSlots[i].key);
+                mSlots[index] = oldSlots[i];
+                mNames[index] = std::move(oldNames[i]);
+            }
+        }
+    }
+
+    // Reports a StringId whose name differs from the name stored in its slot (debug only)
+    void CheckCollision(size_t index, StringId key) const
+    {
+#ifndef NDEBUG
+        if (!key.GetName().empty() && !mNames[index].empty() && key.GetName() != mNames[index])
+        {
+            std::cout << "StringId collision between \"" << mNames[index] << "\" and \"" << key.GetName() << "\"" << std::endl;
+        }
+#else
+        (void)index;
+        (void)key;
+#endif
+    }
+
+    // Contiguous array of slots, the size is always zero or a power of two
+    std::vector<Slot> mSlots;
+
+    // Names each slot was stored with, used for the collision check. The names are only
+    // stored in debug builds, but the array always matches the slots so maps have the same
+    // layout and stay valid when translation units with and without NDEBUG share them
+    std::vector<std::string> mNames;
+
+    // Number of used slots
+    size_t mCount;
+};
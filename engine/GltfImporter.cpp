@@ -0,0 +1,634 @@
+#include "MeshImporter.h"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <iostream>
+#include <memory>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "JobSystem.h"
+#include "Json.h"
+#include "MappedFile.h"
+
+// Magic numbers of the .glb container
+static const uint32_t sGlbMagic = 0x46546C67;
+static const uint32_t sGlbChunkJson = 0x4E4F534A;
+static const uint32_t sGlbChunkBin = 0x004E4942;
+
+// glTF accessor component types
+static const int sGltfByte = 5120;
+static const int sGltfUnsignedByte = 5121;
+static const int sGltfShort = 5122;
+static const int sGltfUnsignedShort = 5123;
+static const int sGltfUnsignedInt = 5125;
+static const int sGltfFloat = 5126;
+
+// glTF primitive mode for triangle lists
+static const int sGltfTriangles = 4;
+
+// The bytes of a glTF buffer. Buffers point into a mapped file (.glb binary chunk
+// or external .bin file) or into decoded data of a base64 data URI
+struct GltfBuffer
+{
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    std::vector<unsigned char> decoded;
+    std::unique_ptr<MappedFile> file;
+};
+
+// A resolved accessor that can read elements straight out of a buffer
+struct GltfAccessor
+{
+    const unsigned char *data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int numComponents = 0;
+    bool normalized = false;
+};
+
+// A single mesh primitive to import, transformed by the world matrix of the node using it
+struct GltfTask
+{
+    int mesh;
+    int primitive;
+    glm::mat4 world;
+};
+
+static uint32_t ReadGlbUint(const char *p)
+{
+    uint32_t value = 0;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Decodes base64 text into bytes
+static std::vector<unsigned char> DecodeBase64(std::string_view text)
+{
+    std::vector<unsigned char> bytes;
+    bytes.reserve(text.size() * 3 / 4);
+    unsigned int bits = 0;
+    int numBits = 0;
+    for (char c : text)
+    {
+        int value = -1;
+        if (c >= 'A' && c <= 'Z')
+        {
+            value = c - 'A';
+        }
+        else if (c >= 'a' && c <= 'z')
+        {
+            value = c - 'a' + 26;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            value = c - '0' + 52;
+        }
+        else if (c == '+')
+        {
+            value = 62;
+        }
+        else if (c == '/')
+        {
+            value = 63;
+        }
+        else
+        {
+            // Padding or whitespace
+            continue;
+        }
+
+        bits = (bits << 6) | static_cast<unsigned int>(value);
+        numBits += 6;
+        if (numBits >= 8)
+        {
+            numBits -= 8;
+            bytes.push_back(static_cast<unsigned char>((bits >> numBits) & 0xFF));
+        }
+    }
+    return bytes;
+}
+
+// Returns the value of a hex digit, which must pass std::isxdigit
+static int HexDigitValue(char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+//   DecodeUri decodes the %XX escapes of a relative URI into a file path.
+//   Returns false if an escape is not followed by two hex digits:
+// - std::string_view for the URI
+// - std::string& for the path
+static bool DecodeUri(std::string_view uri, std::string &path)
+{
+    path.clear();
+    for (size_t i = 0; i < uri.size(); ++i)
+    {
+        if (uri[i] != '%')
+        {
+            path += uri[i];
+            continue;
+        }
+        if (i + 2 >= uri.size() || !std::isxdigit(static_cast<unsigned char>(uri[i + 1])) || !std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+        {
+            return false;
+        }
+        path += static_cast<char>(HexDigitValue(uri[i + 1]) * 16 + HexDigitValue(uri[i + 2]));
+        i += 2;
+    }
+    return true;
+}
+
+// Reads a single component and converts it to a float, applying normalization for integer types
+static float ReadGltfComponent(const unsigned char *p, int componentType, bool normalized)
+{
+    switch (componentType)
+    {
+    case sGltfFloat:
+    {
+        float value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case sGltfByte:
+    {
+        float value = static_cast<float>(static_cast<int8_t>(*p));
+        return normalized ? glm::max(value / 127.0f, -1.0f) : value;
+    }
+    case sGltfUnsignedByte:
+        return normalized ? *p / 255.0f : static_cast<float>(*p);
+    case sGltfShort:
+    {
+        int16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return normalized ? glm::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+    }
+    case sGltfUnsignedShort:
+    {
+        uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return normalized ? value / 65535.0f : static_cast<float>(value);
+    }
+    case sGltfUnsignedInt:
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return static_cast<float>(value);
+    }
+    }
+    return 0.0f;
+}
+
+static size_t GltfComponentSize(int componentType)
+{
+    switch (componentType)
+    {
+    case sGltfByte:
+    case sGltfUnsignedByte:
+        return 1;
+    case sGltfShort:
+    case sGltfUnsignedShort:
+        return 2;
+    case sGltfUnsignedInt:
+    case sGltfFloat:
+        return 4;
+    }
+    return 0;
+}
+
+static int GltfNumComponents(std::string_view type)
+{
+    if (type == "SCALAR")
+    {
+        return 1;
+    }
+    if (type == "VEC2")
+    {
+        return 2;
+    }
+    if (type == "VEC3")
+    {
+        return 3;
+    }
+    if (type == "VEC4" || type == "MAT2")
+    {
+        return 4;
+    }
+    if (type == "MAT3")
+    {
+        return 9;
+    }
+    if (type == "MAT4")
+    {
+        return 16;
+    }
+    return 0;
+}
+
+// Reads a byte offset, length, stride or element count, or the default if it is missing.
+// Returns false unless the number is whole, not negative and fits a size_t
+static bool GetGltfSize(const JsonValue &value, size_t defaultValue, size_t &size)
+{
+    if (value.IsNull())
+    {
+        size = defaultValue;
+        return true;
+    }
+    double number = value.GetNumber(-1.0);
+    if (!std::isfinite(number) || number < 0.0 || number != std::floor(number) || number >= std::ldexp(1.0, std::numeric_limits<size_t>::digits))
+    {
+        return false;
+    }
+    size = static_cast<size_t>(number);
+    return true;
+}
+
+// Resolves an accessor against its buffer view and buffer, returns false if it is missing or out of bounds
+static bool GetGltfAccessor(const JsonValue &json, const std::vector<GltfBuffer> &buffers, int index, GltfAccessor &accessor)
+{
+    if (index < 0)
+    {
+        return false;
+    }
+    const JsonValue &a = json["accessors"][static_cast<size_t>(index)];
+    if (!a.IsObject())
+    {
+        return false;
+    }
+
+    accessor.componentType = a["componentType"].GetInt();
+    accessor.numComponents = GltfNumComponents(a["type"].GetString());
+    accessor.normalized = a["normalized"].GetBool();
+    if (a.Has("sparse"))
+    {
+        std::cout << "Sparse glTF accessors are not supported" << std::endl;
+        return false;
+    }
+
+    size_t elementSize = GltfComponentSize(accessor.componentType) * accessor.numComponents;
+    int viewIndex = a["bufferView"].GetInt(-1);
+    if (elementSize == 0 || viewIndex < 0)
+    {
+        return false;
+    }
+
+    const JsonValue &view = json["bufferViews"][static_cast<size_t>(viewIndex)];
+    int bufferIndex = view["buffer"].GetInt(-1);
+    if (bufferIndex < 0 || bufferIndex >= static_cast<int>(buffers.size()))
+    {
+        return false;
+    }
+    const GltfBuffer &buffer = buffers[bufferIndex];
+
+    size_t viewOffset, viewLength, offset;
+    if (!GetGltfSize(a["count"], 0, accessor.count) || !GetGltfSize(view["byteOffset"], 0, viewOffset) || !GetGltfSize(view["byteLength"], 0, viewLength) ||
+        !GetGltfSize(a["byteOffset"], 0, offset) || !GetGltfSize(view["byteStride"], elementSize, accessor.stride))
+    {
+        std::cout << "glTF accessor " << index << " has an invalid offset, length, stride or count" << std::endl;
+        return false;
+    }
+
+    // Make sure every element lies inside of the view and the view inside of the buffer.
+    // Each side is compared against what is left, so nothing can wrap around
+    if (accessor.stride < elementSize || viewOffset > buffer.size || viewLength > buffer.size - viewOffset ||
+        (accessor.count > 0 && (offset > viewLength || elementSize > viewLength - offset ||
+                                accessor.count - 1 > (viewLength - offset - elementSize) / accessor.stride)))
+    {
+        std::cout << "glTF accessor " << index << " is out of bounds" << std::endl;
+        return false;
+    }
+
+    accessor.data = buffer.data + viewOffset + offset;
+    return true;
+}
+
+// Reads up to 4 components of an element of an accessor
+static glm::vec4 ReadGltfElement(const GltfAccessor &accessor, size_t index)
+{
+    glm::vec4 value(0.0f);
+    const unsigned char *p = accessor.data + index * accessor.stride;
+    size_t componentSize = GltfComponentSize(accessor.componentType);
+    int n = glm::min(accessor.numComponents, 4);
+    for (int c = 0; c < n; ++c)
+    {
+        value[c] = ReadGltfComponent(p + c * componentSize, accessor.componentType, accessor.normalized);
+    }
+    return value;
+}
+
+// Reads an index of an index accessor
+static uint32_t ReadGltfIndex(const GltfAccessor &accessor, size_t index)
+{
+    const unsigned char *p = accessor.data + index * accessor.stride;
+    switch (accessor.componentType)
+    {
+    case sGltfUnsignedByte:
+        return *p;
+    case sGltfUnsignedShort:
+    {
+        uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    default:
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    }
+}
+
+// Returns the local transform of a node from its matrix or its translation/rotation/scale
+static glm::mat4 GetGltfNodeTransform(const JsonValue &node)
+{
+    const JsonValue &matrix = node["matrix"];
+    if (matrix.Size() == 16)
+    {
+        float values[16];
+        for (size_t i = 0; i < 16; ++i)
+        {
+            values[i] = static_cast<float>(matrix[i].GetNumber());
+        }
+        // glTF matrices are column major like glm
+        return glm::make_mat4(values);
+    }
+
+    glm::vec3 translation(0.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale(1.0f);
+    const JsonValue &t = node["translation"];
+    const JsonValue &r = node["rotation"];
+    const JsonValue &s = node["scale"];
+    if (t.Size() == 3)
+    {
+        translation = glm::vec3(t[0].GetNumber(), t[1].GetNumber(), t[2].GetNumber());
+    }
+    if (r.Size() == 4)
+    {
+        // glTF stores quaternions as x, y, z, w while glm's constructor takes w first
+        rotation = glm::quat(static_cast<float>(r[3].GetNumber()), static_cast<float>(r[0].GetNumber()),
+                             static_cast<float>(r[1].GetNumber()), static_cast<float>(r[2].GetNumber()));
+    }
+    if (s.Size() == 3)
+    {
+        scale = glm::vec3(s[0].GetNumber(), s[1].GetNumber(), s[2].GetNumber());
+    }
+
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+// Imports a single primitive into a mesh
+static void ImportGltfPrimitive(const JsonValue &json, const std::vector<GltfBuffer> &buffers, const GltfTask &task, MeshData &mesh)
+{
+    const JsonValue &gltfMesh = json["meshes"][static_cast<size_t>(task.mesh)];
+    const JsonValue &primitive = gltfMesh["primitives"][static_cast<size_t>(task.primitive)];
+    const JsonValue &attributes = primitive["attributes"];
+
+    mesh.name = std::string(gltfMesh["name"].GetString());
+
+    GltfAccessor positions;
+    if (!GetGltfAccessor(json, buffers, attributes["POSITION"].GetInt(-1), positions))
+    {
+        std::cout << "glTF primitive has no valid positions" << std::endl;
+        return;
+    }
+    GltfAccessor normals;
+    GltfAccessor uvs;
+    bool hasNormals = GetGltfAccessor(json, buffers, attributes["NORMAL"].GetInt(-1), normals) && normals.count == positions.count;
+    bool hasUvs = GetGltfAccessor(json, buffers, attributes["TEXCOORD_0"].GetInt(-1), uvs) && uvs.count == positions.count;
+
+    // Normals are transformed by the inverse transpose to stay perpendicular under non uniform scale
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(task.world)));
+
+    mesh.vertices.resize(positions.count);
+    for (size_t i = 0; i < positions.count; ++i)
+    {
+        VertexNormalTexture &v = mesh.vertices[i];
+        v.pos = glm::vec3(task.world * glm::vec4(glm::vec3(ReadGltfElement(positions, i)), 1.0f));
+        if (hasNormals)
+        {
+            v.normal = glm::normalize(normalMatrix * glm::vec3(ReadGltfElement(normals, i)));
+        }
+        if (hasUvs)
+        {
+            // glTF's uv origin is the top left of the image, textures are flipped on load
+            glm::vec4 uv = ReadGltfElement(uvs, i);
+            v.uv = glm::vec2(uv.x, 1.0f - uv.y);
+        }
+        else
+        {
+            v.uv = glm::vec2(0.0f);
+        }
+    }
+
+    GltfAccessor indices;
+    if (primitive.Has("indices") && GetGltfAccessor(json, buffers, primitive["indices"].GetInt(), indices))
+    {
+        mesh.indices.resize(indices.count);
+        for (size_t i = 0; i < indices.count; ++i)
+        {
+            mesh.indices[i] = ReadGltfIndex(indices, i);
+        }
+    }
+    else
+    {
+        // Non indexed primitives draw their vertices in order
+        mesh.indices.resize(positions.count);
+        for (size_t i = 0; i < positions.count; ++i)
+        {
+            mesh.indices[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Drop a trailing partial triangle and any triangle with an index out of range
+    mesh.indices.resize(mesh.indices.size() - mesh.indices.size() % 3);
+    size_t numValid = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        if (mesh.indices[i] < positions.count && mesh.indices[i + 1] < positions.count && mesh.indices[i + 2] < positions.count)
+        {
+            std::memmove(&mesh.indices[numValid], &mesh.indices[i], 3 * sizeof(uint32_t));
+            numValid += 3;
+        }
+    }
+    mesh.indices.resize(numValid);
+
+    // A negative determinant mirrors the mesh, which flips the triangles' winding
+    if (glm::determinant(glm::mat3(task.world)) < 0.0f)
+    {
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+        }
+    }
+
+    if (!hasNormals)
+    {
+        MeshImporter::GenerateNormals(mesh);
+    }
+}
+
+bool MeshImporter::LoadGltf(const std::string &fileName, const MappedFile &file, std::vector<MeshData> &meshes)
+{
+    const char *data = file.GetData();
+    size_t size = file.GetSize();
+
+    std::string_view jsonText;
+    const unsigned char *binChunk = nullptr;
+    size_t binChunkSize = 0;
+
+    // Binary .glb files start with a header followed by a JSON chunk and an optional binary chunk
+    if (size >= 12 && ReadGlbUint(data) == sGlbMagic)
+    {
+        size_t length = std::min<size_t>(ReadGlbUint(data + 8), size);
+        size_t offset = 12;
+        while (offset + 8 <= length)
+        {
+            size_t chunkLength = ReadGlbUint(data + offset);
+            uint32_t chunkType = ReadGlbUint(data + offset + 4);
+            offset += 8;
+            if (offset + chunkLength > length)
+            {
+                std::cout << "Truncated glb chunk in " << fileName << std::endl;
+                return false;
+            }
+
+            if (chunkType == sGlbChunkJson)
+            {
+                jsonText = std::string_view(data + offset, chunkLength);
+            }
+            else if (chunkType == sGlbChunkBin && !binChunk)
+            {
+                // The binary chunk is used in place, straight from the mapped file
+                binChunk = reinterpret_cast<const unsigned char *>(data + offset);
+                binChunkSize = chunkLength;
+            }
+            offset += chunkLength;
+        }
+    }
+    else
+    {
+        jsonText = std::string_view(data, size);
+    }
+
+    JsonValue json;
+    if (!JsonValue::Parse(jsonText, json))
+    {
+        std::cout << "Failed to parse glTF file " << fileName << std::endl;
+        return false;
+    }
+
+    // Resolve every buffer
+    std::string directory = fileName.substr(0, fileName.find_last_of("/\\") + 1);
+    const JsonValue &jsonBuffers = json["buffers"];
+    std::vector<GltfBuffer> buffers(jsonBuffers.Size());
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        std::string_view uri = jsonBuffers[b]["uri"].GetString();
+        GltfBuffer &buffer = buffers[b];
+        if (uri.empty())
+        {
+            // The first buffer of a .glb without a uri is the binary chunk
+            if (b == 0 && binChunk)
+            {
+                buffer.data = binChunk;
+                buffer.size = binChunkSize;
+            }
+        }
+        else if (uri.substr(0, 5) == "data:")
+        {
+            size_t comma = uri.find(',');
+            if (comma != std::string_view::npos)
+            {
+                buffer.decoded = DecodeBase64(uri.substr(comma + 1));
+                buffer.data = buffer.decoded.data();
+                buffer.size = buffer.decoded.size();
+            }
+        }
+        else
+        {
+            std::string path;
+            if (!DecodeUri(uri, path))
+            {
+                std::cout << "Invalid glTF buffer uri " << uri << " in " << fileName << std::endl;
+                return false;
+            }
+            buffer.file = std::make_unique<MappedFile>(directory + path);
+            buffer.data = reinterpret_cast<const unsigned char *>(buffer.file->GetData());
+            buffer.size = buffer.file->GetSize();
+        }
+    }
+
+    // Collect every mesh used by the nodes of the scene with the node's world transform
+    std::vector<GltfTask> tasks;
+    const JsonValue &nodes = json["nodes"];
+    const JsonValue &scenes = json["scenes"];
+    if (scenes.Size() > 0)
+    {
+        const JsonValue &scene = scenes[static_cast<size_t>(json["scene"].GetInt(0))];
+        std::vector<std::pair<int, glm::mat4>> stack;
+        for (size_t i = 0; i < scene["nodes"].Size(); ++i)
+        {
+            stack.emplace_back(scene["nodes"][i].GetInt(), glm::mat4(1.0f));
+        }
+
+        // Walk the node hierarchy, bounded by the node count in case of cycles
+        size_t visited = 0;
+        while (!stack.empty() && visited++ <= nodes.Size() * 4)
+        {
+            auto [nodeIndex, parent] = stack.back();
+            stack.pop_back();
+
+            const JsonValue &node = nodes[static_cast<size_t>(nodeIndex)];
+            glm::mat4 world = parent * GetGltfNodeTransform(node);
+            if (node.Has("mesh"))
+            {
+                int meshIndex = node["mesh"].GetInt();
+                for (size_t p = 0; p < json["meshes"][static_cast<size_t>(meshIndex)]["primitives"].Size(); ++p)
+                {
+                    tasks.push_back({meshIndex, static_cast<int>(p), world});
+                }
+            }
+            for (size_t c = 0; c < node["children"].Size(); ++c)
+            {
+                stack.emplace_back(node["children"][c].GetInt(), world);
+            }
+        }
+    }
+    else
+    {
+        // Files without a scene just list their meshes
+        for (size_t m = 0; m < json["meshes"].Size(); ++m)
+        {
+            for (size_t p = 0; p < json["meshes"][m]["primitives"].Size(); ++p)
+            {
+                tasks.push_back({static_cast<int>(m), static_cast<int>(p), glm::mat4(1.0f)});
+            }
+        }
+    }
+
+    // Only triangle lists are imported
+    std::vector<GltfTask> triangleTasks;
+    for (const auto &t : tasks)
+    {
+        if (json["meshes"][static_cast<size_t>(t.mesh)]["primitives"][static_cast<size_t>(t.primitive)]["mode"].GetInt(sGltfTriangles) == sGltfTriangles)
+        {
+            triangleTasks.push_back(t);
+        }
+    }
+
+    // Import every primitive as its own job
+    size_t firstMesh = meshes.size();
+    meshes.resize(firstMesh + triangleTasks.size());
+    JobSystem::Get()->ParallelFor(triangleTasks.size(), 1, [&](size_t begin, size_t end)
+                                  {
+                                      for (size_t t = begin; t < end; ++t)
+                                      {
+                                          ImportGltfPrimitive(json, buffers, triangleTasks[t], meshes[firstMesh + t]);
+                                      } });
+
+    return true;
+}
@@ -0,0 +1,195 @@
+#include "InstanceCuller.h"
+#include <iostream>
+#include "AssetManager.h"
+#include "DepthPyramid.h"
+#include "MeshletCuller.h"
+#include "Shader.h"
+#include "VertexBuffer.h"
+
+// Work group size of shaders/instanceCullCS.glsl
+static const unsigned int sCullGroupSize = 64;
+
+// Texture unit of the depth pyramid, clear of the units the draw shaders sample
+static const unsigned int sDepthPyramidUnit = 7;
+
+glm::mat4 InstanceCuller::sViewProj = glm::mat4(1.0f);
+const DepthPyramid *InstanceCuller::sDepthPyramid = nullptr;
+
+InstanceCuller::InstanceCuller(VertexBuffer *vertexBuffer, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, size_t maxInstances,
+                               unsigned int instanceIndexLocation)
+    : mVertexBuffer(vertexBuffer), mBoundsMin(boundsMin), mBoundsMax(boundsMax), mMaxInstances(maxInstances), mModelsDirty(false),
+      mInstanceBufferID(0), mInstanceIndexBufferID(0), mCommandBufferID(0), mDrawCountBufferID(0)
+{
+    mModels.reserve(maxInstances);
+
+    glGenBuffers(1, &mInstanceBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxInstances * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+
+    // A command's baseInstance selects its entry here, so the attribute reads the instance's index
+    std::vector<uint32_t> instanceIndices(maxInstances);
+    for (size_t i = 0; i < maxInstances; ++i)
+    {
+        instanceIndices[i] = static_cast<uint32_t>(i);
+    }
+    glGenBuffers(1, &mInstanceIndexBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceIndexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, instanceIndices.size() * sizeof(uint32_t), instanceIndices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mVertexBuffer->SetInstanceAttribute(mInstanceIndexBufferID, instanceIndexLocation);
+
+    glGenBuffers(1, &mCommandBufferID);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBufferID);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, maxInstances * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glGenBuffers(1, &mDrawCountBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawCountBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+InstanceCuller::~InstanceCuller()
+{
+    std::cout << "Delete instance culler" << std::endl;
+
+    glDeleteBuffers(1, &mInstanceBufferID);
+    glDeleteBuffers(1, &mInstanceIndexBufferID);
+    glDeleteBuffers(1, &mCommandBufferID);
+    glDeleteBuffers(1, &mDrawCountBufferID);
+}
+
+void InstanceCuller::SetView(const glm::mat4 &viewProj, const DepthPyramid *depthPyramid)
+{
+    sViewProj = viewProj;
+    sDepthPyramid = depthPyramid;
+}
+
+size_t InstanceCuller::AddInstance(const glm::mat4 &model)
+{
+    if (mModels.size() == mMaxInstances)
+    {
+        std::cout << "Instance culler is full, " << mMaxInstances << " instances" << std::endl;
+        return mMaxInstances;
+    }
+    mModels.push_back(model);
+    mModelsDirty = true;
+    return mModels.size() - 1;
+}
+
+void InstanceCuller::SetInstance(size_t index, const glm::mat4 &model)
+{
+    mModels[index] = model;
+    mModelsDirty = true;
+}
+
+void InstanceCuller::Draw()
+{
+    Cull();
+    DrawVisible();
+}
+
+void InstanceCuller::DrawDepth(const glm::mat4 &viewProj)
+{
+    Cull(viewProj);
+    DrawVisible();
+}
+
+void InstanceCuller::Cull()
+{
+    CullInstances(sViewProj, sDepthPyramid);
+}
+
+void InstanceCuller::Cull(const glm::mat4 &viewProj)
+{
+    CullInstances(viewProj, nullptr);
+}
+
+void InstanceCuller::CullInstances(const glm::mat4 &viewProj, const DepthPyramid *depthPyramid)
+{
+    if (mModels.empty())
+    {
+        return;
+    }
+
+    // The cull shader is shared by every instanced mesh and owned by the AssetManager
+    AssetManager *am = AssetManager::Get();
+    Shader *cullShader = am->LoadShader("instanceCull"_id);
+    if (!cullShader)
+    {
+        cullShader = new Shader("shaders/instanceCullCS.glsl");
+        am->SaveShader("instanceCull"_id, cullShader);
+    }
+
+    if (mModelsDirty)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceBufferID);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mModels.size() * sizeof(glm::mat4), mModels.data());
+        mModelsDirty = false;
+    }
+
+    // Remember the draw shader, the cull shader replaces it while dispatching
+    int drawShader = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &drawShader);
+
+    // Zeroed commands draw nothing, so the slots past the visible count are harmless
+    // when the draw count can not be read from the GPU
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCommandBufferID);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawCountBufferID);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mCommandBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mDrawCountBufferID);
+
+    cullShader->SetActive();
+    cullShader->SetMat4("viewProj"_id, viewProj);
+    cullShader->SetVec3("boundsMin"_id, mBoundsMin);
+    cullShader->SetVec3("boundsMax"_id, mBoundsMax);
+    cullShader->SetUInt("instanceCount"_id, static_cast<unsigned int>(mModels.size()));
+    cullShader->SetUInt("indexCount"_id, static_cast<unsigned int>(mVertexBuffer->GetIndexCount()));
+
+    // Occlusion is tested where the boxes were on screen when the pyramid was rendered
+    bool useOcclusion = depthPyramid && depthPyramid->IsValid();
+    cullShader->SetBool("useOcclusion"_id, useOcclusion);
+    if (useOcclusion)
+    {
+        depthPyramid->Bind(sDepthPyramidUnit);
+        cullShader->SetInt("depthPyramid"_id, sDepthPyramidUnit);
+        cullShader->SetMat4("pyramidViewProj"_id, depthPyramid->GetViewProj());
+        cullShader->SetInt("pyramidLevels"_id, depthPyramid->GetLevelCount());
+        cullShader->SetInt("screenWidth"_id, depthPyramid->GetWidth());
+        cullShader->SetInt("screenHeight"_id, depthPyramid->GetHeight());
+        cullShader->SetInt("pyramidWidth"_id, depthPyramid->GetLevelWidth());
+        cullShader->SetInt("pyramidHeight"_id, depthPyramid->GetLevelHeight());
+    }
+    glDispatchCompute(static_cast<GLuint>((mModels.size() + sCullGroupSize - 1) / sCullGroupSize), 1, 1);
+
+    // Make the commands visible to the indirect draw, the matrices to the vertex shader
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    glUseProgram(drawShader);
+}
+
+void InstanceCuller::DrawVisible()
+{
+    if (mModels.empty())
+    {
+        return;
+    }
+
+    mVertexBuffer->SetActive();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBufferID);
+    if (GLAD_GL_VERSION_4_6)
+    {
+        // Only draw as many commands as the compute shader wrote
+        glBindBuffer(GL_PARAMETER_BUFFER, mDrawCountBufferID);
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, mVertexBuffer->GetIndexType(), nullptr, 0, static_cast<GLsizei>(mModels.size()), 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, mVertexBuffer->GetIndexType(), nullptr, static_cast<GLsizei>(mModels.size()), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
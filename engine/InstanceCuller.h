@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+class DepthPyramid;
+class VertexBuffer;
+
+// InstanceCuller draws many instances of one mesh with visibility decided on the GPU.
+// The model matrices of the instances live in a storage buffer. Each frame a compute
+// shader tests every instance's bounding box against the view frustum and against the
+// DepthPyramid of the previous frame, and appends a draw command for each instance that
+// survives. The commands are drawn with glMultiDrawElementsIndirectCount, so the CPU
+// cost of a draw does not grow with the number of instances. Without GL 4.6 the command
+// buffer is cleared before culling and every slot is drawn, the zeroed ones draw nothing.
+// Each command's baseInstance is its instance, which the vertex shader receives through
+// an instanced attribute at sInstanceIndexLocation and uses to fetch the model matrix
+// from binding 0 (see shaders/instancedVS.glsl).
+class InstanceCuller
+{
+public:
+    // Location of the instance index attribute in the vertex shader
+    static const unsigned int sInstanceIndexLocation = 2;
+
+    //   InstanceCuller constructor, creates the GPU buffers. Must be called on the main thread:
+    // - VertexBuffer* for the mesh, the instance index attribute is added to its VAO
+    // - const glm::vec3& for the minimum corner of the mesh's bounding box
+    // - const glm::vec3& for the maximum corner of the mesh's bounding box
+    // - size_t for the maximum number of instances
+    // - unsigned int for the location of the instance index attribute, for meshes whose
+    //   vertices already use sInstanceIndexLocation
+    InstanceCuller(VertexBuffer *vertexBuffer, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, size_t maxInstances,
+                   unsigned int instanceIndexLocation = sInstanceIndexLocation);
+    ~InstanceCuller();
+
+    //   SetView sets the camera and the depth pyramid used for culling, called once per frame:
+    // - const glm::mat4& for the view projection matrix
+    // - const DepthPyramid* for the depth of the previous frame, nullptr to skip occlusion
+    static void SetView(const glm::mat4 &viewProj, const DepthPyramid *depthPyramid);
+
+    //   AddInstance adds an instance and returns its index, or returns the maximum
+    //   number of instances if the culler is full:
+    // - const glm::mat4& for the instance's model matrix
+    size_t AddInstance(const glm::mat4 &model);
+
+    //   SetInstance moves an instance, the matrices are uploaded on the next Draw:
+    // - size_t for the instance's index
+    // - const glm::mat4& for the instance's model matrix
+    void SetInstance(size_t index, const glm::mat4 &model);
+
+    size_t GetInstanceCount() const { return mModels.size(); }
+
+    // Culls the instances and draws the visible ones with the shader that is currently active
+    void Draw();
+
+    //   DrawDepth culls the instances against another view, such as a shadow's, without occlusion
+    //   and draws the visible ones with the shader that is currently active:
+    // - const glm::mat4& for the view projection matrix
+    void DrawDepth(const glm::mat4 &viewProj);
+
+    //   Cull culls the instances against the camera, or against another view without occlusion, and
+    //   keeps the draw shader active. DrawVisible draws what survived. The cull shader takes storage
+    //   buffer bindings 0 to 2, so a draw shader reading its own buffers there binds them in between:
+    // - const glm::mat4& for the view projection matrix of the other view
+    void Cull();
+    void Cull(const glm::mat4 &viewProj);
+    void DrawVisible();
+
+private:
+    //   CullInstances culls the instances on the GPU into the draw commands:
+    // - const glm::mat4& for the view projection matrix
+    // - const DepthPyramid* for the depth to test occlusion against, nullptr to skip occlusion
+    void CullInstances(const glm::mat4 &viewProj, const DepthPyramid *depthPyramid);
+
+    VertexBuffer *mVertexBuffer;
+
+    // Model space bounding box of the mesh
+    glm::vec3 mBoundsMin;
+    glm::vec3 mBoundsMax;
+
+    size_t mMaxInstances;
+
+    // Model matrices, uploaded when they changed
+    std::vector<glm::mat4> mModels;
+    bool mModelsDirty;
+
+    // Model matrices read by the cull and vertex shaders
+    unsigned int mInstanceBufferID;
+
+    // 0, 1, 2, ... read by the instance index attribute
+    unsigned int mInstanceIndexBufferID;
+
+    // Indirect draw commands, one slot per instance
+    unsigned int mCommandBufferID;
+
+    // Number of commands written by the cull shader
+    unsigned int mDrawCountBufferID;
+
+    static glm::mat4 sViewProj;
+    static const DepthPyramid *sDepthPyramid;
+};
@@ -0,0 +1,152 @@
+#include "InstancedMesh.h"
+#include "AssetManager.h"
+#include "InstanceCuller.h"
+#include "TextureArray.h"
+#include "TexturePacker.h"
+#include "TextureResidency.h"
+#include "VertexBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include <algorithm>
+#include <iostream>
+
+// Location of the texture layer attribute in shaders/instancedVS.glsl
+static const unsigned int sTextureLayerLocation = InstanceCuller::sInstanceIndexLocation + 1;
+
+// Binding of the table of bindless handles in shaders/texturedBindlessFS.glsl
+static const unsigned int sTextureHandleBinding = 3;
+
+InstancedMesh::InstancedMesh(VertexBuffer *vBuffer, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, size_t maxInstances)
+    : RenderObj(), mBindless(AssetManager::Get()->GetTextureResidency() != nullptr), mTextureLayersDirty(false), mTextureLayerBufferID(0)
+{
+    // The bounds stay empty: the instances are culled on the GPU, not by the OcclusionCuller
+    mVertexBuffer = vBuffer;
+    mInstanceCuller = new InstanceCuller(mVertexBuffer, boundsMin, boundsMax, maxInstances);
+
+    // Like the instance index, the draw command's baseInstance selects the layers of its instance
+    mTextureLayers.reserve(maxInstances);
+    glGenBuffers(1, &mTextureLayerBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, mTextureLayerBufferID);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(glm::uvec4), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mVertexBuffer->SetInstanceAttribute(mTextureLayerBufferID, sTextureLayerLocation, 4);
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    std::cout << "Delete instanced mesh" << std::endl;
+
+    // The AssetManager made every handle non-resident already if it was deleted first
+    AssetManager *assets = AssetManager::Get();
+    if (assets && assets->GetTextureResidency())
+    {
+        for (auto slot : mResidentTextures)
+        {
+            assets->GetTextureResidency()->Release(slot);
+        }
+    }
+
+    glDeleteBuffers(1, &mTextureLayerBufferID);
+    delete mInstanceCuller;
+    delete mVertexBuffer;
+}
+
+size_t InstancedMesh::AddInstance(const glm::mat4 &model, const std::vector<Texture *> &textures)
+{
+    // The culler returns its maximum number of instances when it is full
+    size_t index = mInstanceCuller->AddInstance(model);
+    if (index != mTextureLayers.size())
+    {
+        return index;
+    }
+
+    glm::uvec4 layers = glm::uvec4(0);
+    if (mBindless)
+    {
+        // Resolve the textures to the slots of their handles, each texture is acquired once per mesh
+        TextureResidency *residency = AssetManager::Get()->GetTextureResidency();
+        for (size_t slot = 0; slot < textures.size() && slot < sMaxTextures; ++slot)
+        {
+            int handle = residency->Acquire(textures[slot]);
+            if (handle < 0)
+            {
+                std::cout << "Texture " << textures[slot]->GetName() << " has no bindless handle" << std::endl;
+                continue;
+            }
+            if (std::find(mResidentTextures.begin(), mResidentTextures.end(), handle) == mResidentTextures.end())
+            {
+                mResidentTextures.emplace_back(handle);
+            }
+            else
+            {
+                residency->Release(handle);
+            }
+            layers[slot] = static_cast<unsigned int>(handle);
+        }
+        mTextureLayers.push_back(layers);
+        mTextureLayersDirty = true;
+        return index;
+    }
+
+    // Resolve the textures to their layers, the first copy decides the array of each slot
+    TexturePacker *packer = AssetManager::Get()->GetTexturePacker();
+    for (size_t slot = 0; slot < textures.size() && slot < sMaxTextures; ++slot)
+    {
+        TextureLayer packed = packer->Pack(textures[slot]);
+        if (slot == mTextureArrays.size())
+        {
+            mTextureArrays.emplace_back(packed.array);
+        }
+        if (packed.array != mTextureArrays[slot] || packed.layer < 0)
+        {
+            std::cout << "Texture " << textures[slot]->GetName() << " is not in the texture array of slot " << slot << std::endl;
+            continue;
+        }
+        layers[slot] = static_cast<unsigned int>(packed.layer);
+    }
+    mTextureLayers.push_back(layers);
+    mTextureLayersDirty = true;
+    return index;
+}
+
+void InstancedMesh::SetInstance(size_t index, const glm::mat4 &model)
+{
+    mInstanceCuller->SetInstance(index, model);
+}
+
+void InstancedMesh::Draw()
+{
+    // Set a shader program to use
+    mShader->SetActive();
+
+    // Bindless textures are sampled from their handles, otherwise bind the texture arrays on their texture units
+    if (mBindless)
+    {
+        AssetManager::Get()->GetTextureResidency()->Bind(sTextureHandleBinding);
+    }
+    for (size_t i = 0; i < mTextureArrays.size(); ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        if (mTextureArrays[i])
+        {
+            mTextureArrays[i]->SetActive();
+        }
+    }
+
+    if (mTextureLayersDirty)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, mTextureLayerBufferID);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mTextureLayers.size() * sizeof(glm::uvec4), mTextureLayers.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mTextureLayersDirty = false;
+    }
+
+    // Cull on the GPU and draw the visible instances
+    mInstanceCuller->Draw();
+}
+
+void InstancedMesh::DrawDepth()
+{
+    AssetManager::Get()->LoadShader("instancedDepth"_id)->SetActive();
+    mInstanceCuller->DrawDepth(GetDepthViewProj());
+}
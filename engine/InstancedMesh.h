@@ -0,0 +1,62 @@
+#pragma once
+#include "RenderObj.h"
+
+class InstanceCuller;
+class TextureArray;
+
+// InstancedMesh draws many copies of one mesh as a single RenderObj. Every copy has its
+// own model matrix, and the InstanceCuller decides which of them are drawn on the GPU,
+// so the engine spends the same CPU time on it no matter how many instances it has.
+// Copies can have different textures: each texture is packed into a TextureArray and
+// the copy passes its layers to the shader in a per-instance attribute.
+// It draws with shaders/instancedVS.glsl and shaders/texturedArrayFS.glsl.
+// When the context supports bindless textures the attribute holds the slots of the
+// textures' handles in the TextureResidency instead, the textures of a slot don't need
+// to have the same size, and the mesh draws with shaders/texturedBindlessFS.glsl.
+class InstancedMesh : public RenderObj
+{
+public:
+    //   InstancedMesh constructor, takes ownership of the vertex buffer:
+    // - VertexBuffer* for the mesh
+    // - const glm::vec3& for the minimum corner of the mesh's bounding box
+    // - const glm::vec3& for the maximum corner of the mesh's bounding box
+    // - size_t for the maximum number of instances
+    InstancedMesh(VertexBuffer *vBuffer, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, size_t maxInstances);
+    ~InstancedMesh();
+
+    // The instances are placed with AddInstance/SetInstance, not by the RenderObj's transform
+    void Update(float) override {}
+    void Draw() override;
+    void DrawDepth() override;
+
+    // Most textures a copy can have, one per sampler of the shader
+    static const size_t sMaxTextures = 4;
+
+    //   AddInstance adds a copy of the mesh and returns its index. Without bindless textures
+    //   the textures in the same slot of every copy must have the same size so they share a TextureArray:
+    // - const glm::mat4& for the copy's model matrix
+    // - const std::vector<Texture*>& for the copy's textures, in the order of the samplers
+    size_t AddInstance(const glm::mat4 &model, const std::vector<Texture *> &textures = {});
+
+    //   SetInstance moves a copy of the mesh:
+    // - size_t for the copy's index
+    // - const glm::mat4& for the copy's model matrix
+    void SetInstance(size_t index, const glm::mat4 &model);
+
+private:
+    InstanceCuller *mInstanceCuller;
+
+    // Array of every texture slot, bound to the texture unit of the slot
+    std::vector<TextureArray *> mTextureArrays;
+
+    // Handle slots of the textures acquired from the TextureResidency, empty without bindless textures
+    std::vector<int> mResidentTextures;
+    bool mBindless;
+
+    // Layer or handle slot of every texture slot of every copy, uploaded when they changed
+    std::vector<glm::uvec4> mTextureLayers;
+    bool mTextureLayersDirty;
+
+    // Per-instance attribute with the texture layers or handle slots
+    unsigned int mTextureLayerBufferID;
+};
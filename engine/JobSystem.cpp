@@ -0,0 +1,145 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <iostream>
+
+JobSystem *JobSystem::sJobSystem = nullptr;
+
+JobSystem::JobSystem(unsigned int numWorkers)
+    : mShutdown(false)
+{
+    if (sJobSystem)
+    {
+        std::cout << "There can only be one job system" << std::endl;
+        return;
+    }
+    sJobSystem = this;
+
+    // Leave one hardware thread for the main thread
+    if (numWorkers == 0)
+    {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        numWorkers = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+    }
+
+    for (unsigned int i = 0; i < numWorkers; ++i)
+    {
+        mWorkers.emplace_back(&JobSystem::WorkerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    std::cout << "Delete job system" << std::endl;
+
+    // Wake up every worker so they can finish the queue and exit
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCondition.notify_all();
+
+    for (auto &w : mWorkers)
+    {
+        w.join();
+    }
+    mWorkers.clear();
+
+    if (sJobSystem == this)
+    {
+        sJobSystem = nullptr;
+    }
+}
+
+void JobSystem::Schedule(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.emplace_back(std::move(job));
+    }
+    mCondition.notify_one();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)> &func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    // Run small ranges on the calling thread to skip the queue
+    size_t numBatches = (count + batchSize - 1) / batchSize;
+    if (numBatches == 1)
+    {
+        func(0, count);
+        return;
+    }
+
+    // The counter lives on this stack frame, which is safe since this
+    // function does not return until every batch has decremented it
+    std::atomic<size_t> remaining(numBatches);
+    for (size_t b = 1; b < numBatches; ++b)
+    {
+        size_t begin = b * batchSize;
+        size_t end = std::min(begin + batchSize, count);
+        Schedule([&func, &remaining, begin, end]()
+                 {
+                     func(begin, end);
+                     remaining.fetch_sub(1, std::memory_order_release); });
+    }
+
+    // The calling thread takes the first batch itself
+    func(0, std::min(batchSize, count));
+    remaining.fetch_sub(1, std::memory_order_release);
+
+    WaitFor(remaining);
+}
+
+bool JobSystem::RunPendingJob()
+{
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mJobs.empty())
+        {
+            return false;
+        }
+        job = std::move(mJobs.front());
+        mJobs.pop_front();
+    }
+    job();
+    return true;
+}
+
+void JobSystem::WaitFor(const std::atomic<size_t> &counter)
+{
+    // Help with queued jobs while waiting instead of blocking the thread
+    while (counter.load(std::memory_order_acquire) > 0)
+    {
+        if (!RunPendingJob())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]()
+                            { return mShutdown || !mJobs.empty(); });
+            if (mJobs.empty())
+            {
+                // Shutting down with nothing left to run
+                return;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The JobSystem is a singleton pool of worker threads that runs small
+// jobs in the background. Jobs are plain functions pushed onto a shared
+// queue. Threads that have to wait on jobs (ParallelFor) help run queued
+// jobs instead of blocking, so jobs are free to schedule and wait on
+// other jobs. Jobs must not make any OpenGL calls since the context is
+// only current on the main thread.
+class JobSystem
+{
+public:
+    //   JobSystem constructor:
+    // - unsigned int for the number of worker threads. 0 uses one less than the number of hardware threads
+    JobSystem(unsigned int numWorkers = 0);
+    ~JobSystem();
+
+    // Returns the static JobSystem
+    static JobSystem *Get() { return sJobSystem; }
+
+    //   Schedule pushes a job onto the queue to be run by a worker thread:
+    // - std::function<void()> for the job
+    void Schedule(std::function<void()> job);
+
+    //   ParallelFor splits the range [0, count) into batches and runs them on the worker
+    //   threads and the calling thread. Returns once every batch has finished:
+    // - size_t for the number of items
+    // - size_t for the number of items per batch
+    // - const std::function<void(size_t, size_t)>& called with the begin and end of each batch
+    void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)> &func);
+
+    //   RunPendingJob pops a single job off the queue and runs it on the calling thread.
+    //   Returns false if the queue was empty.
+    bool RunPendingJob();
+
+    //   WaitFor runs queued jobs on the calling thread until a counter reaches zero:
+    // - const std::atomic<size_t>& for the number of jobs still running
+    void WaitFor(const std::atomic<size_t> &counter);
+
+    // Getter for the number of worker threads
+    unsigned int GetNumWorkers() const { return static_cast<unsigned int>(mWorkers.size()); }
+
+private:
+    // Loop that each worker thread runs until shutdown
+    void WorkerLoop();
+
+    // Singleton
+    static JobSystem *sJobSystem;
+
+    // Worker threads
+    std::vector<std::thread> mWorkers;
+
+    // Queue of jobs waiting to run
+    std::deque<std::function<void()>> mJobs;
+
+    // Mutex and condition variable guarding the job queue
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+
+    // Bool to tell the workers to exit
+    bool mShutdown;
+};
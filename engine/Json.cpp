@@ -0,0 +1,357 @@
+#include "Json.h"
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+
+// JsonParser is a recursive descent parser that fills in JsonValues
+class JsonParser
+{
+public:
+    JsonParser(std::string_view text) : mText(text), mPos(0)
+    {
+    }
+
+    // Parses the whole text into a value, returns false on any syntax error
+    bool ParseDocument(JsonValue &value)
+    {
+        if (!ParseValue(value, 0))
+        {
+            return false;
+        }
+        SkipWhitespace();
+        return mPos == mText.size() || Error("unexpected trailing characters");
+    }
+
+private:
+    // Deepest nesting allowed, so bad input can't overflow the stack
+    static constexpr int sMaxDepth = 256;
+
+    bool Error(const char *message)
+    {
+        std::cout << "JSON parse error at " << mPos << ": " << message << std::endl;
+        return false;
+    }
+
+    void SkipWhitespace()
+    {
+        while (mPos < mText.size() && (mText[mPos] == ' ' || mText[mPos] == '\t' || mText[mPos] == '\n' || mText[mPos] == '\r'))
+        {
+            ++mPos;
+        }
+    }
+
+    bool Consume(char c)
+    {
+        SkipWhitespace();
+        if (mPos < mText.size() && mText[mPos] == c)
+        {
+            ++mPos;
+            return true;
+        }
+        return false;
+    }
+
+    bool ParseValue(JsonValue &value, int depth)
+    {
+        if (depth > sMaxDepth)
+        {
+            return Error("nesting is too deep");
+        }
+
+        SkipWhitespace();
+        if (mPos >= mText.size())
+        {
+            return Error("unexpected end of text");
+        }
+
+        char c = mText[mPos];
+        if (c == '{')
+        {
+            return ParseObject(value, depth);
+        }
+        if (c == '[')
+        {
+            return ParseArray(value, depth);
+        }
+        if (c == '"')
+        {
+            value.mType = JsonValue::Type::String;
+            return ParseString(value.mString, value.mDecoded, value.mIsDecoded);
+        }
+        if (mText.compare(mPos, 4, "true") == 0)
+        {
+            value.mType = JsonValue::Type::Bool;
+            value.mBool = true;
+            mPos += 4;
+            return true;
+        }
+        if (mText.compare(mPos, 5, "false") == 0)
+        {
+            value.mType = JsonValue::Type::Bool;
+            value.mBool = false;
+            mPos += 5;
+            return true;
+        }
+        if (mText.compare(mPos, 4, "null") == 0)
+        {
+            value.mType = JsonValue::Type::Null;
+            mPos += 4;
+            return true;
+        }
+        return ParseNumber(value);
+    }
+
+    bool ParseObject(JsonValue &value, int depth)
+    {
+        value.mType = JsonValue::Type::Object;
+        ++mPos;
+        if (Consume('}'))
+        {
+            return true;
+        }
+
+        do
+        {
+            SkipWhitespace();
+            if (mPos >= mText.size() || mText[mPos] != '"')
+            {
+                return Error("expected a key");
+            }
+
+            // Keys are kept as raw views, glTF keys never contain escapes
+            std::string_view key;
+            std::string decoded;
+            bool isDecoded = false;
+            if (!ParseString(key, decoded, isDecoded))
+            {
+                return false;
+            }
+            if (!Consume(':'))
+            {
+                return Error("expected ':'");
+            }
+
+            value.mMembers.emplace_back(key, JsonValue());
+            if (!ParseValue(value.mMembers.back().second, depth + 1))
+            {
+                return false;
+            }
+        } while (Consume(','));
+
+        return Consume('}') || Error("expected '}'");
+    }
+
+    bool ParseArray(JsonValue &value, int depth)
+    {
+        value.mType = JsonValue::Type::Array;
+        ++mPos;
+        if (Consume(']'))
+        {
+            return true;
+        }
+
+        do
+        {
+            value.mElements.emplace_back();
+            if (!ParseValue(value.mElements.back(), depth + 1))
+            {
+                return false;
+            }
+        } while (Consume(','));
+
+        return Consume(']') || Error("expected ']'");
+    }
+
+    bool ParseString(std::string_view &out, std::string &decoded, bool &isDecoded)
+    {
+        // Skip the opening quote
+        size_t start = ++mPos;
+        bool hasEscapes = false;
+        while (mPos < mText.size() && mText[mPos] != '"')
+        {
+            if (mText[mPos] == '\\')
+            {
+                hasEscapes = true;
+                ++mPos;
+            }
+            ++mPos;
+        }
+        if (mPos >= mText.size())
+        {
+            return Error("unterminated string");
+        }
+
+        out = mText.substr(start, mPos - start);
+        // Skip the closing quote
+        ++mPos;
+
+        if (hasEscapes)
+        {
+            isDecoded = true;
+            if (!Unescape(out, decoded))
+            {
+                return Error("invalid \\u escape");
+            }
+        }
+        return true;
+    }
+
+    //   ReadCodeUnit reads the 4 hex digits of a \u escape, returns -1 if they are not 4 hex digits:
+    // - std::string_view for the string
+    // - size_t for the position of the first digit
+    static int ReadCodeUnit(std::string_view raw, size_t pos)
+    {
+        unsigned int code = 0;
+        if (pos + 4 > raw.size())
+        {
+            return -1;
+        }
+        auto parsed = std::from_chars(raw.data() + pos, raw.data() + pos + 4, code, 16);
+        return parsed.ec == std::errc() && parsed.ptr == raw.data() + pos + 4 ? static_cast<int>(code) : -1;
+    }
+
+    //   Unescape decodes the escape sequences of a string. \u escapes are written as UTF-8, a
+    //   surrogate pair as one code point. Returns false for a \u escape that is not 4 hex digits
+    //   or a surrogate without its pair:
+    // - std::string_view for the string between the quotes
+    // - std::string& for the decoded string
+    static bool Unescape(std::string_view raw, std::string &result)
+    {
+        result.clear();
+        result.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i)
+        {
+            if (raw[i] != '\\' || i + 1 >= raw.size())
+            {
+                result += raw[i];
+                continue;
+            }
+
+            char e = raw[++i];
+            switch (e)
+            {
+            case 'b':
+                result += '\b';
+                break;
+            case 'f':
+                result += '\f';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            case 'u':
+            {
+                int unit = ReadCodeUnit(raw, i + 1);
+                if (unit < 0 || (unit >= 0xDC00 && unit <= 0xDFFF))
+                {
+                    return false;
+                }
+                i += 4;
+                unsigned int code = static_cast<unsigned int>(unit);
+
+                // A high surrogate must be followed by a low one, together they hold a code point above 0xFFFF
+                if (unit >= 0xD800 && unit <= 0xDBFF)
+                {
+                    int low = i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u' ? ReadCodeUnit(raw, i + 3) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                    {
+                        return false;
+                    }
+                    i += 6;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (static_cast<unsigned int>(low) - 0xDC00);
+                }
+
+                if (code < 0x80)
+                {
+                    result += static_cast<char>(code);
+                }
+                else if (code < 0x800)
+                {
+                    result += static_cast<char>(0xC0 | (code >> 6));
+                    result += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else if (code < 0x10000)
+                {
+                    result += static_cast<char>(0xE0 | (code >> 12));
+                    result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    result += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    result += static_cast<char>(0xF0 | (code >> 18));
+                    result += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                    result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    result += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                // \" \\ and \/ map to themselves
+                result += e;
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool ParseNumber(JsonValue &value)
+    {
+        const char *begin = mText.data() + mPos;
+        const char *end = mText.data() + mText.size();
+
+        // from_chars does not accept a leading '+', JSON does not allow one either
+        auto result = std::from_chars(begin, end, value.mNumber);
+        if (result.ec != std::errc() || result.ptr == begin)
+        {
+            return Error("invalid value");
+        }
+        value.mType = JsonValue::Type::Number;
+        mPos += result.ptr - begin;
+        return true;
+    }
+
+    // The text being parsed
+    std::string_view mText;
+
+    // Current position in the text
+    size_t mPos;
+};
+
+bool JsonValue::Parse(std::string_view text, JsonValue &root)
+{
+    root = JsonValue();
+    JsonParser parser(text);
+    return parser.ParseDocument(root);
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const
+{
+    static const JsonValue sNull;
+    if (mType != Type::Array || index >= mElements.size())
+    {
+        return sNull;
+    }
+    return mElements[index];
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const
+{
+    static const JsonValue sNull;
+    if (mType == Type::Object)
+    {
+        for (const auto &m : mMembers)
+        {
+            if (m.first == key)
+            {
+                return m.second;
+            }
+        }
+    }
+    return sNull;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <climits>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// JsonValue is a minimal JSON document used by the glTF importer.
+// Strings without escape sequences point straight into the parsed text
+// instead of being copied, so the text has to outlive the document.
+// Looking up a missing key or index returns a null value instead of failing,
+// which keeps optional glTF properties easy to read.
+class JsonValue
+{
+public:
+    // Enum for the type of a value
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    JsonValue() : mType(Type::Null), mBool(false), mNumber(0.0), mIsDecoded(false) {}
+
+    //   Parse parses a JSON document. Returns false and prints an error if the text is invalid:
+    // - std::string_view for the JSON text
+    // - JsonValue& for the root of the resulting document
+    static bool Parse(std::string_view text, JsonValue &root);
+
+    // Getters for the type of the value
+    Type GetType() const { return mType; }
+    bool IsNull() const { return mType == Type::Null; }
+    bool IsArray() const { return mType == Type::Array; }
+    bool IsObject() const { return mType == Type::Object; }
+
+    // Getters for the value, returning a default if the value is of a different type
+    bool GetBool(bool defaultValue = false) const { return mType == Type::Bool ? mBool : defaultValue; }
+    double GetNumber(double defaultValue = 0.0) const { return mType == Type::Number ? mNumber : defaultValue; }
+
+    // Integers also fall back to the default unless the number is whole and fits an int
+    int GetInt(int defaultValue = 0) const
+    {
+        if (mType != Type::Number || !std::isfinite(mNumber) || mNumber != std::floor(mNumber) || mNumber < INT_MIN || mNumber > INT_MAX)
+        {
+            return defaultValue;
+        }
+        return static_cast<int>(mNumber);
+    }
+
+    std::string_view GetString() const
+    {
+        if (mType != Type::String)
+        {
+            return std::string_view();
+        }
+        return mIsDecoded ? std::string_view(mDecoded) : mString;
+    }
+
+    // Returns the number of elements of an array or members of an object
+    size_t Size() const { return mType == Type::Array ? mElements.size() : mMembers.size(); }
+
+    //   Returns the element at an index of an array, or a null value:
+    // - size_t for the index
+    const JsonValue &operator[](size_t index) const;
+
+    //   Returns the member of an object by key, or a null value:
+    // - std::string_view for the member's key
+    const JsonValue &operator[](std::string_view key) const;
+
+    //   Returns true if an object has a member by key:
+    // - std::string_view for the member's key
+    bool Has(std::string_view key) const { return !(*this)[key].IsNull(); }
+
+private:
+    friend class JsonParser;
+
+    // Type of the value
+    Type mType;
+
+    // Bool and number values
+    bool mBool;
+    double mNumber;
+
+    // String value pointing into the parsed text. Strings with escape
+    // sequences are decoded into mDecoded instead
+    std::string_view mString;
+    std::string mDecoded;
+    bool mIsDecoded;
+
+    // Array elements and object members
+    std::vector<JsonValue> mElements;
+    std::vector<std::pair<std::string_view, JsonValue>> mMembers;
+};
@@ -0,0 +1,45 @@
+#include "LodSelector.h"
+
+glm::vec3 LodSelector::sCameraPosition = glm::vec3(0.0f);
+float LodSelector::sPixelsPerUnit = 1.0f;
+float LodSelector::sMaxPixelError = 1.0f;
+float LodSelector::sHysteresis = 0.25f;
+
+void LodSelector::SetView(const glm::vec3 &cameraPosition, const glm::mat4 &projection, float viewportHeight)
+{
+    sCameraPosition = cameraPosition;
+
+    // projection[1][1] is cot(fov / 2), which maps a unit length at unit distance to half the viewport
+    sPixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+}
+
+size_t LodSelector::Select(const std::vector<MeshLod> &lods, const glm::vec3 &center, float radius, float scale, size_t currentLod)
+{
+    if (lods.empty())
+    {
+        return 0;
+    }
+
+    // Use the closest point of the bounding sphere, inside it everything is drawn at full detail
+    float distance = glm::length(center - sCameraPosition) - radius;
+    if (distance <= 0.0f)
+    {
+        return 0;
+    }
+    float pixelsPerError = scale * sPixelsPerUnit / distance;
+
+    // Take the coarsest level that is still below the threshold. Levels up to the current one
+    // get a looser threshold and coarser ones a stricter one, so switching in either
+    // direction needs the error to move past the threshold by the hysteresis
+    size_t selected = 0;
+    for (size_t i = 1; i < lods.size(); ++i)
+    {
+        float threshold = sMaxPixelError * (i <= currentLod ? 1.0f + sHysteresis : 1.0f - sHysteresis);
+        if (lods[i].error * pixelsPerError > threshold)
+        {
+            break;
+        }
+        selected = i;
+    }
+    return selected;
+}
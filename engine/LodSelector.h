@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A level of detail of a mesh: a range of the mesh's index buffer
+struct MeshLod
+{
+    // First index and number of indices of the level
+    uint32_t indexOffset;
+    uint32_t indexCount;
+
+    // Largest distance the simplified surface moved away from the full detail surface, in model units
+    float error;
+};
+
+// LodSelector picks the level of detail of a mesh from how large its simplification
+// error appears on screen. The error is projected like the mesh's bounding sphere, so
+// the coarsest level whose error covers less than a pixel (by default) is drawn.
+// Switching levels uses hysteresis so objects near a threshold do not pop back and forth.
+class LodSelector
+{
+public:
+    //   SetView sets the camera used for selection, called once per frame before objects update:
+    // - const glm::vec3& for the camera's world position
+    // - const glm::mat4& for the projection matrix
+    // - float for the height of the viewport in pixels
+    static void SetView(const glm::vec3 &cameraPosition, const glm::mat4 &projection, float viewportHeight);
+
+    //   Sets the largest error in pixels a level may show on screen
+    static void SetMaxPixelError(float pixels) { sMaxPixelError = pixels; }
+
+    //   Sets how far past the threshold, as a fraction of it, the error must go before the level changes
+    static void SetHysteresis(float hysteresis) { sHysteresis = hysteresis; }
+
+    //   Select returns the level to draw. Returns 0 if the mesh has no levels:
+    // - const std::vector<MeshLod>& for the levels of the mesh, finest first
+    // - const glm::vec3& for the world space center of the mesh's bounds
+    // - float for the world space radius of the mesh's bounds
+    // - float for the scale from model to world units
+    // - size_t for the level drawn last frame
+    static size_t Select(const std::vector<MeshLod> &lods, const glm::vec3 &center, float radius, float scale, size_t currentLod);
+
+private:
+    // Camera position in world space
+    static glm::vec3 sCameraPosition;
+
+    // Pixels covered by one world unit at a distance of one unit from the camera
+    static float sPixelsPerUnit;
+
+    static float sMaxPixelError;
+
+    static float sHysteresis;
+};
@@ -1,9 +1,20 @@
+#include <cstring>
 #include "Engine.h"
 
-int main()
+int main(int argc, char *argv[])
 {
+    // --deferred draws with the G-buffer and a lighting pass instead of lighting while drawing
+    RenderPath renderPath = RenderPath::Forward;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--deferred") == 0)
+        {
+            renderPath = RenderPath::Deferred;
+        }
+    }
+
     Engine engine;
-    if (engine.Init())
+    if (engine.Init(renderPath))
     {
         engine.Run();
     }
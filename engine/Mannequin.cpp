@@ -0,0 +1,196 @@
+#include "Mannequin.h"
+#include "AnimationClip.h"
+#include "Skeleton.h"
+#include "VertexBuffer.h"
+#include <cmath>
+#include <vector>
+
+const glm::vec3 Mannequin::sBoundsMin = glm::vec3(-1.0f, 0.0f, -0.7f);
+const glm::vec3 Mannequin::sBoundsMax = glm::vec3(1.0f, 2.2f, 0.7f);
+
+// Keyframes per second the clips are baked at
+static const float sSampleRate = 30.0f;
+
+// Indices of the bones
+static const int sHips = 0, sSpine = 1, sChest = 2, sHead = 3;
+static const int sLeftUpperArm = 4, sLeftLowerArm = 5, sRightUpperArm = 6, sRightLowerArm = 7;
+static const int sLeftUpperLeg = 8, sLeftLowerLeg = 9, sRightUpperLeg = 10, sRightLowerLeg = 11;
+static const size_t sBoneCount = 12;
+
+// A bone of the figure and the box around it
+struct MannequinBone
+{
+    int parent;
+
+    // Translation relative to the parent in the bind pose
+    glm::vec3 translation;
+
+    // Height of the box's bottom and top relative to the bone, and half its width and depth.
+    // The box starts at the bone's joint, above it for the spine and head, below it for the limbs
+    float bottom, top;
+    float halfWidth, halfDepth;
+};
+
+static const MannequinBone sBones[sBoneCount] = {
+    {-1, glm::vec3(0.0f, 0.95f, 0.0f), -0.1f, 0.12f, 0.17f, 0.1f},
+    {sHips, glm::vec3(0.0f, 0.1f, 0.0f), 0.0f, 0.25f, 0.15f, 0.09f},
+    {sSpine, glm::vec3(0.0f, 0.25f, 0.0f), -0.02f, 0.27f, 0.19f, 0.11f},
+    {sChest, glm::vec3(0.0f, 0.27f, 0.0f), 0.02f, 0.3f, 0.1f, 0.11f},
+    {sChest, glm::vec3(0.25f, 0.2f, 0.0f), -0.3f, 0.04f, 0.05f, 0.05f},
+    {sLeftUpperArm, glm::vec3(0.0f, -0.3f, 0.0f), -0.3f, 0.02f, 0.045f, 0.045f},
+    {sChest, glm::vec3(-0.25f, 0.2f, 0.0f), -0.3f, 0.04f, 0.05f, 0.05f},
+    {sRightUpperArm, glm::vec3(0.0f, -0.3f, 0.0f), -0.3f, 0.02f, 0.045f, 0.045f},
+    {sHips, glm::vec3(0.1f, -0.05f, 0.0f), -0.43f, 0.02f, 0.065f, 0.07f},
+    {sLeftUpperLeg, glm::vec3(0.0f, -0.43f, 0.0f), -0.45f, 0.02f, 0.06f, 0.06f},
+    {sHips, glm::vec3(-0.1f, -0.05f, 0.0f), -0.43f, 0.02f, 0.065f, 0.07f},
+    {sRightUpperLeg, glm::vec3(0.0f, -0.43f, 0.0f), -0.45f, 0.02f, 0.06f, 0.06f}};
+
+// Rings of vertices along each box, and the share of its length from the joint where the parent still pulls on it
+static const int sRingCount = 5;
+static const float sBlendLength = 0.4f;
+
+Skeleton *Mannequin::CreateSkeleton()
+{
+    Skeleton *skeleton = new Skeleton();
+    for (const MannequinBone &bone : sBones)
+    {
+        skeleton->AddBone(bone.parent, bone.translation);
+    }
+    return skeleton;
+}
+
+VertexBuffer *Mannequin::CreateVertexBuffer()
+{
+    std::vector<VertexSkinnedTexture> vertices;
+    std::vector<uint16_t> indices;
+
+    // Every bind rotation is the identity, so a bone's origin in the mesh is the sum of the translations
+    glm::vec3 origins[sBoneCount];
+    for (size_t b = 0; b < sBoneCount; ++b)
+    {
+        const MannequinBone &bone = sBones[b];
+        origins[b] = bone.parent < 0 ? bone.translation : origins[bone.parent] + bone.translation;
+
+        // Corners of the cross section, counter-clockwise seen from above
+        glm::vec2 corners[4] = {glm::vec2(-bone.halfWidth, bone.halfDepth), glm::vec2(bone.halfWidth, bone.halfDepth), glm::vec2(bone.halfWidth, -bone.halfDepth),
+                                glm::vec2(-bone.halfWidth, -bone.halfDepth)};
+        bool jointAtTop = bone.bottom + bone.top < 0.0f;
+        float length = bone.top - bone.bottom;
+
+        //   Vertex builds a vertex of the box at a corner and height, near the joint it
+        //   blends into the parent so the boxes bend without tearing apart:
+        // - const glm::vec2& for the corner
+        // - float for the height relative to the bone
+        // - const glm::vec2& for the texture coordinate
+        auto vertex = [&](const glm::vec2 &corner, float height, const glm::vec2 &uv)
+        {
+            VertexSkinnedTexture v;
+            v.pos = origins[b] + glm::vec3(corner.x, height, corner.y);
+            v.uv = uv;
+            float distance = (jointAtTop ? bone.top - height : height - bone.bottom) / length;
+            float parentWeight = bone.parent < 0 ? 0.0f : 0.5f * std::fmax(0.0f, 1.0f - distance / sBlendLength);
+            v.bones = BoneIndices(static_cast<uint8_t>(b), static_cast<uint8_t>(bone.parent < 0 ? b : bone.parent));
+            v.weights = BoneWeights(glm::vec4(1.0f - parentWeight, parentWeight, 0.0f, 0.0f));
+            vertices.emplace_back(v);
+            return static_cast<uint16_t>(vertices.size() - 1);
+        };
+
+        // The four sides in rings along the length
+        for (int side = 0; side < 4; ++side)
+        {
+            const glm::vec2 &left = corners[side];
+            const glm::vec2 &right = corners[(side + 1) % 4];
+            uint16_t first = static_cast<uint16_t>(vertices.size());
+            for (int ring = 0; ring < sRingCount; ++ring)
+            {
+                float v = static_cast<float>(ring) / (sRingCount - 1);
+                float height = bone.bottom + length * v;
+                vertex(left, height, glm::vec2(0.0f, v));
+                vertex(right, height, glm::vec2(1.0f, v));
+            }
+            for (int ring = 0; ring + 1 < sRingCount; ++ring)
+            {
+                uint16_t bottomLeft = first + ring * 2, bottomRight = bottomLeft + 1, topLeft = bottomLeft + 2, topRight = bottomLeft + 3;
+                indices.insert(indices.end(), {bottomLeft, bottomRight, topRight, bottomLeft, topRight, topLeft});
+            }
+        }
+
+        // The caps, the bottom one faces down
+        uint16_t top[4], bottom[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            glm::vec2 uv = glm::vec2(c == 1 || c == 2 ? 1.0f : 0.0f, c >= 2 ? 1.0f : 0.0f);
+            top[c] = vertex(corners[c], bone.top, uv);
+            bottom[c] = vertex(corners[c], bone.bottom, uv);
+        }
+        indices.insert(indices.end(), {top[0], top[1], top[2], top[0], top[2], top[3]});
+        indices.insert(indices.end(), {bottom[0], bottom[2], bottom[1], bottom[0], bottom[3], bottom[2]});
+    }
+
+    return new VertexBuffer(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+//   BakeClip samples curves of the bones into the keyframes of a clip:
+// - float for the seconds of the clip
+// - void(*)(float, glm::quat*, glm::vec3*) for the curves, which move the bones from the bind
+//   pose at an angle from 0 to 2 pi over the clip
+static AnimationClip *BakeClip(float duration, void (*curves)(float phase, glm::quat *rotations, glm::vec3 *translations))
+{
+    size_t frameCount = static_cast<size_t>(std::round(duration * sSampleRate));
+    std::vector<glm::quat> rotations(frameCount * sBoneCount, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    std::vector<glm::vec3> translations(frameCount * sBoneCount);
+    for (size_t frame = 0; frame < frameCount; ++frame)
+    {
+        for (size_t b = 0; b < sBoneCount; ++b)
+        {
+            translations[frame * sBoneCount + b] = sBones[b].translation;
+        }
+        float phase = 6.2831853f * frame / frameCount;
+        curves(phase, &rotations[frame * sBoneCount], &translations[frame * sBoneCount]);
+    }
+    return new AnimationClip(sBoneCount, sSampleRate, rotations, translations);
+}
+
+AnimationClip *Mannequin::CreateWalkClip()
+{
+    return BakeClip(1.0f, [](float phase, glm::quat *r, glm::vec3 *t)
+                    {
+                        const glm::vec3 x = glm::vec3(1.0f, 0.0f, 0.0f), y = glm::vec3(0.0f, 1.0f, 0.0f), z = glm::vec3(0.0f, 0.0f, 1.0f);
+                        float s = std::sin(phase);
+
+                        // The hips bob twice a step and twist against the shoulders
+                        t[sHips].y += 0.03f * std::cos(phase * 2.0f);
+                        r[sHips] = glm::angleAxis(0.1f * s, y);
+                        r[sSpine] = glm::angleAxis(-0.15f * s, y);
+
+                        // The legs swing forward and back, the knees bend while a leg swings forward
+                        r[sLeftUpperLeg] = glm::angleAxis(-0.5f * s, x);
+                        r[sLeftLowerLeg] = glm::angleAxis(0.4f * (1.0f + std::sin(phase + 1.2f)), x);
+                        r[sRightUpperLeg] = glm::angleAxis(0.5f * s, x);
+                        r[sRightLowerLeg] = glm::angleAxis(0.4f * (1.0f - std::sin(phase + 1.2f)), x);
+
+                        // The arms swing against the legs
+                        r[sLeftUpperArm] = glm::angleAxis(0.1f, z) * glm::angleAxis(0.4f * s, x);
+                        r[sLeftLowerArm] = glm::angleAxis(-0.3f - 0.15f * s, x);
+                        r[sRightUpperArm] = glm::angleAxis(-0.1f, z) * glm::angleAxis(-0.4f * s, x);
+                        r[sRightLowerArm] = glm::angleAxis(-0.3f + 0.15f * s, x); });
+}
+
+AnimationClip *Mannequin::CreateWaveClip()
+{
+    return BakeClip(2.0f, [](float phase, glm::quat *r, glm::vec3 *t)
+                    {
+                        const glm::vec3 x = glm::vec3(1.0f, 0.0f, 0.0f), y = glm::vec3(0.0f, 1.0f, 0.0f), z = glm::vec3(0.0f, 0.0f, 1.0f);
+                        float s = std::sin(phase);
+
+                        // Breathing and looking around
+                        t[sHips].y += 0.01f * s;
+                        r[sChest] = glm::angleAxis(0.03f * s, x);
+                        r[sHead] = glm::angleAxis(0.3f * s, y);
+
+                        // The right arm is raised and the forearm waves four times
+                        r[sRightUpperArm] = glm::angleAxis(-2.5f, z);
+                        r[sRightLowerArm] = glm::angleAxis(0.5f * std::sin(phase * 4.0f), z);
+                        r[sLeftUpperArm] = glm::angleAxis(0.08f, z);
+                        r[sLeftLowerArm] = glm::angleAxis(-0.2f, x); });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <glm/glm.hpp>
+
+class AnimationClip;
+class Skeleton;
+class VertexBuffer;
+
+// Mannequin builds a jointed figure out of boxes: its skeleton of 12 bones, a skinned mesh
+// and clips of it walking and waving, baked from curves at 30 keyframes per second. It stands
+// in for a character imported with its animations. The mesh is about 1.9 units tall, stands on
+// the origin and faces +z. Everything is created for the caller to own
+class Mannequin
+{
+public:
+    // Creates the skeleton, in the bind pose every bone has the identity rotation
+    static Skeleton *CreateSkeleton();
+
+    // Creates the skinned mesh of the skeleton, where the boxes meet the vertices blend both bones
+    static VertexBuffer *CreateVertexBuffer();
+
+    // Creates a clip of a one second walk cycle in place
+    static AnimationClip *CreateWalkClip();
+
+    // Creates a clip of two seconds of waving with one arm
+    static AnimationClip *CreateWaveClip();
+
+    // Corners of the box the figure stays in while it plays the clips
+    static const glm::vec3 sBoundsMin;
+    static const glm::vec3 sBoundsMax;
+};
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &fileName)
+    : mData(nullptr), mSize(0), mIsOpen(false), mFile(INVALID_HANDLE_VALUE), mMapping(nullptr)
+{
+    mFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        std::cout << "Can't open file " << fileName << std::endl;
+        return;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(mFile, &size);
+    mSize = static_cast<size_t>(size.QuadPart);
+    mIsOpen = true;
+
+    // Files with no bytes can't be mapped
+    if (mSize == 0)
+    {
+        return;
+    }
+
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping)
+    {
+        mData = static_cast<const char *>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!mData)
+    {
+        std::cout << "Can't map file " << fileName << std::endl;
+        mIsOpen = false;
+        mSize = 0;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping)
+    {
+        CloseHandle(mMapping);
+    }
+    if (mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+    }
+    mData = nullptr;
+    mSize = 0;
+}
+#else
+MappedFile::MappedFile(const std::string &fileName)
+    : mData(nullptr), mSize(0), mIsOpen(false)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cout << "Can't open file " << fileName << std::endl;
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0)
+    {
+        mSize = static_cast<size_t>(info.st_size);
+        mIsOpen = true;
+
+        // Files with no bytes can't be mapped
+        if (mSize > 0)
+        {
+            void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                mData = static_cast<const char *>(data);
+                // The file is parsed from front to back
+                madvise(data, mSize, MADV_SEQUENTIAL);
+            }
+            else
+            {
+                std::cout << "Can't map file " << fileName << std::endl;
+                mIsOpen = false;
+                mSize = 0;
+            }
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+    {
+        munmap(const_cast<char *>(mData), mSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// MappedFile maps a whole file read-only into memory so it can be parsed
+// in place. The operating system pages the file in on demand, which avoids
+// copying it into a buffer first. Large binary data (such as glTF .glb buffers)
+// is read straight out of the mapping.
+class MappedFile
+{
+public:
+    //   MappedFile constructor:
+    // - const std::string& for the file path to map
+    MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns true if the file was opened and mapped
+    bool IsOpen() const { return mIsOpen; }
+
+    // Getters for the mapped bytes and the size of the file in bytes
+    const char *GetData() const { return mData; }
+    size_t GetSize() const { return mSize; }
+
+private:
+    // Pointer to the start of the mapping
+    const char *mData;
+
+    // Size of the file in bytes
+    size_t mSize;
+
+    // Bool for if the file was opened, an empty file has no mapping
+    bool mIsOpen;
+
+#ifdef _WIN32
+    // Windows file and file mapping handles
+    void *mFile;
+    void *mMapping;
+#endif
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LodSelector.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "VertexBuffer.h"
+#include "VertexFormats.h"
+
+// MeshData is the CPU side geometry of a single mesh primitive produced
+// by the model importers. It has no OpenGL resources, so it can be built
+// on worker threads and turned into a VertexBuffer on the main thread.
+struct MeshData
+{
+    // Name of the mesh (object/group in .obj files, mesh name in glTF)
+    std::string name;
+
+    // Vertices of the mesh
+    std::vector<VertexNormalTexture> vertices;
+
+    // Triangle list indices into the vertices. With levels of detail, every level's indices
+    // are stored one after another and all of them index the same vertices
+    std::vector<uint32_t> indices;
+
+    // Levels of detail, finest first (see MeshSimplifier::GenerateLods). Empty if the
+    // whole index buffer is a single level
+    std::vector<MeshLod> lods;
+
+    // Meshlets of the full detail level, whose triangles are the start of the index buffer
+    // (see MeshletBuilder::Build). Empty if the mesh is too small to be split
+    std::vector<Meshlet> meshlets;
+
+    // Bounding sphere of the vertices in model space
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+
+    // Computes the bounding sphere around the center of the vertices' bounding box
+    void ComputeBounds()
+    {
+        if (vertices.empty())
+        {
+            return;
+        }
+        glm::vec3 min = vertices[0].pos;
+        glm::vec3 max = vertices[0].pos;
+        for (const VertexNormalTexture &v : vertices)
+        {
+            min = glm::min(min, v.pos);
+            max = glm::max(max, v.pos);
+        }
+        boundsCenter = (min + max) * 0.5f;
+        boundsRadius = 0.0f;
+        for (const VertexNormalTexture &v : vertices)
+        {
+            boundsRadius = glm::max(boundsRadius, glm::length(v.pos - boundsCenter));
+        }
+    }
+
+    // Largest position coordinate that is stored as a half float. Half floats keep 11 significant
+    // bits, so vertices up to this far from the origin are placed with a precision of a quarter unit
+    static constexpr float kMaxPackedPosition = 256.0f;
+
+    //   Returns true if the mesh can use the quantized VertexPackedNormalTexture layout without
+    //   visible loss: every uv must be in [0, 1] and every position within kMaxPackedPosition
+    bool CanPack() const
+    {
+        for (const VertexNormalTexture &v : vertices)
+        {
+            if (glm::any(glm::greaterThan(glm::abs(v.pos), glm::vec3(kMaxPackedPosition))) ||
+                glm::any(glm::lessThan(v.uv, glm::vec2(0.0f))) || glm::any(glm::greaterThan(v.uv, glm::vec2(1.0f))))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Creates an indexed VertexBuffer from the mesh, with 16-bit indices if they fit and
+    // half the vertex size if the mesh can be quantized. Must be called on the main thread
+    VertexBuffer *CreateVertexBuffer() const
+    {
+        if (CanPack())
+        {
+            std::vector<VertexPackedNormalTexture> packed;
+            packed.reserve(vertices.size());
+            for (const VertexNormalTexture &v : vertices)
+            {
+                packed.push_back({HalfPosition(v.pos), PackedNormal(v.normal), UNormUV(v.uv)});
+            }
+            return CreateVertexBuffer(packed);
+        }
+        return CreateVertexBuffer(vertices);
+    }
+
+private:
+    // Creates an indexed VertexBuffer from vertices of any layout with the mesh's indices
+    template <class TVertex>
+    VertexBuffer *CreateVertexBuffer(const std::vector<TVertex> &vertexData) const
+    {
+        if (MeshOptimizer::Fits16BitIndices(vertexData.size()))
+        {
+            std::vector<uint16_t> shortIndices = MeshOptimizer::To16BitIndices(indices);
+            return new VertexBuffer(vertexData.data(), vertexData.size(), shortIndices.data(), shortIndices.size());
+        }
+        return new VertexBuffer(vertexData.data(), vertexData.size(), indices.data(), indices.size());
+    }
+};
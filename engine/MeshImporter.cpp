@@ -0,0 +1,94 @@
+#include "MeshImporter.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <memory>
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+
+bool MeshImporter::Load(const std::string &fileName, std::vector<MeshData> &meshes)
+{
+    // Get the lower case file extension
+    size_t dot = fileName.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : fileName.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+
+    if (extension != "obj" && extension != "gltf" && extension != "glb")
+    {
+        std::cout << "Unsupported model format " << fileName << std::endl;
+        return false;
+    }
+
+    MappedFile file(fileName);
+    if (!file.IsOpen())
+    {
+        return false;
+    }
+
+    size_t firstMesh = meshes.size();
+    bool loaded = extension == "obj" ? LoadObj(file, meshes) : LoadGltf(fileName, file, meshes);
+    if (!loaded)
+    {
+        return false;
+    }
+
+    // Optimize every imported mesh for the GPU, split it into meshlets and
+    // generate its levels of detail as its own job
+    JobSystem::Get()->ParallelFor(meshes.size() - firstMesh, 1, [&meshes, firstMesh](size_t begin, size_t end)
+                                  {
+                                      for (size_t m = begin; m < end; ++m)
+                                      {
+                                          MeshOptimizer::Optimize(meshes[firstMesh + m]);
+                                          MeshletBuilder::Build(meshes[firstMesh + m]);
+                                          MeshSimplifier::GenerateLods(meshes[firstMesh + m]);
+                                      } });
+    return true;
+}
+
+std::future<std::vector<MeshData>> MeshImporter::LoadAsync(const std::string &fileName)
+{
+    auto promise = std::make_shared<std::promise<std::vector<MeshData>>>();
+    std::future<std::vector<MeshData>> future = promise->get_future();
+
+    JobSystem::Get()->Schedule([fileName, promise]()
+                               {
+                                   std::vector<MeshData> meshes;
+                                   if (!Load(fileName, meshes))
+                                   {
+                                       std::cout << "Failed to load model " << fileName << std::endl;
+                                   }
+                                   promise->set_value(std::move(meshes)); });
+
+    return future;
+}
+
+void MeshImporter::GenerateNormals(MeshData &mesh, const std::vector<uint8_t> *missing)
+{
+    std::vector<glm::vec3> normals(mesh.vertices.size(), glm::vec3(0.0f));
+
+    // The cross product's length is twice the triangle's area, so
+    // larger triangles contribute more to their vertices' normals
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        uint32_t i0 = mesh.indices[i], i1 = mesh.indices[i + 1], i2 = mesh.indices[i + 2];
+        const glm::vec3 &p0 = mesh.vertices[i0].pos;
+        glm::vec3 faceNormal = glm::cross(mesh.vertices[i1].pos - p0, mesh.vertices[i2].pos - p0);
+        normals[i0] += faceNormal;
+        normals[i1] += faceNormal;
+        normals[i2] += faceNormal;
+    }
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        if (missing && !(*missing)[i])
+        {
+            continue;
+        }
+        float length = glm::length(normals[i]);
+        mesh.vertices[i].normal = length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <future>
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+class MappedFile;
+
+// MeshImporter loads model files into MeshData that can be turned into
+// VertexBuffers. Supported formats are Wavefront .obj and glTF 2.0
+// (.gltf with external or embedded buffers, and binary .glb).
+// Files are memory mapped and parsed in place without building strings
+// for each token. Parsing is split across the JobSystem's worker threads:
+// .obj files are parsed in chunks of lines, and every object/group of an
+// .obj or primitive of a glTF mesh is assembled as its own job.
+// Every imported mesh is run through the MeshOptimizer, split into meshlets
+// and gets simplified levels of detail from the MeshSimplifier before it is returned.
+class MeshImporter
+{
+public:
+    //   Load imports every mesh of a model file on the calling thread, using worker threads
+    //   for the parsing. Returns false if the file could not be read or parsed:
+    // - const std::string& for the file path of the model
+    // - std::vector<MeshData>& that the imported meshes are appended to
+    static bool Load(const std::string &fileName, std::vector<MeshData> &meshes);
+
+    //   LoadAsync imports a model file on a worker thread. Several files can be loaded in parallel:
+    // - const std::string& for the file path of the model
+    static std::future<std::vector<MeshData>> LoadAsync(const std::string &fileName);
+
+    //   GenerateNormals computes smooth vertex normals by averaging the
+    //   area weighted normals of the triangles using each vertex:
+    // - MeshData& for the mesh
+    // - const std::vector<uint8_t>* for a flag per vertex, set if the vertex needs a normal.
+    //   The others keep the normal they have. nullptr generates every normal
+    static void GenerateNormals(MeshData &mesh, const std::vector<uint8_t> *missing = nullptr);
+
+private:
+    // Wavefront .obj importer
+    static bool LoadObj(const MappedFile &file, std::vector<MeshData> &meshes);
+
+    // glTF 2.0 importer for both .gltf and .glb files
+    static bool LoadGltf(const std::string &fileName, const MappedFile &file, std::vector<MeshData> &meshes);
+};
@@ -0,0 +1,469 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "MeshData.h"
+
+// Size of the simulated LRU cache used for Forsyth's scoring
+static const int sForsythCacheSize = 32;
+
+// Score of a vertex given its position in the LRU cache and the number of triangles still using it
+static float ForsythScore(int cachePosition, unsigned int valence)
+{
+    if (valence == 0)
+    {
+        // No triangle needs this vertex anymore
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The last triangle's vertices get a fixed score so the
+            // next triangle does not just reuse the same edge
+            score = 0.75f;
+        }
+        else
+        {
+            float scale = 1.0f / (sForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+        }
+    }
+
+    // Boost vertices with few triangles left so they are finished off early
+    score += 2.0f / std::sqrt(static_cast<float>(valence));
+    return score;
+}
+
+// Hashes the bytes of a vertex (FNV-1a)
+static uint64_t HashVertex(const unsigned char *vertex, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= vertex[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t MeshOptimizer::WeldVertices(const void *vertices, size_t vertexCount, size_t vertexSize, std::vector<uint32_t> &remap)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(vertices);
+    remap.assign(vertexCount, 0);
+
+    // Open addressing table of unique vertex indices
+    size_t tableSize = 16;
+    while (tableSize < vertexCount * 2)
+    {
+        tableSize *= 2;
+    }
+    const uint32_t empty = ~0u;
+    std::vector<uint32_t> table(tableSize, empty);
+    size_t mask = tableSize - 1;
+
+    // Unique vertices are numbered in order of first appearance
+    size_t uniqueCount = 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const unsigned char *vertex = bytes + v * vertexSize;
+        size_t slot = static_cast<size_t>(HashVertex(vertex, vertexSize)) & mask;
+        while (table[slot] != empty && std::memcmp(bytes + table[slot] * vertexSize, vertex, vertexSize) != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        if (table[slot] == empty)
+        {
+            table[slot] = static_cast<uint32_t>(v);
+            remap[v] = static_cast<uint32_t>(uniqueCount++);
+        }
+        else
+        {
+            remap[v] = remap[table[slot]];
+        }
+    }
+    return uniqueCount;
+}
+
+void MeshOptimizer::RemapVertices(void *destination, const void *vertices, size_t vertexCount, size_t vertexSize, const std::vector<uint32_t> &remap)
+{
+    unsigned char *dst = static_cast<unsigned char *>(destination);
+    const unsigned char *src = static_cast<const unsigned char *>(vertices);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        std::memcpy(dst + remap[v] * vertexSize, src + v * vertexSize, vertexSize);
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Build the list of triangles using each vertex
+    std::vector<unsigned int> valence(vertexCount, 0);
+    for (uint32_t i : indices)
+    {
+        ++valence[i];
+    }
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + valence[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            adjacency[fill[indices[t * 3 + c]]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    // valence now counts the triangles that still have to be emitted. The first
+    // valence[v] entries of a vertex's adjacency are its live triangles
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = ForsythScore(-1, valence[v]);
+    }
+
+    // Start with the best scoring triangle of the whole mesh
+    std::vector<bool> emitted(triangleCount, false);
+    int bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = static_cast<int>(t);
+        }
+    }
+
+    std::vector<uint32_t> cache;
+    cache.reserve(sForsythCacheSize + 3);
+    std::vector<uint32_t> newCache;
+    newCache.reserve(sForsythCacheSize + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    size_t nextUnemitted = 0;
+
+    for (size_t n = 0; n < triangleCount; ++n)
+    {
+        // Fall back to the next triangle in input order when nothing in the cache scores
+        if (bestTriangle < 0)
+        {
+            while (emitted[nextUnemitted])
+            {
+                ++nextUnemitted;
+            }
+            bestTriangle = static_cast<int>(nextUnemitted);
+        }
+
+        // Emit the triangle
+        size_t t = static_cast<size_t>(bestTriangle);
+        emitted[t] = true;
+        const uint32_t *tri = &indices[t * 3];
+        result.insert(result.end(), tri, tri + 3);
+
+        // Remove the triangle from its vertices' live triangles
+        for (int c = 0; c < 3; ++c)
+        {
+            uint32_t v = tri[c];
+            unsigned int *live = &adjacency[adjacencyOffsets[v]];
+            for (unsigned int i = 0; i < valence[v]; ++i)
+            {
+                if (live[i] == t)
+                {
+                    std::swap(live[i], live[valence[v] - 1]);
+                    break;
+                }
+            }
+            --valence[v];
+        }
+
+        // Push the triangle's vertices to the front of the LRU cache
+        newCache.assign(tri, tri + 3);
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // Rescore every vertex in the cache, including the ones that just fell out of it
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            uint32_t v = newCache[i];
+            cachePosition[v] = i < static_cast<size_t>(sForsythCacheSize) ? static_cast<int>(i) : -1;
+            vertexScore[v] = ForsythScore(cachePosition[v], valence[v]);
+        }
+        newCache.resize(std::min(newCache.size(), static_cast<size_t>(sForsythCacheSize)));
+        cache.swap(newCache);
+
+        // Rescore the live triangles of the cached vertices and pick the best one
+        bestTriangle = -1;
+        bestScore = -1.0f;
+        for (uint32_t v : cache)
+        {
+            const unsigned int *live = &adjacency[adjacencyOffsets[v]];
+            for (unsigned int i = 0; i < valence[v]; ++i)
+            {
+                unsigned int lt = live[i];
+                float score = vertexScore[indices[lt * 3]] + vertexScore[indices[lt * 3 + 1]] + vertexScore[indices[lt * 3 + 2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = static_cast<int>(lt);
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t> &indices, const float *positions, size_t vertexCount, size_t vertexStride, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    auto position = [&](uint32_t v)
+    {
+        const float *p = reinterpret_cast<const float *>(reinterpret_cast<const unsigned char *>(positions) + v * vertexStride);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Split into clusters where the cache is flushed, which is where a
+    // triangle misses the cache on all three of its vertices
+    const unsigned int cacheSize = 16;
+    std::vector<unsigned int> timestamp(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    std::vector<size_t> clusters;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int misses = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            uint32_t v = indices[t * 3 + c];
+            if (time - timestamp[v] > cacheSize)
+            {
+                timestamp[v] = time++;
+                ++misses;
+            }
+        }
+        if (t == 0 || misses == 3)
+        {
+            clusters.push_back(t);
+        }
+    }
+    if (clusters.size() < 2)
+    {
+        return;
+    }
+
+    // Area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        glm::vec3 a = position(indices[t * 3]);
+        glm::vec3 b = position(indices[t * 3 + 1]);
+        glm::vec3 c = position(indices[t * 3 + 2]);
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+    // Sort key of each cluster: how much it faces away from the mesh's centroid
+    std::vector<float> sortKey(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        size_t begin = clusters[i];
+        size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = begin; t < end; ++t)
+        {
+            glm::vec3 a = position(indices[t * 3]);
+            glm::vec3 b = position(indices[t * 3 + 1]);
+            glm::vec3 c = position(indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        centroid = area > 0.0f ? centroid / area : centroid;
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : normal;
+        sortKey[i] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<size_t> order(clusters.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b)
+                     { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (size_t i : order)
+    {
+        size_t begin = clusters[i];
+        size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+    }
+
+    // Keep the vertex cache order if the new order costs too many cache misses
+    float before = AnalyzeVertexCache(indices, vertexCount).acmr;
+    float after = AnalyzeVertexCache(result, vertexCount).acmr;
+    if (after <= before * threshold)
+    {
+        indices.swap(result);
+    }
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(void *vertices, std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexSize)
+{
+    // Number the vertices in the order they are first referenced
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+    for (uint32_t &i : indices)
+    {
+        if (remap[i] == unused)
+        {
+            remap[i] = next++;
+        }
+        i = remap[i];
+    }
+
+    std::vector<unsigned char> reordered(static_cast<size_t>(next) * vertexSize);
+    const unsigned char *src = static_cast<const unsigned char *>(vertices);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] != unused)
+        {
+            std::memcpy(&reordered[remap[v] * vertexSize], src + v * vertexSize, vertexSize);
+        }
+    }
+    std::memcpy(vertices, reordered.data(), reordered.size());
+    return next;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0)
+    {
+        return stats;
+    }
+
+    // A vertex is in the FIFO cache if fewer than cacheSize misses happened since it was inserted
+    std::vector<unsigned int> timestamp(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    for (uint32_t v : indices)
+    {
+        if (time - timestamp[v] > cacheSize)
+        {
+            timestamp[v] = time++;
+            ++misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    return stats;
+}
+
+size_t MeshOptimizer::Optimize(std::vector<unsigned char> &vertices, std::vector<uint32_t> &indices, size_t vertexSize, const char *name)
+{
+    size_t vertexCount = vertices.size() / vertexSize;
+
+    // Unindexed meshes draw their vertices in order
+    if (indices.empty())
+    {
+        indices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            indices[i] = static_cast<uint32_t>(i);
+        }
+    }
+    if (indices.size() < 3)
+    {
+        return vertexCount;
+    }
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertexCount);
+
+    // Weld the duplicate vertices
+    std::vector<uint32_t> remap;
+    size_t uniqueCount = WeldVertices(vertices.data(), vertexCount, vertexSize, remap);
+    if (uniqueCount < vertexCount)
+    {
+        std::vector<unsigned char> welded(uniqueCount * vertexSize);
+        RemapVertices(welded.data(), vertices.data(), vertexCount, vertexSize, remap);
+        vertices.swap(welded);
+        for (uint32_t &i : indices)
+        {
+            i = remap[i];
+        }
+        vertexCount = uniqueCount;
+    }
+
+    OptimizeVertexCache(indices, vertexCount);
+    OptimizeOverdraw(indices, reinterpret_cast<const float *>(vertices.data()), vertexCount, vertexSize);
+    vertexCount = OptimizeVertexFetch(vertices.data(), indices, vertexCount, vertexSize);
+    vertices.resize(vertexCount * vertexSize);
+
+    VertexCacheStats after = AnalyzeVertexCache(indices, vertexCount);
+    std::cout << "Optimized mesh " << name << ": ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
+    return vertexCount;
+}
+
+void MeshOptimizer::Optimize(MeshData &mesh)
+{
+    // Run the pipeline on the raw bytes of the vertices
+    size_t vertexSize = sizeof(VertexNormalTexture);
+    std::vector<unsigned char> bytes(mesh.vertices.size() * vertexSize);
+    std::memcpy(bytes.data(), mesh.vertices.data(), bytes.size());
+
+    size_t vertexCount = Optimize(bytes, mesh.indices, vertexSize, mesh.name.c_str());
+
+    mesh.vertices.resize(vertexCount);
+    std::memcpy(mesh.vertices.data(), bytes.data(), vertexCount * vertexSize);
+}
+
+std::vector<uint16_t> MeshOptimizer::To16BitIndices(const std::vector<uint32_t> &indices)
+{
+    std::vector<uint16_t> result(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        result[i] = static_cast<uint16_t>(indices[i]);
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+
+// Statistics of how well an index buffer uses the GPU's post-transform vertex cache
+struct VertexCacheStats
+{
+    // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal, 3.0 is worst)
+    float acmr = 0.0f;
+
+    // Average transformed to vertex ratio: transformed vertices per unique vertex (1.0 is ideal)
+    float atvr = 0.0f;
+};
+
+// MeshOptimizer reorders mesh data so the GPU processes it faster. It is run
+// at import time and works on raw vertex bytes so any vertex format can be used.
+// The pipeline (Optimize) runs these steps in order:
+// - WeldVertices merges duplicate vertices and builds an index buffer
+// - OptimizeVertexCache reorders triangles for the post-transform vertex cache (Forsyth)
+// - OptimizeOverdraw reorders clusters of triangles so outward facing ones are drawn first
+// - OptimizeVertexFetch reorders vertices by first use for vertex fetch locality
+class MeshOptimizer
+{
+public:
+    //   WeldVertices finds vertices with identical bytes and returns a remap table
+    //   from each old vertex to its unique vertex. Returns the number of unique vertices:
+    // - const void* for the vertices
+    // - size_t for the number of vertices
+    // - size_t for the size of a vertex in bytes
+    // - std::vector<uint32_t>& that receives the remap table
+    static size_t WeldVertices(const void *vertices, size_t vertexCount, size_t vertexSize, std::vector<uint32_t> &remap);
+
+    //   RemapVertices moves vertices to their new location in a remap table:
+    // - void* for the destination, large enough for every remapped vertex
+    // - const void* for the source vertices
+    // - size_t for the number of source vertices
+    // - size_t for the size of a vertex in bytes
+    // - const std::vector<uint32_t>& for the remap table
+    static void RemapVertices(void *destination, const void *vertices, size_t vertexCount, size_t vertexSize, const std::vector<uint32_t> &remap);
+
+    //   OptimizeVertexCache reorders triangles to improve post-transform vertex cache hits
+    //   using Tom Forsyth's linear-speed vertex cache optimization:
+    // - std::vector<uint32_t>& for the triangle list indices, reordered in place
+    // - size_t for the number of vertices
+    static void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+    //   OptimizeOverdraw splits a vertex cache optimized index buffer into clusters and sorts them
+    //   so that clusters facing away from the mesh's center are drawn first, which lets early depth
+    //   testing reject more of the hidden fragments. The new order is only kept if it does not make
+    //   the vertex cache miss ratio worse than the threshold allows:
+    // - std::vector<uint32_t>& for the triangle list indices, reordered in place
+    // - const float* for the first vertex's position (3 floats)
+    // - size_t for the number of vertices
+    // - size_t for the distance in bytes between two vertices' positions
+    // - float for how much worse the ACMR is allowed to get (1.05 allows 5%)
+    static void OptimizeOverdraw(std::vector<uint32_t> &indices, const float *positions, size_t vertexCount, size_t vertexStride, float threshold = 1.05f);
+
+    //   OptimizeVertexFetch reorders vertices in the order they are first used by the indices.
+    //   Unused vertices are dropped. Returns the number of vertices left:
+    // - void* for the vertices, reordered in place
+    // - std::vector<uint32_t>& for the indices, rewritten to the new vertex order
+    // - size_t for the number of vertices
+    // - size_t for the size of a vertex in bytes
+    static size_t OptimizeVertexFetch(void *vertices, std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexSize);
+
+    //   AnalyzeVertexCache simulates a FIFO post-transform vertex cache:
+    // - const std::vector<uint32_t>& for the triangle list indices
+    // - size_t for the number of vertices
+    // - unsigned int for the number of cache entries
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+    //   Optimize runs the whole pipeline on a mesh and prints its ACMR/ATVR before and after:
+    // - MeshData& for the mesh
+    static void Optimize(MeshData &mesh);
+
+    //   Optimize runs the whole pipeline on raw vertices whose position is the first 3 floats
+    //   of each vertex. Returns the number of vertices left:
+    // - std::vector<unsigned char>& for the vertex bytes, rewritten in place
+    // - std::vector<uint32_t>& for the indices. If empty, the vertices are treated as a triangle list
+    // - size_t for the size of a vertex in bytes
+    // - const char* for the name printed with the statistics
+    static size_t Optimize(std::vector<unsigned char> &vertices, std::vector<uint32_t> &indices, size_t vertexSize, const char *name);
+
+    //   Returns true if every index fits into a 16-bit index buffer:
+    // - size_t for the number of vertices
+    static bool Fits16BitIndices(size_t vertexCount) { return vertexCount <= 0xFFFF; }
+
+    //   Converts 32-bit indices to 16-bit indices, only valid if Fits16BitIndices is true:
+    // - const std::vector<uint32_t>& for the indices
+    static std::vector<uint16_t> To16BitIndices(const std::vector<uint32_t> &indices);
+};
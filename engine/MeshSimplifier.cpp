@@ -0,0 +1,341 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+
+// Stop adding levels once a level keeps more than this fraction of the previous level's triangles
+static const float sMinLodReduction = 0.9f;
+
+// Meshes with fewer triangles than this do not get another level
+static const size_t sMinLodTriangles = 16;
+
+// A collapse is rejected if it rotates a triangle's normal by more than about 78 degrees
+static const float sMaxNormalChange = 0.2f;
+
+// Symmetric 4x4 matrix of the sum of squared distances to a set of planes, weighted by area
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+
+    Quadric &operator+=(const Quadric &q)
+    {
+        a00 += q.a00, a01 += q.a01, a02 += q.a02, a11 += q.a11, a12 += q.a12, a22 += q.a22;
+        b0 += q.b0, b1 += q.b1, b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+        return *this;
+    }
+};
+
+// An edge that can be collapsed by moving its first vertex onto its second
+struct Collapse
+{
+    // Quadric error of the collapse (squared distance)
+    double error;
+    // Position ids of the vertex that is removed and the vertex that is kept
+    uint32_t from, to;
+    // Vertex the removed vertex's indices are rewritten to
+    uint32_t toVertex;
+};
+
+// Adds the plane n.x + d = 0 to a quadric
+static void AddPlane(Quadric &q, const glm::dvec3 &n, double d, double weight)
+{
+    q.a00 += weight * n.x * n.x, q.a01 += weight * n.x * n.y, q.a02 += weight * n.x * n.z;
+    q.a11 += weight * n.y * n.y, q.a12 += weight * n.y * n.z, q.a22 += weight * n.z * n.z;
+    q.b0 += weight * n.x * d, q.b1 += weight * n.y * d, q.b2 += weight * n.z * d;
+    q.c += weight * d * d;
+    q.weight += weight;
+}
+
+// Returns the area weighted average of the squared distances from p to the quadric's planes
+static double EvaluateQuadric(const Quadric &q, const glm::dvec3 &p)
+{
+    double rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z;
+    double ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z;
+    double rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z;
+    double error = rx * p.x + ry * p.y + rz * p.z + 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+    return q.weight > 0.0 ? std::fabs(error) / q.weight : 0.0;
+}
+
+// Returns false if moving vertex "from" onto "to" flips or nearly flips one of from's triangles
+static bool KeepsOrientation(uint32_t from, uint32_t to, const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &corners,
+                             const std::vector<uint32_t> &adjacencyOffsets, const std::vector<uint32_t> &adjacency)
+{
+    for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a)
+    {
+        const uint32_t *triangle = &corners[adjacency[a] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            // This triangle is removed by the collapse
+            continue;
+        }
+
+        glm::vec3 p0 = positions[triangle[0]], p1 = positions[triangle[1]], p2 = positions[triangle[2]];
+        glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+
+        glm::vec3 q0 = positions[triangle[0] == from ? to : triangle[0]];
+        glm::vec3 q1 = positions[triangle[1] == from ? to : triangle[1]];
+        glm::vec3 q2 = positions[triangle[2] == from ? to : triangle[2]];
+        glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+
+        float lengths = glm::length(before) * glm::length(after);
+        if (lengths <= 0.0f || glm::dot(before, after) < sMaxNormalChange * lengths)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+float MeshSimplifier::Simplify(std::vector<uint32_t> &destination, const std::vector<uint32_t> &indices, const float *positions, size_t vertexCount,
+                               size_t vertexStride, size_t targetIndexCount, float targetError)
+{
+    destination = indices;
+    if (indices.size() <= targetIndexCount || vertexCount == 0)
+    {
+        return 0.0f;
+    }
+
+    // Give vertices that share a position the same position id, so vertices split
+    // by a normal or uv seam are treated as one point of the surface
+    std::vector<glm::vec3> vertexPositions(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        std::memcpy(&vertexPositions[v], reinterpret_cast<const unsigned char *>(positions) + v * vertexStride, sizeof(glm::vec3));
+    }
+    std::vector<uint32_t> positionIds;
+    size_t positionCount = MeshOptimizer::WeldVertices(vertexPositions.data(), vertexCount, sizeof(glm::vec3), positionIds);
+
+    std::vector<glm::vec3> uniquePositions(positionCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        uniquePositions[positionIds[v]] = vertexPositions[v];
+    }
+
+    // Count the used vertices of each position, more than one means the position is on a seam
+    std::vector<uint32_t> vertexOfPosition(positionCount, ~0u);
+    std::vector<bool> isSeam(positionCount, false);
+    for (uint32_t i : indices)
+    {
+        uint32_t id = positionIds[i];
+        if (vertexOfPosition[id] != ~0u && vertexOfPosition[id] != i)
+        {
+            isSeam[id] = true;
+        }
+        vertexOfPosition[id] = i;
+    }
+
+    // Every vertex starts with the planes of the triangles around it
+    std::vector<Quadric> quadrics(positionCount);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::dvec3 p0 = uniquePositions[positionIds[indices[i]]];
+        glm::dvec3 p1 = uniquePositions[positionIds[indices[i + 1]]];
+        glm::dvec3 p2 = uniquePositions[positionIds[indices[i + 2]]];
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+        normal /= length;
+
+        Quadric q;
+        AddPlane(q, normal, -glm::dot(normal, p0), length * 0.5);
+        quadrics[positionIds[indices[i]]] += q;
+        quadrics[positionIds[indices[i + 1]]] += q;
+        quadrics[positionIds[indices[i + 2]]] += q;
+    }
+
+    double maxError = static_cast<double>(targetError) * targetError;
+    double resultError = 0.0;
+
+    std::vector<uint32_t> corners;
+    std::vector<uint32_t> adjacencyOffsets;
+    std::vector<uint32_t> adjacency;
+    std::vector<bool> isLocked;
+    std::vector<bool> isTouched;
+    std::vector<uint32_t> collapseTo;
+    std::vector<uint32_t> collapseToVertex;
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses a set of edges that do not share triangles, then rebuilds the index buffer
+    while (destination.size() > targetIndexCount)
+    {
+        size_t triangleCount = destination.size() / 3;
+
+        // Triangles in position ids
+        corners.resize(destination.size());
+        for (size_t i = 0; i < destination.size(); ++i)
+        {
+            corners[i] = positionIds[destination[i]];
+        }
+
+        // Triangles around each position
+        adjacencyOffsets.assign(positionCount + 1, 0);
+        for (uint32_t id : corners)
+        {
+            ++adjacencyOffsets[id + 1];
+        }
+        for (size_t p = 0; p < positionCount; ++p)
+        {
+            adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+        }
+        adjacency.resize(corners.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < corners.size(); ++i)
+        {
+            adjacency[fill[corners[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // Lock seams, and vertices on open or non-manifold edges so the outline of the mesh stays put
+        isLocked.assign(isSeam.begin(), isSeam.end());
+        for (size_t i = 0; i < corners.size(); ++i)
+        {
+            uint32_t from = corners[i];
+            uint32_t to = corners[i - i % 3 + (i + 1) % 3];
+            unsigned int edgeCount = 0;
+            for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a)
+            {
+                const uint32_t *triangle = &corners[adjacency[a] * 3];
+                edgeCount += triangle[0] == to || triangle[1] == to || triangle[2] == to;
+            }
+            if (edgeCount != 2)
+            {
+                isLocked[from] = true;
+                isLocked[to] = true;
+            }
+        }
+
+        // Collect the collapses of every edge in both directions
+        collapses.clear();
+        for (size_t i = 0; i < corners.size(); ++i)
+        {
+            uint32_t from = corners[i];
+            size_t next = i - i % 3 + (i + 1) % 3;
+            for (size_t other : {next, i - i % 3 + (i + 2) % 3})
+            {
+                uint32_t to = corners[other];
+                if (isLocked[from] || from == to)
+                {
+                    continue;
+                }
+                Quadric q = quadrics[from];
+                q += quadrics[to];
+                collapses.push_back({EvaluateQuadric(q, uniquePositions[to]), from, to, destination[other]});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+                  { return a.error < b.error; });
+
+        // Collapse the cheapest edges until enough triangles are removed
+        size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        size_t trianglesRemoved = 0;
+        isTouched.assign(positionCount, false);
+        collapseTo.assign(positionCount, ~0u);
+        collapseToVertex.assign(positionCount, ~0u);
+        for (const Collapse &c : collapses)
+        {
+            if (c.error > maxError || trianglesRemoved >= trianglesToRemove)
+            {
+                break;
+            }
+            if (isTouched[c.from] || isTouched[c.to] || !KeepsOrientation(c.from, c.to, uniquePositions, corners, adjacencyOffsets, adjacency))
+            {
+                continue;
+            }
+
+            // Lock the whole neighbourhood for this pass, its triangles are about to change
+            for (uint32_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1]; ++a)
+            {
+                const uint32_t *triangle = &corners[adjacency[a] * 3];
+                isTouched[triangle[0]] = isTouched[triangle[1]] = isTouched[triangle[2]] = true;
+                trianglesRemoved += triangle[0] == c.to || triangle[1] == c.to || triangle[2] == c.to;
+            }
+
+            collapseTo[c.from] = c.to;
+            collapseToVertex[c.from] = c.toVertex;
+            quadrics[c.to] += quadrics[c.from];
+            resultError = std::max(resultError, c.error);
+        }
+
+        if (trianglesRemoved == 0)
+        {
+            // Nothing left that can be collapsed within the error limit
+            break;
+        }
+
+        // Rewrite the indices and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < destination.size(); i += 3)
+        {
+            uint32_t triangle[3];
+            uint32_t ids[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t id = corners[i + c];
+                triangle[c] = collapseTo[id] == ~0u ? destination[i + c] : collapseToVertex[id];
+                ids[c] = collapseTo[id] == ~0u ? id : collapseTo[id];
+            }
+            if (ids[0] == ids[1] || ids[1] == ids[2] || ids[0] == ids[2])
+            {
+                continue;
+            }
+            destination[write++] = triangle[0];
+            destination[write++] = triangle[1];
+            destination[write++] = triangle[2];
+        }
+        destination.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(resultError));
+}
+
+void MeshSimplifier::GenerateLods(MeshData &mesh, size_t maxLods)
+{
+    mesh.ComputeBounds();
+    mesh.lods.clear();
+    if (mesh.indices.size() < 3)
+    {
+        return;
+    }
+    mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+
+    std::vector<uint32_t> previous = mesh.indices;
+    std::vector<uint32_t> lod;
+    for (size_t level = 0; level < maxLods && previous.size() / 3 >= sMinLodTriangles * 2; ++level)
+    {
+        // The error is not limited since the selector picks levels by their error anyway,
+        // but a surface moving farther than the mesh's radius is never useful
+        size_t target = previous.size() / 6 * 3;
+        float error = Simplify(lod, previous, &mesh.vertices[0].pos.x, mesh.vertices.size(), sizeof(VertexNormalTexture), target, mesh.boundsRadius);
+        if (lod.size() > previous.size() * sMinLodReduction)
+        {
+            break;
+        }
+        MeshOptimizer::OptimizeVertexCache(lod, mesh.vertices.size());
+
+        // Each level is simplified from the previous one, so the errors add up
+        mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), mesh.lods.back().error + error});
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        previous.swap(lod);
+    }
+
+    if (mesh.lods.size() > 1)
+    {
+        std::cout << "Generated " << mesh.lods.size() - 1 << " LODs for mesh " << mesh.name << ":";
+        for (const MeshLod &l : mesh.lods)
+        {
+            std::cout << " " << l.indexCount / 3;
+        }
+        std::cout << " triangles" << std::endl;
+    }
+}
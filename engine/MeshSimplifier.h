@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+
+// MeshSimplifier reduces the triangle count of a mesh with quadric error metric edge collapses
+// (Garland and Heckbert). A vertex is only ever collapsed onto one of its neighbours, so the
+// simplified index buffer still indexes the original vertices and every level of detail of a
+// mesh can share a single vertex buffer. Vertices on open borders and on attribute seams
+// (several vertices with the same position, but different normals or uvs) are kept in place so
+// simplification does not open cracks or tear textures apart.
+class MeshSimplifier
+{
+public:
+    //   Simplify collapses edges in order of increasing error until the target triangle count or
+    //   the error limit is reached. Returns the largest error of a collapse that was made:
+    // - std::vector<uint32_t>& that receives the simplified triangle list indices
+    // - const std::vector<uint32_t>& for the source triangle list indices
+    // - const float* for the first vertex's position (3 floats)
+    // - size_t for the number of vertices
+    // - size_t for the distance in bytes between two vertices' positions
+    // - size_t for the target number of indices
+    // - float for the largest distance a surface may move, in model units
+    static float Simplify(std::vector<uint32_t> &destination, const std::vector<uint32_t> &indices, const float *positions, size_t vertexCount,
+                          size_t vertexStride, size_t targetIndexCount, float targetError);
+
+    //   GenerateLods appends simplified levels of detail to a mesh's index buffer, each with about
+    //   half the triangles of the previous one. Levels stop early when a mesh can not be reduced any
+    //   further, and every level is vertex cache optimized:
+    // - MeshData& for the mesh, whose indices must hold a single optimized level
+    // - size_t for the largest number of simplified levels, not counting the full detail level
+    static void GenerateLods(MeshData &mesh, size_t maxLods = 4);
+};
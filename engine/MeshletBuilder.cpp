@@ -0,0 +1,213 @@
+#include "MeshletBuilder.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "MeshData.h"
+
+// Cones whose normals spread wider than this (cosine of the largest angle to the axis) are never culled
+static const float sMinConeSpread = 0.1f;
+
+// Returns the position of a vertex
+static glm::vec3 GetPosition(const float *positions, size_t vertexStride, uint32_t vertex)
+{
+    glm::vec3 p;
+    std::memcpy(&p, reinterpret_cast<const unsigned char *>(positions) + vertex * vertexStride, sizeof(glm::vec3));
+    return p;
+}
+
+void MeshletBuilder::ComputeBounds(Meshlet &meshlet, const std::vector<uint32_t> &indices, const float *positions, size_t vertexStride)
+{
+    uint32_t end = meshlet.indexOffset + meshlet.indexCount;
+
+    // Sphere around the center of the bounding box
+    glm::vec3 min = GetPosition(positions, vertexStride, indices[meshlet.indexOffset]);
+    glm::vec3 max = min;
+    for (uint32_t i = meshlet.indexOffset; i < end; ++i)
+    {
+        glm::vec3 p = GetPosition(positions, vertexStride, indices[i]);
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    meshlet.center = (min + max) * 0.5f;
+    meshlet.radius = 0.0f;
+
+    // Average the triangle normals for the cone's axis
+    glm::vec3 normalSum = glm::vec3(0.0f);
+    for (uint32_t i = meshlet.indexOffset; i < end; i += 3)
+    {
+        glm::vec3 p0 = GetPosition(positions, vertexStride, indices[i]);
+        glm::vec3 p1 = GetPosition(positions, vertexStride, indices[i + 1]);
+        glm::vec3 p2 = GetPosition(positions, vertexStride, indices[i + 2]);
+        meshlet.radius = glm::max(meshlet.radius, glm::max(glm::length(p0 - meshlet.center), glm::max(glm::length(p1 - meshlet.center), glm::length(p2 - meshlet.center))));
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normalSum += normal / length;
+        }
+    }
+
+    float sumLength = glm::length(normalSum);
+    meshlet.coneAxis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+    // The cone's half angle is the largest angle between the axis and a triangle normal
+    float minDot = 1.0f;
+    for (uint32_t i = meshlet.indexOffset; i < end; i += 3)
+    {
+        glm::vec3 p0 = GetPosition(positions, vertexStride, indices[i]);
+        glm::vec3 p1 = GetPosition(positions, vertexStride, indices[i + 1]);
+        glm::vec3 p2 = GetPosition(positions, vertexStride, indices[i + 2]);
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            minDot = glm::min(minDot, glm::dot(normal / length, meshlet.coneAxis));
+        }
+    }
+    meshlet.coneCutoff = minDot < sMinConeSpread ? 2.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+void MeshletBuilder::Build(MeshData &mesh, size_t maxVertices, size_t maxTriangles, size_t minTriangles)
+{
+    mesh.meshlets.clear();
+    size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount < minTriangles)
+    {
+        return;
+    }
+    const std::vector<uint32_t> &indices = mesh.indices;
+    size_t vertexCount = mesh.vertices.size();
+
+    // Triangles around each vertex
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t i : indices)
+    {
+        ++adjacencyOffsets[i + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // Unit normal of each triangle
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        glm::vec3 p0 = mesh.vertices[indices[t * 3]].pos;
+        glm::vec3 n = glm::cross(mesh.vertices[indices[t * 3 + 1]].pos - p0, mesh.vertices[indices[t * 3 + 2]].pos - p0);
+        float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    std::vector<bool> isEmitted(triangleCount, false);
+    // Stamps of the meshlet a vertex or candidate triangle was last added to
+    std::vector<uint32_t> vertexStamp(vertexCount, ~0u);
+    std::vector<uint32_t> candidateStamp(triangleCount, ~0u);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+
+    size_t nextSeed = 0;
+    while (reordered.size() < indices.size())
+    {
+        while (isEmitted[nextSeed])
+        {
+            ++nextSeed;
+        }
+
+        uint32_t stamp = static_cast<uint32_t>(mesh.meshlets.size());
+        Meshlet meshlet = {};
+        meshlet.indexOffset = static_cast<uint32_t>(reordered.size());
+        size_t meshletVertices = 0;
+        size_t meshletTriangles = 0;
+        glm::vec3 normalSum = glm::vec3(0.0f);
+        candidates.clear();
+
+        uint32_t triangle = static_cast<uint32_t>(nextSeed);
+        while (true)
+        {
+            // Add the triangle and queue its neighbours
+            isEmitted[triangle] = true;
+            ++meshletTriangles;
+            normalSum += normals[triangle];
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[triangle * 3 + c];
+                reordered.push_back(v);
+                if (vertexStamp[v] == stamp)
+                {
+                    continue;
+                }
+                vertexStamp[v] = stamp;
+                ++meshletVertices;
+                for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+                {
+                    uint32_t neighbour = adjacency[a];
+                    if (!isEmitted[neighbour] && candidateStamp[neighbour] != stamp)
+                    {
+                        candidateStamp[neighbour] = stamp;
+                        candidates.push_back(neighbour);
+                    }
+                }
+            }
+            if (meshletTriangles >= maxTriangles)
+            {
+                break;
+            }
+
+            // Pick the candidate with the fewest new vertices, then the best aligned normal
+            const size_t none = ~size_t(0);
+            size_t best = none;
+            int bestNewVertices = 4;
+            float bestAlignment = -FLT_MAX;
+            size_t write = 0;
+            for (size_t c = 0; c < candidates.size(); ++c)
+            {
+                uint32_t t = candidates[c];
+                if (isEmitted[t])
+                {
+                    continue;
+                }
+                candidates[write] = t;
+
+                int newVertices = (vertexStamp[indices[t * 3]] != stamp) + (vertexStamp[indices[t * 3 + 1]] != stamp) + (vertexStamp[indices[t * 3 + 2]] != stamp);
+                float alignment = glm::dot(normals[t], normalSum);
+                if (meshletVertices + newVertices <= maxVertices &&
+                    (newVertices < bestNewVertices || (newVertices == bestNewVertices && alignment > bestAlignment)))
+                {
+                    best = write;
+                    bestNewVertices = newVertices;
+                    bestAlignment = alignment;
+                }
+                ++write;
+            }
+            candidates.resize(write);
+
+            if (best == none)
+            {
+                // Every neighbour would go over the vertex limit, or the meshlet is an island
+                break;
+            }
+            triangle = candidates[best];
+        }
+
+        meshlet.indexCount = static_cast<uint32_t>(reordered.size()) - meshlet.indexOffset;
+        mesh.meshlets.push_back(meshlet);
+    }
+
+    mesh.indices.swap(reordered);
+    for (Meshlet &meshlet : mesh.meshlets)
+    {
+        ComputeBounds(meshlet, mesh.indices, &mesh.vertices[0].pos.x, sizeof(VertexNormalTexture));
+    }
+
+    std::cout << "Built " << mesh.meshlets.size() << " meshlets for mesh " << mesh.name << std::endl;
+}
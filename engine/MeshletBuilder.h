@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct MeshData;
+
+// A meshlet is a small cluster of neighbouring triangles that is culled as a whole.
+// Its triangles are a contiguous range of the mesh's index buffer, so visible meshlets
+// can be drawn with indirect draws straight from the mesh's VertexBuffer.
+struct Meshlet
+{
+    // First index and number of indices of the meshlet's triangles
+    uint32_t indexOffset;
+    uint32_t indexCount;
+
+    // Bounding sphere of the triangles in model space
+    glm::vec3 center;
+    float radius;
+
+    // Normal cone: every triangle normal is within the cone around the axis. coneCutoff is the
+    // sine of the cone's half angle, or larger than 1 if the cone is too wide to ever cull
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+// MeshletBuilder splits a mesh into meshlets. Each meshlet is grown from a seed triangle
+// by adding the neighbouring triangle that brings in the fewest new vertices and,
+// between equals, faces the most like the meshlet, which keeps the normal cones narrow.
+class MeshletBuilder
+{
+public:
+    //   Build reorders the mesh's triangles so each meshlet is contiguous and fills mesh.meshlets.
+    //   Only meshes with at least minTriangles triangles are split, smaller meshes are culled whole:
+    // - MeshData& for the mesh, whose indices must hold a single level of detail
+    // - size_t for the largest number of unique vertices in a meshlet
+    // - size_t for the largest number of triangles in a meshlet
+    // - size_t for the smallest mesh that is split into meshlets
+    static void Build(MeshData &mesh, size_t maxVertices = 64, size_t maxTriangles = 124, size_t minTriangles = 1024);
+
+    //   ComputeBounds computes a meshlet's bounding sphere and normal cone from its triangles:
+    // - Meshlet& for the meshlet, whose index range must be set
+    // - const std::vector<uint32_t>& for the mesh's indices
+    // - const float* for the first vertex's position (3 floats)
+    // - size_t for the distance in bytes between two vertices' positions
+    static void ComputeBounds(Meshlet &meshlet, const std::vector<uint32_t> &indices, const float *positions, size_t vertexStride);
+};
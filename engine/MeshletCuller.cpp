@@ -0,0 +1,274 @@
+#include "MeshletCuller.h"
+#include <iostream>
+#include "AssetManager.h"
+#include "Shader.h"
+#include "VertexBuffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESHLET_CULLER_SSE
+#endif
+
+// Work group size of shaders/meshletCullCS.glsl
+static const unsigned int sCullGroupSize = 64;
+
+// Meshlet layout of the compute shader's storage buffer (std430)
+struct GpuMeshlet
+{
+    glm::vec4 sphere;
+    glm::vec4 cone;
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t pad[2];
+};
+
+glm::mat4 MeshletCuller::sViewProj = glm::mat4(1.0f);
+glm::vec3 MeshletCuller::sCameraPosition = glm::vec3(0.0f);
+bool MeshletCuller::sUseCompute = false;
+
+// Extracts the 6 frustum planes of a clip matrix (Gribb/Hartmann), normalized so
+// dot(plane.xyz, p) + plane.w is the distance of p to the plane in the matrix's input space
+static void ExtractFrustumPlanes(const glm::mat4 &clip, glm::vec4 planes[6])
+{
+    glm::vec4 rowX = glm::vec4(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    glm::vec4 rowY = glm::vec4(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    glm::vec4 rowZ = glm::vec4(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    glm::vec4 rowW = glm::vec4(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+    planes[0] = rowW + rowX;
+    planes[1] = rowW - rowX;
+    planes[2] = rowW + rowY;
+    planes[3] = rowW - rowY;
+    planes[4] = rowW + rowZ;
+    planes[5] = rowW - rowZ;
+    for (int i = 0; i < 6; ++i)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+MeshletCuller::MeshletCuller(const std::vector<Meshlet> &meshlets)
+    : mMeshletCount(meshlets.size()), mCommandBufferID(0), mMeshletBufferID(0), mDrawCountBufferID(0)
+{
+    // Pad with meshlets that are always outside of the frustum
+    size_t paddedCount = (mMeshletCount + 3) & ~size_t(3);
+    mCenterX.assign(paddedCount, 0.0f), mCenterY.assign(paddedCount, 0.0f), mCenterZ.assign(paddedCount, 0.0f);
+    mRadius.assign(paddedCount, -1.0f);
+    mAxisX.assign(paddedCount, 0.0f), mAxisY.assign(paddedCount, 0.0f), mAxisZ.assign(paddedCount, 0.0f);
+    mCutoff.assign(paddedCount, 2.0f);
+
+    std::vector<GpuMeshlet> gpuMeshlets(mMeshletCount);
+    for (size_t i = 0; i < mMeshletCount; ++i)
+    {
+        const Meshlet &m = meshlets[i];
+        mCenterX[i] = m.center.x, mCenterY[i] = m.center.y, mCenterZ[i] = m.center.z;
+        mRadius[i] = m.radius;
+        mAxisX[i] = m.coneAxis.x, mAxisY[i] = m.coneAxis.y, mAxisZ[i] = m.coneAxis.z;
+        mCutoff[i] = m.coneCutoff;
+        mIndexOffsets.push_back(m.indexOffset);
+        mIndexCounts.push_back(m.indexCount);
+
+        gpuMeshlets[i] = {glm::vec4(m.center, m.radius), glm::vec4(m.coneAxis, m.coneCutoff), m.indexOffset, m.indexCount, {0, 0}};
+    }
+    mCommands.reserve(mMeshletCount);
+
+    // Command buffer is large enough for one command per meshlet
+    glGenBuffers(1, &mCommandBufferID);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBufferID);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, mMeshletCount * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glGenBuffers(1, &mMeshletBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mMeshletBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, gpuMeshlets.size() * sizeof(GpuMeshlet), gpuMeshlets.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &mDrawCountBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawCountBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+MeshletCuller::~MeshletCuller()
+{
+    std::cout << "Delete meshlet culler" << std::endl;
+
+    glDeleteBuffers(1, &mCommandBufferID);
+    glDeleteBuffers(1, &mMeshletBufferID);
+    glDeleteBuffers(1, &mDrawCountBufferID);
+}
+
+void MeshletCuller::SetView(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition)
+{
+    sViewProj = viewProj;
+    sCameraPosition = cameraPosition;
+}
+
+size_t MeshletCuller::Cull(const glm::mat4 &model, std::vector<DrawElementsIndirectCommand> &commands) const
+{
+    commands.clear();
+
+    // Cull in model space: the planes of viewProj * model are the frustum in model space
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(sViewProj * model, planes);
+    glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(sCameraPosition, 1.0f));
+
+    size_t visibleCount = 0;
+    for (size_t base = 0; base < mCenterX.size(); base += 4)
+    {
+        // One bit per visible meshlet of this group of 4
+        int visibleMask = 0;
+
+#ifdef MESHLET_CULLER_SSE
+        __m128 cx = _mm_loadu_ps(&mCenterX[base]);
+        __m128 cy = _mm_loadu_ps(&mCenterY[base]);
+        __m128 cz = _mm_loadu_ps(&mCenterZ[base]);
+        __m128 radius = _mm_loadu_ps(&mRadius[base]);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        // Inside if the distance to every plane is larger than -radius
+        __m128 inside = _mm_cmpge_ps(radius, _mm_setzero_ps());
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)), _mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+                                         _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negRadius));
+        }
+
+        // Back facing if the whole sphere is inside the region the cone faces away from:
+        // dot(center - camera, axis) >= cutoff * |center - camera| + radius * (1 + cutoff)
+        __m128 dx = _mm_sub_ps(cx, _mm_set1_ps(camera.x));
+        __m128 dy = _mm_sub_ps(cy, _mm_set1_ps(camera.y));
+        __m128 dz = _mm_sub_ps(cz, _mm_set1_ps(camera.z));
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&mAxisX[base])), _mm_mul_ps(dy, _mm_loadu_ps(&mAxisY[base]))),
+                                   _mm_mul_ps(dz, _mm_loadu_ps(&mAxisZ[base])));
+        __m128 cutoff = _mm_loadu_ps(&mCutoff[base]);
+        __m128 limit = _mm_add_ps(_mm_mul_ps(cutoff, distance), _mm_mul_ps(radius, _mm_add_ps(_mm_set1_ps(1.0f), cutoff)));
+        __m128 backFacing = _mm_cmpge_ps(facing, limit);
+
+        visibleMask = _mm_movemask_ps(_mm_andnot_ps(backFacing, inside));
+#else
+        for (size_t j = 0; j < 4; ++j)
+        {
+            size_t i = base + j;
+            glm::vec3 center = glm::vec3(mCenterX[i], mCenterY[i], mCenterZ[i]);
+            bool inside = mRadius[i] >= 0.0f;
+            for (int p = 0; p < 6; ++p)
+            {
+                inside = inside && glm::dot(glm::vec3(planes[p]), center) + planes[p].w > -mRadius[i];
+            }
+
+            glm::vec3 toCenter = center - camera;
+            float facing = glm::dot(toCenter, glm::vec3(mAxisX[i], mAxisY[i], mAxisZ[i]));
+            bool backFacing = facing >= mCutoff[i] * glm::length(toCenter) + mRadius[i] * (1.0f + mCutoff[i]);
+
+            visibleMask |= (inside && !backFacing) << j;
+        }
+#endif
+
+        // Merge visible meshlets that follow each other in the index buffer into one command
+        while (visibleMask)
+        {
+            int bit = 0;
+            while (!(visibleMask & (1 << bit)))
+            {
+                ++bit;
+            }
+            visibleMask &= ~(1 << bit);
+
+            size_t i = base + bit;
+            ++visibleCount;
+            if (!commands.empty() && commands.back().firstIndex + commands.back().count == mIndexOffsets[i])
+            {
+                commands.back().count += mIndexCounts[i];
+            }
+            else
+            {
+                commands.push_back({mIndexCounts[i], 1, mIndexOffsets[i], 0, 0});
+            }
+        }
+    }
+    return visibleCount;
+}
+
+void MeshletCuller::Draw(VertexBuffer *vertexBuffer, const glm::mat4 &model)
+{
+    if (mMeshletCount == 0)
+    {
+        return;
+    }
+    if (sUseCompute)
+    {
+        DrawCompute(vertexBuffer, model);
+        return;
+    }
+
+    Cull(model, mCommands);
+    if (mCommands.empty())
+    {
+        return;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBufferID);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, mCommands.size() * sizeof(DrawElementsIndirectCommand), mCommands.data());
+
+    vertexBuffer->SetActive();
+    glMultiDrawElementsIndirect(GL_TRIANGLES, vertexBuffer->GetIndexType(), nullptr, static_cast<GLsizei>(mCommands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void MeshletCuller::DrawCompute(VertexBuffer *vertexBuffer, const glm::mat4 &model)
+{
+    // The cull shader is shared by every mesh and owned by the AssetManager
+    AssetManager *am = AssetManager::Get();
+    Shader *cullShader = am->LoadShader("meshletCull"_id);
+    if (!cullShader)
+    {
+        cullShader = new Shader("shaders/meshletCullCS.glsl");
+        am->SaveShader("meshletCull"_id, cullShader);
+    }
+
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(sViewProj * model, planes);
+    glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(sCameraPosition, 1.0f));
+
+    // Remember the draw shader, the cull shader replaces it while dispatching
+    int drawShader = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &drawShader);
+
+    // Zeroed commands draw nothing, so the slots past the visible count are harmless
+    // when the draw count can not be read from the GPU
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCommandBufferID);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawCountBufferID);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mMeshletBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mCommandBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mDrawCountBufferID);
+
+    cullShader->SetActive();
+    cullShader->SetVec4Array("frustumPlanes"_id, planes, 6);
+    cullShader->SetVec3("cameraPosition"_id, camera);
+    cullShader->SetUInt("meshletCount"_id, static_cast<unsigned int>(mMeshletCount));
+    glDispatchCompute(static_cast<GLuint>((mMeshletCount + sCullGroupSize - 1) / sCullGroupSize), 1, 1);
+
+    // Make the commands visible to the indirect draw
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(drawShader);
+    vertexBuffer->SetActive();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBufferID);
+    if (GLAD_GL_VERSION_4_6)
+    {
+        // Only draw as many commands as the compute shader wrote
+        glBindBuffer(GL_PARAMETER_BUFFER, mDrawCountBufferID);
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, vertexBuffer->GetIndexType(), nullptr, 0, static_cast<GLsizei>(mMeshletCount), 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, vertexBuffer->GetIndexType(), nullptr, static_cast<GLsizei>(mMeshletCount), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
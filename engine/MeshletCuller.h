@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "MeshletBuilder.h"
+
+class VertexBuffer;
+
+// Command layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// MeshletCuller culls the meshlets of one mesh against the view frustum and against
+// their normal cones, which reject meshlets whose triangles all face away from the camera.
+// The visible meshlets become indirect draw commands for the mesh's VertexBuffer.
+// Culling runs on the CPU four meshlets at a time with SSE, merging neighbouring visible
+// meshlets into a single index range. The optional compute path culls on the GPU instead
+// and writes one command per visible meshlet, so the CPU never waits on the results.
+class MeshletCuller
+{
+public:
+    //   MeshletCuller constructor, copies the meshlet bounds into SIMD friendly arrays and
+    //   creates the GPU buffers. Must be called on the main thread:
+    // - const std::vector<Meshlet>& for the meshlets of the mesh
+    MeshletCuller(const std::vector<Meshlet> &meshlets);
+    ~MeshletCuller();
+
+    //   SetView sets the camera used for culling, called once per frame before drawing:
+    // - const glm::mat4& for the view projection matrix
+    // - const glm::vec3& for the camera's world position
+    static void SetView(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition);
+
+    // Switches between culling on the CPU and with the compute shader
+    static void SetUseCompute(bool useCompute) { sUseCompute = useCompute; }
+    static bool GetUseCompute() { return sUseCompute; }
+
+    //   Cull culls the meshlets on the CPU and writes the draw commands of the visible ones.
+    //   Returns the number of visible meshlets:
+    // - const glm::mat4& for the model matrix of the mesh
+    // - std::vector<DrawElementsIndirectCommand>& that receives the commands of the visible ranges
+    size_t Cull(const glm::mat4 &model, std::vector<DrawElementsIndirectCommand> &commands) const;
+
+    //   Draw culls the meshlets on the CPU or GPU and draws the visible ones with the
+    //   shader that is currently active:
+    // - VertexBuffer* for the mesh's vertices and indices
+    // - const glm::mat4& for the model matrix of the mesh
+    void Draw(VertexBuffer *vertexBuffer, const glm::mat4 &model);
+
+private:
+    // Culls and draws with the compute shader
+    void DrawCompute(VertexBuffer *vertexBuffer, const glm::mat4 &model);
+
+    // Meshlet bounds as structure of arrays, padded to a multiple of 4 meshlets
+    std::vector<float> mCenterX, mCenterY, mCenterZ, mRadius;
+    std::vector<float> mAxisX, mAxisY, mAxisZ, mCutoff;
+
+    // Index range of each meshlet
+    std::vector<uint32_t> mIndexOffsets;
+    std::vector<uint32_t> mIndexCounts;
+
+    size_t mMeshletCount;
+
+    // Commands of the last CPU cull, kept to avoid allocating each frame
+    std::vector<DrawElementsIndirectCommand> mCommands;
+
+    // Indirect draw commands
+    unsigned int mCommandBufferID;
+
+    // Meshlet bounds and ranges read by the compute shader
+    unsigned int mMeshletBufferID;
+
+    // Number of commands written by the compute shader
+    unsigned int mDrawCountBufferID;
+
+    static glm::mat4 sViewProj;
+    static glm::vec3 sCameraPosition;
+    static bool sUseCompute;
+};
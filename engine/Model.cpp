@@ -0,0 +1,166 @@
+#include "Model.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include "AssetManager.h"
+#include "MeshData.h"
+#include "MeshletCuller.h"
+#include "OcclusionCuller.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "VertexBuffer.h"
+
+Model::Model(const std::vector<MeshData> &meshes) : RenderObj()
+{
+    // Surface area of the triangles in model space and in texture space, for the UV density
+    float area = 0.0f;
+    float uvArea = 0.0f;
+
+    for (const auto &m : meshes)
+    {
+        // Skip meshes that failed to import
+        if (!m.indices.empty())
+        {
+            MeshletCuller *meshletCuller = m.meshlets.empty() ? nullptr : new MeshletCuller(m.meshlets);
+            mMeshes.push_back({m.CreateVertexBuffer(), meshletCuller, m.lods, 0, m.boundsCenter, m.boundsRadius});
+
+            // Grow the bounding box
+            if (!HasBounds())
+            {
+                mBoundsMin = m.vertices[0].pos;
+                mBoundsMax = m.vertices[0].pos;
+            }
+            for (const VertexNormalTexture &v : m.vertices)
+            {
+                mBoundsMin = glm::min(mBoundsMin, v.pos);
+                mBoundsMax = glm::max(mBoundsMax, v.pos);
+            }
+
+            // Measure the finest level's triangles
+            uint32_t finestCount = m.lods.empty() ? static_cast<uint32_t>(m.indices.size()) : m.lods[0].indexCount;
+            for (uint32_t i = 0; i + 2 < finestCount; i += 3)
+            {
+                const VertexNormalTexture &v0 = m.vertices[m.indices[i]];
+                const VertexNormalTexture &v1 = m.vertices[m.indices[i + 1]];
+                const VertexNormalTexture &v2 = m.vertices[m.indices[i + 2]];
+                area += glm::length(glm::cross(v1.pos - v0.pos, v2.pos - v0.pos));
+                glm::vec2 uv1 = v1.uv - v0.uv, uv2 = v2.uv - v0.uv;
+                uvArea += glm::abs(uv1.x * uv2.y - uv1.y * uv2.x);
+            }
+
+            // Copy the vertices used by the coarsest level as occluder geometry
+            uint32_t begin = m.lods.empty() ? 0 : m.lods.back().indexOffset;
+            uint32_t end = m.lods.empty() ? static_cast<uint32_t>(m.indices.size()) : begin + m.lods.back().indexCount;
+            std::vector<uint32_t> remap(m.vertices.size(), ~0u);
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                uint32_t v = m.indices[i];
+                if (remap[v] == ~0u)
+                {
+                    remap[v] = static_cast<uint32_t>(mOccluderPositions.size());
+                    mOccluderPositions.push_back(m.vertices[v].pos);
+                }
+                mOccluderIndices.push_back(remap[v]);
+            }
+        }
+    }
+
+    // Texture coordinates stretch by the square root of the area ratio along each side
+    if (area > 0.0f && uvArea > 0.0f)
+    {
+        mUvDensity = glm::sqrt(uvArea / area);
+    }
+}
+
+Model::~Model()
+{
+    std::cout << "Delete model" << std::endl;
+
+    for (auto &m : mMeshes)
+    {
+        delete m.vertexBuffer;
+        delete m.meshletCuller;
+    }
+    mMeshes.clear();
+}
+
+void Model::Update(float)
+{
+    // Update model matrix from the position and scale
+    mModel = glm::translate(glm::mat4(1.0f), mPosition);
+    mModel = glm::scale(mModel, mScale);
+
+    // Pick the level of detail of each mesh from its size on screen
+    float scale = glm::max(glm::abs(mScale.x), glm::max(glm::abs(mScale.y), glm::abs(mScale.z)));
+    for (auto &m : mMeshes)
+    {
+        glm::vec3 center = glm::vec3(mModel * glm::vec4(m.boundsCenter, 1.0f));
+        m.currentLod = LodSelector::Select(m.lods, center, m.boundsRadius * scale, scale, m.currentLod);
+    }
+}
+
+void Model::Draw()
+{
+    // Set a shader program to use
+    mShader->SetActive();
+
+    // Bind the texture on their texture units
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        mTextures[i]->SetActive();
+    }
+
+    mShader->SetMat4("model"_id, mModel);
+    mShader->SetMat4("previousModel"_id, mPreviousModel);
+
+    // Cull back faces, a mirroring model matrix flips the winding of every triangle
+    glEnable(GL_CULL_FACE);
+    glFrontFace(glm::determinant(mModel) < 0.0f ? GL_CW : GL_CCW);
+
+    // Draw every mesh at its selected level of detail
+    for (auto &m : mMeshes)
+    {
+        if (m.meshletCuller && m.currentLod == 0)
+        {
+            m.meshletCuller->Draw(m.vertexBuffer, mModel);
+        }
+        else if (m.lods.empty())
+        {
+            m.vertexBuffer->Draw();
+        }
+        else
+        {
+            const MeshLod &lod = m.lods[m.currentLod];
+            m.vertexBuffer->Draw(lod.indexOffset, lod.indexCount);
+        }
+    }
+
+    glFrontFace(GL_CCW);
+    glDisable(GL_CULL_FACE);
+}
+
+void Model::DrawDepth()
+{
+    Shader *depthShader = AssetManager::Get()->LoadShader("depth"_id);
+    depthShader->SetActive();
+    depthShader->SetMat4("model"_id, mModel);
+
+    // Meshlets are culled against the camera, so shadows draw the whole mesh at the selected level
+    for (auto &m : mMeshes)
+    {
+        if (m.lods.empty())
+        {
+            m.vertexBuffer->Draw();
+        }
+        else
+        {
+            const MeshLod &lod = m.lods[m.currentLod];
+            m.vertexBuffer->Draw(lod.indexOffset, lod.indexCount);
+        }
+    }
+}
+
+void Model::AddOccluder(OcclusionCuller *culler)
+{
+    culler->AddOccluder(mOccluderPositions.data(), mOccluderIndices.data(), mOccluderIndices.size(), mModel);
+}
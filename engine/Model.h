@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include "LodSelector.h"
+#include "RenderObj.h"
+
+struct MeshData;
+
+// Model is a RenderObj made of imported meshes (see MeshImporter).
+// Each mesh gets its own VertexBuffer and all of them are drawn
+// with the model's shader, textures and model matrix. Every update
+// picks the level of detail of each mesh with the LodSelector, and
+// meshes split into meshlets are culled per meshlet at full detail.
+// Imported meshes are consistently wound, so back faces are culled.
+class MeshletCuller;
+
+class Model : public RenderObj
+{
+public:
+    //   Model constructor, creates a VertexBuffer for each mesh. Must be called on the main thread:
+    // - const std::vector<MeshData>& for the imported meshes
+    Model(const std::vector<MeshData> &meshes);
+    ~Model();
+
+    void Update(float deltaTime) override;
+    void Draw() override;
+    void DrawDepth() override;
+    void AddOccluder(OcclusionCuller *culler) override;
+
+private:
+    // GPU side of a mesh
+    struct ModelMesh
+    {
+        VertexBuffer *vertexBuffer;
+
+        // Culls the meshlets at full detail, nullptr if the mesh has no meshlets
+        MeshletCuller *meshletCuller;
+
+        // Levels of detail and the level currently drawn
+        std::vector<MeshLod> lods;
+        size_t currentLod;
+
+        // Bounding sphere in model space
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+    };
+
+    std::vector<ModelMesh> mMeshes;
+
+    // Coarsest level of every mesh, kept on the CPU for the OcclusionCuller
+    std::vector<glm::vec3> mOccluderPositions;
+    std::vector<uint32_t> mOccluderIndices;
+};
@@ -0,0 +1,426 @@
+#include "MeshImporter.h"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+// Files are split into chunks of about this many bytes that are parsed in parallel
+static const size_t sObjChunkSize = 1 << 20;
+
+// Marks a missing texture coordinate or normal index
+static const int sObjMissing = INT_MIN;
+
+// A face corner's indices as written in the file, converted to 0 based indices.
+// Negative (relative) indices can only be resolved against the chunk's own counts
+// while parsing, so they are flagged and offset once every chunk is parsed
+struct ObjCorner
+{
+    int v;
+    int vt;
+    int vn;
+    // Bit 0, 1, 2 are set if v, vt, vn are relative to the chunk
+    unsigned char relative;
+};
+
+// An object or group that starts within a chunk
+struct ObjGroup
+{
+    std::string_view name;
+    // Index of the group's first corner in the chunk
+    size_t firstCorner;
+};
+
+// A range of lines of the file and everything parsed from them
+struct ObjChunk
+{
+    const char *begin = nullptr;
+    const char *end = nullptr;
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+
+    // Triangulated faces, three corners per triangle
+    std::vector<ObjCorner> corners;
+
+    // Objects/groups that start in this chunk
+    std::vector<ObjGroup> groups;
+};
+
+// A continuous range of corners of a chunk that belongs to a group
+struct ObjSegment
+{
+    size_t chunk;
+    size_t begin;
+    size_t end;
+};
+
+// An object/group of the whole file, which becomes one MeshData
+struct ObjMesh
+{
+    std::string_view name;
+    std::vector<ObjSegment> segments;
+};
+
+static bool IsObjSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *SkipObjSpaces(const char *p, const char *end)
+{
+    while (p < end && IsObjSpace(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+// Parses a float in place, returns nullptr if there is no number
+static const char *ParseObjFloat(const char *p, const char *end, float &value)
+{
+    p = SkipObjSpaces(p, end);
+    // from_chars does not accept a leading '+'
+    if (p < end && *p == '+')
+    {
+        ++p;
+    }
+    auto result = std::from_chars(p, end, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// Parses an int in place, returns nullptr if there is no number
+static const char *ParseObjInt(const char *p, const char *end, int &value)
+{
+    if (p < end && *p == '+')
+    {
+        ++p;
+    }
+    auto result = std::from_chars(p, end, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// Converts an index from the file into a 0 based index, flagging relative indices
+static void ResolveObjIndex(int fileIndex, int localCount, int &index, unsigned char &relative, unsigned char bit)
+{
+    if (fileIndex > 0)
+    {
+        index = fileIndex - 1;
+    }
+    else if (fileIndex < 0)
+    {
+        index = localCount + fileIndex;
+        relative |= bit;
+    }
+    else
+    {
+        index = sObjMissing;
+    }
+}
+
+// Parses every line of a chunk
+static void ParseObjChunk(ObjChunk &chunk)
+{
+    std::vector<ObjCorner> polygon;
+
+    const char *p = chunk.begin;
+    while (p < chunk.end)
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', chunk.end - p));
+        if (!lineEnd)
+        {
+            lineEnd = chunk.end;
+        }
+
+        p = SkipObjSpaces(p, lineEnd);
+        if (lineEnd - p >= 2)
+        {
+            if (p[0] == 'v' && IsObjSpace(p[1]))
+            {
+                glm::vec3 pos(0.0f);
+                const char *q = ParseObjFloat(p + 2, lineEnd, pos.x);
+                q = q ? ParseObjFloat(q, lineEnd, pos.y) : nullptr;
+                q = q ? ParseObjFloat(q, lineEnd, pos.z) : nullptr;
+                chunk.positions.emplace_back(pos);
+            }
+            else if (p[0] == 'v' && p[1] == 't')
+            {
+                glm::vec2 uv(0.0f);
+                const char *q = ParseObjFloat(p + 2, lineEnd, uv.x);
+                q = q ? ParseObjFloat(q, lineEnd, uv.y) : nullptr;
+                chunk.uvs.emplace_back(uv);
+            }
+            else if (p[0] == 'v' && p[1] == 'n')
+            {
+                glm::vec3 normal(0.0f);
+                const char *q = ParseObjFloat(p + 2, lineEnd, normal.x);
+                q = q ? ParseObjFloat(q, lineEnd, normal.y) : nullptr;
+                q = q ? ParseObjFloat(q, lineEnd, normal.z) : nullptr;
+                chunk.normals.emplace_back(normal);
+            }
+            else if (p[0] == 'f' && IsObjSpace(p[1]))
+            {
+                // Read every corner of the polygon: v, v/vt, v//vn or v/vt/vn
+                polygon.clear();
+                const char *q = SkipObjSpaces(p + 2, lineEnd);
+                while (q < lineEnd)
+                {
+                    int v = 0;
+                    int vt = 0;
+                    int vn = 0;
+                    q = ParseObjInt(q, lineEnd, v);
+                    if (!q)
+                    {
+                        break;
+                    }
+                    if (q < lineEnd && *q == '/')
+                    {
+                        ++q;
+                        if (q < lineEnd && *q != '/')
+                        {
+                            q = ParseObjInt(q, lineEnd, vt);
+                        }
+                        if (q && q < lineEnd && *q == '/')
+                        {
+                            q = ParseObjInt(q + 1, lineEnd, vn);
+                        }
+                        if (!q)
+                        {
+                            break;
+                        }
+                    }
+
+                    ObjCorner corner = {0, 0, 0, 0};
+                    ResolveObjIndex(v, static_cast<int>(chunk.positions.size()), corner.v, corner.relative, 1);
+                    ResolveObjIndex(vt, static_cast<int>(chunk.uvs.size()), corner.vt, corner.relative, 2);
+                    ResolveObjIndex(vn, static_cast<int>(chunk.normals.size()), corner.vn, corner.relative, 4);
+                    polygon.emplace_back(corner);
+
+                    q = SkipObjSpaces(q, lineEnd);
+                }
+
+                // Triangulate the polygon as a fan
+                for (size_t i = 1; i + 1 < polygon.size(); ++i)
+                {
+                    chunk.corners.emplace_back(polygon[0]);
+                    chunk.corners.emplace_back(polygon[i]);
+                    chunk.corners.emplace_back(polygon[i + 1]);
+                }
+            }
+            else if ((p[0] == 'o' || p[0] == 'g') && IsObjSpace(p[1]))
+            {
+                const char *nameBegin = SkipObjSpaces(p + 2, lineEnd);
+                const char *nameEnd = lineEnd;
+                while (nameEnd > nameBegin && IsObjSpace(nameEnd[-1]))
+                {
+                    --nameEnd;
+                }
+                chunk.groups.push_back({std::string_view(nameBegin, nameEnd - nameBegin), chunk.corners.size()});
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+// Builds one mesh by welding the corners that share the same position, uv and normal
+static void AssembleObjMesh(const ObjMesh &objMesh, const std::vector<ObjChunk> &chunks,
+                            const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &uvs, const std::vector<glm::vec3> &normals,
+                            const std::vector<int> &positionOffsets, const std::vector<int> &uvOffsets, const std::vector<int> &normalOffsets,
+                            MeshData &mesh)
+{
+    mesh.name = std::string(objMesh.name);
+
+    size_t cornerCount = 0;
+    for (const auto &s : objMesh.segments)
+    {
+        cornerCount += s.end - s.begin;
+    }
+
+    // Open addressing table from a corner's resolved indices to its vertex
+    struct Slot
+    {
+        int v = -1;
+        int vt = 0;
+        int vn = 0;
+        uint32_t vertex = 0;
+    };
+    size_t tableSize = 16;
+    while (tableSize < cornerCount * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<Slot> table(tableSize);
+    size_t mask = tableSize - 1;
+
+    mesh.indices.reserve(cornerCount);
+    mesh.vertices.reserve(cornerCount / 2);
+
+    // Vertices of corners without a normal, they get a generated one
+    std::vector<uint8_t> missingNormals;
+    missingNormals.reserve(cornerCount / 2);
+    size_t missingCount = 0;
+    size_t skipped = 0;
+
+    for (const auto &s : objMesh.segments)
+    {
+        const ObjChunk &chunk = chunks[s.chunk];
+        for (size_t t = s.begin; t + 2 < s.end; t += 3)
+        {
+            // Resolve the triangle's corners and skip it if any index is out of range
+            int resolved[3][3];
+            bool valid = true;
+            for (int c = 0; c < 3; ++c)
+            {
+                const ObjCorner &corner = chunk.corners[t + c];
+                int v = corner.v + ((corner.relative & 1) ? positionOffsets[s.chunk] : 0);
+                int vt = corner.vt == sObjMissing ? -1 : corner.vt + ((corner.relative & 2) ? uvOffsets[s.chunk] : 0);
+                int vn = corner.vn == sObjMissing ? -1 : corner.vn + ((corner.relative & 4) ? normalOffsets[s.chunk] : 0);
+                valid = valid && v >= 0 && v < static_cast<int>(positions.size()) &&
+                        vt < static_cast<int>(uvs.size()) && vn < static_cast<int>(normals.size());
+                resolved[c][0] = v;
+                resolved[c][1] = vt;
+                resolved[c][2] = vn;
+            }
+            if (!valid)
+            {
+                ++skipped;
+                continue;
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                int v = resolved[c][0];
+                int vt = resolved[c][1];
+                int vn = resolved[c][2];
+
+                uint64_t hash = static_cast<uint64_t>(v) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(vt + 1) * 0xC2B2AE3D27D4EB4Full ^ static_cast<uint64_t>(vn + 1) * 0x165667B19E3779F9ull;
+                size_t index = static_cast<size_t>(hash ^ (hash >> 29)) & mask;
+                while (table[index].v >= 0 && (table[index].v != v || table[index].vt != vt || table[index].vn != vn))
+                {
+                    index = (index + 1) & mask;
+                }
+
+                if (table[index].v < 0)
+                {
+                    VertexNormalTexture vertex;
+                    vertex.pos = positions[v];
+                    vertex.uv = vt >= 0 ? uvs[vt] : glm::vec2(0.0f);
+                    vertex.normal = vn >= 0 ? normals[vn] : glm::vec3(0.0f);
+                    missingNormals.emplace_back(vn < 0);
+                    missingCount += vn < 0;
+
+                    table[index].v = v;
+                    table[index].vt = vt;
+                    table[index].vn = vn;
+                    table[index].vertex = static_cast<uint32_t>(mesh.vertices.size());
+                    mesh.vertices.emplace_back(vertex);
+                }
+                mesh.indices.emplace_back(table[index].vertex);
+            }
+        }
+    }
+
+    if (skipped > 0)
+    {
+        std::cout << "Skipped " << skipped << " triangles with invalid indices in " << mesh.name << std::endl;
+    }
+
+    // Normals authored in the file are kept, only the vertices without one get a generated normal
+    if (missingCount > 0)
+    {
+        MeshImporter::GenerateNormals(mesh, missingCount == mesh.vertices.size() ? nullptr : &missingNormals);
+    }
+}
+
+bool MeshImporter::LoadObj(const MappedFile &file, std::vector<MeshData> &meshes)
+{
+    const char *data = file.GetData();
+    size_t size = file.GetSize();
+    JobSystem *jobs = JobSystem::Get();
+
+    // Split the file into chunks that end on a line break
+    size_t maxChunks = 4 * (static_cast<size_t>(jobs->GetNumWorkers()) + 1);
+    size_t numChunks = std::clamp<size_t>(size / sObjChunkSize, 1, maxChunks);
+    std::vector<ObjChunk> chunks(numChunks);
+    const char *end = data + size;
+    const char *p = data;
+    for (size_t c = 0; c < numChunks; ++c)
+    {
+        chunks[c].begin = p;
+        const char *target = c + 1 == numChunks ? end : std::min(end, data + (c + 1) * (size / numChunks));
+        const char *lineEnd = target < end ? static_cast<const char *>(std::memchr(target, '\n', end - target)) : nullptr;
+        p = lineEnd ? lineEnd + 1 : end;
+        chunks[c].end = p;
+    }
+
+    // Parse the chunks in parallel
+    jobs->ParallelFor(numChunks, 1, [&chunks](size_t begin, size_t end)
+                      {
+                          for (size_t c = begin; c < end; ++c)
+                          {
+                              ParseObjChunk(chunks[c]);
+                          } });
+
+    // Offsets of each chunk's attributes in the whole file, and the merged attribute arrays
+    std::vector<int> positionOffsets(numChunks);
+    std::vector<int> uvOffsets(numChunks);
+    std::vector<int> normalOffsets(numChunks);
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    for (size_t c = 0; c < numChunks; ++c)
+    {
+        positionOffsets[c] = static_cast<int>(positions.size());
+        uvOffsets[c] = static_cast<int>(uvs.size());
+        normalOffsets[c] = static_cast<int>(normals.size());
+        positions.insert(positions.end(), chunks[c].positions.begin(), chunks[c].positions.end());
+        uvs.insert(uvs.end(), chunks[c].uvs.begin(), chunks[c].uvs.end());
+        normals.insert(normals.end(), chunks[c].normals.begin(), chunks[c].normals.end());
+    }
+
+    // Gather each object/group's corners, a group can continue across chunks
+    std::vector<ObjMesh> objMeshes(1);
+    for (size_t c = 0; c < numChunks; ++c)
+    {
+        size_t start = 0;
+        for (const auto &g : chunks[c].groups)
+        {
+            if (g.firstCorner > start)
+            {
+                objMeshes.back().segments.push_back({c, start, g.firstCorner});
+            }
+            // Drop groups that never received a face
+            if (objMeshes.back().segments.empty())
+            {
+                objMeshes.pop_back();
+            }
+            objMeshes.push_back({g.name, {}});
+            start = g.firstCorner;
+        }
+        if (chunks[c].corners.size() > start)
+        {
+            objMeshes.back().segments.push_back({c, start, chunks[c].corners.size()});
+        }
+    }
+    if (objMeshes.back().segments.empty())
+    {
+        objMeshes.pop_back();
+    }
+
+    // Assemble every object/group as its own job
+    size_t firstMesh = meshes.size();
+    meshes.resize(firstMesh + objMeshes.size());
+    jobs->ParallelFor(objMeshes.size(), 1, [&](size_t begin, size_t end)
+                      {
+                          for (size_t m = begin; m < end; ++m)
+                          {
+                              AssembleObjMesh(objMeshes[m], chunks, positions, uvs, normals, positionOffsets, uvOffsets, normalOffsets, meshes[firstMesh + m]);
+                          } });
+
+    return true;
+}
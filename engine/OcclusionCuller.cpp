@@ -0,0 +1,391 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE
+#endif
+
+// Size of a tile in pixels, the width must be a multiple of 4 for the SIMD loops
+static const int sTileWidth = 32;
+static const int sTileHeight = 16;
+
+// Number of occluder triangles set up by one job
+static const size_t sTrianglesPerBatch = 256;
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : mViewProj(glm::mat4(1.0f)), mBatchCount(0)
+{
+    mTilesX = (std::max(width, 1) + sTileWidth - 1) / sTileWidth;
+    mTilesY = (std::max(height, 1) + sTileHeight - 1) / sTileHeight;
+    mWidth = mTilesX * sTileWidth;
+    mHeight = mTilesY * sTileHeight;
+
+    mDepth.assign(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+    mTileMaxDepth.assign(static_cast<size_t>(mTilesX) * mTilesY, 1.0f);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    std::cout << "Delete occlusion culler" << std::endl;
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4 &viewProj)
+{
+    mViewProj = viewProj;
+    mOccluders.clear();
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+    std::fill(mTileMaxDepth.begin(), mTileMaxDepth.end(), 1.0f);
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3 *positions, const uint32_t *indices, size_t indexCount, const glm::mat4 &model)
+{
+    if (indexCount >= 3)
+    {
+        mOccluders.push_back({positions, indices, indexCount / 3, model});
+    }
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+    // Number all occluder triangles so they can be split into even batches
+    mTriangleOffsets.resize(mOccluders.size() + 1);
+    mTriangleOffsets[0] = 0;
+    for (size_t i = 0; i < mOccluders.size(); ++i)
+    {
+        mTriangleOffsets[i + 1] = mTriangleOffsets[i] + mOccluders[i].triangleCount;
+    }
+    size_t triangleCount = mTriangleOffsets.back();
+    if (triangleCount == 0)
+    {
+        mBatchCount = 0;
+        return;
+    }
+
+    // Each batch has its own bins, so setup needs no locks
+    JobSystem *jobs = JobSystem::Get();
+    size_t maxBatches = 4 * (jobs->GetNumWorkers() + 1);
+    mBatchCount = std::min(maxBatches, (triangleCount + sTrianglesPerBatch - 1) / sTrianglesPerBatch);
+    if (mBatches.size() < mBatchCount)
+    {
+        mBatches.resize(mBatchCount);
+    }
+    size_t tileCount = static_cast<size_t>(mTilesX) * mTilesY;
+    for (size_t b = 0; b < mBatchCount; ++b)
+    {
+        mBatches[b].triangles.clear();
+        mBatches[b].bins.resize(tileCount);
+        for (auto &bin : mBatches[b].bins)
+        {
+            bin.clear();
+        }
+    }
+
+    jobs->ParallelFor(mBatchCount, 1, [this, triangleCount](size_t begin, size_t end)
+                      {
+                          for (size_t b = begin; b < end; ++b)
+                          {
+                              SetupTriangles(triangleCount * b / mBatchCount, triangleCount * (b + 1) / mBatchCount, mBatches[b]);
+                          } });
+
+    // Tiles cover separate pixels, so each can be rasterized by its own job
+    jobs->ParallelFor(tileCount, 1, [this](size_t begin, size_t end)
+                      {
+                          for (size_t t = begin; t < end; ++t)
+                          {
+                              RasterizeTile(static_cast<int>(t));
+                          } });
+}
+
+void OcclusionCuller::SetupTriangles(size_t begin, size_t end, Batch &batch)
+{
+    // Find the occluder of the first triangle
+    size_t o = std::upper_bound(mTriangleOffsets.begin(), mTriangleOffsets.end(), begin) - mTriangleOffsets.begin() - 1;
+    glm::mat4 modelViewProj = mViewProj * mOccluders[o].model;
+
+    for (size_t t = begin; t < end; ++t)
+    {
+        while (t >= mTriangleOffsets[o + 1])
+        {
+            ++o;
+            modelViewProj = mViewProj * mOccluders[o].model;
+        }
+        const Occluder &occluder = mOccluders[o];
+        const uint32_t *triangle = occluder.indices + (t - mTriangleOffsets[o]) * 3;
+
+        glm::vec4 clip[3];
+        float nearDistance[3];
+        int inFront = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            clip[c] = modelViewProj * glm::vec4(occluder.positions[triangle[c]], 1.0f);
+            nearDistance[c] = clip[c].z + clip[c].w;
+            inFront += nearDistance[c] >= 0.0f;
+        }
+
+        if (inFront == 3)
+        {
+            BinTriangle(clip, batch);
+            continue;
+        }
+        if (inFront == 0)
+        {
+            continue;
+        }
+
+        // Clip against the near plane, which leaves a triangle or a quad
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            int next = (c + 1) % 3;
+            if (nearDistance[c] >= 0.0f)
+            {
+                polygon[count++] = clip[c];
+            }
+            if ((nearDistance[c] >= 0.0f) != (nearDistance[next] >= 0.0f))
+            {
+                float f = nearDistance[c] / (nearDistance[c] - nearDistance[next]);
+                polygon[count++] = clip[c] + (clip[next] - clip[c]) * f;
+            }
+        }
+        for (int c = 1; c + 1 < count; ++c)
+        {
+            glm::vec4 fan[3] = {polygon[0], polygon[c], polygon[c + 1]};
+            BinTriangle(fan, batch);
+        }
+    }
+}
+
+void OcclusionCuller::BinTriangle(const glm::vec4 (&clip)[3], Batch &batch)
+{
+    ScreenTriangle screen;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (clip[c].w <= 0.0f)
+        {
+            return;
+        }
+        glm::vec3 ndc = glm::vec3(clip[c]) / clip[c].w;
+        screen.v[c] = glm::vec3((ndc.x * 0.5f + 0.5f) * mWidth, (ndc.y * 0.5f + 0.5f) * mHeight, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Both faces are rasterized, but triangles seen edge on cover no pixels
+    float area = (screen.v[1].x - screen.v[0].x) * (screen.v[2].y - screen.v[0].y) - (screen.v[2].x - screen.v[0].x) * (screen.v[1].y - screen.v[0].y);
+    if (area == 0.0f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(screen.v[1], screen.v[2]);
+    }
+
+    float minX = std::min(screen.v[0].x, std::min(screen.v[1].x, screen.v[2].x));
+    float maxX = std::max(screen.v[0].x, std::max(screen.v[1].x, screen.v[2].x));
+    float minY = std::min(screen.v[0].y, std::min(screen.v[1].y, screen.v[2].y));
+    float maxY = std::max(screen.v[0].y, std::max(screen.v[1].y, screen.v[2].y));
+    if (maxX < 0.0f || maxY < 0.0f || minX >= mWidth || minY >= mHeight)
+    {
+        return;
+    }
+
+    int tileX0 = std::max(0, static_cast<int>(minX) / sTileWidth);
+    int tileX1 = std::min(mTilesX - 1, static_cast<int>(maxX) / sTileWidth);
+    int tileY0 = std::max(0, static_cast<int>(minY) / sTileHeight);
+    int tileY1 = std::min(mTilesY - 1, static_cast<int>(maxY) / sTileHeight);
+
+    uint32_t index = static_cast<uint32_t>(batch.triangles.size());
+    batch.triangles.push_back(screen);
+    for (int ty = tileY0; ty <= tileY1; ++ty)
+    {
+        for (int tx = tileX0; tx <= tileX1; ++tx)
+        {
+            batch.bins[ty * mTilesX + tx].push_back(index);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTile(int tile)
+{
+    int tileX0 = (tile % mTilesX) * sTileWidth;
+    int tileY0 = (tile / mTilesX) * sTileHeight;
+    int tileX1 = tileX0 + sTileWidth - 1;
+    int tileY1 = tileY0 + sTileHeight - 1;
+
+    for (size_t b = 0; b < mBatchCount; ++b)
+    {
+        const Batch &batch = mBatches[b];
+        for (uint32_t index : batch.bins[tile])
+        {
+            const glm::vec3 *v = batch.triangles[index].v;
+
+            // Edge functions are positive inside the counter clockwise triangle. Each edge is
+            // set up from its lower vertex and flipped by negation, so the two triangles that
+            // share an edge compute exactly opposite values and no pixels fall between them
+            float edgeA[3], edgeB[3], edgeC[3];
+            for (int e = 0; e < 3; ++e)
+            {
+                const glm::vec3 *from = &v[e];
+                const glm::vec3 *to = &v[(e + 1) % 3];
+                bool flip = to->y < from->y || (to->y == from->y && to->x < from->x);
+                if (flip)
+                {
+                    std::swap(from, to);
+                }
+                edgeA[e] = from->y - to->y;
+                edgeB[e] = to->x - from->x;
+                edgeC[e] = -(edgeA[e] * from->x + edgeB[e] * from->y);
+                if (flip)
+                {
+                    edgeA[e] = -edgeA[e], edgeB[e] = -edgeB[e], edgeC[e] = -edgeC[e];
+                }
+            }
+
+            // Depth is linear in screen space: z = z0 + dzdx * (x - x0) + dzdy * (y - y0)
+            float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+            float dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+            float dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+            float zC = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+
+            // Bounding box of the triangle within the tile, starting on a 4 pixel boundary
+            int minX = std::max(tileX0, static_cast<int>(std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x))))) & ~3;
+            int maxX = std::min(tileX1, static_cast<int>(std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x)))));
+            int minY = std::max(tileY0, static_cast<int>(std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y)))));
+            int maxY = std::min(tileY1, static_cast<int>(std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y)))));
+
+            for (int y = minY; y <= maxY; ++y)
+            {
+                float py = y + 0.5f;
+                float *row = &mDepth[static_cast<size_t>(y) * mWidth];
+#ifdef OCCLUSION_CULLER_SSE
+                __m128 rowE0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+                __m128 rowE1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+                __m128 rowE2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+                __m128 rowZ = _mm_set1_ps(dzdy * py + zC);
+                for (int x = minX; x <= maxX; x += 4)
+                {
+                    __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+                    __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), px), rowE0);
+                    __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), px), rowE1);
+                    __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), px), rowE2);
+                    __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, _mm_setzero_ps()),
+                                               _mm_and_ps(_mm_cmpge_ps(e1, _mm_setzero_ps()), _mm_cmpge_ps(e2, _mm_setzero_ps())));
+                    if (_mm_movemask_ps(inside) == 0)
+                    {
+                        continue;
+                    }
+
+                    // Keep the nearest depth of the covered pixels
+                    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), rowZ);
+                    __m128 depth = _mm_loadu_ps(row + x);
+                    __m128 nearest = _mm_min_ps(depth, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+                }
+#else
+                for (int x = minX; x <= maxX; ++x)
+                {
+                    float px = x + 0.5f;
+                    if (edgeA[0] * px + edgeB[0] * py + edgeC[0] >= 0.0f && edgeA[1] * px + edgeB[1] * py + edgeC[1] >= 0.0f &&
+                        edgeA[2] * px + edgeB[2] * py + edgeC[2] >= 0.0f)
+                    {
+                        row[x] = std::min(row[x], dzdx * px + dzdy * py + zC);
+                    }
+                }
+#endif
+            }
+        }
+    }
+
+    // Farthest depth of the tile for the early out of the visibility tests
+    float maxDepth = 0.0f;
+    for (int y = tileY0; y <= tileY1; ++y)
+    {
+        const float *row = &mDepth[static_cast<size_t>(y) * mWidth];
+        for (int x = tileX0; x <= tileX1; ++x)
+        {
+            maxDepth = std::max(maxDepth, row[x]);
+        }
+    }
+    mTileMaxDepth[tile] = maxDepth;
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &model) const
+{
+    glm::mat4 modelViewProj = mViewProj * model;
+
+    // Screen rectangle and nearest depth of the box's corners
+    float minX = static_cast<float>(mWidth), maxX = 0.0f;
+    float minY = static_cast<float>(mHeight), maxY = 0.0f;
+    float minZ = 1.0f;
+    for (int c = 0; c < 8; ++c)
+    {
+        glm::vec3 corner = glm::vec3(c & 1 ? boundsMax.x : boundsMin.x, c & 2 ? boundsMax.y : boundsMin.y, c & 4 ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = modelViewProj * glm::vec4(corner, 1.0f);
+        if (clip.w <= 0.0f || clip.z < -clip.w)
+        {
+            return true;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        float x = (ndc.x * 0.5f + 0.5f) * mWidth;
+        float y = (ndc.y * 0.5f + 0.5f) * mHeight;
+        minX = std::min(minX, x), maxX = std::max(maxX, x);
+        minY = std::min(minY, y), maxY = std::max(maxY, y);
+        minZ = std::min(minZ, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Off screen or behind the far plane
+    if (maxX < 0.0f || maxY < 0.0f || minX >= mWidth || minY >= mHeight || minZ >= 1.0f)
+    {
+        return false;
+    }
+
+    int pixelX0 = std::max(0, static_cast<int>(minX));
+    int pixelX1 = std::min(mWidth - 1, static_cast<int>(maxX));
+    int pixelY0 = std::max(0, static_cast<int>(minY));
+    int pixelY1 = std::min(mHeight - 1, static_cast<int>(maxY));
+
+    for (int ty = pixelY0 / sTileHeight; ty <= pixelY1 / sTileHeight; ++ty)
+    {
+        for (int tx = pixelX0 / sTileWidth; tx <= pixelX1 / sTileWidth; ++tx)
+        {
+            // Every pixel of the tile is nearer than the box
+            if (minZ >= mTileMaxDepth[ty * mTilesX + tx])
+            {
+                continue;
+            }
+
+            // Visible if any pixel of the rectangle within the tile is farther than the box
+            int x0 = std::max(pixelX0, tx * sTileWidth);
+            int x1 = std::min(pixelX1, tx * sTileWidth + sTileWidth - 1);
+            int y0 = std::max(pixelY0, ty * sTileHeight);
+            int y1 = std::min(pixelY1, ty * sTileHeight + sTileHeight - 1);
+            for (int y = y0; y <= y1; ++y)
+            {
+                const float *row = &mDepth[static_cast<size_t>(y) * mWidth];
+                int x = x0;
+#ifdef OCCLUSION_CULLER_SSE
+                __m128 boxDepth = _mm_set1_ps(minZ);
+                for (; x + 3 <= x1; x += 4)
+                {
+                    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(row + x), boxDepth)))
+                    {
+                        return true;
+                    }
+                }
+#endif
+                for (; x <= x1; ++x)
+                {
+                    if (row[x] > minZ)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
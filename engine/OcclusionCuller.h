@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// OcclusionCuller is a CPU software occlusion culler. Each frame a chosen set of occluder
+// meshes is rasterized into a small depth buffer, then the bounding boxes of other objects
+// are tested against it before they are submitted to the GPU.
+// The depth buffer is split into tiles. Occluder triangles are transformed, clipped and
+// binned to the tiles they touch in parallel batches on the JobSystem, then every tile is
+// rasterized by its own job, 4 pixels at a time with SSE. Each tile keeps the farthest
+// depth of its pixels so most bounding box tests are answered without touching pixels.
+// Nothing here uses OpenGL, so it runs (and can be benchmarked) without a GPU.
+class OcclusionCuller
+{
+public:
+    //   OcclusionCuller constructor:
+    // - int for the width of the depth buffer, rounded up to a multiple of the tile width
+    // - int for the height of the depth buffer, rounded up to a multiple of the tile height
+    OcclusionCuller(int width = 256, int height = 144);
+    ~OcclusionCuller();
+
+    //   BeginFrame clears the depth buffer and the occluders of the last frame:
+    // - const glm::mat4& for the view projection matrix
+    void BeginFrame(const glm::mat4 &viewProj);
+
+    //   AddOccluder queues a mesh to be rasterized. The data is read in RasterizeOccluders
+    //   and must stay alive until then:
+    // - const glm::vec3* for the positions of the mesh's vertices
+    // - const uint32_t* for the triangle list indices
+    // - size_t for the number of indices
+    // - const glm::mat4& for the model matrix
+    void AddOccluder(const glm::vec3 *positions, const uint32_t *indices, size_t indexCount, const glm::mat4 &model);
+
+    // RasterizeOccluders rasterizes every queued occluder into the depth buffer using the JobSystem
+    void RasterizeOccluders();
+
+    //   IsVisible returns false if a bounding box is fully hidden behind the occluders or
+    //   outside of the screen. Boxes that cross the near plane are always visible:
+    // - const glm::vec3& for the minimum corner of the box in model space
+    // - const glm::vec3& for the maximum corner of the box in model space
+    // - const glm::mat4& for the model matrix
+    bool IsVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &model) const;
+
+    // Getters for the depth buffer's size and its depths (0 is near, 1 is far), row by row from the bottom
+    int GetWidth() const { return mWidth; }
+    int GetHeight() const { return mHeight; }
+    const float *GetDepth() const { return mDepth.data(); }
+
+private:
+    // An occluder mesh queued for this frame
+    struct Occluder
+    {
+        const glm::vec3 *positions;
+        const uint32_t *indices;
+        size_t triangleCount;
+        glm::mat4 model;
+    };
+
+    // A clipped triangle in screen space: x and y in pixels, z in [0, 1]
+    struct ScreenTriangle
+    {
+        glm::vec3 v[3];
+    };
+
+    // Triangles and tile bins written by one setup batch
+    struct Batch
+    {
+        std::vector<ScreenTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    //   Transforms, clips and bins the triangles of a range of all occluder triangles:
+    // - size_t for the first triangle
+    // - size_t for the end of the range
+    // - Batch& that receives the triangles
+    void SetupTriangles(size_t begin, size_t end, Batch &batch);
+
+    //   Adds a triangle that is in front of the near plane to a batch:
+    // - const glm::vec4 (&)[3] for the clip space corners
+    // - Batch& that receives the triangle
+    void BinTriangle(const glm::vec4 (&clip)[3], Batch &batch);
+
+    //   Rasterizes every triangle binned to a tile:
+    // - int for the tile's index
+    void RasterizeTile(int tile);
+
+    // Size of the depth buffer in pixels and tiles
+    int mWidth;
+    int mHeight;
+    int mTilesX;
+    int mTilesY;
+
+    // Depth of every pixel, the nearest occluder wins
+    std::vector<float> mDepth;
+
+    // Farthest depth of the pixels of each tile
+    std::vector<float> mTileMaxDepth;
+
+    glm::mat4 mViewProj;
+
+    std::vector<Occluder> mOccluders;
+
+    // First triangle of each occluder among all occluder triangles
+    std::vector<size_t> mTriangleOffsets;
+
+    // Setup batches, only the first mBatchCount are used this frame
+    std::vector<Batch> mBatches;
+    size_t mBatchCount;
+};
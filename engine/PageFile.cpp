@@ -0,0 +1,165 @@
+#include "PageFile.h"
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "Texture.h"
+
+// Header at the start of a page file, followed by the pages
+struct PageFileHeader
+{
+    char magic[4];
+    uint32_t size;
+    uint32_t pageSize;
+    uint32_t border;
+    uint32_t levelCount;
+};
+
+static const char sMagic[4] = {'V', 'T', 'P', 'F'};
+
+// Largest page side that is read, the pages are uploaded into textures
+static const uint32_t sMaxPageSize = 1 << 14;
+
+PageFile::PageFile(const std::string &fileName)
+    : mFile(fileName), mSize(0), mPageSize(0), mBorder(0), mLevelCount(0), mLevelOffsets(1, 0), mIsOpen(false)
+{
+    if (!mFile.GetData() || mFile.GetSize() < sizeof(PageFileHeader))
+    {
+        std::cout << "Page file " << fileName << " is missing or empty" << std::endl;
+        return;
+    }
+
+    PageFileHeader header;
+    std::memcpy(&header, mFile.GetData(), sizeof(header));
+    // The header has to describe what Bake writes before any size is derived from it: whole pages,
+    // a power of two of them along each side and a level for every halving down to a single page
+    uint32_t pageCount = header.pageSize > 0 ? header.size / header.pageSize : 0;
+    uint32_t levelCount = 1;
+    while ((pageCount >> (levelCount - 1)) > 1)
+    {
+        ++levelCount;
+    }
+    if (std::memcmp(header.magic, sMagic, sizeof(sMagic)) != 0 || header.pageSize == 0 || header.pageSize > sMaxPageSize || header.border >= header.pageSize ||
+        header.size > INT_MAX || pageCount == 0 || header.size % header.pageSize != 0 || (pageCount & (pageCount - 1)) != 0 || header.levelCount != levelCount)
+    {
+        std::cout << "Page file " << fileName << " has an invalid header" << std::endl;
+        return;
+    }
+
+    // Count the pages without overflowing before the offsets are built
+    uint64_t totalPages = 0;
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        uint64_t levelPages = pageCount >> level;
+        totalPages += levelPages * levelPages;
+    }
+    uint64_t tileSize = header.pageSize + 2 * static_cast<uint64_t>(header.border);
+    uint64_t tileBytes = tileSize * tileSize * 4;
+    if (totalPages > INT_MAX || totalPages > (mFile.GetSize() - sizeof(PageFileHeader)) / tileBytes)
+    {
+        std::cout << "Page file " << fileName << " is missing pages" << std::endl;
+        return;
+    }
+
+    mSize = static_cast<int>(header.size);
+    mPageSize = static_cast<int>(header.pageSize);
+    mBorder = static_cast<int>(header.border);
+    mLevelCount = static_cast<int>(header.levelCount);
+
+    for (int level = 0; level < mLevelCount; ++level)
+    {
+        mLevelOffsets.push_back(mLevelOffsets.back() + GetPageCount(level) * GetPageCount(level));
+    }
+    mIsOpen = true;
+}
+
+PageFile::~PageFile()
+{
+    std::cout << "Delete page file" << std::endl;
+}
+
+const unsigned char *PageFile::GetPage(int page) const
+{
+    size_t tileBytes = static_cast<size_t>(GetTileSize()) * GetTileSize() * 4;
+    return reinterpret_cast<const unsigned char *>(mFile.GetData() + sizeof(PageFileHeader) + page * tileBytes);
+}
+
+bool PageFile::Bake(const std::string &fileName, const ImageData &image, int repeat, int pageSize, int border)
+{
+    int size = image.width * repeat;
+    int pageCount = pageSize > 0 ? size / pageSize : 0;
+    if (!image.pixels || image.width != image.height || pageCount == 0 || pageCount * pageSize != size || (pageCount & (pageCount - 1)) != 0)
+    {
+        std::cout << "Can't bake page file " << fileName << ", the image must be square and cover a power of two number of pages" << std::endl;
+        return false;
+    }
+
+    // The finest level as RGBA8, each copy of the image with its own tint
+    std::vector<std::vector<unsigned char>> levels(1);
+    levels[0].resize(static_cast<size_t>(size) * size * 4);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            uint32_t hash = static_cast<uint32_t>(x / image.width) * 73856093u ^ static_cast<uint32_t>(y / image.height) * 19349663u;
+            const unsigned char *source = image.pixels + (static_cast<size_t>(y % image.height) * image.width + x % image.width) * image.numChannels;
+            unsigned char *texel = levels[0].data() + (static_cast<size_t>(y) * size + x) * 4;
+            for (int c = 0; c < 3; ++c)
+            {
+                float tint = 0.6f + 0.4f * static_cast<float>((hash >> (c * 8)) & 255u) / 255.0f;
+                texel[c] = static_cast<unsigned char>(source[std::min(c, image.numChannels - 1)] * tint);
+            }
+            texel[3] = image.numChannels == 4 ? source[3] : 255;
+        }
+    }
+
+    // Every level down to a single page
+    int levelCount = 1;
+    while ((pageCount >> (levelCount - 1)) > 1)
+    {
+        int levelSize = size >> (levelCount - 1);
+        levels.emplace_back();
+        Texture::Downsample(levels[levelCount - 1].data(), levelSize, levelSize, 4, levels.back());
+        ++levelCount;
+    }
+
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Can't write page file " << fileName << std::endl;
+        return false;
+    }
+    PageFileHeader header;
+    std::memcpy(header.magic, sMagic, sizeof(sMagic));
+    header.size = static_cast<uint32_t>(size);
+    header.pageSize = static_cast<uint32_t>(pageSize);
+    header.border = static_cast<uint32_t>(border);
+    header.levelCount = static_cast<uint32_t>(levelCount);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // Cut the pages, the borders repeat the texels at the edge of the level
+    int tileSize = pageSize + 2 * border;
+    std::vector<unsigned char> tile(static_cast<size_t>(tileSize) * tileSize * 4);
+    for (int level = 0; level < levelCount; ++level)
+    {
+        int levelSize = size >> level;
+        int levelPages = std::max(pageCount >> level, 1);
+        for (int py = 0; py < levelPages; ++py)
+        {
+            for (int px = 0; px < levelPages; ++px)
+            {
+                for (int ty = 0; ty < tileSize; ++ty)
+                {
+                    int sy = std::clamp(py * pageSize + ty - border, 0, levelSize - 1);
+                    for (int tx = 0; tx < tileSize; ++tx)
+                    {
+                        int sx = std::clamp(px * pageSize + tx - border, 0, levelSize - 1);
+                        std::memcpy(tile.data() + (static_cast<size_t>(ty) * tileSize + tx) * 4, levels[level].data() + (static_cast<size_t>(sy) * levelSize + sx) * 4, 4);
+                    }
+                }
+                file.write(reinterpret_cast<const char *>(tile.data()), tile.size());
+            }
+        }
+    }
+    return file.good();
+}
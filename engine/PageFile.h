@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+struct ImageData;
+
+// PageFile is the on-disk form of a virtual texture: every mipmap level cut into square
+// pages, one after another from the finest level to the single page of the coarsest.
+// Each page is stored as RGBA8 with a border of texels copied from its neighbours, so
+// a page can be filtered on its own once it is in a VirtualTexture's page cache.
+// The file is mapped with MappedFile, so reading a page only touches the disk for that
+// page, and pages can be read from any thread.
+class PageFile
+{
+public:
+    //   PageFile constructor, maps the file and checks its header:
+    // - const std::string& for the file path of the page file
+    PageFile(const std::string &fileName);
+    ~PageFile();
+
+    //   Bake cuts an image into a page file. The image is repeated to cover the virtual
+    //   texture, each copy tinted differently so every page of the result is unique.
+    //   Returns false if the size is not a power of two number of pages:
+    // - const std::string& for the file path to write
+    // - const ImageData& for a decoded square image
+    // - int for how many times the image repeats along each side
+    // - int for the number of texels along the side of a page, without the borders
+    // - int for the number of border texels on each side of a page
+    static bool Bake(const std::string &fileName, const ImageData &image, int repeat, int pageSize, int border);
+
+    // Returns true if the file was mapped and its header is valid
+    bool IsOpen() const { return mIsOpen; }
+
+    // Getters for the size of the finest level in texels, the size of a page with and
+    // without its borders, the border and the number of mipmap levels
+    int GetSize() const { return mSize; }
+    int GetPageSize() const { return mPageSize; }
+    int GetTileSize() const { return mPageSize + 2 * mBorder; }
+    int GetBorder() const { return mBorder; }
+    int GetLevelCount() const { return mLevelCount; }
+
+    //   GetPageCount returns the number of pages along each side of a level:
+    // - int for the level
+    int GetPageCount(int level) const { return std::max(mSize / mPageSize >> level, 1); }
+
+    //   GetPageIndex returns the index of a page counting the pages of every level, finest level first:
+    // - int for the level
+    // - int for the column and row of the page in the level
+    int GetPageIndex(int level, int x, int y) const { return mLevelOffsets[level] + y * GetPageCount(level) + x; }
+
+    // Getter for the number of pages of all levels
+    int GetTotalPageCount() const { return mLevelOffsets.back(); }
+
+    //   GetPage returns the RGBA8 texels of a page, GetTileSize() squared, inside the mapping:
+    // - int for the index of the page
+    const unsigned char *GetPage(int page) const;
+
+private:
+    MappedFile mFile;
+
+    int mSize;
+    int mPageSize;
+    int mBorder;
+    int mLevelCount;
+
+    // Index of the first page of every level, followed by the total number of pages
+    std::vector<int> mLevelOffsets;
+
+    bool mIsOpen;
+};
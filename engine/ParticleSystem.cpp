@@ -0,0 +1,429 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <glad/glad.h>
+#include "AssetManager.h"
+#include "JobSystem.h"
+#include "Shader.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PARTICLE_SYSTEM_SSE
+#endif
+
+// Work group size of shaders/particleSimulateCS.glsl
+static const unsigned int sSimulateGroupSize = 64;
+
+// Work group size of shaders/particleSortCS.glsl, each group sorts twice as many entries in shared memory
+static const size_t sSortGroupSize = 512;
+static const size_t sSortBlockSize = sSortGroupSize * 2;
+
+// Slots the CPU simulation hands to a job at a time, a multiple of 4
+static const size_t sBatchSize = 4096;
+
+// Modes of the sort shader
+static const int sSortKeys = 0;
+static const int sSortBlocks = 1;
+static const int sSortMergeStep = 2;
+static const int sSortMergeBlocks = 3;
+
+//   Hash scrambles a number, the same hash as in shaders/particleSimulateCS.glsl:
+// - uint32_t for the number
+static uint32_t Hash(uint32_t x)
+{
+    uint32_t state = x * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+//   Random returns a number in [0, 1) and moves the seed on:
+// - uint32_t& for the seed
+static float Random(uint32_t &seed)
+{
+    seed = Hash(seed);
+    return static_cast<float>(seed >> 8) / 16777216.0f;
+}
+
+ParticleSystem::ParticleSystem(size_t maxParticles)
+    : mMaxParticles((maxParticles + 3) & ~size_t(3)), mParticleCount(0), mGravity(0.0f, -9.8f, 0.0f), mUseCompute(true), mCpuTime(0.0f), mFrame(0),
+      mCurrent(0), mEmitterBufferID(0), mSortBufferID(0), mSortCount(sSortBlockSize), mVertexArrayID(0)
+{
+    // Every slot starts dead
+    mPositionX.assign(mMaxParticles, 0.0f), mPositionY.assign(mMaxParticles, 0.0f), mPositionZ.assign(mMaxParticles, 0.0f);
+    mVelocityX.assign(mMaxParticles, 0.0f), mVelocityY.assign(mMaxParticles, 0.0f), mVelocityZ.assign(mMaxParticles, 0.0f);
+    mAge.assign(mMaxParticles, -1.0f);
+    mPacked.assign(mMaxParticles, {glm::vec4(0.0f, 0.0f, 0.0f, -1.0f), glm::vec4(0.0f)});
+
+    glGenBuffers(2, mParticleBufferIDs);
+    for (unsigned int bufferID : mParticleBufferIDs)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mPacked.size() * sizeof(GpuParticle), mPacked.data(), GL_DYNAMIC_DRAW);
+    }
+
+    glGenBuffers(1, &mEmitterBufferID);
+
+    // The bitonic sort needs a power of 2 entries, at least a block of the sort shader
+    while (mSortCount < mMaxParticles)
+    {
+        mSortCount *= 2;
+    }
+    glGenBuffers(1, &mSortBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSortBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, mSortCount * sizeof(uint32_t) * 2, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Core profile draws need a vertex array even without attributes
+    glGenVertexArrays(1, &mVertexArrayID);
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    std::cout << "Delete particle system" << std::endl;
+
+    glDeleteBuffers(2, mParticleBufferIDs);
+    glDeleteBuffers(1, &mEmitterBufferID);
+    glDeleteBuffers(1, &mSortBufferID);
+    glDeleteVertexArrays(1, &mVertexArrayID);
+}
+
+size_t ParticleSystem::AddEmitter(const ParticleEmitter &emitter)
+{
+    // Enough slots for every particle alive at once, 4 at a time for the SSE simulation
+    size_t count = static_cast<size_t>(std::ceil(std::max(emitter.rate * emitter.lifetime, 1.0f)));
+    count = (count + 3) & ~size_t(3);
+    if (mParticleCount + count > mMaxParticles)
+    {
+        std::cout << "Particle system is full, " << mMaxParticles << " particles" << std::endl;
+        return mEmitters.size();
+    }
+    mEmitters.push_back({emitter, static_cast<uint32_t>(mParticleCount), static_cast<uint32_t>(count), 0, 0, 0.0f});
+    mParticleCount += count;
+    return mEmitters.size() - 1;
+}
+
+void ParticleSystem::SetUseCompute(bool useCompute)
+{
+    // The CPU simulation goes on from where the compute shader left the particles
+    if (!useCompute && mUseCompute)
+    {
+        ReadBack();
+    }
+    mUseCompute = useCompute;
+}
+
+void ParticleSystem::Update(float deltaTime)
+{
+    if (mParticleCount == 0)
+    {
+        return;
+    }
+
+    // Particles due this frame, an emitter never spawns more than its ring holds
+    std::vector<GpuEmitter> gpuEmitters(mEmitters.size());
+    for (size_t i = 0; i < mEmitters.size(); ++i)
+    {
+        EmitterState &state = mEmitters[i];
+        const ParticleEmitter &emitter = state.emitter;
+        state.spawnRemainder += emitter.rate * deltaTime;
+        float spawnCount = std::floor(state.spawnRemainder);
+        state.spawnRemainder -= spawnCount;
+        state.spawnCount = std::min(static_cast<uint32_t>(spawnCount), state.count);
+
+        gpuEmitters[i] = {glm::vec4(emitter.position, emitter.radius), glm::vec4(emitter.velocity, emitter.spread), emitter.startColor, emitter.endColor,
+                          glm::vec4(emitter.lifetime, emitter.startSize, emitter.endSize, emitter.drag), {state.first, state.count, state.cursor, state.spawnCount}};
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mEmitterBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, gpuEmitters.size() * sizeof(GpuEmitter), gpuEmitters.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (mUseCompute)
+    {
+        SimulateCompute(deltaTime);
+    }
+    else
+    {
+        SimulateCpu(deltaTime);
+    }
+
+    for (EmitterState &state : mEmitters)
+    {
+        state.cursor = (state.cursor + state.spawnCount) % state.count;
+    }
+    ++mFrame;
+}
+
+void ParticleSystem::SimulateCompute(float deltaTime)
+{
+    // The simulation shader is owned by the AssetManager
+    AssetManager *am = AssetManager::Get();
+    Shader *simulateShader = am->LoadShader("particleSimulate"_id);
+    if (!simulateShader)
+    {
+        simulateShader = new Shader("shaders/particleSimulateCS.glsl");
+        am->SaveShader("particleSimulate"_id, simulateShader);
+    }
+
+    // Remember the current shader, the simulation shader replaces it while dispatching
+    int currentShader = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentShader);
+
+    // Last frame's particles are read from one buffer and this frame's written to the other
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mParticleBufferIDs[mCurrent]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mParticleBufferIDs[1 - mCurrent]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mEmitterBufferID);
+
+    simulateShader->SetActive();
+    simulateShader->SetUInt("particleCount"_id, static_cast<unsigned int>(mParticleCount));
+    simulateShader->SetUInt("emitterCount"_id, static_cast<unsigned int>(mEmitters.size()));
+    simulateShader->SetFloat("deltaTime"_id, deltaTime);
+    simulateShader->SetVec3("gravity"_id, mGravity);
+    simulateShader->SetUInt("frameSeed"_id, Hash(mFrame));
+    glDispatchCompute(static_cast<GLuint>((mParticleCount + sSimulateGroupSize - 1) / sSimulateGroupSize), 1, 1);
+
+    // Make the particles visible to the sort and the vertex shader
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    mCurrent = 1 - mCurrent;
+    mCpuTime = 0.0f;
+
+    glUseProgram(currentShader);
+}
+
+void ParticleSystem::SimulateCpu(float deltaTime)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    // Each emitter's slots are split into batches, so no batch mixes the settings of two emitters
+    std::vector<std::pair<size_t, size_t>> batches;
+    for (size_t e = 0; e < mEmitters.size(); ++e)
+    {
+        for (size_t begin = mEmitters[e].first; begin < mEmitters[e].first + mEmitters[e].count; begin += sBatchSize)
+        {
+            batches.emplace_back(e, begin);
+        }
+    }
+
+    auto simulate = [this, &batches, deltaTime](size_t begin, size_t end)
+    {
+        for (size_t b = begin; b < end; ++b)
+        {
+            const EmitterState &state = mEmitters[batches[b].first];
+            size_t first = batches[b].second;
+            size_t last = std::min(first + sBatchSize, static_cast<size_t>(state.first + state.count));
+            SimulateBatch(state, first, last, deltaTime);
+
+            // The slots spawned into run from the cursor on and wrap around the ring at most once
+            uint32_t headCount = std::min(state.spawnCount, state.count - state.cursor);
+            uint32_t segments[2][3] = {{state.cursor, headCount, 0}, {0, state.spawnCount - headCount, headCount}};
+            for (const auto &segment : segments)
+            {
+                size_t segmentBegin = std::max(first, static_cast<size_t>(state.first + segment[0]));
+                size_t segmentEnd = std::min(last, static_cast<size_t>(state.first + segment[0] + segment[1]));
+                for (size_t slot = segmentBegin; slot < segmentEnd; ++slot)
+                {
+                    uint32_t order = segment[2] + static_cast<uint32_t>(slot - state.first - segment[0]);
+                    SpawnParticle(state, static_cast<uint32_t>(slot), order, deltaTime);
+                }
+            }
+
+            float emitterIndex = static_cast<float>(batches[b].first);
+            for (size_t i = first; i < last; ++i)
+            {
+                mPacked[i] = {glm::vec4(mPositionX[i], mPositionY[i], mPositionZ[i], mAge[i]), glm::vec4(mVelocityX[i], mVelocityY[i], mVelocityZ[i], emitterIndex)};
+            }
+        }
+    };
+    JobSystem *jobs = JobSystem::Get();
+    if (jobs)
+    {
+        jobs->ParallelFor(batches.size(), 1, simulate);
+    }
+    else
+    {
+        simulate(0, batches.size());
+    }
+
+    // Written to the buffer the compute shader would have, the other may still be drawn from
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mParticleBufferIDs[1 - mCurrent]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mParticleCount * sizeof(GpuParticle), mPacked.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    mCurrent = 1 - mCurrent;
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    mCpuTime = static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6);
+}
+
+void ParticleSystem::SimulateBatch(const EmitterState &state, size_t begin, size_t end, float deltaTime)
+{
+    const ParticleEmitter &emitter = state.emitter;
+    glm::vec3 gravity = mGravity * deltaTime;
+    float damping = std::max(1.0f - emitter.drag * deltaTime, 0.0f);
+
+#ifdef PARTICLE_SYSTEM_SSE
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 gx = _mm_set1_ps(gravity.x), gy = _mm_set1_ps(gravity.y), gz = _mm_set1_ps(gravity.z);
+    __m128 damp = _mm_set1_ps(damping);
+    __m128 lifetime = _mm_set1_ps(emitter.lifetime);
+    __m128 dead = _mm_set1_ps(-1.0f);
+    for (size_t i = begin; i < end; i += 4)
+    {
+        // Dead particles are left as they are, the ones that outlive their lifetime die
+        __m128 age = _mm_loadu_ps(&mAge[i]);
+        __m128 alive = _mm_cmpge_ps(age, _mm_setzero_ps());
+        __m128 newAge = _mm_add_ps(age, dt);
+        __m128 survives = _mm_andnot_ps(_mm_cmpge_ps(newAge, lifetime), alive);
+        _mm_storeu_ps(&mAge[i], _mm_or_ps(_mm_and_ps(survives, newAge), _mm_andnot_ps(survives, dead)));
+
+        float *velocities[3] = {&mVelocityX[i], &mVelocityY[i], &mVelocityZ[i]};
+        float *positions[3] = {&mPositionX[i], &mPositionY[i], &mPositionZ[i]};
+        __m128 accelerations[3] = {gx, gy, gz};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            __m128 velocity = _mm_loadu_ps(velocities[axis]);
+            __m128 position = _mm_loadu_ps(positions[axis]);
+            __m128 newVelocity = _mm_mul_ps(_mm_add_ps(velocity, accelerations[axis]), damp);
+            __m128 newPosition = _mm_add_ps(position, _mm_mul_ps(newVelocity, dt));
+            _mm_storeu_ps(velocities[axis], _mm_or_ps(_mm_and_ps(alive, newVelocity), _mm_andnot_ps(alive, velocity)));
+            _mm_storeu_ps(positions[axis], _mm_or_ps(_mm_and_ps(alive, newPosition), _mm_andnot_ps(alive, position)));
+        }
+    }
+#else
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (mAge[i] < 0.0f)
+        {
+            continue;
+        }
+        float age = mAge[i] + deltaTime;
+        mAge[i] = age < emitter.lifetime ? age : -1.0f;
+        mVelocityX[i] = (mVelocityX[i] + gravity.x) * damping;
+        mVelocityY[i] = (mVelocityY[i] + gravity.y) * damping;
+        mVelocityZ[i] = (mVelocityZ[i] + gravity.z) * damping;
+        mPositionX[i] += mVelocityX[i] * deltaTime;
+        mPositionY[i] += mVelocityY[i] * deltaTime;
+        mPositionZ[i] += mVelocityZ[i] * deltaTime;
+    }
+#endif
+}
+
+void ParticleSystem::SpawnParticle(const EmitterState &state, uint32_t slot, uint32_t order, float deltaTime)
+{
+    // Same random numbers in the same order as the compute shader
+    const ParticleEmitter &emitter = state.emitter;
+    uint32_t seed = Hash(slot ^ Hash(mFrame));
+    float ox = Random(seed) * 2.0f - 1.0f;
+    float oy = Random(seed) * 2.0f - 1.0f;
+    float oz = Random(seed) * 2.0f - 1.0f;
+    float vx = Random(seed) * 2.0f - 1.0f;
+    float vy = Random(seed) * 2.0f - 1.0f;
+    float vz = Random(seed) * 2.0f - 1.0f;
+    glm::vec3 velocity = emitter.velocity + glm::vec3(vx, vy, vz) * emitter.spread;
+
+    // The particles of a frame spawned over its whole time, so they don't leave in bursts
+    float age = deltaTime * (1.0f - (static_cast<float>(order) + 0.5f) / static_cast<float>(state.spawnCount));
+    glm::vec3 position = emitter.position + glm::vec3(ox, oy, oz) * emitter.radius + velocity * age;
+
+    mPositionX[slot] = position.x, mPositionY[slot] = position.y, mPositionZ[slot] = position.z;
+    mVelocityX[slot] = velocity.x, mVelocityY[slot] = velocity.y, mVelocityZ[slot] = velocity.z;
+    mAge[slot] = age;
+}
+
+void ParticleSystem::ReadBack()
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mParticleBufferIDs[mCurrent]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mParticleCount * sizeof(GpuParticle), mPacked.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    for (size_t i = 0; i < mParticleCount; ++i)
+    {
+        const GpuParticle &particle = mPacked[i];
+        mPositionX[i] = particle.positionAge.x, mPositionY[i] = particle.positionAge.y, mPositionZ[i] = particle.positionAge.z;
+        mVelocityX[i] = particle.velocityEmitter.x, mVelocityY[i] = particle.velocityEmitter.y, mVelocityZ[i] = particle.velocityEmitter.z;
+        mAge[i] = particle.positionAge.w;
+    }
+}
+
+void ParticleSystem::Draw(const glm::mat4 &view, const glm::mat4 &viewProj)
+{
+    if (mParticleCount == 0)
+    {
+        return;
+    }
+
+    // The sort and draw shaders are owned by the AssetManager
+    AssetManager *am = AssetManager::Get();
+    Shader *sortShader = am->LoadShader("particleSort"_id);
+    if (!sortShader)
+    {
+        sortShader = new Shader("shaders/particleSortCS.glsl");
+        am->SaveShader("particleSort"_id, sortShader);
+    }
+    Shader *particleShader = am->LoadShader("particle"_id);
+    if (!particleShader)
+    {
+        particleShader = new Shader("shaders/particleVS.glsl", "shaders/particleFS.glsl");
+        am->SaveShader("particle"_id, particleShader);
+    }
+
+    int currentShader = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentShader);
+
+    // Only as many entries as the emitters have slots are sorted, padded to a power of 2
+    size_t sortCount = sSortBlockSize;
+    while (sortCount < mParticleCount)
+    {
+        sortCount *= 2;
+    }
+    GLuint blockGroups = static_cast<GLuint>(sortCount / sSortBlockSize);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mParticleBufferIDs[mCurrent]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mSortBufferID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mEmitterBufferID);
+
+    // Squared distances of the live particles as keys, the dead ones and the padding sort last
+    sortShader->SetActive();
+    sortShader->SetUInt("particleCount"_id, static_cast<unsigned int>(mParticleCount));
+    sortShader->SetVec3("cameraPosition"_id, glm::vec3(glm::inverse(view)[3]));
+    sortShader->SetInt("mode"_id, sSortKeys);
+    glDispatchCompute(static_cast<GLuint>(sortCount / sSortGroupSize), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Every block is sorted in shared memory, then the blocks are merged. Merge steps with
+    // strides below a block are all done by one dispatch in shared memory
+    sortShader->SetInt("mode"_id, sSortBlocks);
+    glDispatchCompute(blockGroups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    for (size_t blockSize = sSortBlockSize * 2; blockSize <= sortCount; blockSize *= 2)
+    {
+        sortShader->SetUInt("blockSize"_id, static_cast<unsigned int>(blockSize));
+        sortShader->SetInt("mode"_id, sSortMergeStep);
+        for (size_t stride = blockSize / 2; stride >= sSortBlockSize; stride /= 2)
+        {
+            sortShader->SetUInt("stride"_id, static_cast<unsigned int>(stride));
+            glDispatchCompute(blockGroups, 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        sortShader->SetInt("mode"_id, sSortMergeBlocks);
+        glDispatchCompute(blockGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // The quads face the camera along its right and up axes
+    particleShader->SetActive();
+    particleShader->SetMat4("viewProj"_id, viewProj);
+    particleShader->SetVec3("cameraRight"_id, glm::vec3(view[0][0], view[1][0], view[2][0]));
+    particleShader->SetVec3("cameraUp"_id, glm::vec3(view[0][1], view[1][1], view[2][1]));
+
+    // Blended back to front over the scene, hidden by it but not hiding each other
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(mVertexArrayID);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(mParticleCount));
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+
+    glUseProgram(currentShader);
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// How an emitter spawns its particles and how they change over their life
+struct ParticleEmitter
+{
+    // Center of the box the particles spawn in, and half its size
+    glm::vec3 position = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Velocity at birth, and how far each axis of it is randomly moved
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float spread = 0.0f;
+
+    // Color at birth and at death, blended over the particle's life
+    glm::vec4 startColor = glm::vec4(1.0f);
+    glm::vec4 endColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+
+    // Size of the quads at birth and at death in world units
+    float startSize = 0.1f;
+    float endSize = 0.1f;
+
+    // Seconds a particle lives, share of its velocity lost per second, particles spawned per second
+    float lifetime = 1.0f;
+    float drag = 0.0f;
+    float rate = 100.0f;
+};
+
+// ParticleSystem simulates and draws the particles of a set of emitters. Every emitter owns a
+// ring of particle slots big enough for the particles it keeps alive, rate times lifetime, and
+// spawns into the ring after the ones it spawned last frame, so the slot of a new particle is
+// always the oldest one of its emitter. The particles are simulated by a compute shader that
+// reads them from one storage buffer and writes them to the other, the buffers swap every
+// frame. Without compute the same simulation runs on the CPU on the JobSystem's workers, four
+// particles at a time with SSE over a structure of arrays, and is uploaded to the buffer the
+// compute shader would have written. Both use the same hash for their random numbers, so they
+// spawn the same particles. Particles are drawn back to front as instanced quads facing the
+// camera, in the order of a bitonic sort of their distances run on the GPU every frame.
+class ParticleSystem
+{
+public:
+    //   ParticleSystem constructor, creates the GPU buffers. Must be called on the main thread:
+    // - size_t for the maximum number of particles of all emitters together
+    ParticleSystem(size_t maxParticles);
+    ~ParticleSystem();
+
+    //   AddEmitter adds an emitter and returns its index, or returns the number of emitters
+    //   if its particles don't fit:
+    // - const ParticleEmitter& for the emitter
+    size_t AddEmitter(const ParticleEmitter &emitter);
+
+    //   SetEmitter changes an emitter, its rate times lifetime is limited to the slots it got:
+    // - size_t for the emitter's index
+    // - const ParticleEmitter& for the emitter
+    void SetEmitter(size_t index, const ParticleEmitter &emitter) { mEmitters[index].emitter = emitter; }
+    const ParticleEmitter &GetEmitter(size_t index) const { return mEmitters[index].emitter; }
+
+    // Setter for the acceleration of every particle
+    void SetGravity(const glm::vec3 &gravity) { mGravity = gravity; }
+
+    // Switches between simulating with the compute shader and on the CPU, switching to the
+    // CPU reads the particles back once
+    void SetUseCompute(bool useCompute);
+    bool GetUseCompute() const { return mUseCompute; }
+
+    // Getter for the particle slots of all emitters
+    size_t GetParticleCount() const { return mParticleCount; }
+
+    // Getter for the milliseconds the last CPU simulation took, 0 with compute
+    float GetCpuTime() const { return mCpuTime; }
+
+    //   Update spawns and moves the particles. Called once per frame on the main thread:
+    // - float for the seconds since the last frame
+    void Update(float deltaTime);
+
+    //   Draw sorts the particles by their distance to the camera and blends them over the
+    //   bound framebuffer, testing but not writing depth:
+    // - const glm::mat4& for the view matrix
+    // - const glm::mat4& for the view projection matrix
+    void Draw(const glm::mat4 &view, const glm::mat4 &viewProj);
+
+private:
+    // An emitter with its ring of slots
+    struct EmitterState
+    {
+        ParticleEmitter emitter;
+        uint32_t first;
+        uint32_t count;
+
+        // Slot the next particle spawns in, relative to first
+        uint32_t cursor;
+
+        // Particles spawned this frame from cursor on, and the part of one left from the last frames
+        uint32_t spawnCount;
+        float spawnRemainder;
+    };
+
+    // Particle layout of the storage buffers
+    struct GpuParticle
+    {
+        // xyz position, w age in seconds, negative when dead
+        glm::vec4 positionAge;
+
+        // xyz velocity, w index of the emitter
+        glm::vec4 velocityEmitter;
+    };
+
+    // Emitter layout of the storage buffer the shaders read
+    struct GpuEmitter
+    {
+        glm::vec4 position;
+        glm::vec4 velocity;
+        glm::vec4 startColor;
+        glm::vec4 endColor;
+
+        // x lifetime, y start size, z end size, w drag
+        glm::vec4 params;
+
+        // x first slot, y slot count, z cursor, w particles spawned this frame
+        uint32_t range[4];
+    };
+
+    // Simulates with the compute shader
+    void SimulateCompute(float deltaTime);
+
+    // Simulates on the CPU and uploads the particles
+    void SimulateCpu(float deltaTime);
+
+    //   SimulateBatch moves the particles of a batch of an emitter's slots on the CPU:
+    // - const EmitterState& for the emitter
+    // - size_t for the first and one past the last slot
+    // - float for the seconds since the last frame
+    void SimulateBatch(const EmitterState &state, size_t begin, size_t end, float deltaTime);
+
+    //   SpawnParticle gives a slot a new particle of its emitter on the CPU:
+    // - const EmitterState& for the emitter
+    // - uint32_t for the slot
+    // - uint32_t for the order the particle spawned in this frame
+    // - float for the seconds since the last frame
+    void SpawnParticle(const EmitterState &state, uint32_t slot, uint32_t order, float deltaTime);
+
+    // Reads the particles of the current buffer into the arrays of the CPU simulation
+    void ReadBack();
+
+    size_t mMaxParticles;
+    size_t mParticleCount;
+    std::vector<EmitterState> mEmitters;
+    glm::vec3 mGravity;
+
+    bool mUseCompute;
+    float mCpuTime;
+
+    // Counts the frames for the seeds of the random numbers
+    uint32_t mFrame;
+
+    // Particles as structure of arrays for the CPU simulation, each emitter's slots start at a multiple of 4
+    std::vector<float> mPositionX, mPositionY, mPositionZ;
+    std::vector<float> mVelocityX, mVelocityY, mVelocityZ;
+    std::vector<float> mAge;
+
+    // Particles of the CPU simulation in the layout of the storage buffers
+    std::vector<GpuParticle> mPacked;
+
+    // The two particle buffers, mCurrent holds the latest particles
+    unsigned int mParticleBufferIDs[2];
+    int mCurrent;
+
+    unsigned int mEmitterBufferID;
+
+    // Distance and particle index pairs sorted by the GPU, a power of 2 long
+    unsigned int mSortBufferID;
+    size_t mSortCount;
+
+    // Vertex array of the quads, which have no vertex buffer
+    unsigned int mVertexArrayID;
+};
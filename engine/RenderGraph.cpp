@@ -0,0 +1,376 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <iostream>
+#include <glad/glad.h>
+
+// Frames a pooled texture is kept without being used before it is deleted,
+// long enough to ride out a pass that skips a few frames
+static const int sMaxUnusedFrames = 8;
+
+RenderGraph::RenderGraph()
+    : mCulledPassCount(0), mTransientBytes(0), mAllocatedBytes(0)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    std::cout << "Delete render graph" << std::endl;
+
+    for (auto &entry : mFramebuffers)
+    {
+        glDeleteFramebuffers(1, &entry.second);
+    }
+    for (auto &texture : mPool)
+    {
+        glDeleteTextures(1, &texture.textureID);
+    }
+}
+
+bool RenderGraph::IsDepthFormat(unsigned int format)
+{
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 ||
+           format == GL_DEPTH32F_STENCIL8;
+}
+
+size_t RenderGraph::GetTexelBytes(unsigned int format)
+{
+    switch (format)
+    {
+    case GL_R8:
+        return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        // RGBA8, RG16, R32F, R11F_G11F_B10F, depth 24 and 32 bit and the like
+        return 4;
+    }
+}
+
+int RenderGraph::CreateTexture(const std::string &name, int width, int height, unsigned int format)
+{
+    mResources.push_back({name, width, height, format, 0, 0, false, false, -1, -1});
+    return static_cast<int>(mResources.size() - 1);
+}
+
+int RenderGraph::ImportTexture(const std::string &name, unsigned int textureID, int width, int height, unsigned int format)
+{
+    mResources.push_back({name, width, height, format, textureID, 0, true, false, -1, -1});
+    return static_cast<int>(mResources.size() - 1);
+}
+
+int RenderGraph::ImportBuffer(const std::string &name, unsigned int bufferID)
+{
+    mResources.push_back({name, 0, 0, 0, 0, bufferID, true, false, -1, -1});
+    return static_cast<int>(mResources.size() - 1);
+}
+
+int RenderGraph::ImportBackbuffer(int width, int height)
+{
+    mResources.push_back({"backbuffer", width, height, 0, 0, 0, true, true, -1, -1});
+    return static_cast<int>(mResources.size() - 1);
+}
+
+size_t RenderGraph::AddPass(const std::string &name, const std::function<void()> &execute)
+{
+    mPasses.push_back({name, execute, {}, {}, false, false});
+    return mPasses.size() - 1;
+}
+
+void RenderGraph::Read(size_t pass, int resource)
+{
+    mPasses[pass].reads.emplace_back(resource);
+}
+
+void RenderGraph::Write(size_t pass, int resource)
+{
+    mPasses[pass].writes.emplace_back(resource);
+}
+
+unsigned int RenderGraph::GetFramebuffer(const std::vector<int> &resources)
+{
+    std::vector<unsigned int> key;
+    for (int r : resources)
+    {
+        if (mResources[r].backbuffer)
+        {
+            return 0;
+        }
+        key.emplace_back(mResources[r].textureID);
+    }
+
+    auto found = mFramebuffers.find(key);
+    if (found != mFramebuffers.end())
+    {
+        return found->second;
+    }
+
+    int previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    unsigned int framebufferID = 0;
+    glGenFramebuffers(1, &framebufferID);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+    std::vector<GLenum> drawBuffers;
+    for (int r : resources)
+    {
+        const Resource &resource = mResources[r];
+        if (IsDepthFormat(resource.format))
+        {
+            bool stencil = resource.format == GL_DEPTH24_STENCIL8 || resource.format == GL_DEPTH32F_STENCIL8;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, resource.textureID, 0);
+        }
+        else
+        {
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.textureID, 0);
+            drawBuffers.emplace_back(attachment);
+        }
+    }
+    if (drawBuffers.empty())
+    {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else
+    {
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Render graph framebuffer of " << mResources[resources[0]].name << " is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+    mFramebuffers[key] = framebufferID;
+    return framebufferID;
+}
+
+void RenderGraph::DeleteFramebuffers(unsigned int textureID)
+{
+    for (auto it = mFramebuffers.begin(); it != mFramebuffers.end();)
+    {
+        if (std::find(it->first.begin(), it->first.end(), textureID) != it->first.end())
+        {
+            glDeleteFramebuffers(1, &it->second);
+            it = mFramebuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void RenderGraph::Compile()
+{
+    // Walk back from the outputs, a pass lives if a later live pass reads what it writes.
+    // A write ends the need for what was written before it, unless the pass also reads it
+    mCulledPassCount = 0;
+    std::vector<bool> needed(mResources.size(), false);
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        Pass &pass = mPasses[i];
+        pass.live = pass.sideEffect;
+        for (int w : pass.writes)
+        {
+            pass.live = pass.live || needed[w] || mResources[w].imported;
+        }
+        if (!pass.live)
+        {
+            ++mCulledPassCount;
+            continue;
+        }
+        for (int w : pass.writes)
+        {
+            if (!mResources[w].imported)
+            {
+                needed[w] = false;
+            }
+        }
+        for (int r : pass.reads)
+        {
+            needed[r] = true;
+        }
+    }
+
+    // Lifetime of every resource over the live passes
+    for (size_t i = 0; i < mPasses.size(); ++i)
+    {
+        if (!mPasses[i].live)
+        {
+            continue;
+        }
+        for (const auto *list : {&mPasses[i].reads, &mPasses[i].writes})
+        {
+            for (int r : *list)
+            {
+                Resource &resource = mResources[r];
+                if (resource.firstPass < 0)
+                {
+                    resource.firstPass = static_cast<int>(i);
+                }
+                resource.lastPass = static_cast<int>(i);
+            }
+        }
+    }
+}
+
+void RenderGraph::Acquire(Resource &resource)
+{
+    for (auto &texture : mPool)
+    {
+        if (!texture.inUse && texture.width == resource.width && texture.height == resource.height && texture.format == resource.format)
+        {
+            texture.inUse = true;
+            texture.unusedFrames = 0;
+            resource.textureID = texture.textureID;
+            return;
+        }
+    }
+
+    // Immutable storage, the format and size of a pooled texture never change
+    PooledTexture texture = {0, resource.width, resource.height, resource.format, true, 0};
+    glGenTextures(1, &texture.textureID);
+    glBindTexture(GL_TEXTURE_2D, texture.textureID);
+    glTexStorage2D(GL_TEXTURE_2D, 1, resource.format, resource.width, resource.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mPool.emplace_back(texture);
+    resource.textureID = texture.textureID;
+}
+
+void RenderGraph::Release(const Resource &resource)
+{
+    for (auto &texture : mPool)
+    {
+        if (texture.textureID == resource.textureID)
+        {
+            texture.inUse = false;
+            return;
+        }
+    }
+}
+
+void RenderGraph::Execute()
+{
+    Compile();
+
+    for (auto &texture : mPool)
+    {
+        ++texture.unusedFrames;
+    }
+
+    mTransientBytes = 0;
+    for (const auto &resource : mResources)
+    {
+        if (!resource.imported && resource.firstPass >= 0)
+        {
+            mTransientBytes += static_cast<size_t>(resource.width) * resource.height * GetTexelBytes(resource.format);
+        }
+    }
+
+    for (size_t i = 0; i < mPasses.size(); ++i)
+    {
+        Pass &pass = mPasses[i];
+        if (!pass.live)
+        {
+            continue;
+        }
+
+        // Transient textures get their memory when the first pass that uses them runs
+        for (const auto *list : {&pass.reads, &pass.writes})
+        {
+            for (int r : *list)
+            {
+                Resource &resource = mResources[r];
+                if (!resource.imported && resource.textureID == 0)
+                {
+                    Acquire(resource);
+                }
+            }
+        }
+
+        // Bind the textures the pass writes, color targets first and the depth target last
+        std::vector<int> targets;
+        int depthTarget = -1;
+        for (int w : pass.writes)
+        {
+            const Resource &resource = mResources[w];
+            if (resource.bufferID != 0)
+            {
+                continue;
+            }
+            if (IsDepthFormat(resource.format))
+            {
+                depthTarget = w;
+            }
+            else
+            {
+                targets.emplace_back(w);
+            }
+        }
+        if (depthTarget >= 0)
+        {
+            targets.emplace_back(depthTarget);
+        }
+        if (!targets.empty())
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(targets));
+            glViewport(0, 0, mResources[targets[0]].width, mResources[targets[0]].height);
+        }
+
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, pass.name.c_str());
+        pass.execute();
+        glPopDebugGroup();
+
+        // The memory of textures no later pass uses goes to the next texture that fits
+        for (const auto *list : {&pass.reads, &pass.writes})
+        {
+            for (int r : *list)
+            {
+                const Resource &resource = mResources[r];
+                if (!resource.imported && resource.lastPass == static_cast<int>(i) && resource.textureID != 0)
+                {
+                    Release(resource);
+                    // Read and written by the same pass, only give it back once
+                    mResources[r].lastPass = -1;
+                }
+            }
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Delete the pooled textures no frame has used for a while, with their framebuffers
+    mAllocatedBytes = 0;
+    for (size_t i = 0; i < mPool.size();)
+    {
+        PooledTexture &texture = mPool[i];
+        if (texture.unusedFrames == 0)
+        {
+            mAllocatedBytes += static_cast<size_t>(texture.width) * texture.height * GetTexelBytes(texture.format);
+        }
+        if (texture.unusedFrames <= sMaxUnusedFrames)
+        {
+            ++i;
+            continue;
+        }
+        DeleteFramebuffers(texture.textureID);
+        glDeleteTextures(1, &texture.textureID);
+        mPool.erase(mPool.begin() + i);
+    }
+
+    mPasses.clear();
+    mResources.clear();
+}
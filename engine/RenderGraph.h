@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// RenderGraph describes a frame as passes that read and write textures and buffers, and
+// decides what actually runs and where its targets live. It is rebuilt every frame: passes
+// are added in an order their reads and writes agree with, then Execute compiles the graph
+// and runs it. Compiling culls every pass whose writes nobody reads, walking back from the
+// passes with side effects and the writes to imported resources such as the backbuffer.
+// Transient textures are only allocated for the passes that survive, from a pool of textures
+// kept across frames, so steady frames create no textures or framebuffers. A pooled texture
+// is handed to the next transient texture of the same size and format as soon as the last
+// pass reading it has run, so targets whose lifetimes don't overlap share their memory.
+// Before a pass runs, the framebuffer of the textures it writes is bound and sized, color
+// targets in the order they were written and the depth target last.
+class RenderGraph
+{
+public:
+    RenderGraph();
+    ~RenderGraph();
+
+    //   CreateTexture declares a transient texture and returns its resource:
+    // - const std::string& for the name, used in debug groups
+    // - int for the width and height in texels
+    // - unsigned int for the sized internal format
+    int CreateTexture(const std::string &name, int width, int height, unsigned int format);
+
+    //   ImportTexture declares a texture the graph does not own and returns its resource.
+    //   Writes to imported resources are outputs of the frame:
+    // - const std::string& for the name
+    // - unsigned int for the texture
+    // - int for the width and height in texels
+    // - unsigned int for its internal format
+    int ImportTexture(const std::string &name, unsigned int textureID, int width, int height, unsigned int format);
+
+    //   ImportBuffer declares a buffer the graph does not own and returns its resource:
+    // - const std::string& for the name
+    // - unsigned int for the buffer
+    int ImportBuffer(const std::string &name, unsigned int bufferID);
+
+    //   ImportBackbuffer declares the default framebuffer and returns its resource:
+    // - int for the width and height of the framebuffer in pixels
+    int ImportBackbuffer(int width, int height);
+
+    //   AddPass adds a pass and returns its index:
+    // - const std::string& for the name, used in debug groups
+    // - const std::function<void()>& for the pass's draws and dispatches
+    size_t AddPass(const std::string &name, const std::function<void()> &execute);
+
+    //   Read and Write declare that a pass reads or writes a resource:
+    // - size_t for the pass
+    // - int for the resource
+    void Read(size_t pass, int resource);
+    void Write(size_t pass, int resource);
+
+    //   SetSideEffect keeps a pass even if nothing reads its writes, for passes that write
+    //   outside the graph such as readbacks and feedback:
+    // - size_t for the pass
+    void SetSideEffect(size_t pass) { mPasses[pass].sideEffect = true; }
+
+    // Compiles and runs the passes, then clears them and the resources for the next frame
+    void Execute();
+
+    //   GetTexture returns the texture of a resource, valid while the graph executes:
+    // - int for the resource
+    unsigned int GetTexture(int resource) const { return mResources[resource].textureID; }
+
+    //   GetBuffer returns the buffer of an imported buffer resource:
+    // - int for the resource
+    unsigned int GetBuffer(int resource) const { return mResources[resource].bufferID; }
+
+    //   GetFramebuffer returns a framebuffer with the textures attached, created on first use.
+    //   Returns 0, the default framebuffer, for the backbuffer:
+    // - const std::vector<int>& for the color resources in order, then at most one depth resource
+    unsigned int GetFramebuffer(const std::vector<int> &resources);
+
+    //   DeleteFramebuffers deletes the cached framebuffers a texture is attached to, called
+    //   before an imported texture is deleted:
+    // - unsigned int for the texture
+    void DeleteFramebuffers(unsigned int textureID);
+
+    // Getters for the passes culled by the last Execute, the bytes its transient textures
+    // would take without aliasing and the bytes of the pooled textures they used
+    size_t GetCulledPassCount() const { return mCulledPassCount; }
+    size_t GetTransientBytes() const { return mTransientBytes; }
+    size_t GetAllocatedBytes() const { return mAllocatedBytes; }
+
+private:
+    struct Pass
+    {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<int> reads;
+        std::vector<int> writes;
+        bool sideEffect;
+        bool live;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        int width;
+        int height;
+        unsigned int format;
+        unsigned int textureID;
+        unsigned int bufferID;
+        bool imported;
+        bool backbuffer;
+
+        // First and last live pass that uses the resource, -1 if none does
+        int firstPass;
+        int lastPass;
+    };
+
+    // A texture owned by the pool
+    struct PooledTexture
+    {
+        unsigned int textureID;
+        int width;
+        int height;
+        unsigned int format;
+        bool inUse;
+
+        // Frames since a transient texture used it
+        int unusedFrames;
+    };
+
+    // Marks the live passes and the lifetime of every resource
+    void Compile();
+
+    //   Acquire gives a transient resource a pooled texture, creating one if none is free:
+    // - Resource& for the resource
+    void Acquire(Resource &resource);
+
+    //   Release gives the pooled texture of a transient resource back to the pool:
+    // - const Resource& for the resource
+    void Release(const Resource &resource);
+
+    //   IsDepthFormat returns true for depth and depth stencil formats:
+    // - unsigned int for the internal format
+    static bool IsDepthFormat(unsigned int format);
+
+    //   GetTexelBytes returns the bytes of a texel of a format:
+    // - unsigned int for the internal format
+    static size_t GetTexelBytes(unsigned int format);
+
+    std::vector<Pass> mPasses;
+    std::vector<Resource> mResources;
+    std::vector<PooledTexture> mPool;
+
+    // Framebuffers of the attachment sets passes wrote, keyed by their textures
+    std::map<std::vector<unsigned int>, unsigned int> mFramebuffers;
+
+    size_t mCulledPassCount;
+    size_t mTransientBytes;
+    size_t mAllocatedBytes;
+};
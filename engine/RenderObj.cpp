@@ -1,18 +1,24 @@
 #include "RenderObj.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "AssetManager.h"
 #include "VertexBuffer.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
 #include <iostream>
 
+glm::mat4 RenderObj::sDepthViewProj = glm::mat4(1.0f);
+
 RenderObj::RenderObj()
-    : mVertexBuffer(nullptr), mShader(nullptr), mModel(glm::mat4(1.0f)), mPosition(glm::vec3(0.0f, 0.0f, 0.0f)), mScale(glm::vec3(1.0f, 1.0f, 1.0f)), mTimer(0.0f)
+    : mVertexBuffer(nullptr), mShader(nullptr), mModel(glm::mat4(1.0f)), mPreviousModel(glm::mat4(1.0f)), mPosition(glm::vec3(0.0f, 0.0f, 0.0f)), mScale(glm::vec3(1.0f, 1.0f, 1.0f)),
+      mBoundsMin(glm::vec3(1.0f)), mBoundsMax(glm::vec3(-1.0f)), mUvDensity(1.0f), mIsOccluder(false), mIsStatic(false), mIsTransparent(false), mTimer(0.0f)
 {
 }
 
 RenderObj::RenderObj(VertexBuffer *vBuffer, Shader *shader, const std::vector<Texture *> &textures)
-    : mVertexBuffer(vBuffer), mShader(shader), mTextures(textures), mModel(glm::mat4(1.0f)), mPosition(glm::vec3(0.0f, 0.0f, 0.0f)), mScale(glm::vec3(1.0f, 1.0f, 1.0f)), mTimer(0.0f)
+    : mVertexBuffer(vBuffer), mShader(shader), mTextures(textures), mModel(glm::mat4(1.0f)), mPreviousModel(glm::mat4(1.0f)), mPosition(glm::vec3(0.0f, 0.0f, 0.0f)), mScale(glm::vec3(1.0f, 1.0f, 1.0f)),
+      mBoundsMin(glm::vec3(1.0f)), mBoundsMax(glm::vec3(-1.0f)), mUvDensity(1.0f), mIsOccluder(false), mIsStatic(false), mIsTransparent(false), mTimer(0.0f)
 {
 }
 
@@ -51,18 +57,80 @@ void RenderObj::Draw()
         mTextures[i]->SetActive();
     }
 
-    //   Query the location of uniform containing the model matrix in shader:
-    // - Supply with shader program
-    // - the name of the uniform
-    int modelLoc = glGetUniformLocation(mShader->GetID(), "model");
-
-    //   Send model matrix to GPU using glUniform with Matrix4fv as postfix:
-    // - Take the uniform's location
-    // - The number of matrices to send
-    // - Transpose matrix (column-major or row-major). GLM uses column by default (GL_FALSE)
-    // - The actual matrix data converted with glm::value_ptr
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(mModel));
+    //   Send model matrix to GPU. The uniform's location is looked up
+    //   by its compile time hashed name instead of glGetUniformLocation
+    mShader->SetMat4("model"_id, mModel);
+    mShader->SetMat4("previousModel"_id, mPreviousModel);
 
     // Draw the vertex buffer
     mVertexBuffer->Draw();
 }
+
+glm::vec4 RenderObj::GetBoundingSphere() const
+{
+    if (!HasBounds())
+    {
+        return glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+    }
+    float scale = glm::max(glm::length(glm::vec3(mModel[0])), glm::max(glm::length(glm::vec3(mModel[1])), glm::length(glm::vec3(mModel[2]))));
+    glm::vec3 center = glm::vec3(mModel * glm::vec4((mBoundsMin + mBoundsMax) * 0.5f, 1.0f));
+    return glm::vec4(center, glm::length(mBoundsMax - mBoundsMin) * 0.5f * scale);
+}
+
+void RenderObj::SetDepthViewProj(const glm::mat4 &viewProj)
+{
+    sDepthViewProj = viewProj;
+
+    // The depth shaders are shared by every object and owned by the AssetManager
+    AssetManager *am = AssetManager::Get();
+    Shader *instancedShader = am->LoadShader("instancedDepth"_id);
+    if (!instancedShader)
+    {
+        instancedShader = new Shader("shaders/instancedDepthVS.glsl", "shaders/depthFS.glsl");
+        am->SaveShader("instancedDepth"_id, instancedShader);
+    }
+    instancedShader->SetActive();
+    instancedShader->SetMat4("viewProj"_id, viewProj);
+
+    Shader *depthShader = am->LoadShader("depth"_id);
+    if (!depthShader)
+    {
+        depthShader = new Shader("shaders/depthVS.glsl", "shaders/depthFS.glsl");
+        am->SaveShader("depth"_id, depthShader);
+    }
+    depthShader->SetActive();
+    depthShader->SetMat4("viewProj"_id, viewProj);
+}
+
+void RenderObj::DrawDepth()
+{
+    Shader *depthShader = AssetManager::Get()->LoadShader("depth"_id);
+    depthShader->SetActive();
+    depthShader->SetMat4("model"_id, mModel);
+    mVertexBuffer->Draw();
+}
+
+void RenderObj::RequestTextures(TextureStreamer *streamer)
+{
+    if (!HasBounds())
+    {
+        return;
+    }
+
+    // The largest axis scale of the model matrix grows the bounds the most, and the
+    // smallest one squeezes the texture coordinates the most and needs the finest level
+    glm::vec3 scales = glm::vec3(glm::length(glm::vec3(mModel[0])), glm::length(glm::vec3(mModel[1])), glm::length(glm::vec3(mModel[2])));
+    float maxScale = glm::max(scales.x, glm::max(scales.y, scales.z));
+    float minScale = glm::min(scales.x, glm::min(scales.y, scales.z));
+    if (minScale <= 0.0f)
+    {
+        return;
+    }
+    glm::vec3 center = glm::vec3(mModel * glm::vec4((mBoundsMin + mBoundsMax) * 0.5f, 1.0f));
+    float radius = glm::length(mBoundsMax - mBoundsMin) * 0.5f * maxScale;
+
+    for (auto t : mTextures)
+    {
+        streamer->Request(t, center, radius, mUvDensity / minScale);
+    }
+}
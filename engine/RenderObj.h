@@ -5,6 +5,8 @@
 class VertexBuffer;
 class Shader;
 class Texture;
+class OcclusionCuller;
+class TextureStreamer;
 
 // The RenderObj class describes any drawable object for the engine.
 // It controls how each object is updated and drawn on each frame.
@@ -39,11 +41,61 @@ public:
     glm::vec3 &GetPosition() { return mPosition; }
     glm::vec3 &GetScale() { return mScale; }
 
+    // Getter for the model matrix of the last frame, and SavePreviousModelMatrix keeps the current
+    // one as it, called before the object updates. Lit shaders draw motion vectors from both
+    const glm::mat4 &GetPreviousModelMatrix() const { return mPreviousModel; }
+    void SavePreviousModelMatrix() { mPreviousModel = mModel; }
+
     // Setters for the RenderObj's model matrix, position, and scale
     void SetModelMatrix(const glm::mat4 &model) { mModel = model; }
     void SetPosition(const glm::vec3 &pos) { mPosition = pos; }
     void SetScale(const glm::vec3 &scale) { mScale = scale; }
 
+    // Getters for the model space bounding box, which is empty (min > max) if it is unknown
+    const glm::vec3 &GetBoundsMin() const { return mBoundsMin; }
+    const glm::vec3 &GetBoundsMax() const { return mBoundsMax; }
+    bool HasBounds() const { return mBoundsMin.x <= mBoundsMax.x; }
+
+    // Returns the world space sphere around the bounds, the center in xyz and the radius in w,
+    // which is negative for objects without bounds
+    glm::vec4 GetBoundingSphere() const;
+
+    // Occluders are rasterized by the OcclusionCuller and hide the objects behind them
+    void SetOccluder(bool isOccluder) { mIsOccluder = isOccluder; }
+    bool IsOccluder() const { return mIsOccluder; }
+
+    //   AddOccluder queues the object's occluder geometry with the OcclusionCuller.
+    //   Objects without occluder geometry add nothing:
+    // - OcclusionCuller* for the culler
+    virtual void AddOccluder(OcclusionCuller *) {}
+
+    //   RequestTextures asks the TextureStreamer for the mipmap levels of the object's textures
+    //   that its bounds need on screen. Objects without bounds request nothing:
+    // - TextureStreamer* for the streamer
+    virtual void RequestTextures(TextureStreamer *streamer);
+
+    // Draws the object into the feedback passes it owns before the frame, such as the page
+    // requests of a virtual texture. Most objects have none
+    virtual void DrawFeedback() {}
+
+    // Static objects never move, so shadows can cache their depth
+    void SetStatic(bool isStatic) { mIsStatic = isStatic; }
+    bool IsStatic() const { return mIsStatic; }
+
+    // Transparent objects are drawn by the TransparencyRenderer after the opaque ones, in
+    // any order, and cast no shadows
+    void SetTransparent(bool isTransparent) { mIsTransparent = isTransparent; }
+    bool IsTransparent() const { return mIsTransparent; }
+
+    //   SetDepthViewProj activates the depth only shaders, creating them on first use, and sets
+    //   the view projection matrix DrawDepth renders with. Called before drawing a shadow:
+    // - const glm::mat4& for the view projection matrix
+    static void SetDepthViewProj(const glm::mat4 &viewProj);
+    static const glm::mat4 &GetDepthViewProj() { return sDepthViewProj; }
+
+    // Draws only the object's depth with the shader set up by SetDepthViewProj
+    virtual void DrawDepth();
+
 protected:
     // Object's vertex buffer
     VertexBuffer *mVertexBuffer;
@@ -54,13 +106,33 @@ protected:
     // Vector of textures
     std::vector<Texture *> mTextures;
 
-    // The object's model matrix
+    // The object's model matrix, and the one of the last frame
     glm::mat4 mModel;
+    glm::mat4 mPreviousModel;
 
     // Vector3 for position/scale
     glm::vec3 mPosition;
     glm::vec3 mScale;
 
+    // Model space bounding box
+    glm::vec3 mBoundsMin;
+    glm::vec3 mBoundsMax;
+
+    // Texture coordinate units per model unit of the mesh's surface
+    float mUvDensity;
+
+    // Bool for if the object is rasterized as an occluder
+    bool mIsOccluder;
+
+    // Bool for if the object never moves
+    bool mIsStatic;
+
+    // Bool for if the object is blended over the opaque ones
+    bool mIsTransparent;
+
     //// TEMP TIMER
     float mTimer;
+
+    // View projection matrix of the depth pass being drawn
+    static glm::mat4 sDepthViewProj;
 };
@@ -2,30 +2,32 @@
 #include <iostream>
 #include <fstream>
 
-Shader::Shader(const std::string &vertexFile, const std::string &fragmentFile)
+// Files can include each other this many levels deep, which also stops include cycles
+static const int sMaxIncludeDepth = 8;
+
+// Adds lines of code right after the #version directive, which must come first
+static void InsertDefines(std::string &code, const std::string &defines)
+{
+    size_t version = code.find("#version");
+    size_t lineEnd = version == std::string::npos ? version : code.find('\n', version);
+    if (lineEnd != std::string::npos)
+    {
+        code.insert(lineEnd + 1, defines);
+    }
+}
+
+Shader::Shader(const std::string &vertexFile, const std::string &fragmentFile, const std::string &defines)
+    : mShaderID(0)
 {
     // Strings to hold the vertex/fragment codes
     std::string vertexCode;
     std::string fragmentCode;
 
-    // Open the files and read them into the strings
-    std::ifstream vsFile(vertexFile);
-    std::ifstream fsFile(fragmentFile);
-
-    if (vsFile.is_open() && fsFile.is_open())
+    // Read the files into the strings, with the files they include pasted in
+    if (ReadSource(vertexFile, vertexCode) && ReadSource(fragmentFile, fragmentCode))
     {
-        std::string line;
-
-        while (std::getline(vsFile, line))
-        {
-            vertexCode += line + "\n";
-        }
-        while (std::getline(fsFile, line))
-        {
-            fragmentCode += line + "\n";
-        }
-        vsFile.close();
-        fsFile.close();
+        InsertDefines(vertexCode, defines);
+        InsertDefines(fragmentCode, defines);
 
         // Compile the shaders
         CompileShaders(vertexCode.c_str(), fragmentCode.c_str());
@@ -36,6 +38,51 @@ Shader::Shader(const std::string &vertexFile, const std::string &fragmentFile)
     }
 }
 
+Shader::Shader(const std::string &computeFile)
+    : mShaderID(0)
+{
+    std::string computeCode;
+
+    if (ReadSource(computeFile, computeCode))
+    {
+        CompileComputeShader(computeCode.c_str());
+    }
+    else
+    {
+        std::cout << "Can't open shader file " << computeFile << std::endl;
+    }
+}
+
+bool Shader::ReadSource(const std::string &file, std::string &code, int depth)
+{
+    std::ifstream source(file);
+    if (!source.is_open())
+    {
+        return false;
+    }
+
+    // Included files are found next to the file including them
+    std::string directory = file.substr(0, file.find_last_of("/\\") + 1);
+
+    std::string line;
+    while (std::getline(source, line))
+    {
+        size_t directive = line.find_first_not_of(" \t");
+        if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0)
+        {
+            size_t begin = line.find('"', directive);
+            size_t end = begin == std::string::npos ? begin : line.find('"', begin + 1);
+            if (end == std::string::npos || depth >= sMaxIncludeDepth || !ReadSource(directory + line.substr(begin + 1, end - begin - 1), code, depth + 1))
+            {
+                std::cout << "Can't include " << line << " in " << file << std::endl;
+            }
+            continue;
+        }
+        code += line + "\n";
+    }
+    return true;
+}
+
 Shader::~Shader()
 {
     std::cout << "Delete shader" << std::endl;
@@ -110,4 +157,75 @@ void Shader::CompileShaders(const char *vertexCode, const char *fragmentCode)
     glDeleteShader(fragmentShader);
 
     std::cout << "Delete vertex and fragment shaders" << std::endl;
+
+    CacheUniformLocations();
+}
+
+void Shader::CompileComputeShader(const char *computeCode)
+{
+    unsigned int computeShader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeShader, 1, &computeCode, NULL);
+    glCompileShader(computeShader);
+
+    int success = 0;
+    char infoLog[512];
+    glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(computeShader, 512, NULL, infoLog);
+        std::cout << "Compute shader compilation failed\n"
+                  << infoLog << std::endl;
+    }
+
+    mShaderID = glCreateProgram();
+    glAttachShader(mShaderID, computeShader);
+    glLinkProgram(mShaderID);
+
+    glGetProgramiv(mShaderID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(mShaderID, 512, NULL, infoLog);
+        std::cout << "Compute program creation failed\n"
+                  << infoLog << std::endl;
+    }
+
+    glDeleteShader(computeShader);
+
+    CacheUniformLocations();
+}
+
+void Shader::CacheUniformLocations()
+{
+    mUniformLocations.Clear();
+
+    // Get the number of active uniforms and the length of the longest name
+    int uniformCount = 0;
+    int maxLength = 0;
+    glGetProgramiv(mShaderID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(mShaderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::string name(maxLength, '\0');
+    for (int i = 0; i < uniformCount; ++i)
+    {
+        int length = 0;
+        int size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(mShaderID, i, maxLength, &length, &size, &type, name.data());
+
+        std::string uniformName = name.substr(0, length);
+        int location = glGetUniformLocation(mShaderID, uniformName.c_str());
+        // Uniforms inside of uniform blocks have no location
+        if (location < 0)
+        {
+            continue;
+        }
+        mUniformLocations.Insert(StringId(uniformName), location);
+
+        // Arrays are reported as "name[0]", also store them by their plain name
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos)
+        {
+            mUniformLocations.Insert(StringId(uniformName.substr(0, bracket)), location);
+        }
+    }
 }
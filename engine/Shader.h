@@ -1,24 +1,40 @@
 #pragma once
 #include <string>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "FlatMap.h"
+#include "StringId.h"
 
 // Shader class contains a OpenGL shader program that consists of
-// a vertex shader and a fragment shader. This shader class manages
-// when a particular shader program is being set as active, as well as
-// functions to help set any uniforms set by its shaders.
+// a vertex shader and a fragment shader, or of a single compute shader.
+// This shader class manages when a particular shader program is being set as active, as well as
+// functions to help set any uniforms set by its shaders. The locations of
+// all active uniforms are queried once after linking and stored by StringId,
+// so setting a uniform never calls glGetUniformLocation.
+// Shader files can share code with #include "file", resolved next to the including file
+// before compiling, since GLSL has no includes of its own.
 class Shader
 {
 public:
     //   Shader constructor:
     // - const std::string& for the vertex shader name/file path
     // - const std::string& for the fragment shader name/file path
-    Shader(const std::string &vertexFile, const std::string &fragmentFile);
+    // - const std::string& for lines added after the #version of both shaders, such as "#define DEFERRED\n"
+    Shader(const std::string &vertexFile, const std::string &fragmentFile, const std::string &defines = "");
+
+    //   Compute shader constructor:
+    // - const std::string& for the compute shader name/file path
+    Shader(const std::string &computeFile);
     ~Shader();
 
     //   CompileShaders compiles both the vertex and fragment shaders and links them into a program.
     // - Takes in 2 const char* of the vertex and fragment codes as parameters
     void CompileShaders(const char *vertexCode, const char *fragmentCode);
 
+    //   CompileComputeShader compiles a compute shader and links it into a program.
+    // - Takes in a const char* of the compute code as a parameter
+    void CompileComputeShader(const char *computeCode);
+
     // Sets this shader program as the active one with glUseProgram
     // Every shader/rendering call will use this program object and its shaders
     void SetActive() { glUseProgram(mShaderID); }
@@ -26,23 +42,76 @@ public:
     // Getter for the shader program's id
     int GetID() const { return mShaderID; }
 
-    // Setters for bool, int, and float uniforms
-    void SetBool(const std::string &name, bool value) const
+    //   GetUniformLocation returns the location of an active uniform, or -1 if the
+    //   program has no active uniform by that name:
+    // - StringId for the uniform's name
+    int GetUniformLocation(StringId name) const
+    {
+        const int *location = mUniformLocations.Find(name);
+        return location ? *location : -1;
+    }
+
+    // Setters for bool, int, float, and mat4 uniforms
+    void SetBool(StringId name, bool value) const
+    {
+        glUniform1i(GetUniformLocation(name), static_cast<int>(value));
+    }
+
+    void SetInt(StringId name, int value) const
+    {
+        glUniform1i(GetUniformLocation(name), value);
+    }
+
+    void SetFloat(StringId name, float value) const
+    {
+        glUniform1f(GetUniformLocation(name), value);
+    }
+
+    void SetMat4(StringId name, const glm::mat4 &value) const
+    {
+        glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &value[0][0]);
+    }
+
+    // Setters for unsigned int and vector uniforms
+    void SetUInt(StringId name, unsigned int value) const
+    {
+        glUniform1ui(GetUniformLocation(name), value);
+    }
+
+    void SetVec2(StringId name, const glm::vec2 &value) const
     {
-        glUniform1i(glGetUniformLocation(mShaderID, name.c_str()), static_cast<int>(value));
+        glUniform2fv(GetUniformLocation(name), 1, &value[0]);
     }
 
-    void SetInt(const std::string &name, int value) const
+    void SetVec3(StringId name, const glm::vec3 &value) const
     {
-        glUniform1i(glGetUniformLocation(mShaderID, name.c_str()), value);
+        glUniform3fv(GetUniformLocation(name), 1, &value[0]);
     }
 
-    void SetFloat(const std::string &name, float value) const
+    void SetVec4(StringId name, const glm::vec4 &value) const
     {
-        glUniform1f(glGetUniformLocation(mShaderID, name.c_str()), value);
+        glUniform4fv(GetUniformLocation(name), 1, &value[0]);
+    }
+
+    void SetVec4Array(StringId name, const glm::vec4 *values, int count) const
+    {
+        glUniform4fv(GetUniformLocation(name), count, &values[0][0]);
     }
 
 private:
+    //   ReadSource appends the code of a shader file to a string, replacing every line with
+    //   #include "file" by the code of that file. Returns false if the file can't be opened:
+    // - const std::string& for the file path
+    // - std::string& that receives the code
+    // - int for how many files deep the include is
+    static bool ReadSource(const std::string &file, std::string &code, int depth = 0);
+
+    // Queries every active uniform of the linked program and caches its location
+    void CacheUniformLocations();
+
     // The shader's ID
     unsigned int mShaderID;
+
+    // Locations of the program's active uniforms by name
+    FlatMap<int> mUniformLocations;
 };
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "ClusteredLighting.h"
+#include "RenderObj.h"
+
+// Texture unit of the atlas and binding of the tiles in shaders/lighting.glsl
+static const int sAtlasUnit = 6;
+static const unsigned int sTileBinding = 7;
+
+// Tile layout of the ShadowTiles storage buffer (std430)
+struct GpuShadowTile
+{
+    glm::mat4 worldToAtlas;
+    glm::vec4 bounds;
+};
+
+// Looking direction and up vector of each cube face
+static const glm::vec3 sFaceDirections[6] = {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+                                             glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+static const glm::vec3 sFaceUps[6] = {glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                      glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)};
+
+// Creates a depth texture of the atlas' size
+static unsigned int CreateDepthTexture(int size, bool compare)
+{
+    unsigned int textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, size, size);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (compare)
+    {
+        // Linear filtering of a comparison averages the 4 nearest results
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return textureID;
+}
+
+ShadowAtlas::ShadowAtlas(int size, int minTileSize, int maxTileSize)
+    : mAllocator(size, minTileSize), mMinTileSize(minTileSize), mMaxTileSize(maxTileSize), mStaticTextureID(0), mTextureID(0), mFramebufferID(0),
+      mTileBufferID(0), mTileBufferCapacity(0), mStaticDirty(true), mShadowCount(0), mStaticTileRenders(0), mDynamicTileRenders(0)
+{
+    mStaticTextureID = CreateDepthTexture(size, false);
+    mTextureID = CreateDepthTexture(size, true);
+
+    // Depth only framebuffer, the atlas it renders to is attached for each pass
+    glGenFramebuffers(1, &mFramebufferID);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Room for the tiles of 64 lights, doubled when more lights cast shadows
+    mTileBufferCapacity = 64 * 6 * sizeof(GpuShadowTile);
+    glGenBuffers(1, &mTileBufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, mTileBufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+    std::cout << "Delete shadow atlas" << std::endl;
+
+    glDeleteTextures(1, &mStaticTextureID);
+    glDeleteTextures(1, &mTextureID);
+    glDeleteFramebuffers(1, &mFramebufferID);
+    glDeleteBuffers(1, &mTileBufferID);
+}
+
+glm::mat4 ShadowAtlas::GetFaceViewProj(const glm::vec3 &position, float radius, int face)
+{
+    glm::mat4 view = glm::lookAt(position, position + sFaceDirections[face], sFaceUps[face]);
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, std::max(radius * 0.01f, 0.02f), radius);
+    return projection * view;
+}
+
+bool ShadowAtlas::Reallocate(LightShadow &shadow, int size)
+{
+    for (auto &tile : shadow.tiles)
+    {
+        mAllocator.Free(tile);
+    }
+    shadow.staticValid = false;
+
+    for (; size >= mMinTileSize; size /= 2)
+    {
+        int face = 0;
+        for (; face < 6; ++face)
+        {
+            shadow.tiles[face] = mAllocator.Allocate(size);
+            if (shadow.tiles[face].level < 0)
+            {
+                break;
+            }
+        }
+        if (face == 6)
+        {
+            return true;
+        }
+        for (auto &tile : shadow.tiles)
+        {
+            mAllocator.Free(tile);
+        }
+    }
+    return false;
+}
+
+void ShadowAtlas::RenderDepth(const LightShadow &shadow, const glm::vec3 &position, float radius, const std::vector<RenderObj *> &objects)
+{
+    for (int face = 0; face < 6; ++face)
+    {
+        const AtlasTile &tile = shadow.tiles[face];
+        glViewport(tile.x, tile.y, tile.size, tile.size);
+        glScissor(tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        RenderObj::SetDepthViewProj(GetFaceViewProj(position, radius, face));
+        for (auto o : objects)
+        {
+            o->DrawDepth();
+        }
+    }
+}
+
+void ShadowAtlas::Update(ClusteredLighting *lighting, const std::vector<RenderObj *> &objects, const glm::mat4 &view, const glm::mat4 &projection, int height)
+{
+    mShadowCount = 0;
+    mStaticTileRenders = 0;
+    mDynamicTileRenders = 0;
+
+    // Lights that were removed give their tiles back
+    size_t lightCount = lighting->GetLightCount();
+    for (size_t i = lightCount; i < mShadows.size(); ++i)
+    {
+        for (auto &tile : mShadows[i].tiles)
+        {
+            mAllocator.Free(tile);
+        }
+    }
+    mShadows.resize(lightCount);
+
+    // Size of each light's tiles from how large its sphere is on screen
+    std::vector<std::pair<int, size_t>> requests;
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        const PointLight &light = lighting->GetLight(i);
+        lighting->SetShadowSlot(i, -1);
+        if (!light.castsShadows)
+        {
+            for (auto &tile : mShadows[i].tiles)
+            {
+                mAllocator.Free(tile);
+            }
+            continue;
+        }
+
+        // A face covers about half of the sphere's diameter on screen
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        float distance = glm::length(center);
+        int size = mMaxTileSize;
+        if (center.z > light.radius)
+        {
+            size = mMinTileSize;
+        }
+        else if (distance > light.radius)
+        {
+            float pixels = light.radius / distance * projection[1][1] * static_cast<float>(height) * 0.5f;
+            size = mMinTileSize;
+            while (size < mMaxTileSize && static_cast<float>(size) < pixels)
+            {
+                size *= 2;
+            }
+        }
+        requests.emplace_back(size, i);
+    }
+
+    // Larger tiles are placed first, so the small ones fill the gaps they leave
+    std::stable_sort(requests.begin(), requests.end(), [](const std::pair<int, size_t> &a, const std::pair<int, size_t> &b)
+                     { return a.first > b.first; });
+    for (auto &request : requests)
+    {
+        // Grow right away, but only shrink when the tiles are 4 times too large so lights don't flip between sizes
+        LightShadow &shadow = mShadows[request.second];
+        int current = shadow.tiles[0].level >= 0 ? shadow.tiles[0].size : 0;
+        if (current == 0 || request.first > current || request.first * 4 <= current)
+        {
+            Reallocate(shadow, request.first);
+        }
+    }
+
+    // World bounding sphere of every object, a negative radius for objects without bounds
+    std::vector<glm::vec4> spheres(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        spheres[i] = objects[i]->GetBoundingSphere();
+    }
+
+    // Remember the framebuffer, viewport and fill mode the frame is drawn with
+    int previousFramebuffer = 0;
+    int previousViewport[4];
+    int polygonMode[2];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_SCISSOR_TEST);
+    // Push the depth away from the light along the slope of each triangle against shadow acne
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    std::vector<GpuShadowTile> gpuTiles;
+    std::vector<RenderObj *> staticObjects;
+    std::vector<RenderObj *> dynamicObjects;
+    float atlasSize = static_cast<float>(mAllocator.GetSize());
+    for (auto &request : requests)
+    {
+        size_t index = request.second;
+        LightShadow &shadow = mShadows[index];
+        if (shadow.tiles[0].level < 0)
+        {
+            continue;
+        }
+        const PointLight &light = lighting->GetLight(index);
+
+        // The objects inside the light's sphere, objects without bounds are always inside
+        staticObjects.clear();
+        dynamicObjects.clear();
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            glm::vec3 toObject = glm::vec3(spheres[i]) - light.position;
+            float reach = spheres[i].w + light.radius;
+            if (spheres[i].w >= 0.0f && glm::dot(toObject, toObject) > reach * reach)
+            {
+                continue;
+            }
+            (objects[i]->IsStatic() ? staticObjects : dynamicObjects).emplace_back(objects[i]);
+        }
+
+        // Render the static depth again if the light moved or the static objects changed
+        bool refresh = false;
+        if (!shadow.staticValid || mStaticDirty || shadow.position != light.position || shadow.radius != light.radius)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mStaticTextureID, 0);
+            RenderDepth(shadow, light.position, light.radius, staticObjects);
+            shadow.position = light.position;
+            shadow.radius = light.radius;
+            shadow.staticValid = true;
+            mStaticTileRenders += 6;
+            refresh = true;
+        }
+
+        // Start from the cached static depth and draw the dynamic objects on top. A light without
+        // dynamic objects now or last frame already has its static depth in the atlas
+        if (refresh || shadow.hasDynamic || !dynamicObjects.empty())
+        {
+            for (const auto &tile : shadow.tiles)
+            {
+                glCopyImageSubData(mStaticTextureID, GL_TEXTURE_2D, 0, tile.x, tile.y, 0, mTextureID, GL_TEXTURE_2D, 0, tile.x, tile.y, 0, tile.size, tile.size, 1);
+            }
+            if (!dynamicObjects.empty())
+            {
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mTextureID, 0);
+                RenderDepth(shadow, light.position, light.radius, dynamicObjects);
+                mDynamicTileRenders += 6;
+            }
+        }
+        shadow.hasDynamic = !dynamicObjects.empty();
+
+        // Each face maps world positions to its tile, the bounds keep filtering inside the tile
+        for (int face = 0; face < 6; ++face)
+        {
+            const AtlasTile &tile = shadow.tiles[face];
+            glm::mat4 toTile = glm::translate(glm::mat4(1.0f), glm::vec3(tile.x / atlasSize, tile.y / atlasSize, 0.0f)) *
+                               glm::scale(glm::mat4(1.0f), glm::vec3(tile.size / atlasSize, tile.size / atlasSize, 1.0f)) *
+                               glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+            glm::vec4 bounds = glm::vec4(tile.x + 0.5f, tile.y + 0.5f, tile.x + tile.size - 0.5f, tile.y + tile.size - 0.5f) / atlasSize;
+            gpuTiles.push_back({toTile * GetFaceViewProj(light.position, light.radius, face), bounds});
+        }
+        lighting->SetShadowSlot(index, static_cast<int>(mShadowCount++));
+    }
+    mStaticDirty = false;
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileBufferID);
+    if (gpuTiles.size() * sizeof(GpuShadowTile) > mTileBufferCapacity)
+    {
+        while (mTileBufferCapacity < gpuTiles.size() * sizeof(GpuShadowTile))
+        {
+            mTileBufferCapacity *= 2;
+        }
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mTileBufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!gpuTiles.empty())
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuTiles.size() * sizeof(GpuShadowTile), gpuTiles.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ShadowAtlas::Bind()
+{
+    glActiveTexture(GL_TEXTURE0 + sAtlasUnit);
+    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    glActiveTexture(GL_TEXTURE0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sTileBinding, mTileBufferID);
+}
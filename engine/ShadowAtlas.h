@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "AtlasAllocator.h"
+
+class ClusteredLighting;
+class RenderObj;
+
+// ShadowAtlas renders the shadows of the point lights that cast them into one large depth
+// texture. Each light gets six tiles, one per cube face, packed by an AtlasAllocator, and the
+// tiles are as large as the light's sphere appears on screen, so distant lights cost little.
+// The depth of the static objects is cached per light in a second atlas and only rendered
+// again when the light moves, its tiles change or the static objects change. Each frame the
+// cached depth is copied into the tiles of the lights that dynamic objects touch and the
+// dynamic objects are drawn on top, so most lights cost nothing once their cache is built.
+// Shaders that include shaders/lighting.glsl read the tiles from binding 7 and the atlas
+// from texture unit 6.
+class ShadowAtlas
+{
+public:
+    //   ShadowAtlas constructor, creates the atlas textures. Must be called on the main thread:
+    // - int for the size of the atlas in texels, a power of two
+    // - int for the smallest and largest size of a light's tiles
+    ShadowAtlas(int size = 4096, int minTileSize = 64, int maxTileSize = 1024);
+    ~ShadowAtlas();
+
+    //   Update sizes the tiles of every light that casts shadows, renders the depth that
+    //   changed and gives ClusteredLighting the shadow of each light. Called once per frame
+    //   after the objects and lights moved and before ClusteredLighting::Update:
+    // - ClusteredLighting* for the lights
+    // - const std::vector<RenderObj*>& for the objects that cast shadows
+    // - const glm::mat4& for the camera's view and projection matrices
+    // - int for the height of the framebuffer in pixels
+    void Update(ClusteredLighting *lighting, const std::vector<RenderObj *> &objects, const glm::mat4 &view, const glm::mat4 &projection, int height);
+
+    // Binds the atlas and the tiles read by shaders/lighting.glsl
+    void Bind();
+
+    // Renders the static depth of every light again, called when static objects were added, removed or moved
+    void InvalidateStatic() { mStaticDirty = true; }
+
+    // Getters for the number of lights with shadows, the number of tiles of static and of
+    // dynamic depth rendered by the last Update, and the texels of the atlas in use
+    size_t GetShadowCount() const { return mShadowCount; }
+    size_t GetStaticTileRenders() const { return mStaticTileRenders; }
+    size_t GetDynamicTileRenders() const { return mDynamicTileRenders; }
+    int64_t GetUsedArea() const { return mAllocator.GetUsedArea(); }
+
+private:
+    // Tiles and cache state of a light
+    struct LightShadow
+    {
+        AtlasTile tiles[6];
+
+        // Position and radius the static depth was rendered for
+        glm::vec3 position = glm::vec3(0.0f);
+        float radius = 0.0f;
+
+        // True if the static tiles hold the depth of the light's current position
+        bool staticValid = false;
+
+        // True if dynamic objects were drawn into the light's tiles by the last Update
+        bool hasDynamic = false;
+    };
+
+    //   Reallocate frees the tiles of a light and allocates six of the given size, halving the
+    //   size until they fit. Returns false if not even the smallest tiles fit:
+    // - LightShadow& for the light
+    // - int for the size of the tiles
+    bool Reallocate(LightShadow &shadow, int size);
+
+    //   RenderDepth draws objects into the tiles of a light:
+    // - const LightShadow& for the light with its tiles
+    // - const glm::vec3& for the light's position
+    // - float for the light's radius
+    // - const std::vector<RenderObj*>& for the objects
+    void RenderDepth(const LightShadow &shadow, const glm::vec3 &position, float radius, const std::vector<RenderObj *> &objects);
+
+    //   GetFaceViewProj returns the view projection matrix of a cube face of a light:
+    // - const glm::vec3& for the light's position
+    // - float for the light's radius
+    // - int for the face, +X, -X, +Y, -Y, +Z, -Z
+    static glm::mat4 GetFaceViewProj(const glm::vec3 &position, float radius, int face);
+
+    AtlasAllocator mAllocator;
+    int mMinTileSize;
+    int mMaxTileSize;
+
+    // Depth of the static objects, and the depth the lighting reads
+    unsigned int mStaticTextureID;
+    unsigned int mTextureID;
+    unsigned int mFramebufferID;
+
+    // World to atlas matrix and bounds of every tile of every shadow, read by the lighting
+    unsigned int mTileBufferID;
+    size_t mTileBufferCapacity;
+
+    // Shadow of every light, indexed like the lights
+    std::vector<LightShadow> mShadows;
+
+    bool mStaticDirty;
+
+    size_t mShadowCount;
+    size_t mStaticTileRenders;
+    size_t mDynamicTileRenders;
+};
@@ -0,0 +1,92 @@
+#include "Skeleton.h"
+#include "AnimationClip.h"
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SKELETON_SSE
+#endif
+
+//   Multiply computes a * b. Each column of the result is the sum of a's columns scaled by
+//   the column of b, 4 multiplies and adds per column with SSE:
+// - const glm::mat4& for a
+// - const glm::mat4& for b
+// - glm::mat4& for the result, which can't be a or b
+static inline void Multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &result)
+{
+#ifdef SKELETON_SSE
+    __m128 a0 = _mm_loadu_ps(&a[0][0]), a1 = _mm_loadu_ps(&a[1][0]), a2 = _mm_loadu_ps(&a[2][0]), a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; ++column)
+    {
+        __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&result[column][0], sum);
+    }
+#else
+    result = a * b;
+#endif
+}
+
+Skeleton::Skeleton()
+{
+}
+
+Skeleton::~Skeleton()
+{
+    std::cout << "Delete skeleton" << std::endl;
+}
+
+size_t Skeleton::AddBone(int parent, const glm::vec3 &translation, const glm::quat &rotation)
+{
+    size_t bone = mParents.size();
+    if (parent >= static_cast<int>(bone))
+    {
+        std::cout << "Bone " << bone << " is added before its parent " << parent << std::endl;
+        parent = -1;
+    }
+    mParents.emplace_back(parent);
+    mBindTranslations.emplace_back(translation);
+    mBindRotations.emplace_back(rotation);
+
+    glm::mat4 local = glm::mat4_cast(rotation);
+    local[3] = glm::vec4(translation, 1.0f);
+    mBindMatrices.emplace_back(parent < 0 ? local : mBindMatrices[parent] * local);
+    mInverseBindMatrices.emplace_back(glm::inverse(mBindMatrices.back()));
+    return bone;
+}
+
+void Skeleton::GetBindPose(Pose &pose) const
+{
+    pose.Resize(mParents.size());
+    for (size_t bone = 0; bone < mParents.size(); ++bone)
+    {
+        pose.rotationX[bone] = mBindRotations[bone].x;
+        pose.rotationY[bone] = mBindRotations[bone].y;
+        pose.rotationZ[bone] = mBindRotations[bone].z;
+        pose.rotationW[bone] = mBindRotations[bone].w;
+        pose.translationX[bone] = mBindTranslations[bone].x;
+        pose.translationY[bone] = mBindTranslations[bone].y;
+        pose.translationZ[bone] = mBindTranslations[bone].z;
+    }
+}
+
+void Skeleton::ComputeSkinningMatrices(const Pose &pose, const glm::mat4 &model, glm::mat4 *matrices) const
+{
+    // First each bone's transform in the world, the parent's is already in the matrices
+    for (size_t bone = 0; bone < mParents.size(); ++bone)
+    {
+        glm::quat rotation = glm::quat(pose.rotationW[bone], pose.rotationX[bone], pose.rotationY[bone], pose.rotationZ[bone]);
+        glm::mat4 local = glm::mat4_cast(rotation);
+        local[3] = glm::vec4(pose.translationX[bone], pose.translationY[bone], pose.translationZ[bone], 1.0f);
+        Multiply(mParents[bone] < 0 ? model : matrices[mParents[bone]], local, matrices[bone]);
+    }
+
+    // Then from the bind pose to there, once no child needs the bone's transform anymore
+    for (size_t bone = 0; bone < mParents.size(); ++bone)
+    {
+        glm::mat4 world = matrices[bone];
+        Multiply(world, mInverseBindMatrices[bone], matrices[bone]);
+    }
+}
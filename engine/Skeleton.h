@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct Pose;
+
+// Skeleton is the hierarchy of the bones of a skinned mesh. Every bone's parent comes before
+// it, so walking the bones in order always finds the parent's transform already computed.
+// The inverse bind matrices move a vertex from the mesh into the space of its bone in the
+// pose the mesh was modeled in, the bind pose. Skinning matrices move it from there to where
+// the bone is in an animated pose, and are computed with SSE matrix products where available.
+class Skeleton
+{
+public:
+    Skeleton();
+    ~Skeleton();
+
+    //   AddBone adds a bone and returns its index:
+    // - int for the index of the parent, which must already be added, -1 for a root
+    // - const glm::vec3& for the bone's translation relative to its parent in the bind pose
+    // - const glm::quat& for the bone's rotation relative to its parent in the bind pose
+    size_t AddBone(int parent, const glm::vec3 &translation, const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+
+    // Getters for the number of bones and a bone's parent
+    size_t GetBoneCount() const { return mParents.size(); }
+    int GetParent(size_t bone) const { return mParents[bone]; }
+
+    // Getters for a bone's transform relative to the mesh in the bind pose, and its inverse
+    const glm::mat4 &GetBindMatrix(size_t bone) const { return mBindMatrices[bone]; }
+    const glm::mat4 &GetInverseBindMatrix(size_t bone) const { return mInverseBindMatrices[bone]; }
+
+    //   GetBindPose writes the transforms of the bind pose into a pose:
+    // - Pose& for the pose
+    void GetBindPose(Pose &pose) const;
+
+    //   ComputeSkinningMatrices computes the matrices that move the vertices from the bind pose
+    //   to a pose and then into the world. Safe to call from several threads at once:
+    // - const Pose& for the pose
+    // - const glm::mat4& for the model matrix of the mesh
+    // - glm::mat4* for one matrix per bone
+    void ComputeSkinningMatrices(const Pose &pose, const glm::mat4 &model, glm::mat4 *matrices) const;
+
+private:
+    std::vector<int> mParents;
+    std::vector<glm::vec3> mBindTranslations;
+    std::vector<glm::quat> mBindRotations;
+    std::vector<glm::mat4> mBindMatrices;
+    std::vector<glm::mat4> mInverseBindMatrices;
+};
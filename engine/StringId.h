@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// StringId is a 64-bit FNV-1a hash of a name that can be computed at
+// compile time. Assets and shader uniforms are keyed by StringId so that
+// a lookup only costs an integer compare instead of hashing a std::string.
+// String literals can be hashed at compile time with the _id suffix:
+//     Shader *shader = AssetManager::Get()->LoadShader("textured"_id);
+// Runtime names (std::string, std::string_view) are hashed once on construction.
+class StringId
+{
+public:
+    // FNV-1a 64-bit constants
+    static constexpr uint64_t sOffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t sPrime = 1099511628211ull;
+
+    constexpr StringId() : mHash(0) {}
+
+    //   StringId constructors:
+    // - const char*, std::string_view or const std::string& for the name to hash
+    constexpr StringId(const char *name) : StringId(std::string_view(name)) {}
+    constexpr StringId(std::string_view name) : mHash(Hash(name)), mName(name) {}
+    StringId(const std::string &name) : StringId(std::string_view(name)) {}
+
+    //   Hash computes the FNV-1a hash of a string:
+    // - std::string_view for the string to hash
+    static constexpr uint64_t Hash(std::string_view name)
+    {
+        uint64_t hash = sOffsetBasis;
+        for (char c : name)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= sPrime;
+        }
+        return hash;
+    }
+
+    // Getter for the hashed value
+    constexpr uint64_t GetHash() const { return mHash; }
+
+    // Getter for the name that was hashed, debug builds use it to detect hash collisions.
+    // The view is only valid as long as the source string.
+    constexpr std::string_view GetName() const { return mName; }
+
+    constexpr bool operator==(const StringId &other) const { return mHash == other.mHash; }
+    constexpr bool operator!=(const StringId &other) const { return mHash != other.mHash; }
+
+private:
+    // The hashed value of the name
+    uint64_t mHash;
+
+    // The name that was hashed. Kept in every build so StringId has the same layout
+    // whether or not a translation unit defines NDEBUG
+    std::string_view mName;
+};
+
+// User defined literal to hash a string at compile time: "textured"_id
+constexpr StringId operator""_id(const char *name, size_t length)
+{
+    return StringId(std::string_view(name, length));
+}
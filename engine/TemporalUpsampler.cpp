@@ -0,0 +1,187 @@
+#include "TemporalUpsampler.h"
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "AssetManager.h"
+#include "RenderGraph.h"
+#include "Shader.h"
+
+// Offsets of the Halton sequence cycled through, enough to cover a pixel evenly
+static const int sJitterPhases = 8;
+
+// Texture units the resolve shader reads from
+static const int sColorUnit = 0;
+static const int sDepthUnit = 1;
+static const int sMotionUnit = 2;
+static const int sHistoryUnit = 3;
+
+//   Halton returns the element of the Halton sequence of a base, evenly spread over [0, 1):
+// - int for the index, from 1
+// - int for the base
+static float Halton(int index, int base)
+{
+    float fraction = 1.0f, result = 0.0f;
+    while (index > 0)
+    {
+        fraction /= static_cast<float>(base);
+        result += fraction * static_cast<float>(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+TemporalUpsampler::TemporalUpsampler()
+    : mEnabled(false), mBlend(0.1f), mJitterIndex(0), mJitter(0.0f), mViewProj(1.0f), mPreviousViewProj(1.0f), mCurrent(0), mWidth(0), mHeight(0),
+      mHistoryValid(false), mVertexArrayID(0)
+{
+    mHistoryIDs[0] = mHistoryIDs[1] = 0;
+
+    // Core profile draws need a vertex array even without attributes
+    glGenVertexArrays(1, &mVertexArrayID);
+}
+
+TemporalUpsampler::~TemporalUpsampler()
+{
+    std::cout << "Delete temporal upsampler" << std::endl;
+
+    glDeleteTextures(2, mHistoryIDs);
+    glDeleteVertexArrays(1, &mVertexArrayID);
+}
+
+void TemporalUpsampler::SetEnabled(bool enabled)
+{
+    // The history of an earlier run belongs to another scene
+    if (enabled && !mEnabled)
+    {
+        mHistoryValid = false;
+    }
+    mEnabled = enabled;
+}
+
+glm::mat4 TemporalUpsampler::Jitter(const glm::mat4 &projection, int renderWidth, int renderHeight)
+{
+    if (!mEnabled)
+    {
+        mJitter = glm::vec2(0.0f);
+        return projection;
+    }
+
+    // The sequence starts at 1, index 0 is the pixel's corner in both bases
+    mJitterIndex = mJitterIndex % sJitterPhases + 1;
+    mJitter = glm::vec2(Halton(mJitterIndex, 2) - 0.5f, Halton(mJitterIndex, 3) - 0.5f);
+
+    // Moving the clip space position moves the image by the same amount at every depth
+    glm::vec3 offset(2.0f * mJitter.x / renderWidth, 2.0f * mJitter.y / renderHeight, 0.0f);
+    return glm::translate(glm::mat4(1.0f), offset) * projection;
+}
+
+void TemporalUpsampler::SetViewProj(const glm::mat4 &viewProj)
+{
+    mPreviousViewProj = mViewProj;
+    mViewProj = viewProj;
+}
+
+void TemporalUpsampler::Resize(RenderGraph &graph, int width, int height)
+{
+    for (unsigned int historyID : mHistoryIDs)
+    {
+        graph.DeleteFramebuffers(historyID);
+    }
+    glDeleteTextures(2, mHistoryIDs);
+    mWidth = width;
+    mHeight = height;
+
+    // Half floats keep the small steps of the blend from being rounded away
+    glGenTextures(2, mHistoryIDs);
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, mHistoryIDs[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mHistoryValid = false;
+}
+
+void TemporalUpsampler::AddResolvePasses(RenderGraph &graph, int sceneColor, int sceneDepth, int sceneMotion, int backbuffer, int width, int height)
+{
+    if (width != mWidth || height != mHeight)
+    {
+        Resize(graph, width, height);
+    }
+
+    // Last frame's result is read, this frame's goes into the other texture
+    mCurrent = 1 - mCurrent;
+    int history = graph.ImportTexture("History", mHistoryIDs[mCurrent], width, height, GL_RGBA16F);
+    int previous = graph.ImportTexture("Previous history", mHistoryIDs[1 - mCurrent], width, height, GL_RGBA16F);
+
+    size_t resolvePass = graph.AddPass("Temporal resolve", [this, &graph, sceneColor, sceneDepth, sceneMotion]()
+                                       { Resolve(graph.GetTexture(sceneColor), graph.GetTexture(sceneDepth), graph.GetTexture(sceneMotion)); });
+    graph.Read(resolvePass, sceneColor);
+    graph.Read(resolvePass, sceneDepth);
+    graph.Read(resolvePass, sceneMotion);
+    graph.Read(resolvePass, previous);
+    graph.Write(resolvePass, history);
+
+    // The graph bound the backbuffer, the history is copied as is
+    size_t presentPass = graph.AddPass("Present history", [&graph, history, width, height]()
+                                       {
+                                           glBindFramebuffer(GL_READ_FRAMEBUFFER, graph.GetFramebuffer({history}));
+                                           glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                                           glBindFramebuffer(GL_READ_FRAMEBUFFER, 0); });
+    graph.Read(presentPass, history);
+    graph.Write(presentPass, backbuffer);
+}
+
+void TemporalUpsampler::Resolve(unsigned int sceneColor, unsigned int sceneDepth, unsigned int sceneMotion)
+{
+    // The resolve shader is owned by the AssetManager like the other shaders
+    AssetManager *am = AssetManager::Get();
+    Shader *resolveShader = am->LoadShader("temporalResolve"_id);
+    if (!resolveShader)
+    {
+        resolveShader = new Shader("shaders/fullscreenVS.glsl", "shaders/temporalResolveFS.glsl");
+        resolveShader->SetActive();
+        resolveShader->SetInt("sceneColor"_id, sColorUnit);
+        resolveShader->SetInt("sceneDepth"_id, sDepthUnit);
+        resolveShader->SetInt("sceneMotion"_id, sMotionUnit);
+        resolveShader->SetInt("history"_id, sHistoryUnit);
+        am->SaveShader("temporalResolve"_id, resolveShader);
+    }
+
+    // The full screen triangle is always filled and neither tests nor writes depth
+    int polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE0 + sColorUnit);
+    glBindTexture(GL_TEXTURE_2D, sceneColor);
+    glActiveTexture(GL_TEXTURE0 + sDepthUnit);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glActiveTexture(GL_TEXTURE0 + sMotionUnit);
+    glBindTexture(GL_TEXTURE_2D, sceneMotion);
+    glActiveTexture(GL_TEXTURE0 + sHistoryUnit);
+    glBindTexture(GL_TEXTURE_2D, mHistoryIDs[1 - mCurrent]);
+
+    resolveShader->SetActive();
+    resolveShader->SetVec2("outputSize"_id, glm::vec2(static_cast<float>(mWidth), static_cast<float>(mHeight)));
+    resolveShader->SetVec2("jitter"_id, mJitter);
+    resolveShader->SetFloat("blend"_id, mBlend);
+    resolveShader->SetBool("historyValid"_id, mHistoryValid);
+    glBindVertexArray(mVertexArrayID);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    mHistoryValid = true;
+
+    for (int unit : {sHistoryUnit, sMotionUnit, sDepthUnit, sColorUnit})
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
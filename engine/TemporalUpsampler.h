@@ -0,0 +1,86 @@
+#pragma once
+#include <glm/glm.hpp>
+
+class RenderGraph;
+
+// TemporalUpsampler reconstructs the scene at the output resolution from samples spread over
+// several frames, so the scene can be rendered at a fraction of the pixels. The projection is
+// moved by a different sub-pixel offset each frame, cycling through a Halton sequence, so
+// every frame samples the pixels at new positions. The lit shaders write how far each pixel
+// moved on screen since the last frame, from the model matrices and view projections of both
+// frames without the offset. The resolve pass filters this frame's samples around each output
+// pixel by their distance to it, finds where the pixel was last frame by the motion of the
+// closest surface around it, and blends in the history there. The history is clamped to the
+// range of this frame's samples around the pixel first, so surfaces that moved away or
+// changed don't leave ghosts. The history is kept at the output resolution in two textures
+// that swap every frame, and copied to the backbuffer after it is resolved.
+class TemporalUpsampler
+{
+public:
+    // TemporalUpsampler constructor
+    TemporalUpsampler();
+    ~TemporalUpsampler();
+
+    // Setter and getter for whether the projection is jittered and resolved, turning it on drops the history
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const { return mEnabled; }
+
+    // Setter and getter for the share of a frame in the result where its sample lands on the pixel
+    void SetBlend(float blend) { mBlend = blend; }
+    float GetBlend() const { return mBlend; }
+
+    //   Jitter moves to the next sub-pixel offset and returns the projection moved by it, or
+    //   the projection as is when disabled. Called once per frame:
+    // - const glm::mat4& for the projection
+    // - int for the width and height the scene is rendered at in pixels
+    glm::mat4 Jitter(const glm::mat4 &projection, int renderWidth, int renderHeight);
+
+    //   SetViewProj sets this frame's view projection without the jitter, the last one becomes
+    //   the previous. Called once per frame:
+    // - const glm::mat4& for the view projection matrix
+    void SetViewProj(const glm::mat4 &viewProj);
+
+    // Getters for the view projections of this and the last frame without the jitter
+    const glm::mat4 &GetViewProj() const { return mViewProj; }
+    const glm::mat4 &GetPreviousViewProj() const { return mPreviousViewProj; }
+
+    //   AddResolvePasses adds the passes that resolve this frame into the history and copy it
+    //   to the backbuffer:
+    // - RenderGraph& for the frame's graph
+    // - int for the color, depth and motion resources of the scene
+    // - int for the backbuffer resource
+    // - int for the width and height of the backbuffer in pixels
+    void AddResolvePasses(RenderGraph &graph, int sceneColor, int sceneDepth, int sceneMotion, int backbuffer, int width, int height);
+
+private:
+    //   Resize recreates the history at the output resolution:
+    // - RenderGraph& for the graph that cached framebuffers of the old history
+    // - int for the width and height in pixels
+    void Resize(RenderGraph &graph, int width, int height);
+
+    //   Resolve blends this frame into the bound history:
+    // - unsigned int for the scene's color, depth and motion textures
+    void Resolve(unsigned int sceneColor, unsigned int sceneDepth, unsigned int sceneMotion);
+
+    bool mEnabled;
+    float mBlend;
+
+    // Index into the Halton sequence and this frame's offset in render pixels
+    int mJitterIndex;
+    glm::vec2 mJitter;
+
+    glm::mat4 mViewProj;
+    glm::mat4 mPreviousViewProj;
+
+    // Two RGBA16F history textures at the output resolution, mCurrent is written this frame
+    unsigned int mHistoryIDs[2];
+    int mCurrent;
+    int mWidth;
+    int mHeight;
+
+    // False until a frame was resolved into the history
+    bool mHistoryValid;
+
+    // Vertex array of the full screen triangle
+    unsigned int mVertexArrayID;
+};
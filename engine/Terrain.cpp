@@ -0,0 +1,91 @@
+#include "Terrain.h"
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <vector>
+#include "Shader.h"
+#include "VertexBuffer.h"
+#include "VirtualTexture.h"
+
+Terrain::Terrain(VirtualTexture *virtualTexture, float size, int resolution)
+    : RenderObj(), mVirtualTexture(virtualTexture), mFeedbackShader(nullptr)
+{
+    resolution = std::max(resolution, 1);
+    mBoundsMin = glm::vec3(-0.5f * size, 0.0f, -0.5f * size);
+    mBoundsMax = glm::vec3(0.5f * size, 0.0f, 0.5f * size);
+
+    // The texture coordinates span the whole grid once
+    std::vector<VertexTexture> vertices;
+    vertices.reserve(static_cast<size_t>(resolution + 1) * (resolution + 1));
+    for (int z = 0; z <= resolution; ++z)
+    {
+        for (int x = 0; x <= resolution; ++x)
+        {
+            glm::vec2 uv = glm::vec2(x, z) / static_cast<float>(resolution);
+            vertices.push_back({glm::vec3(mBoundsMin.x + uv.x * size, 0.0f, mBoundsMin.z + uv.y * size), uv});
+        }
+    }
+
+    // Two counter-clockwise triangles per quad seen from above
+    std::vector<uint32_t> indices;
+    indices.reserve(static_cast<size_t>(resolution) * resolution * 6);
+    for (int z = 0; z < resolution; ++z)
+    {
+        for (int x = 0; x < resolution; ++x)
+        {
+            uint32_t v00 = z * (resolution + 1) + x;
+            uint32_t v01 = v00 + resolution + 1;
+            indices.insert(indices.end(), {v00, v01, v00 + 1, v00 + 1, v01, v01 + 1});
+        }
+    }
+    mVertexBuffer = new VertexBuffer(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+    mUvDensity = 1.0f / size;
+}
+
+Terrain::~Terrain()
+{
+    std::cout << "Delete terrain" << std::endl;
+
+    delete mVirtualTexture;
+    delete mVertexBuffer;
+}
+
+void Terrain::Update(float)
+{
+    mModel = glm::translate(glm::mat4(1.0f), mPosition);
+    mModel = glm::scale(mModel, mScale);
+
+    // Request the pages the last feedback saw and upload the ones that loaded
+    mVirtualTexture->Update();
+}
+
+void Terrain::Draw()
+{
+    // Set a shader program to use
+    mShader->SetActive();
+
+    // Bind the page cache and indirection textures instead of the object's textures
+    mVirtualTexture->Bind(mShader);
+
+    mShader->SetMat4("model"_id, mModel);
+    mShader->SetMat4("previousModel"_id, mPreviousModel);
+
+    mVertexBuffer->Draw();
+}
+
+void Terrain::DrawFeedback()
+{
+    if (!mFeedbackShader)
+    {
+        return;
+    }
+    mFeedbackShader->SetActive();
+    if (!mVirtualTexture->BeginFeedback(mFeedbackShader))
+    {
+        return;
+    }
+    mFeedbackShader->SetMat4("model"_id, mModel);
+    mVertexBuffer->Draw();
+    mVirtualTexture->EndFeedback();
+}
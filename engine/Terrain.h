@@ -0,0 +1,30 @@
+#pragma once
+#include "RenderObj.h"
+
+class VirtualTexture;
+
+// Terrain is a flat grid covered by a single VirtualTexture, so every part of it can have
+// its own texels at full resolution while only the pages in view are in video memory.
+// It draws the page requests of its texture into the feedback pass before each frame.
+class Terrain : public RenderObj
+{
+public:
+    //   Terrain constructor, takes ownership of the virtual texture:
+    // - VirtualTexture* for the texture stretched over the whole terrain
+    // - float for the length of a side in model units
+    // - int for the number of quads along a side
+    Terrain(VirtualTexture *virtualTexture, float size, int resolution);
+    ~Terrain();
+
+    void Update(float deltaTime) override;
+    void Draw() override;
+    void DrawFeedback() override;
+
+    // Setter for the shader that writes the page requests, drawn with shaders/virtualFeedbackFS.glsl
+    void SetFeedbackShader(Shader *shader) { mFeedbackShader = shader; }
+
+private:
+    VirtualTexture *mVirtualTexture;
+
+    Shader *mFeedbackShader;
+};
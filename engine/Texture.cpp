@@ -1,12 +1,91 @@
 #include "Texture.h"
+#include <algorithm>
 #include <iostream>
 #include <glad/glad.h>
 #include "stb_image.h"
-#include "AssetManager.h"
+
+// Streamed textures start with the levels that are at most this many texels wide and high
+static const int sStreamingSize = 64;
+
+void Texture::Downsample(const unsigned char *source, int width, int height, int numChannels, std::vector<unsigned char> &level)
+{
+    int levelWidth = std::max(1, width / 2), levelHeight = std::max(1, height / 2);
+    level.resize(static_cast<size_t>(levelWidth) * levelHeight * numChannels);
+    for (int y = 0; y < levelHeight; ++y)
+    {
+        const unsigned char *row0 = source + static_cast<size_t>(std::min(2 * y, height - 1)) * width * numChannels;
+        const unsigned char *row1 = source + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width * numChannels;
+        unsigned char *out = level.data() + static_cast<size_t>(y) * levelWidth * numChannels;
+        for (int x = 0; x < levelWidth; ++x)
+        {
+            int x0 = std::min(2 * x, width - 1) * numChannels, x1 = std::min(2 * x + 1, width - 1) * numChannels;
+            for (int c = 0; c < numChannels; ++c)
+            {
+                out[x * numChannels + c] = static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
 
 Texture::Texture(const char *textureFile)
-    : mName(textureFile), mTextureID(0), mWidth(0), mHeight(0), mNumChannels(0)
+    : mName(textureFile), mTextureID(0), mWidth(0), mHeight(0), mNumChannels(0), mLevelCount(0), mInternalFormat(GL_RGB8), mFormat(GL_RGB), mResidentLevel(0)
+{
+    ImageData image = DecodeImage(mName);
+    Upload(image, true);
+    FreeImage(image);
+}
+
+Texture::Texture(const std::string &textureFile, ImageData &image)
+    : mName(textureFile), mTextureID(0), mWidth(0), mHeight(0), mNumChannels(0), mLevelCount(0), mInternalFormat(GL_RGB8), mFormat(GL_RGB), mResidentLevel(0)
 {
+    Upload(image, false);
+}
+
+ImageData Texture::DecodeImage(const std::string &textureFile)
+{
+    ImageData image;
+
+    // Tell stb_image.h to flip loaded textures on the y axis.
+    // The flag is set per thread so worker threads can decode in parallel
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    // Load in texture file with stbi_load:
+    // - Takes the location of the image file
+    // - width, height, and number of color channels as ints
+    image.pixels = stbi_load(textureFile.c_str(), &image.width, &image.height, &image.numChannels, 0);
+
+    // Halve the size until both sides are 1 pixel, each level from the one before it
+    if (image.pixels)
+    {
+        const unsigned char *source = image.pixels;
+        int width = image.width, height = image.height;
+        while (width > 1 || height > 1)
+        {
+            image.levels.emplace_back();
+            Downsample(source, width, height, image.numChannels, image.levels.back());
+            source = image.levels.back().data();
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+    }
+
+    return image;
+}
+
+void Texture::FreeImage(ImageData &image)
+{
+    // Free image data
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+    image.levels.clear();
+}
+
+void Texture::Upload(ImageData &image, bool allLevels)
+{
+    mWidth = image.width;
+    mHeight = image.height;
+    mNumChannels = image.numChannels;
+
     //   Create a texture object with glGenTextures:
     // - Takes in the number of textures to generate
     // - The unsigned int array to store the number of textures(can be a single uint)
@@ -21,58 +100,162 @@ Texture::Texture(const char *textureFile)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    // Set texture filtering parameters (set on currently bound texture)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // Set texture filtering parameters (set on currently bound texture).
+    // Minified texels are blended from the two closest mipmap levels
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Load/Generate a texture
-    // Tell stb_image.h to flip loaded textures on the y axis
-    stbi_set_flip_vertically_on_load(true);
-
-    // Load in texture file with stbi_load:
-    // - Takes the location of the image file
-    // - width, height, and number of color channels as ints
-    unsigned char *data = stbi_load(textureFile, &mWidth, &mHeight, &mNumChannels, 0);
-
-    if (data)
+    if (image.pixels)
     {
         // Get the format based on the number of color channels
-        GLenum format;
-        if (mNumChannels == 3)
+        mFormat = GL_RGB;
+        if (mNumChannels == 1)
         {
-            format = GL_RGB;
+            mFormat = GL_RED;
         }
         else if (mNumChannels == 4)
         {
-            format = GL_RGBA;
+            mFormat = GL_RGBA;
+        }
+
+        // The mipmaps halve the size until both sides are 1 pixel
+        for (int size = std::max(mWidth, mHeight); size > 0; size /= 2)
+        {
+            ++mLevelCount;
+        }
+
+        // Keep every level in system memory until it is uploaded, the image's levels were already downsampled by DecodeImage
+        mLevelPixels.reserve(mLevelCount);
+        mLevelPixels.emplace_back(image.pixels, image.pixels + static_cast<size_t>(mWidth) * mHeight * mNumChannels);
+        for (auto &level : image.levels)
+        {
+            mLevelPixels.emplace_back(std::move(level));
+        }
+        image.levels.clear();
+
+        // Nothing is resident yet, upload the coarse levels first
+        mResidentLevel = mLevelCount;
+        int level = 0;
+        while (!allLevels && level + 1 < mLevelCount && std::max(mWidth >> level, mHeight >> level) > sStreamingSize)
+        {
+            ++level;
         }
+        SetResidentLevel(level);
 
-        //   Start generating a texture using the loaded image data
-        //   Textures are generated with glTexImage2D:
-        // - 1st argument specifies the texture target. Setting to GL_TEXTURE_2D
-        //   will generate textures on the bound texture object at the same target
-        // - 2nd argument specifies mipmap level to create a texture for. 0 is base level
-        // - 3rd argument specifies the format to store the texture.
-        // - 4th/5th arguments specifies width/height of the resulting texture
-        // - 6th argument default to 6 (legacy)
-        // - 7th/8th arguments specifies the format and datatype of the source image
-        //   Loaded the image with RGB values, and stored them as chars(bytes)
-        // - Last argument is the actual image data
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mWidth, mHeight, 0, format, GL_UNSIGNED_BYTE, data);
-
-        // Automatically generate all the required mipmaps for the currently bound texture
-        glGenerateMipmap(GL_TEXTURE_2D);
+        if (allLevels)
+        {
+            LoadAllLevels();
+        }
     }
     else
     {
-        std::cout << "Failed to load texture" << std::endl;
+        std::cout << "Failed to load texture " << mName << std::endl;
     }
+}
 
-    // Free image data
-    stbi_image_free(data);
+void Texture::SetResidentLevel(int level)
+{
+    level = std::clamp(level, 0, std::max(mLevelCount - 1, 0));
+    if (mLevelPixels.empty() || level == mResidentLevel)
+    {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, mTextureID);
+
+    // Rows of the small levels are not aligned to 4 bytes
+    int alignment = 4, packAlignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    //   Upload the missing levels with glTexImage2D:
+    // - 2nd argument specifies mipmap level to create a texture for. 0 is base level
+    // - 3rd argument specifies the format to store the texture. Every image is stored as 8-bit RGB
+    // - 4th/5th arguments specifies width/height of the level
+    // - 6th argument default to 6 (legacy)
+    // - 7th/8th arguments specifies the format and datatype of the source image
+    // - Last argument is the level's pixels
+    // The uploaded level's pixels are only kept in video memory
+    for (int l = level; l < mResidentLevel; ++l)
+    {
+        glTexImage2D(GL_TEXTURE_2D, l, mInternalFormat, std::max(1, mWidth >> l), std::max(1, mHeight >> l), 0, mFormat, GL_UNSIGNED_BYTE, mLevelPixels[l].data());
+        mLevelPixels[l].clear();
+        mLevelPixels[l].shrink_to_fit();
+    }
+
+    // Read the freed levels back to upload them again later. Every image is stored as 8-bit RGB,
+    // so the pixels come back the way they were uploaded apart from an alpha channel that was dropped.
+    // Respecifying a level with no texels frees it, levels below the base level are never sampled
+    for (int l = mResidentLevel; l < level; ++l)
+    {
+        mLevelPixels[l].resize(static_cast<size_t>(std::max(1, mWidth >> l)) * std::max(1, mHeight >> l) * mNumChannels);
+        glGetTexImage(GL_TEXTURE_2D, l, mFormat, GL_UNSIGNED_BYTE, mLevelPixels[l].data());
+        glTexImage2D(GL_TEXTURE_2D, l, mInternalFormat, 0, 0, 0, mFormat, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    mResidentLevel = level;
+}
+
+void Texture::LoadAllLevels()
+{
+    SetResidentLevel(0);
+    mLevelPixels.clear();
+    mLevelPixels.shrink_to_fit();
+}
 
-    // Store this texture object into the texture cache using the texture's file name/path
-    AssetManager::Get()->SaveTexture(mName, this);
+void Texture::CopyLevel(int level, unsigned int target, unsigned int textureID, int layer) const
+{
+    if (level < 0 || level >= mLevelCount)
+    {
+        return;
+    }
+
+    int levelWidth = std::max(1, mWidth >> level), levelHeight = std::max(1, mHeight >> level);
+    if (level >= mResidentLevel)
+    {
+        glCopyImageSubData(mTextureID, GL_TEXTURE_2D, level, 0, 0, 0, textureID, target, level, 0, 0, layer, levelWidth, levelHeight, 1);
+        return;
+    }
+
+    // The level is only in system memory
+    int alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(target, textureID);
+    if (target == GL_TEXTURE_2D_ARRAY)
+    {
+        glTexSubImage3D(target, level, 0, 0, layer, levelWidth, levelHeight, 1, mFormat, GL_UNSIGNED_BYTE, mLevelPixels[level].data());
+    }
+    else
+    {
+        glTexSubImage2D(target, level, 0, 0, levelWidth, levelHeight, mFormat, GL_UNSIGNED_BYTE, mLevelPixels[level].data());
+    }
+    glBindTexture(target, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+size_t Texture::GetLevelBytes(int level) const
+{
+    if (level < 0 || level >= mLevelCount)
+    {
+        return 0;
+    }
+    return static_cast<size_t>(std::max(1, mWidth >> level)) * std::max(1, mHeight >> level) * 4;
+}
+
+size_t Texture::GetResidentBytes(int level) const
+{
+    size_t bytes = 0;
+    for (int l = std::max(level, 0); l < mLevelCount; ++l)
+    {
+        bytes += GetLevelBytes(l);
+    }
+    return bytes;
 }
 
 Texture::~Texture()
@@ -84,6 +267,8 @@ Texture::~Texture()
     mWidth = 0;
     mHeight = 0;
     mNumChannels = 0;
+    mLevelCount = 0;
+    mLevelPixels.clear();
 }
 
 void Texture::SetActive()
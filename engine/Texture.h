@@ -1,5 +1,26 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <vector>
+
+// ImageData holds the decoded pixels of an image file.
+// Decoding does not touch OpenGL, so it can happen on a worker thread
+// and the result is handed to a Texture on the main thread.
+struct ImageData
+{
+    // Pixel data allocated by stb_image, nullptr if decoding failed
+    unsigned char *pixels = nullptr;
+
+    // Width and height of the image
+    int width = 0;
+    int height = 0;
+
+    // Number of color channels
+    int numChannels = 0;
+
+    // Mipmap levels 1 and up, downsampled from the pixels on the decoding thread
+    std::vector<std::vector<unsigned char>> levels;
+};
 
 // The Texture class helps add details to an object.
 // Loads images files with the stb_image image loader
@@ -7,14 +28,40 @@
 // All texture objects are referenced with an integer,
 // and provides functions to help set "this" as the currently
 // bound texture.
+// Textures created from a decoded image stream their mipmap levels: only the coarse levels
+// are uploaded at first and the TextureStreamer moves the finest resident level up and down
+// as the objects need it. Each level is kept once, in video memory while it is resident and
+// in system memory otherwise: uploading a level frees its pixels and freeing it reads them back.
 class Texture
 {
 public:
-    //   Texture constructor:
+    //   Texture constructor, decodes and uploads every level of the image on the calling thread:
     // - const char* as the name/file path of the texture file
     Texture(const char *textureFile);
+    //   Texture constructor from an already decoded image, uploads only the coarse levels
+    //   and takes the image's mipmap levels to stream the others from:
+    // - const std::string& as the name/file path of the texture file
+    // - ImageData& for the decoded pixels
+    Texture(const std::string &textureFile, ImageData &image);
     ~Texture();
 
+    //   DecodeImage loads and decodes an image file with stb_image and downsamples its mipmap levels.
+    //   This does not make any OpenGL calls and is safe to call from any thread:
+    // - const std::string& for the file path of the image
+    static ImageData DecodeImage(const std::string &textureFile);
+
+    //   Downsample averages each 2x2 block of a level into one texel of the next level,
+    //   repeating the last row or column of a side with an odd size:
+    // - const unsigned char* for the pixels of the level
+    // - int for the width and height of the level
+    // - int for the number of color channels
+    // - std::vector<unsigned char>& for the pixels of the next level
+    static void Downsample(const unsigned char *source, int width, int height, int numChannels, std::vector<unsigned char> &level);
+
+    //   FreeImage frees the pixels and levels of a decoded image:
+    // - ImageData& for the image to free
+    static void FreeImage(ImageData &image);
+
     // Binds the texure as the current texture using glBindTexture
     // Passes in GL_TEXTURE_2D and the texture ID as its paramaters
     void SetActive();
@@ -22,7 +69,50 @@ public:
     // Getter for the texture's ID
     unsigned int GetID() { return mTextureID; }
 
+    // Getters for the texture's name, size, number of mipmap levels and OpenGL internal format
+    const std::string &GetName() const { return mName; }
+    int GetWidth() const { return mWidth; }
+    int GetHeight() const { return mHeight; }
+    int GetLevelCount() const { return mLevelCount; }
+    unsigned int GetInternalFormat() const { return mInternalFormat; }
+
+    // Returns true while the levels are streamed, false once every level is uploaded for good
+    bool IsStreaming() const { return !mLevelPixels.empty(); }
+
+    // Getter for the finest level in video memory, every coarser level is resident as well
+    int GetResidentLevel() const { return mResidentLevel; }
+
+    //   SetResidentLevel uploads the levels finer than the resident ones up to a level,
+    //   or frees the levels finer than it. Does nothing once the texture stopped streaming:
+    // - int for the new finest resident level
+    void SetResidentLevel(int level);
+
+    // LoadAllLevels uploads every level for good, the texture stops streaming
+    void LoadAllLevels();
+
+    //   CopyLevel copies a level into the storage of another texture, on the GPU when the level
+    //   is resident and from its pixels in system memory otherwise, so the copy doesn't stop the streaming:
+    // - int for the level
+    // - unsigned int for the OpenGL target of the destination, GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+    // - unsigned int for the ID of the destination texture
+    // - int for the layer of a GL_TEXTURE_2D_ARRAY, 0 otherwise
+    void CopyLevel(int level, unsigned int target, unsigned int textureID, int layer) const;
+
+    //   GetLevelBytes returns the video memory a level takes, counting 4 bytes per texel
+    //   since drivers pad RGB8 texels:
+    // - int for the level
+    size_t GetLevelBytes(int level) const;
+
+    //   GetResidentBytes returns the video memory of the levels from a level to the coarsest:
+    // - int for the finest level
+    size_t GetResidentBytes(int level) const;
+
 private:
+    //   Creates the OpenGL texture object and keeps the decoded image's levels that are not uploaded:
+    // - ImageData& for the decoded pixels, its levels are moved into the texture
+    // - bool for if every level is uploaded, otherwise only the levels of sStreamingSize and smaller
+    void Upload(ImageData &image, bool allLevels);
+
     // Texture name (file path to the texture)
     std::string mName;
 
@@ -35,4 +125,20 @@ private:
 
     // Number of color channels
     int mNumChannels;
+
+    // Number of mipmap levels, 0 if the image failed to load
+    int mLevelCount;
+
+    // Format the pixels are stored in on the GPU
+    unsigned int mInternalFormat;
+
+    // Format of the pixels in system memory
+    unsigned int mFormat;
+
+    // Pixels of every level while the texture streams, empty for the resident levels.
+    // Empty altogether once every level is uploaded for good
+    std::vector<std::vector<unsigned char>> mLevelPixels;
+
+    // Finest level in video memory, mLevelCount when no level is
+    int mResidentLevel;
 };
\ No newline at end of file
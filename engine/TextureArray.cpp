@@ -0,0 +1,78 @@
+#include "TextureArray.h"
+#include <algorithm>
+#include <iostream>
+#include <glad/glad.h>
+#include "Texture.h"
+
+TextureArray::TextureArray(int width, int height, unsigned int internalFormat, int levelCount, int capacity)
+    : mTextureID(0), mWidth(width), mHeight(height), mInternalFormat(internalFormat), mLevelCount(levelCount), mLayerCount(0), mCapacity(0)
+{
+    Resize(std::max(capacity, 1));
+}
+
+TextureArray::~TextureArray()
+{
+    std::cout << "Delete texture array" << std::endl;
+    glDeleteTextures(1, &mTextureID);
+    mTextureID = 0;
+}
+
+bool TextureArray::Matches(int width, int height, unsigned int internalFormat, int levelCount) const
+{
+    return width == mWidth && height == mHeight && internalFormat == mInternalFormat && levelCount == mLevelCount;
+}
+
+void TextureArray::Resize(int capacity)
+{
+    // Immutable storage for every level and layer, the same sampling parameters as Texture
+    unsigned int textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, mLevelCount, mInternalFormat, mWidth, mHeight, capacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Copy the layers in use, every level at once
+    if (mTextureID && mLayerCount > 0)
+    {
+        for (int level = 0; level < mLevelCount; ++level)
+        {
+            int levelWidth = std::max(1, mWidth >> level), levelHeight = std::max(1, mHeight >> level);
+            glCopyImageSubData(mTextureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                               levelWidth, levelHeight, mLayerCount);
+        }
+    }
+    glDeleteTextures(1, &mTextureID);
+
+    mTextureID = textureID;
+    mCapacity = capacity;
+}
+
+int TextureArray::AddLayer(Texture *texture)
+{
+    if (!Matches(texture->GetWidth(), texture->GetHeight(), texture->GetInternalFormat(), texture->GetLevelCount()))
+    {
+        std::cout << "Texture " << texture->GetName() << " does not match the size and format of the texture array" << std::endl;
+        return -1;
+    }
+
+    if (mLayerCount == mCapacity)
+    {
+        Resize(mCapacity * 2);
+    }
+
+    int layer = mLayerCount++;
+    for (int level = 0; level < mLevelCount; ++level)
+    {
+        texture->CopyLevel(level, GL_TEXTURE_2D_ARRAY, mTextureID, layer);
+    }
+    return layer;
+}
+
+void TextureArray::SetActive()
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+}
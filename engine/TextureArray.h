@@ -0,0 +1,59 @@
+#pragma once
+
+class Texture;
+
+// TextureArray is a GL_TEXTURE_2D_ARRAY whose layers are copies of Textures that share
+// the same size, format and number of mipmap levels. Shaders pick a texture with its
+// layer, so objects using different textures of the same array can be drawn together.
+// Layers are copied on the GPU with glCopyImageSubData, or uploaded from system memory for
+// the levels a streamed texture doesn't have resident. The array keeps every level of its
+// layers while the textures go on streaming. When the array is full its storage is
+// reallocated with twice the layers and the existing layers are copied over.
+class TextureArray
+{
+public:
+    //   TextureArray constructor, must be called on the main thread:
+    // - int for the width of every layer
+    // - int for the height of every layer
+    // - unsigned int for the OpenGL internal format of every layer
+    // - int for the number of mipmap levels
+    // - int for the number of layers to allocate up front
+    TextureArray(int width, int height, unsigned int internalFormat, int levelCount, int capacity = 4);
+    ~TextureArray();
+
+    //   AddLayer copies every mipmap level of a texture into a new layer and returns the layer.
+    //   Returns -1 if the texture's size, format or levels don't match the array:
+    // - Texture* for the texture to copy
+    int AddLayer(Texture *texture);
+
+    //   Returns true if textures of this size, format and number of levels can be added:
+    // - int for the width
+    // - int for the height
+    // - unsigned int for the OpenGL internal format
+    // - int for the number of mipmap levels
+    bool Matches(int width, int height, unsigned int internalFormat, int levelCount) const;
+
+    // Binds the array to the active texture unit
+    void SetActive();
+
+    // Getters for the array's ID and its number of layers in use
+    unsigned int GetID() const { return mTextureID; }
+    int GetLayerCount() const { return mLayerCount; }
+
+private:
+    //   Reallocates the storage and copies the layers in use into it:
+    // - int for the new number of layers
+    void Resize(int capacity);
+
+    // ID of the GL_TEXTURE_2D_ARRAY
+    unsigned int mTextureID;
+
+    int mWidth;
+    int mHeight;
+    unsigned int mInternalFormat;
+    int mLevelCount;
+
+    // Layers in use and layers allocated
+    int mLayerCount;
+    int mCapacity;
+};
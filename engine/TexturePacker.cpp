@@ -0,0 +1,61 @@
+#include "TexturePacker.h"
+#include <iostream>
+#include "Texture.h"
+#include "TextureArray.h"
+
+TexturePacker::TexturePacker()
+{
+}
+
+TexturePacker::~TexturePacker()
+{
+    std::cout << "Delete texture packer" << std::endl;
+    Clear();
+}
+
+void TexturePacker::Clear()
+{
+    for (auto a : mArrays)
+    {
+        delete a;
+    }
+    mArrays.clear();
+    mLayers.Clear();
+}
+
+TextureLayer TexturePacker::Pack(Texture *texture)
+{
+    StringId id(texture->GetName());
+    if (const TextureLayer *packed = mLayers.Find(id))
+    {
+        return *packed;
+    }
+
+    // Textures that failed to load have no levels to copy
+    if (texture->GetLevelCount() == 0)
+    {
+        return TextureLayer();
+    }
+
+    // Add a layer to the first array the texture fits into, or start a new array
+    TextureArray *array = nullptr;
+    for (auto a : mArrays)
+    {
+        if (a->Matches(texture->GetWidth(), texture->GetHeight(), texture->GetInternalFormat(), texture->GetLevelCount()))
+        {
+            array = a;
+            break;
+        }
+    }
+    if (!array)
+    {
+        array = new TextureArray(texture->GetWidth(), texture->GetHeight(), texture->GetInternalFormat(), texture->GetLevelCount());
+        mArrays.emplace_back(array);
+    }
+
+    TextureLayer packed;
+    packed.array = array;
+    packed.layer = array->AddLayer(texture);
+    mLayers.Insert(id, packed);
+    return packed;
+}
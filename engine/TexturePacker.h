@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "FlatMap.h"
+
+class Texture;
+class TextureArray;
+
+// A texture resolved to its layer of a TextureArray
+struct TextureLayer
+{
+    TextureArray *array = nullptr;
+    int layer = -1;
+};
+
+// TexturePacker groups textures with the same size, format and number of mipmap levels
+// into TextureArrays, creating a new array whenever a texture matches none of the
+// existing ones. Each texture is copied once: packing it again returns the same layer.
+// The layer holds every level of the texture, the texture itself keeps streaming.
+// Objects whose textures resolve to the same arrays can share an instanced or
+// multi-draw call by passing their layers to the shader.
+class TexturePacker
+{
+public:
+    TexturePacker();
+    ~TexturePacker();
+
+    //   Pack returns the array and layer of a texture, copying the texture into an
+    //   array the first time. Must be called on the main thread:
+    // - Texture* for a loaded texture
+    TextureLayer Pack(Texture *texture);
+
+    // Deletes every array
+    void Clear();
+
+    // Getter for the arrays, in the order they were created
+    const std::vector<TextureArray *> &GetArrays() const { return mArrays; }
+
+private:
+    // Layer of every packed texture by its name
+    FlatMap<TextureLayer> mLayers;
+
+    std::vector<TextureArray *> mArrays;
+};
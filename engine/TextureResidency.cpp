@@ -0,0 +1,177 @@
+#include "TextureResidency.h"
+#include <cstring>
+#include <iostream>
+#include "Texture.h"
+
+// ARB_bindless_texture is not part of the core profile GLAD was generated for, so its functions are loaded here
+typedef GLuint64(APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void(APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void(APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+static PFNGLGETTEXTUREHANDLEARBPROC sGetTextureHandle = nullptr;
+static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC sMakeTextureHandleResident = nullptr;
+static PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC sMakeTextureHandleNonResident = nullptr;
+
+// The table starts with room for this many handles and doubles when it is full
+static const size_t sInitialCapacity = 64;
+
+bool TextureResidency::sSupported = false;
+
+// Copies every level of a texture into immutable storage with the same sampling parameters as Texture
+static unsigned int CopyTexture(Texture *texture)
+{
+    unsigned int textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexStorage2D(GL_TEXTURE_2D, texture->GetLevelCount(), texture->GetInternalFormat(), texture->GetWidth(), texture->GetHeight());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (int level = 0; level < texture->GetLevelCount(); ++level)
+    {
+        texture->CopyLevel(level, GL_TEXTURE_2D, textureID, 0);
+    }
+    return textureID;
+}
+
+TextureResidency::TextureResidency()
+    : mResidentCount(0), mBufferID(0), mBufferCapacity(0), mDirty(false)
+{
+    glGenBuffers(1, &mBufferID);
+}
+
+TextureResidency::~TextureResidency()
+{
+    std::cout << "Delete texture residency" << std::endl;
+    Clear();
+    glDeleteBuffers(1, &mBufferID);
+}
+
+bool TextureResidency::LoadExtension(GLADloadproc load)
+{
+    sSupported = false;
+
+    int extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    bool found = false;
+    for (int i = 0; i < extensionCount && !found; ++i)
+    {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        found = extension && std::strcmp(extension, "GL_ARB_bindless_texture") == 0;
+    }
+    if (!found)
+    {
+        std::cout << "GL_ARB_bindless_texture is not supported, textures are packed into arrays" << std::endl;
+        return false;
+    }
+
+    sGetTextureHandle = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(load("glGetTextureHandleARB"));
+    sMakeTextureHandleResident = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(load("glMakeTextureHandleResidentARB"));
+    sMakeTextureHandleNonResident = reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(load("glMakeTextureHandleNonResidentARB"));
+    if (!sGetTextureHandle || !sMakeTextureHandleResident || !sMakeTextureHandleNonResident)
+    {
+        std::cout << "Failed to load the GL_ARB_bindless_texture functions" << std::endl;
+        return false;
+    }
+
+    sSupported = true;
+    return true;
+}
+
+int TextureResidency::Acquire(Texture *texture)
+{
+    if (texture->GetLevelCount() == 0)
+    {
+        return -1;
+    }
+
+    StringId id(texture->GetName());
+    int slot;
+    if (const int *found = mSlots.Find(id))
+    {
+        slot = *found;
+    }
+    else
+    {
+        // Creating the handle makes the texture's storage and parameters immutable,
+        // so a streamed texture goes on streaming and the handle samples a copy of it
+        unsigned int copyID = texture->IsStreaming() ? CopyTexture(texture) : 0;
+        slot = static_cast<int>(mHandles.size());
+        mHandles.emplace_back(sGetTextureHandle(copyID ? copyID : texture->GetID()));
+        mCopyIDs.emplace_back(copyID);
+        mReferences.emplace_back(0);
+        mSlots.Insert(id, slot);
+        mDirty = true;
+    }
+
+    if (mReferences[slot]++ == 0)
+    {
+        sMakeTextureHandleResident(mHandles[slot]);
+        ++mResidentCount;
+    }
+    return slot;
+}
+
+void TextureResidency::Release(int slot)
+{
+    if (slot < 0 || slot >= static_cast<int>(mReferences.size()) || mReferences[slot] == 0)
+    {
+        std::cout << "Texture handle " << slot << " is not acquired" << std::endl;
+        return;
+    }
+
+    // The slot keeps its handle, acquiring the texture again only makes it resident
+    if (--mReferences[slot] == 0)
+    {
+        sMakeTextureHandleNonResident(mHandles[slot]);
+        --mResidentCount;
+    }
+}
+
+void TextureResidency::Clear()
+{
+    for (size_t i = 0; i < mHandles.size(); ++i)
+    {
+        if (mReferences[i] > 0)
+        {
+            sMakeTextureHandleNonResident(mHandles[i]);
+        }
+    }
+    glDeleteTextures(static_cast<GLsizei>(mCopyIDs.size()), mCopyIDs.data());
+    mCopyIDs.clear();
+    mHandles.clear();
+    mReferences.clear();
+    mSlots.Clear();
+    mResidentCount = 0;
+    mDirty = false;
+}
+
+void TextureResidency::Bind(unsigned int binding)
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBufferID);
+    if (mHandles.size() > mBufferCapacity)
+    {
+        mBufferCapacity = mBufferCapacity ? mBufferCapacity : sInitialCapacity;
+        while (mBufferCapacity < mHandles.size())
+        {
+            mBufferCapacity *= 2;
+        }
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mBufferCapacity * sizeof(GLuint64), nullptr, GL_DYNAMIC_DRAW);
+        mDirty = true;
+    }
+    if (mDirty)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mHandles.size() * sizeof(GLuint64), mHandles.data());
+        mDirty = false;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // An empty buffer can't be bound, no shader reads the table before a texture was acquired
+    if (mBufferCapacity > 0)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, mBufferID);
+    }
+}
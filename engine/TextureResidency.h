@@ -0,0 +1,74 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include "FlatMap.h"
+
+class Texture;
+
+// TextureResidency manages the 64-bit handles of ARB_bindless_texture. Every texture
+// gets one slot in a table of handles that is uploaded to a storage buffer, and shaders
+// build their samplers from the handle at a slot instead of from a texture unit, so
+// objects with different textures no longer need a bind between their draws.
+// A handle can only be sampled while it is resident. Objects acquire the textures they
+// draw with and release them when they are deleted: the first acquire makes a handle
+// resident and the last release makes it non-resident again.
+// A handle freezes the storage of its texture, so the handle of a streamed texture is created
+// from a copy of all its levels and the texture itself keeps streaming for the other objects.
+// The extension is optional, LoadExtension must be called once after GLAD is loaded and
+// the AssetManager only creates a TextureResidency when it is supported. Without it
+// textures are packed into TextureArrays instead.
+class TextureResidency
+{
+public:
+    TextureResidency();
+    ~TextureResidency();
+
+    //   LoadExtension looks for ARB_bindless_texture in the current context and loads its functions:
+    // - GLADloadproc for the function loader GLAD was loaded with
+    static bool LoadExtension(GLADloadproc load);
+
+    // Returns true if LoadExtension found ARB_bindless_texture
+    static bool IsSupported() { return sSupported; }
+
+    //   Acquire returns the slot of a texture's handle, making the handle resident if no one
+    //   else is using it. Returns -1 if the texture failed to load. Must be called on the main thread:
+    // - Texture* for a loaded texture
+    int Acquire(Texture *texture);
+
+    //   Release gives up one acquire of a slot, making its handle non-resident when it was the last one:
+    // - int for the slot returned by Acquire
+    void Release(int slot);
+
+    // Makes every handle non-resident and forgets every slot, before the textures are deleted
+    void Clear();
+
+    //   Bind uploads the table of handles if it changed and binds it as a storage buffer:
+    // - unsigned int for the binding point of the buffer in the shaders
+    void Bind(unsigned int binding);
+
+    // Number of slots whose handles are resident
+    size_t GetResidentCount() const { return mResidentCount; }
+
+private:
+    // Whether the context supports bindless textures
+    static bool sSupported;
+
+    // Slot of every texture by its name
+    FlatMap<int> mSlots;
+
+    // Handle and number of acquires of every slot
+    std::vector<GLuint64> mHandles;
+    std::vector<int> mReferences;
+
+    // Copy the handle of every slot was created from, 0 if it was created from the texture itself
+    std::vector<unsigned int> mCopyIDs;
+
+    size_t mResidentCount;
+
+    // Storage buffer with the handles and the number of handles it has room for
+    unsigned int mBufferID;
+    size_t mBufferCapacity;
+
+    // True when handles were added since the last upload
+    bool mDirty;
+};
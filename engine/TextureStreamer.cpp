@@ -0,0 +1,172 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "Texture.h"
+
+// Default video memory for the resident levels and bytes uploaded per frame
+static const size_t sDefaultBudget = 64 * 1024 * 1024;
+static const size_t sDefaultUploadBudget = 4 * 1024 * 1024;
+
+TextureStreamer::TextureStreamer()
+    : mCameraPosition(0.0f), mPixelsPerUnit(1.0f), mBudget(sDefaultBudget), mUploadBudget(sDefaultUploadBudget)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    std::cout << "Delete texture streamer" << std::endl;
+    Clear();
+}
+
+void TextureStreamer::SetView(const glm::vec3 &cameraPosition, const glm::mat4 &projection, float viewportHeight)
+{
+    mCameraPosition = cameraPosition;
+
+    // projection[1][1] is cot(fov / 2), which maps a unit length at unit distance to half the viewport
+    mPixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+}
+
+void TextureStreamer::Add(Texture *texture)
+{
+    StringId id(texture->GetName());
+    if (!texture->IsStreaming() || mIndices.Find(id))
+    {
+        return;
+    }
+    mIndices.Insert(id, mTextures.size());
+    mTextures.push_back({texture, -1, texture->GetResidentLevel()});
+}
+
+void TextureStreamer::Clear()
+{
+    mTextures.clear();
+    mIndices.Clear();
+}
+
+void TextureStreamer::Remove(size_t index)
+{
+    mIndices.Erase(StringId(mTextures[index].texture->GetName()));
+    if (index + 1 < mTextures.size())
+    {
+        mTextures[index] = mTextures.back();
+        *mIndices.Find(StringId(mTextures[index].texture->GetName())) = index;
+    }
+    mTextures.pop_back();
+}
+
+void TextureStreamer::Request(Texture *texture, const glm::vec3 &center, float radius, float uvDensity)
+{
+    size_t *index = mIndices.Find(StringId(texture->GetName()));
+    if (!index)
+    {
+        return;
+    }
+    StreamedTexture &streamed = mTextures[*index];
+
+    // Use the closest point of the bounding sphere like the LodSelector, inside it the finest level is needed
+    int level = 0;
+    float distance = glm::length(center - mCameraPosition) - radius;
+    if (distance > 0.0f)
+    {
+        // Texels of the finest level that fall on one pixel, every level halves them
+        float texelsPerPixel = std::max(texture->GetWidth(), texture->GetHeight()) * uvDensity * distance / mPixelsPerUnit;
+        if (texelsPerPixel > 1.0f)
+        {
+            level = static_cast<int>(std::floor(std::log2(texelsPerPixel)));
+        }
+    }
+    level = std::min(level, texture->GetLevelCount() - 1);
+
+    if (streamed.requestedLevel < 0 || level < streamed.requestedLevel)
+    {
+        streamed.requestedLevel = level;
+    }
+}
+
+void TextureStreamer::Update()
+{
+    // Textures that loaded all their levels stopped streaming
+    for (size_t i = mTextures.size(); i-- > 0;)
+    {
+        if (!mTextures[i].texture->IsStreaming())
+        {
+            Remove(i);
+        }
+    }
+
+    // Textures nobody requested keep their levels until the budget needs the memory
+    size_t total = 0;
+    for (auto &t : mTextures)
+    {
+        t.targetLevel = t.requestedLevel >= 0 ? t.requestedLevel : t.texture->GetResidentLevel();
+        total += t.texture->GetResidentBytes(t.targetLevel);
+    }
+
+    // Drop the finest level of the texture that needs it the least: an unrequested one first,
+    // then the one whose finest level is the largest, until the rest fits
+    while (total > mBudget)
+    {
+        StreamedTexture *drop = nullptr;
+        for (auto &t : mTextures)
+        {
+            if (t.targetLevel + 1 >= t.texture->GetLevelCount())
+            {
+                continue;
+            }
+            if (!drop || (t.requestedLevel < 0 && drop->requestedLevel >= 0) ||
+                ((t.requestedLevel < 0) == (drop->requestedLevel < 0) && t.texture->GetLevelBytes(t.targetLevel) > drop->texture->GetLevelBytes(drop->targetLevel)))
+            {
+                drop = &t;
+            }
+        }
+        if (!drop)
+        {
+            break;
+        }
+        total -= drop->texture->GetLevelBytes(drop->targetLevel);
+        ++drop->targetLevel;
+    }
+
+    // Free the dropped levels first so the uploads fit in the memory they leave
+    for (auto &t : mTextures)
+    {
+        if (t.targetLevel > t.texture->GetResidentLevel())
+        {
+            t.texture->SetResidentLevel(t.targetLevel);
+        }
+    }
+
+    // Upload one level per texture at a time, so every texture sharpens a bit each frame
+    size_t uploaded = 0;
+    bool uploading = true;
+    while (uploading && uploaded < mUploadBudget)
+    {
+        uploading = false;
+        for (auto &t : mTextures)
+        {
+            int level = t.texture->GetResidentLevel() - 1;
+            if (level >= t.targetLevel && uploaded < mUploadBudget)
+            {
+                uploaded += t.texture->GetLevelBytes(level);
+                t.texture->SetResidentLevel(level);
+                uploading = true;
+            }
+        }
+    }
+
+    for (auto &t : mTextures)
+    {
+        t.requestedLevel = -1;
+    }
+}
+
+size_t TextureStreamer::GetResidentBytes() const
+{
+    size_t bytes = 0;
+    for (auto &t : mTextures)
+    {
+        bytes += t.texture->GetResidentBytes(t.texture->GetResidentLevel());
+    }
+    return bytes;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FlatMap.h"
+
+class Texture;
+
+// TextureStreamer decides how many mipmap levels of every streamed texture are in video
+// memory. Each frame the objects request the level their size on screen needs: one texel
+// per pixel, from the density of their texture coordinates and their distance to the camera.
+// Update then drops levels, starting with the textures nobody requested, until the resident
+// levels fit in the memory budget, and uploads the missing finer levels a few at a time so
+// a frame never uploads more than the upload budget.
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    //   SetView sets the camera the levels are requested for, called once per frame before the requests:
+    // - const glm::vec3& for the camera's world position
+    // - const glm::mat4& for the projection matrix
+    // - float for the height of the viewport in pixels
+    void SetView(const glm::vec3 &cameraPosition, const glm::mat4 &projection, float viewportHeight);
+
+    //   Add starts streaming a texture. Textures that load all their levels are ignored:
+    // - Texture* for a texture created from a decoded image
+    void Add(Texture *texture);
+
+    // Stops streaming every texture, before the textures are deleted
+    void Clear();
+
+    //   Request asks for the level an object needs, the finest request of the frame wins:
+    // - Texture* for a texture the object samples
+    // - const glm::vec3& for the world space center of the object's bounds
+    // - float for the world space radius of the object's bounds
+    // - float for the texture coordinate units per world unit of the object's surface
+    void Request(Texture *texture, const glm::vec3 &center, float radius, float uvDensity);
+
+    // Fits the requested levels in the budget and uploads or frees levels, called once per frame after the requests
+    void Update();
+
+    // Setters and getters for the video memory of the resident levels and the bytes uploaded per frame
+    void SetBudget(size_t bytes) { mBudget = bytes; }
+    size_t GetBudget() const { return mBudget; }
+    void SetUploadBudget(size_t bytes) { mUploadBudget = bytes; }
+    size_t GetUploadBudget() const { return mUploadBudget; }
+
+    // Getter for the video memory of the streamed textures' resident levels
+    size_t GetResidentBytes() const;
+
+private:
+    // A streamed texture and the level wanted for it this frame
+    struct StreamedTexture
+    {
+        Texture *texture;
+
+        // Finest level requested this frame, or -1 if no object requested the texture
+        int requestedLevel;
+
+        // Level the texture should have resident once the budget is applied
+        int targetLevel;
+    };
+
+    // Removes a texture that stopped streaming, swapping the last texture into its place
+    void Remove(size_t index);
+
+    std::vector<StreamedTexture> mTextures;
+
+    // Index in mTextures of every texture by its name
+    FlatMap<size_t> mIndices;
+
+    // Camera position in world space
+    glm::vec3 mCameraPosition;
+
+    // Pixels covered by one world unit at a distance of one unit from the camera
+    float mPixelsPerUnit;
+
+    size_t mBudget;
+    size_t mUploadBudget;
+};
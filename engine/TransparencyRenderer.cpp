@@ -0,0 +1,103 @@
+#include "TransparencyRenderer.h"
+#include <iostream>
+#include <glad/glad.h>
+#include "AssetManager.h"
+#include "RenderGraph.h"
+#include "Shader.h"
+
+// Texture units the composite shader reads from
+static const int sAccumulationUnit = 0;
+static const int sRevealageUnit = 1;
+
+TransparencyRenderer::TransparencyRenderer()
+    : mVertexArrayID(0)
+{
+    // Core profile draws need a vertex array even without attributes
+    glGenVertexArrays(1, &mVertexArrayID);
+}
+
+TransparencyRenderer::~TransparencyRenderer()
+{
+    std::cout << "Delete transparency renderer" << std::endl;
+
+    glDeleteVertexArrays(1, &mVertexArrayID);
+}
+
+void TransparencyRenderer::AddPasses(RenderGraph &graph, int sceneColor, int sceneDepth, int width, int height, const std::function<void()> &drawObjects)
+{
+    // Half floats keep the sums of many weighted colors, 8 bits are enough for the revealage
+    int accumulation = graph.CreateTexture("Accumulation", width, height, GL_RGBA16F);
+    int revealage = graph.CreateTexture("Revealage", width, height, GL_R8);
+
+    // Colors add up and the revealage multiplies, so the order of the objects doesn't matter.
+    // The depth of the opaque scene hides what is behind it
+    size_t accumulationPass = graph.AddPass("Transparent accumulation", [drawObjects]()
+                                            {
+                                                const float noColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                                                const float revealed[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+                                                glClearBufferfv(GL_COLOR, 0, noColor);
+                                                glClearBufferfv(GL_COLOR, 1, revealed);
+
+                                                glDepthMask(GL_FALSE);
+                                                glEnable(GL_BLEND);
+                                                glBlendFunci(0, GL_ONE, GL_ONE);
+                                                glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+                                                drawObjects();
+                                                glBlendFunc(GL_ONE, GL_ZERO);
+                                                glDisable(GL_BLEND);
+                                                glDepthMask(GL_TRUE); });
+    graph.Read(accumulationPass, sceneDepth);
+    graph.Write(accumulationPass, accumulation);
+    graph.Write(accumulationPass, revealage);
+    graph.Write(accumulationPass, sceneDepth);
+
+    size_t compositePass = graph.AddPass("Transparent composite", [this, &graph, accumulation, revealage]()
+                                         { Composite(graph.GetTexture(accumulation), graph.GetTexture(revealage)); });
+    graph.Read(compositePass, accumulation);
+    graph.Read(compositePass, revealage);
+    graph.Read(compositePass, sceneColor);
+    graph.Write(compositePass, sceneColor);
+}
+
+void TransparencyRenderer::Composite(unsigned int accumulation, unsigned int revealage)
+{
+    // The composite shader is owned by the AssetManager like the other shaders
+    AssetManager *am = AssetManager::Get();
+    Shader *compositeShader = am->LoadShader("transparentComposite"_id);
+    if (!compositeShader)
+    {
+        compositeShader = new Shader("shaders/fullscreenVS.glsl", "shaders/transparentCompositeFS.glsl");
+        compositeShader->SetActive();
+        compositeShader->SetInt("accumulation"_id, sAccumulationUnit);
+        compositeShader->SetInt("revealage"_id, sRevealageUnit);
+        am->SaveShader("transparentComposite"_id, compositeShader);
+    }
+
+    // The full screen triangle is always filled and neither tests nor writes depth
+    int polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE0 + sAccumulationUnit);
+    glBindTexture(GL_TEXTURE_2D, accumulation);
+    glActiveTexture(GL_TEXTURE0 + sRevealageUnit);
+    glBindTexture(GL_TEXTURE_2D, revealage);
+
+    // The shader's alpha is the revealage: scene * revealage + average color * (1 - revealage)
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+    compositeShader->SetActive();
+    glBindVertexArray(mVertexArrayID);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glDisable(GL_BLEND);
+
+    glActiveTexture(GL_TEXTURE0 + sRevealageUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0 + sAccumulationUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
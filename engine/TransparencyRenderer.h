@@ -0,0 +1,38 @@
+#pragma once
+#include <functional>
+
+class RenderGraph;
+
+// TransparencyRenderer draws transparent objects with weighted blended order-independent
+// transparency, so they can be drawn in any order, instanced and batched like opaque ones,
+// without sorting them by depth every frame. The objects add their premultiplied color,
+// weighted by their alpha and their closeness to the camera, into an RGBA16F accumulation
+// target, and multiply a revealage target by one minus their alpha, which leaves how much
+// of the scene behind still shows through. Both are blend operations that don't depend on
+// the order of the fragments. The composite pass divides the accumulated color by the
+// accumulated weight and blends it over the scene by the revealage. The objects are tested
+// against the scene's depth but don't write it. They draw with their usual shaders compiled
+// with "#define TRANSPARENT", which scales the texture's alpha by the opacity uniform.
+class TransparencyRenderer
+{
+public:
+    // TransparencyRenderer constructor
+    TransparencyRenderer();
+    ~TransparencyRenderer();
+
+    //   AddPasses adds the accumulation and composite passes to a frame's render graph. The
+    //   accumulation and revealage targets are transient:
+    // - RenderGraph& for the frame's graph
+    // - int for the color and depth resources of the lit scene, not the backbuffer
+    // - int for the width and height of the scene in pixels
+    // - const std::function<void()>& draws the transparent objects into the bound targets
+    void AddPasses(RenderGraph &graph, int sceneColor, int sceneDepth, int width, int height, const std::function<void()> &drawObjects);
+
+private:
+    //   Composite blends the accumulated objects over the bound scene:
+    // - unsigned int for the accumulation and revealage textures
+    void Composite(unsigned int accumulation, unsigned int revealage);
+
+    // Vertex array of the full screen triangle, which has no vertex buffer
+    unsigned int mVertexArrayID;
+};
@@ -1,8 +1,8 @@
 #include "VertexBuffer.h"
 #include <iostream>
 
-VertexBuffer::VertexBuffer(const void *vertices, const void *indices, size_t vertexSize, size_t indexSize, size_t vertexCount, size_t indexCount, Vertex vertexFormat)
-    : mVaoID(0), mVertexBufferID(0), mIndexBufferID(0), mVertexCount(vertexCount), mIndexCount(indexCount), mDrawIndexed(false)
+VertexBuffer::VertexBuffer(const void *vertices, size_t vertexSize, size_t vertexCount, const void *indices, size_t indexSize, size_t indexCount, GLenum indexType)
+    : mVaoID(0), mVertexBufferID(0), mIndexBufferID(0), mVertexCount(vertexCount), mIndexCount(indexCount), mIndexType(indexType), mDrawIndexed(false)
 {
     // Create a vertex array object, store in int as reference
     glGenVertexArrays(1, &mVaoID);
@@ -39,7 +39,7 @@ VertexBuffer::VertexBuffer(const void *vertices, const void *indices, size_t ver
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indices, GL_STATIC_DRAW);
     }
 
-    SetVertexAttributePointers(vertexFormat);
+    // The attribute pointers are set by the templated constructor, which knows the vertex type
 }
 
 VertexBuffer::~VertexBuffer()
@@ -55,36 +55,24 @@ VertexBuffer::~VertexBuffer()
     mIndexBufferID = 0;
 }
 
-void VertexBuffer::SetVertexAttributePointers(Vertex format)
+void VertexBuffer::SetVertexAttributePointers(const VertexAttribute *attributes, size_t attributeCount, size_t stride)
 {
-    // Get the vector of strides based on the vertex format
-    std::vector<int> strides = GetVertexFormat(format);
-
-    // Loop through that vector to get the total number of values within each vertex
-    int totalStride = 0;
-    for (size_t i = 0; i < strides.size(); ++i)
-    {
-        totalStride += strides[i];
-    }
-
-    int spacing = 0;
-
     // Loop through each attribute of the vertex
-    for (size_t i = 0; i < strides.size(); ++i)
+    for (size_t i = 0; i < attributeCount; ++i)
     {
+        const VertexAttribute &attribute = attributes[i];
+
         //   Set vertex attributes pointers
         //   Link Vertex Attributes with glVertexAttribPointer():
         // - First argument specifies which vertex attribute to configure. This attribute is specified within the vertex shader
         // - Second argument specifies the size or number of values for the vertex attribute.
-        // - Third argument specifies the type of the data, which in this case is a GL_Float (vec* in GLSL)
-        // - Fourth argument specifies if the data is going to be normalized.
+        // - Third argument specifies the type of the data (GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_SHORT, GL_INT_2_10_10_10_REV, ...)
+        // - Fourth argument specifies if integer data is normalized to [0, 1] or [-1, 1] (vec* in GLSL either way)
         // - Fifth argument is the stride, and defines the space between consecutive vertex attributes
-        // - Last argument is type void*, and is the offset of where the position data begins in the buffer
-        glVertexAttribPointer(i, strides[i], GL_FLOAT, GL_FALSE, totalStride * sizeof(float), (void *)(spacing * sizeof(float)));
+        // - Last argument is type void*, and is the offset of where the attribute begins in the vertex
+        glVertexAttribPointer(i, attribute.count, attribute.type, attribute.normalized, stride, (void *)attribute.offset);
         // Enable each attribute
         glEnableVertexAttribArray(i);
-        // Increment the spacing by the stride value
-        spacing += strides[i];
     }
 }
 
@@ -99,9 +87,9 @@ void VertexBuffer::Draw()
         //   glDrawElements takes indices from EBO currently bound to GL_ELEMENT_ARRAY_BUFFER target:
         // - First argument specifies the mode to draw in, in this case draw triangles
         // - Second argument is the count or number of elements/indices to draw
-        // - Third argument is type of indices which is of GL_UNSIGNED_INT
+        // - Third argument is type of indices, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT for small meshes
         // - Last argument allows us to specify offset in EBO or pass in an index array
-        glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, mIndexCount, mIndexType, 0);
     }
     else
     {
@@ -112,3 +100,28 @@ void VertexBuffer::Draw()
         glDrawArrays(GL_TRIANGLES, 0, mVertexCount);
     }
 }
+
+void VertexBuffer::Draw(size_t firstIndex, size_t indexCount)
+{
+    SetActive();
+
+    // The last argument is the byte offset of the first index in the EBO
+    size_t indexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    glDrawElements(GL_TRIANGLES, indexCount, mIndexType, (void *)(firstIndex * indexSize));
+}
+
+void VertexBuffer::SetInstanceAttribute(unsigned int bufferID, unsigned int location, int componentCount)
+{
+    SetActive();
+    glBindBuffer(GL_ARRAY_BUFFER, bufferID);
+
+    // glVertexAttribIPointer keeps the values integers (uint to uvec4 in GLSL)
+    glVertexAttribIPointer(location, componentCount, GL_UNSIGNED_INT, componentCount * sizeof(uint32_t), (void *)0);
+    glEnableVertexAttribArray(location);
+
+    // Advance once per instance instead of once per vertex
+    glVertexAttribDivisor(location, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include <glad/glad.h>
+#include <cstdint>
 #include <cstdlib>
+#include <iterator>
+#include <type_traits>
 #include "VertexFormats.h"
 
 // The VertexBuffer class takes in all the vertex and index information
@@ -10,18 +13,21 @@
 class VertexBuffer
 {
 public:
-    //   Constructor of VertexBuffer:
-    // - 2 const void* for the actual vertex/index data
-    // - 2 size_t for the size in bytes of the vertex/index arrays
-    // - 2 size_t for the number of vertices and indices
-    // - enum class Vertex for the format of the vertex
-    VertexBuffer(const void *vertices, const void *indices, size_t vertexSize, size_t indexSize, size_t vertexCount, size_t indexCount, Vertex vertexFormat);
-    ~VertexBuffer();
+    //   Constructor of VertexBuffer. The attribute pointers are set from the
+    //   VertexLayout of the vertex type, which is resolved at compile time:
+    // - const TVertex* for the vertex data
+    // - size_t for the number of vertices
+    // - const TIndex* for the index data (uint32_t or uint16_t), nullptr to draw without indices
+    // - size_t for the number of indices
+    template <class TVertex, class TIndex = uint32_t>
+    VertexBuffer(const TVertex *vertices, size_t vertexCount, const TIndex *indices = nullptr, size_t indexCount = 0)
+        : VertexBuffer(vertices, vertexCount * sizeof(TVertex), vertexCount, indices, indexCount * sizeof(TIndex), indexCount, IndexType<TIndex>())
+    {
+        static_assert(std::is_same_v<TIndex, uint32_t> || std::is_same_v<TIndex, uint16_t>, "Indices must be 32 or 16 bit");
 
-    //   SetVertexAttributePointers sets all the vertex attributes
-    //   and links the Vertex Attributes with glVertexAttribPointer:
-    // - Takes in an enum class of Vertex that represents the format of the vertex
-    void SetVertexAttributePointers(Vertex format);
+        SetVertexAttributePointers(VertexLayout<TVertex>::attributes, std::size(VertexLayout<TVertex>::attributes), VertexLayout<TVertex>::stride);
+    }
+    ~VertexBuffer();
 
     // Bind the Vertex Array Object using glBindVertexArray with mVaoID as its parameter
     void SetActive() { glBindVertexArray(mVaoID); }
@@ -29,10 +35,48 @@ public:
     // Getter for the Vertex Array's ID
     unsigned int GetID() const { return mVaoID; }
 
+    // Getter for the type of the indices, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+    GLenum GetIndexType() const { return mIndexType; }
+
+    // Getter for the number of indices
+    size_t GetIndexCount() const { return mIndexCount; }
+
     // Sets the VAO as active, and draws based on if it is drawn with indices or not
     void Draw();
 
+    //   Sets the VAO as active and draws a range of the indices, such as one level of detail:
+    // - size_t for the first index
+    // - size_t for the number of indices
+    void Draw(size_t firstIndex, size_t indexCount);
+
+    //   SetInstanceAttribute adds an unsigned integer attribute that advances once per instance,
+    //   such as the instance's index or its texture layers. Indirect draws offset it by their
+    //   baseInstance, which lets a shader look up the instance a command was written for:
+    // - unsigned int for the ID of a buffer of uint32_t
+    // - unsigned int for the attribute's location, after the vertex attributes
+    // - int for the number of uint32_t per instance (1 to 4, uint to uvec4 in GLSL)
+    void SetInstanceAttribute(unsigned int bufferID, unsigned int location, int componentCount = 1);
+
 private:
+    //   Creates the Vertex Array Object and uploads the vertex/index buffers:
+    // - const void* for the vertex data
+    // - 2 size_t for the size in bytes and the number of vertices
+    // - const void* for the index data
+    // - 2 size_t for the size in bytes and the number of indices
+    // - GLenum for the type of the indices, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+    VertexBuffer(const void *vertices, size_t vertexSize, size_t vertexCount, const void *indices, size_t indexSize, size_t indexCount, GLenum indexType);
+
+    //   SetVertexAttributePointers sets all the vertex attributes
+    //   and links the Vertex Attributes with glVertexAttribPointer:
+    // - const VertexAttribute* for the attributes in the order of their shader locations
+    // - size_t for the number of attributes
+    // - size_t for the size of a vertex in bytes
+    void SetVertexAttributePointers(const VertexAttribute *attributes, size_t attributeCount, size_t stride);
+
+    // Returns the GL type of an index type
+    template <class TIndex>
+    static constexpr GLenum IndexType() { return std::is_same_v<TIndex, uint16_t> ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
     // ID for the Vertex Array Object
     unsigned int mVaoID;
 
@@ -46,6 +90,9 @@ private:
 
     size_t mIndexCount;
 
+    // Type of the indices (GL_UNSIGNED_INT or GL_UNSIGNED_SHORT)
+    GLenum mIndexType;
+
     // bool for if the VA draws w/ indices
     bool mDrawIndexed;
 };
\ No newline at end of file
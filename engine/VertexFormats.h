@@ -1,51 +1,139 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
 #include <glm/glm.hpp>
-#include <vector>
+#include <glm/gtc/packing.hpp>
 
-// Enum to store different vertex layouts
-enum class Vertex
+// Class to define a color with 4 channels
+class Color4
 {
-    VertexColor,
-    VertexTexture,
-    VertexColoredTexture,
+public:
+    Color4()
+        : r(0), g(0), b(0), a(0)
+    {
+    }
+    Color4(float _r, float _g, float _b, float _a = 1.0f)
+        : r(_r), g(_g), b(_b), a(_a)
+    {
+    }
+    float r, g, b, a;
 };
 
-// GetVertexFormat statically returns the stride or spacing between each attribute of the vertex.
-// It returns a vector of ints that represents the number of values between each attribute
-static std::vector<int> GetVertexFormat(Vertex vertex)
+// Position stored as 3 half floats, padded to 8 bytes to keep the next attribute 4 byte aligned.
+// Half floats keep about 3 significant digits, which is enough for model space positions
+class HalfPosition
 {
-    std::vector<int> format;
-    switch (vertex)
+public:
+    HalfPosition()
+        : x(0), y(0), z(0), pad(0)
     {
-    case Vertex::VertexColor:
-        format.emplace_back(3);
-        format.emplace_back(4);
-        break;
-    case Vertex::VertexTexture:
-        format.emplace_back(3);
-        format.emplace_back(2);
-        break;
-    case Vertex::VertexColoredTexture:
-        format.emplace_back(3);
-        format.emplace_back(4);
-        format.emplace_back(2);
     }
-    return format;
-}
+    HalfPosition(const glm::vec3 &pos)
+        : x(glm::packHalf1x16(pos.x)), y(glm::packHalf1x16(pos.y)), z(glm::packHalf1x16(pos.z)), pad(0)
+    {
+    }
+    uint16_t x, y, z, pad;
+};
 
-// Class to define a color with 4 channels
-class Color4
+// Texture coordinate stored as 2 normalized unsigned shorts. Only covers uvs in [0, 1]
+class UNormUV
 {
 public:
-    Color4()
+    UNormUV()
+        : u(0), v(0)
+    {
+    }
+    UNormUV(const glm::vec2 &uv)
+        : u(static_cast<uint16_t>(glm::round(glm::clamp(uv.x, 0.0f, 1.0f) * 65535.0f))),
+          v(static_cast<uint16_t>(glm::round(glm::clamp(uv.y, 0.0f, 1.0f) * 65535.0f)))
+    {
+    }
+    uint16_t u, v;
+};
+
+// Normal or tangent stored as signed normalized GL_INT_2_10_10_10_REV.
+// The 2-bit w can hold a tangent's bitangent sign
+class PackedNormal
+{
+public:
+    PackedNormal()
+        : value(0)
+    {
+    }
+    PackedNormal(const glm::vec3 &normal, float w = 0.0f)
+        : value(glm::packSnorm3x10_1x2(glm::vec4(normal, w)))
+    {
+    }
+    uint32_t value;
+};
+
+// Color stored as 4 normalized unsigned bytes
+class ColorRGBA8
+{
+public:
+    ColorRGBA8()
         : r(0), g(0), b(0), a(0)
     {
     }
-    Color4(float _r, float _g, float _b, float _a = 1.0f)
-        : r(_r), g(_g), b(_b), a(_a)
+    ColorRGBA8(const Color4 &color)
+        : r(ToByte(color.r)), g(ToByte(color.g)), b(ToByte(color.b)), a(ToByte(color.a))
     {
     }
-    float r, g, b, a;
+    uint8_t r, g, b, a;
+
+private:
+    static uint8_t ToByte(float value) { return static_cast<uint8_t>(glm::round(glm::clamp(value, 0.0f, 1.0f) * 255.0f)); }
+};
+
+// Indices of the 4 bones that move a skinned vertex, stored as unsigned bytes. They are read
+// without normalizing, so the shader gets them as floats that hold the exact index
+class BoneIndices
+{
+public:
+    BoneIndices()
+        : a(0), b(0), c(0), d(0)
+    {
+    }
+    BoneIndices(uint8_t _a, uint8_t _b = 0, uint8_t _c = 0, uint8_t _d = 0)
+        : a(_a), b(_b), c(_c), d(_d)
+    {
+    }
+    uint8_t a, b, c, d;
+};
+
+// Weights of the 4 bones of a skinned vertex stored as normalized unsigned bytes. The rounding
+// error of the weights is given to the largest, so they still sum up to exactly 1.
+// Negative weights count as 0, and weights that don't add up to a positive sum bind the vertex to its first bone
+class BoneWeights
+{
+public:
+    BoneWeights()
+        : a(255), b(0), c(0), d(0)
+    {
+    }
+    BoneWeights(const glm::vec4 &weights)
+        : BoneWeights()
+    {
+        glm::vec4 positive = glm::max(weights, glm::vec4(0.0f));
+        float total = positive.x + positive.y + positive.z + positive.w;
+        if (!(total > 0.0f) || glm::isinf(total))
+        {
+            return;
+        }
+        glm::vec4 normalized = positive / total;
+        int bytes[4];
+        int sum = 0, largest = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            bytes[i] = static_cast<int>(glm::round(glm::clamp(normalized[i], 0.0f, 1.0f) * 255.0f));
+            sum += bytes[i];
+            largest = bytes[i] > bytes[largest] ? i : largest;
+        }
+        bytes[largest] += 255 - sum;
+        a = static_cast<uint8_t>(bytes[0]), b = static_cast<uint8_t>(bytes[1]), c = static_cast<uint8_t>(bytes[2]), d = static_cast<uint8_t>(bytes[3]);
+    }
+    uint8_t a, b, c, d;
 };
 
 struct VertexColor
@@ -66,3 +154,204 @@ struct VertexColoredTexture
     Color4 color;
     glm::vec2 uv;
 };
+
+struct VertexNormalTexture
+{
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// 12 bytes instead of 28
+struct VertexPackedColor
+{
+    HalfPosition pos;
+    ColorRGBA8 color;
+};
+
+// 12 bytes instead of 20
+struct VertexPackedTexture
+{
+    HalfPosition pos;
+    UNormUV uv;
+};
+
+// 16 bytes instead of 36
+struct VertexPackedColoredTexture
+{
+    HalfPosition pos;
+    ColorRGBA8 color;
+    UNormUV uv;
+};
+
+// 16 bytes instead of 32
+struct VertexPackedNormalTexture
+{
+    HalfPosition pos;
+    PackedNormal normal;
+    UNormUV uv;
+};
+
+// Vertex of a skinned mesh, moved by up to 4 bones of its Skeleton
+struct VertexSkinnedTexture
+{
+    glm::vec3 pos;
+    glm::vec2 uv;
+    BoneIndices bones;
+    BoneWeights weights;
+};
+
+// Describes a single attribute of a vertex for glVertexAttribPointer
+struct VertexAttribute
+{
+    // Number of components
+    int count;
+    // Type of each component (GL_FLOAT, GL_HALF_FLOAT, ...)
+    GLenum type;
+    // Whether integer components are normalized to [0, 1] or [-1, 1]
+    GLboolean normalized;
+    // Offset in bytes from the start of the vertex
+    size_t offset;
+    // Size in bytes of the member holding the attribute
+    size_t size;
+};
+
+// AttributeFormat maps the type of a vertex member to how OpenGL reads it.
+// Every type used in a vertex struct needs a specialization
+template <class T>
+struct AttributeFormat;
+
+template <>
+struct AttributeFormat<glm::vec2>
+{
+    static constexpr int count = 2;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <>
+struct AttributeFormat<glm::vec3>
+{
+    static constexpr int count = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <>
+struct AttributeFormat<Color4>
+{
+    static constexpr int count = 4;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <>
+struct AttributeFormat<HalfPosition>
+{
+    static constexpr int count = 3;
+    static constexpr GLenum type = GL_HALF_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <>
+struct AttributeFormat<UNormUV>
+{
+    static constexpr int count = 2;
+    static constexpr GLenum type = GL_UNSIGNED_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+};
+
+template <>
+struct AttributeFormat<PackedNormal>
+{
+    // Packed 2_10_10_10 attributes always have 4 components
+    static constexpr int count = 4;
+    static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+    static constexpr GLboolean normalized = GL_TRUE;
+};
+
+template <>
+struct AttributeFormat<ColorRGBA8>
+{
+    static constexpr int count = 4;
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+    static constexpr GLboolean normalized = GL_TRUE;
+};
+
+template <>
+struct AttributeFormat<BoneIndices>
+{
+    static constexpr int count = 4;
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <>
+struct AttributeFormat<BoneWeights>
+{
+    static constexpr int count = 4;
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+    static constexpr GLboolean normalized = GL_TRUE;
+};
+
+//   MakeVertexAttribute builds the attribute of a vertex member at compile time:
+// - size_t for the offset of the member in the vertex
+template <class TMember>
+constexpr VertexAttribute MakeVertexAttribute(size_t offset)
+{
+    return {AttributeFormat<TMember>::count, AttributeFormat<TMember>::type, AttributeFormat<TMember>::normalized, offset, sizeof(TMember)};
+}
+
+// Builds the VertexAttribute of a member of a vertex struct
+#define VERTEX_ATTRIBUTE(TVertex, member) MakeVertexAttribute<decltype(TVertex::member)>(offsetof(TVertex, member))
+
+// VertexLayout describes the attributes of a vertex struct in the order of their shader locations.
+// Each vertex struct specializes it with a constexpr array of attributes, and VertexBuffer reads
+// it at compile time, so no layout is built or looked up at runtime
+template <class TVertex>
+struct VertexLayout;
+
+//   Returns true if the attributes cover every byte of the vertex in member order,
+//   which catches a layout that is missing a member or lists them out of order:
+// - const VertexAttribute (&)[N] for the attributes
+// - size_t for the size of the vertex
+template <size_t N>
+constexpr bool IsTightLayout(const VertexAttribute (&attributes)[N], size_t vertexSize)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (attributes[i].offset != offset)
+        {
+            return false;
+        }
+        offset += attributes[i].size;
+    }
+    return offset == vertexSize;
+}
+
+// Declares the VertexLayout of a vertex struct and checks it against the struct at compile time
+#define VERTEX_LAYOUT(TVertex, ...)                                                                     \
+    template <>                                                                                         \
+    struct VertexLayout<TVertex>                                                                        \
+    {                                                                                                   \
+        static constexpr VertexAttribute attributes[] = {__VA_ARGS__};                                  \
+        static constexpr size_t stride = sizeof(TVertex);                                               \
+    };                                                                                                  \
+    static_assert(IsTightLayout(VertexLayout<TVertex>::attributes, sizeof(TVertex)),                    \
+                  "The VertexLayout of " #TVertex " does not match its members")
+
+VERTEX_LAYOUT(VertexColor, VERTEX_ATTRIBUTE(VertexColor, pos), VERTEX_ATTRIBUTE(VertexColor, color));
+VERTEX_LAYOUT(VertexTexture, VERTEX_ATTRIBUTE(VertexTexture, pos), VERTEX_ATTRIBUTE(VertexTexture, uv));
+VERTEX_LAYOUT(VertexColoredTexture, VERTEX_ATTRIBUTE(VertexColoredTexture, pos), VERTEX_ATTRIBUTE(VertexColoredTexture, color),
+              VERTEX_ATTRIBUTE(VertexColoredTexture, uv));
+VERTEX_LAYOUT(VertexNormalTexture, VERTEX_ATTRIBUTE(VertexNormalTexture, pos), VERTEX_ATTRIBUTE(VertexNormalTexture, normal),
+              VERTEX_ATTRIBUTE(VertexNormalTexture, uv));
+VERTEX_LAYOUT(VertexPackedColor, VERTEX_ATTRIBUTE(VertexPackedColor, pos), VERTEX_ATTRIBUTE(VertexPackedColor, color));
+VERTEX_LAYOUT(VertexPackedTexture, VERTEX_ATTRIBUTE(VertexPackedTexture, pos), VERTEX_ATTRIBUTE(VertexPackedTexture, uv));
+VERTEX_LAYOUT(VertexPackedColoredTexture, VERTEX_ATTRIBUTE(VertexPackedColoredTexture, pos), VERTEX_ATTRIBUTE(VertexPackedColoredTexture, color),
+              VERTEX_ATTRIBUTE(VertexPackedColoredTexture, uv));
+VERTEX_LAYOUT(VertexPackedNormalTexture, VERTEX_ATTRIBUTE(VertexPackedNormalTexture, pos), VERTEX_ATTRIBUTE(VertexPackedNormalTexture, normal),
+              VERTEX_ATTRIBUTE(VertexPackedNormalTexture, uv));
+VERTEX_LAYOUT(VertexSkinnedTexture, VERTEX_ATTRIBUTE(VertexSkinnedTexture, pos), VERTEX_ATTRIBUTE(VertexSkinnedTexture, uv), VERTEX_ATTRIBUTE(VertexSkinnedTexture, bones),
+              VERTEX_ATTRIBUTE(VertexSkinnedTexture, weights));
@@ -0,0 +1,475 @@
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "JobSystem.h"
+#include "PageFile.h"
+#include "Shader.h"
+
+// The feedback is drawn at 1/sFeedbackScale of the viewport's width and height
+static const int sFeedbackScale = 8;
+
+// Readbacks in flight, the feedback of a frame is read sFeedbackBufferCount - 1 frames later at most
+static const size_t sFeedbackBufferCount = 3;
+
+// Most page reads on the workers at once and most pages copied into the cache per frame
+static const int sMaxPendingLoads = 16;
+static const size_t sMaxUploadsPerFrame = 8;
+
+// Set on every page id the feedback writes, so cleared texels are told apart from page 0
+static const uint32_t sFeedbackValid = 0x80000000u;
+
+VirtualTexture::VirtualTexture(const std::string &pageFile, int cacheTiles)
+    : mPageFile(new PageFile(pageFile)), mCacheTiles(std::clamp(cacheTiles, 1, 255)), mCacheTextureID(0), mIndirectionTextureID(0), mPendingLoads(0),
+      mIndirectionDirty(false), mFrame(1), mFeedbackFrame(0), mFeedbackFramebufferID(0), mFeedbackTextureID(0), mFeedbackDepthID(0),
+      mFeedbackWidth(0), mFeedbackHeight(0), mReadbackIndex(0), mPreviousFramebuffer(0), mPreviousViewport{0, 0, 0, 0}
+{
+    if (!mPageFile->IsOpen())
+    {
+        return;
+    }
+
+    // Page cache, filtered inside a tile only, the borders make the edges of the pages seamless
+    int cacheSize = mCacheTiles * mPageFile->GetTileSize();
+    glGenTextures(1, &mCacheTextureID);
+    glBindTexture(GL_TEXTURE_2D, mCacheTextureID);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, cacheSize, cacheSize);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Indirection texture, level n has a texel per page of the virtual texture's level n.
+    // Integer textures can't be filtered, they would be incomplete with linear filters
+    int pageCount = mPageFile->GetPageCount(0);
+    glGenTextures(1, &mIndirectionTextureID);
+    glBindTexture(GL_TEXTURE_2D, mIndirectionTextureID);
+    glTexStorage2D(GL_TEXTURE_2D, mPageFile->GetLevelCount(), GL_RGBA8UI, pageCount, pageCount);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    int totalPages = mPageFile->GetTotalPageCount();
+    mSlots.resize(static_cast<size_t>(mCacheTiles) * mCacheTiles);
+    mPageSlots.assign(totalPages, -1);
+    mPageLoading.assign(totalPages, 0);
+    mPageLevels.resize(totalPages);
+    for (int level = 0; level < mPageFile->GetLevelCount(); ++level)
+    {
+        int levelPages = mPageFile->GetPageCount(level);
+        std::fill_n(mPageLevels.begin() + mPageFile->GetPageIndex(level, 0, 0), levelPages * levelPages, static_cast<uint8_t>(level));
+        mIndirection.emplace_back(static_cast<size_t>(levelPages) * levelPages * 4, 0);
+    }
+
+    mReadbackBufferIDs.resize(sFeedbackBufferCount);
+    glGenBuffers(static_cast<int>(sFeedbackBufferCount), mReadbackBufferIDs.data());
+    mReadbackFences.assign(sFeedbackBufferCount, nullptr);
+    mReadbackFrames.assign(sFeedbackBufferCount, 0);
+
+    // The coarsest page covers the whole texture and stays in the first tile
+    int coarsest = totalPages - 1;
+    const unsigned char *texels = mPageFile->GetPage(coarsest);
+    size_t tileBytes = static_cast<size_t>(mPageFile->GetTileSize()) * mPageFile->GetTileSize() * 4;
+    Upload({coarsest, std::vector<unsigned char>(texels, texels + tileBytes)});
+    UpdateIndirection();
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    std::cout << "Delete virtual texture" << std::endl;
+
+    // Workers still reading pages write into this object, help them finish first
+    while (mPendingLoads > 0)
+    {
+        if (!JobSystem::Get() || !JobSystem::Get()->RunPendingJob())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto fence : mReadbackFences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    if (!mReadbackBufferIDs.empty())
+    {
+        glDeleteBuffers(static_cast<int>(mReadbackBufferIDs.size()), mReadbackBufferIDs.data());
+    }
+    glDeleteFramebuffers(1, &mFeedbackFramebufferID);
+    glDeleteTextures(1, &mFeedbackTextureID);
+    glDeleteRenderbuffers(1, &mFeedbackDepthID);
+    glDeleteTextures(1, &mCacheTextureID);
+    glDeleteTextures(1, &mIndirectionTextureID);
+    delete mPageFile;
+}
+
+bool VirtualTexture::IsValid() const
+{
+    return mPageFile->IsOpen();
+}
+
+void VirtualTexture::Update()
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    ReadFeedback();
+
+    // Read the missing pages, coarsest first so the fallback of a page sharpens one level at a time.
+    // Pages left over are requested again by the next feedback if they are still seen
+    size_t tileBytes = static_cast<size_t>(mPageFile->GetTileSize()) * mPageFile->GetTileSize() * 4;
+    for (auto page : mRequests)
+    {
+        if (mPendingLoads >= sMaxPendingLoads)
+        {
+            break;
+        }
+        if (mPageSlots[page] >= 0 || mPageLoading[page])
+        {
+            continue;
+        }
+        mPageLoading[page] = 1;
+        ++mPendingLoads;
+
+        // Copying the page out of the mapping is what reads it from the disk
+        auto load = [this, page, tileBytes]()
+        {
+            const unsigned char *texels = mPageFile->GetPage(page);
+            LoadedPage loaded = {page, std::vector<unsigned char>(texels, texels + tileBytes)};
+            {
+                std::lock_guard<std::mutex> lock(mLoadedMutex);
+                mLoadedPages.emplace_back(std::move(loaded));
+            }
+            --mPendingLoads;
+        };
+        if (JobSystem::Get())
+        {
+            JobSystem::Get()->Schedule(load);
+        }
+        else
+        {
+            load();
+        }
+    }
+    mRequests.clear();
+
+    // Copy a few of the loaded pages into the cache, the others wait for the next frames
+    std::vector<LoadedPage> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mLoadedMutex);
+        size_t count = std::min(mLoadedPages.size(), sMaxUploadsPerFrame);
+        loaded.assign(std::make_move_iterator(mLoadedPages.begin()), std::make_move_iterator(mLoadedPages.begin() + count));
+        mLoadedPages.erase(mLoadedPages.begin(), mLoadedPages.begin() + count);
+    }
+    for (auto &l : loaded)
+    {
+        // Pages that find no tile are dropped, the feedback asks for them again
+        mPageLoading[l.page] = 0;
+        Upload(l);
+    }
+
+    if (mIndirectionDirty)
+    {
+        UpdateIndirection();
+    }
+    ++mFrame;
+}
+
+void VirtualTexture::Touch(int level, int x, int y)
+{
+    int page = mPageFile->GetPageIndex(level, x, y);
+    if (mPageSlots[page] >= 0)
+    {
+        mSlots[mPageSlots[page]].lastUsed = mFeedbackFrame;
+    }
+    else
+    {
+        mRequests.push_back(page);
+    }
+
+    // The parents are drawn in place of the page until it is loaded, and they are the fallback if it is evicted
+    for (int parent = level + 1; parent < mPageFile->GetLevelCount(); ++parent)
+    {
+        x /= 2;
+        y /= 2;
+        int parentPage = mPageFile->GetPageIndex(parent, x, y);
+        if (mPageSlots[parentPage] >= 0)
+        {
+            mSlots[mPageSlots[parentPage]].lastUsed = mFeedbackFrame;
+        }
+    }
+}
+
+void VirtualTexture::ReadFeedback()
+{
+    // The oldest readback is the next one to be written, read them in order until one isn't done
+    bool read = false;
+    for (size_t i = 0; i < sFeedbackBufferCount; ++i)
+    {
+        size_t index = (mReadbackIndex + i) % sFeedbackBufferCount;
+        GLsync fence = mReadbackFences[index];
+        if (!fence)
+        {
+            continue;
+        }
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+        glDeleteSync(fence);
+        mReadbackFences[index] = nullptr;
+
+        size_t count = static_cast<size_t>(mFeedbackWidth) * mFeedbackHeight;
+        std::vector<uint32_t> ids(count);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBufferIDs[index]);
+        if (const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * sizeof(uint32_t), GL_MAP_READ_BIT))
+        {
+            std::copy_n(static_cast<const uint32_t *>(pixels), count, ids.data());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // Most pixels of a page have the same id, touch every page once
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        mFeedbackFrame = mReadbackFrames[index];
+        mRequests.clear();
+        for (auto id : ids)
+        {
+            if (!(id & sFeedbackValid))
+            {
+                continue;
+            }
+            int level = static_cast<int>((id >> 24) & 0x7Fu);
+            int y = static_cast<int>((id >> 12) & 0xFFFu);
+            int x = static_cast<int>(id & 0xFFFu);
+            if (level < mPageFile->GetLevelCount() && x < mPageFile->GetPageCount(level) && y < mPageFile->GetPageCount(level))
+            {
+                Touch(level, x, y);
+            }
+        }
+        read = true;
+    }
+
+    if (read)
+    {
+        std::sort(mRequests.begin(), mRequests.end(), [this](int a, int b)
+                  { return mPageLevels[a] != mPageLevels[b] ? mPageLevels[a] > mPageLevels[b] : a < b; });
+        mRequests.erase(std::unique(mRequests.begin(), mRequests.end()), mRequests.end());
+    }
+}
+
+bool VirtualTexture::Upload(const LoadedPage &loaded)
+{
+    // Take a free tile, or the least recently seen one that the last feedback didn't see.
+    // The coarsest page is never evicted, every page falls back to it
+    int coarsest = mPageFile->GetTotalPageCount() - 1;
+    int slot = -1;
+    for (size_t i = 0; i < mSlots.size(); ++i)
+    {
+        const CacheSlot &s = mSlots[i];
+        if (s.page < 0)
+        {
+            slot = static_cast<int>(i);
+            break;
+        }
+        if (s.page != coarsest && s.lastUsed < mFeedbackFrame && (slot < 0 || s.lastUsed < mSlots[slot].lastUsed))
+        {
+            slot = static_cast<int>(i);
+        }
+    }
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    CacheSlot &s = mSlots[slot];
+    if (s.page >= 0)
+    {
+        mPageSlots[s.page] = -1;
+    }
+    s.page = loaded.page;
+    s.lastUsed = mFeedbackFrame;
+    mPageSlots[loaded.page] = slot;
+
+    int tileSize = mPageFile->GetTileSize();
+    glBindTexture(GL_TEXTURE_2D, mCacheTextureID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % mCacheTiles) * tileSize, (slot / mCacheTiles) * tileSize, tileSize, tileSize, GL_RGBA, GL_UNSIGNED_BYTE, loaded.texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mIndirectionDirty = true;
+    return true;
+}
+
+void VirtualTexture::UpdateIndirection()
+{
+    glBindTexture(GL_TEXTURE_2D, mIndirectionTextureID);
+
+    // Coarsest level first, so a missing page copies the entry its parent already resolved
+    for (int level = mPageFile->GetLevelCount() - 1; level >= 0; --level)
+    {
+        int levelPages = mPageFile->GetPageCount(level);
+        std::vector<uint8_t> &texels = mIndirection[level];
+        for (int y = 0; y < levelPages; ++y)
+        {
+            for (int x = 0; x < levelPages; ++x)
+            {
+                uint8_t *texel = texels.data() + (static_cast<size_t>(y) * levelPages + x) * 4;
+                int slot = mPageSlots[mPageFile->GetPageIndex(level, x, y)];
+                if (slot >= 0)
+                {
+                    texel[0] = static_cast<uint8_t>(slot % mCacheTiles);
+                    texel[1] = static_cast<uint8_t>(slot / mCacheTiles);
+                    texel[2] = static_cast<uint8_t>(level);
+                    texel[3] = 255;
+                }
+                else
+                {
+                    int parentPages = mPageFile->GetPageCount(level + 1);
+                    const uint8_t *parent = mIndirection[level + 1].data() + (static_cast<size_t>(y / 2) * parentPages + x / 2) * 4;
+                    std::copy_n(parent, 4, texel);
+                }
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelPages, levelPages, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, texels.data());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mIndirectionDirty = false;
+}
+
+void VirtualTexture::SetUniforms(Shader *shader, float lodBias)
+{
+    shader->SetFloat("virtualSize"_id, static_cast<float>(mPageFile->GetSize()));
+    shader->SetInt("pageCount"_id, mPageFile->GetPageCount(0));
+    shader->SetInt("levelCount"_id, mPageFile->GetLevelCount());
+    shader->SetFloat("lodBias"_id, lodBias);
+}
+
+void VirtualTexture::Bind(Shader *shader, int unit)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, mCacheTextureID);
+    glActiveTexture(GL_TEXTURE0 + unit + 1);
+    glBindTexture(GL_TEXTURE_2D, mIndirectionTextureID);
+
+    shader->SetInt("pageCache"_id, unit);
+    shader->SetInt("pageTable"_id, unit + 1);
+    shader->SetInt("pageSize"_id, mPageFile->GetPageSize());
+    shader->SetInt("pageBorder"_id, mPageFile->GetBorder());
+    shader->SetFloat("cacheSize"_id, static_cast<float>(mCacheTiles * mPageFile->GetTileSize()));
+    SetUniforms(shader, 0.0f);
+}
+
+bool VirtualTexture::BeginFeedback(Shader *shader)
+{
+    // Skip the feedback while every buffer is still waiting for the GPU
+    if (!IsValid() || mReadbackFences[mReadbackIndex])
+    {
+        return false;
+    }
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mPreviousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, mPreviousViewport);
+    int width = std::max(mPreviousViewport[2] / sFeedbackScale, 1);
+    int height = std::max(mPreviousViewport[3] / sFeedbackScale, 1);
+
+    // Recreate the attachments and readback buffers for a new size, readbacks of the old size are dropped
+    if (width != mFeedbackWidth || height != mFeedbackHeight)
+    {
+        mFeedbackWidth = width;
+        mFeedbackHeight = height;
+        for (size_t i = 0; i < sFeedbackBufferCount; ++i)
+        {
+            if (mReadbackFences[i])
+            {
+                glDeleteSync(mReadbackFences[i]);
+                mReadbackFences[i] = nullptr;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBufferIDs[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<size_t>(width) * height * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glDeleteFramebuffers(1, &mFeedbackFramebufferID);
+        glDeleteTextures(1, &mFeedbackTextureID);
+        glDeleteRenderbuffers(1, &mFeedbackDepthID);
+
+        glGenTextures(1, &mFeedbackTextureID);
+        glBindTexture(GL_TEXTURE_2D, mFeedbackTextureID);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenRenderbuffers(1, &mFeedbackDepthID);
+        glBindRenderbuffer(GL_RENDERBUFFER, mFeedbackDepthID);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &mFeedbackFramebufferID);
+        glBindFramebuffer(GL_FRAMEBUFFER, mFeedbackFramebufferID);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mFeedbackTextureID, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mFeedbackDepthID);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "Virtual texture feedback framebuffer is incomplete" << std::endl;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mFeedbackFramebufferID);
+    glViewport(0, 0, width, height);
+    const GLuint clearId[4] = {0, 0, 0, 0};
+    const GLfloat clearDepth = 1.0f;
+    glClearBufferuiv(GL_COLOR, 0, clearId);
+    glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+    // A feedback pixel covers sFeedbackScale pixels along each side, so its derivatives are that much larger
+    SetUniforms(shader, -std::log2(static_cast<float>(sFeedbackScale)));
+    return true;
+}
+
+void VirtualTexture::EndFeedback()
+{
+    // Copy into the next buffer without waiting, the fence tells ReadFeedback when the copy is done
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBufferIDs[mReadbackIndex]);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, mFeedbackWidth, mFeedbackHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    mReadbackFences[mReadbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mReadbackFrames[mReadbackIndex] = mFrame;
+    mReadbackIndex = (mReadbackIndex + 1) % sFeedbackBufferCount;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mPreviousFramebuffer);
+    glViewport(mPreviousViewport[0], mPreviousViewport[1], mPreviousViewport[2], mPreviousViewport[3]);
+}
+
+size_t VirtualTexture::GetResidentPageCount() const
+{
+    size_t count = 0;
+    for (auto &s : mSlots)
+    {
+        count += s.page >= 0 ? 1 : 0;
+    }
+    return count;
+}
+
+size_t VirtualTexture::GetCacheBytes() const
+{
+    if (!mPageFile->IsOpen())
+    {
+        return 0;
+    }
+    size_t cacheSize = static_cast<size_t>(mCacheTiles) * mPageFile->GetTileSize();
+    return cacheSize * cacheSize * 4;
+}
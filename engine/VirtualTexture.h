@@ -0,0 +1,142 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class PageFile;
+class Shader;
+
+// VirtualTexture samples a texture far larger than video memory from a PageFile. Only the
+// pages the camera sees are in the page cache, a texture of cacheTiles by cacheTiles pages,
+// and an indirection texture with one texel per page of every level points each page at
+// its tile in the cache, or at the tile of its closest resident parent until it is loaded.
+// Which pages are seen comes from a feedback pass: the objects are drawn at a fraction of
+// the resolution into a texture of page ids that is read back without stalling, a few
+// frames later. Missing pages are read on the JobSystem's workers and copied into the
+// least recently seen tiles, so the memory used stays the same however large the texture is.
+// Objects draw with shaders/virtualTextureFS.glsl and their feedback with shaders/virtualFeedbackFS.glsl.
+class VirtualTexture
+{
+public:
+    //   VirtualTexture constructor, loads the coarsest page that every other page falls back to:
+    // - const std::string& for the file path of the page file
+    // - int for the number of tiles along each side of the page cache
+    VirtualTexture(const std::string &pageFile, int cacheTiles = 8);
+    ~VirtualTexture();
+
+    // Returns true if the page file was opened
+    bool IsValid() const;
+
+    // Requests the pages of the last feedback that arrived, uploads the pages that finished
+    // loading and updates the indirection texture, called once per frame
+    void Update();
+
+    //   Bind binds the page cache and indirection textures and sets the shader's uniforms:
+    // - Shader* for a shader with the virtual texture's uniforms, already active
+    // - int for the texture unit of the page cache, the indirection texture uses the next one
+    void Bind(Shader *shader, int unit = 0);
+
+    //   BeginFeedback binds the feedback framebuffer at a fraction of the current viewport and sets
+    //   the feedback shader's uniforms. Returns false if every readback buffer is still in flight:
+    // - Shader* for the feedback shader, already active
+    bool BeginFeedback(Shader *shader);
+
+    // EndFeedback starts reading the feedback back and restores the framebuffer and viewport
+    void EndFeedback();
+
+    // Getters for the number of pages in the cache and the video memory of the cache
+    size_t GetResidentPageCount() const;
+    size_t GetCacheBytes() const;
+
+private:
+    // A tile of the page cache
+    struct CacheSlot
+    {
+        // Page in the tile, -1 if it is free
+        int page = -1;
+
+        // Last frame the page was seen in the feedback
+        uint32_t lastUsed = 0;
+    };
+
+    // A page read by a worker, waiting for its upload
+    struct LoadedPage
+    {
+        int page;
+        std::vector<unsigned char> texels;
+    };
+
+    //   Touch marks a page and its resident parents as seen, and requests it if it is not in the cache:
+    // - int for the level, column and row of the page
+    void Touch(int level, int x, int y);
+
+    // Reads the oldest feedback back if the GPU finished writing it
+    void ReadFeedback();
+
+    //   Upload copies a loaded page into the least recently seen tile. Returns false if every tile is in use:
+    // - const LoadedPage& for the page
+    bool Upload(const LoadedPage &loaded);
+
+    // Points every page at its own tile or the tile of its closest resident parent
+    void UpdateIndirection();
+
+    //   SetUniforms sets the uniforms both shaders use to pick the level of a pixel:
+    // - Shader* for the active shader
+    // - float added to the level, negative to pick finer levels
+    void SetUniforms(Shader *shader, float lodBias);
+
+    PageFile *mPageFile;
+
+    int mCacheTiles;
+
+    // Texture of cache tiles and the indirection texture with one level per page level
+    unsigned int mCacheTextureID;
+    unsigned int mIndirectionTextureID;
+
+    std::vector<CacheSlot> mSlots;
+
+    // Tile of every page, -1 if the page is not in the cache
+    std::vector<int> mPageSlots;
+
+    // Level of every page, and whether a worker is reading it
+    std::vector<uint8_t> mPageLevels;
+    std::vector<uint8_t> mPageLoading;
+
+    // Missing pages seen in the last feedback, coarsest first
+    std::vector<int> mRequests;
+
+    // Pages read by the workers, guarded by mLoadedMutex
+    std::vector<LoadedPage> mLoadedPages;
+    std::mutex mLoadedMutex;
+
+    // Number of page reads on the workers
+    std::atomic<int> mPendingLoads;
+
+    // Indirection texels of every level, uploaded when a page moved
+    std::vector<std::vector<uint8_t>> mIndirection;
+    bool mIndirectionDirty;
+
+    // Counts the frames, and the frame of the feedback that was read last
+    uint32_t mFrame;
+    uint32_t mFeedbackFrame;
+
+    // Feedback framebuffer and its page id and depth attachments
+    unsigned int mFeedbackFramebufferID;
+    unsigned int mFeedbackTextureID;
+    unsigned int mFeedbackDepthID;
+    int mFeedbackWidth;
+    int mFeedbackHeight;
+
+    // Ring of pixel buffers the feedback is read into, and the fences that tell when they are written
+    std::vector<unsigned int> mReadbackBufferIDs;
+    std::vector<GLsync> mReadbackFences;
+    std::vector<uint32_t> mReadbackFrames;
+    size_t mReadbackIndex;
+
+    // Framebuffer and viewport restored by EndFeedback
+    int mPreviousFramebuffer;
+    int mPreviousViewport[4];
+};
@@ -0,0 +1,43 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// G-buffer written by the objects' shaders compiled with DEFERRED
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+// Inverse of the view projection the G-buffer was drawn with, to rebuild world positions from depth
+uniform mat4 inverseViewProj;
+
+// Final vector4 pixel color output
+out vec4 fragColor;
+
+#include "lighting.glsl"
+
+// Unfolds a direction stored by EncodeOctahedral in shaders/surface.glsl
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return normalize(normal);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+
+    // Nothing was drawn, the background keeps the clear color
+    if (depth >= 1.0)
+    {
+        discard;
+    }
+
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec4 world = inverseViewProj * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+
+    vec3 albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec3 normal = DecodeOctahedral(texelFetch(gNormal, pixel, 0).xy);
+    fragColor = vec4(LightSurface(albedo, world.xyz / world.w, normal, vec3(gl_FragCoord.xy, depth)), 1.0);
+}
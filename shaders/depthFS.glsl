@@ -0,0 +1,7 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// Depth only passes have no color attachment, the rasterizer writes the depth
+void main()
+{
+}
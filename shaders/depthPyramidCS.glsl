@@ -0,0 +1,33 @@
+// Specify OpenGL 4.3 with core functionality, the first version with compute shaders
+#version 430 core
+
+// One texel of the level per invocation, must match sReduceGroupSize in DepthPyramid.cpp
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Level being written
+layout (r32f, binding = 0) writeonly uniform image2D level;
+
+// Depth copy or the pyramid itself, read at sourceLevel
+uniform sampler2D source;
+uniform int sourceLevel;
+uniform int sourceWidth;
+uniform int sourceHeight;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, imageSize(level))))
+    {
+        return;
+    }
+
+    // Farthest depth of the 2x2 source texels, the last column/row of odd sizes reads its edge twice
+    ivec2 last = ivec2(sourceWidth - 1, sourceHeight - 1);
+    ivec2 base = texel * 2;
+    float d0 = texelFetch(source, min(base, last), sourceLevel).r;
+    float d1 = texelFetch(source, min(base + ivec2(1, 0), last), sourceLevel).r;
+    float d2 = texelFetch(source, min(base + ivec2(0, 1), last), sourceLevel).r;
+    float d3 = texelFetch(source, min(base + ivec2(1, 1), last), sourceLevel).r;
+
+    imageStore(level, texel, vec4(max(max(d0, d1), max(d2, d3))));
+}
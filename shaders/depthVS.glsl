@@ -0,0 +1,20 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// position variable has attribute position 0
+layout (location = 0) in vec3 position;
+
+// Uniforms for model to world
+uniform mat4 model;
+
+// viewProj of the shadow or depth pre-pass being rendered, only the depth is written
+uniform mat4 viewProj;
+
+// Computed exactly like shaders/texturedVS.glsl, so the depth pre-pass matches the shading pass
+invariant gl_Position;
+
+void main()
+{
+    vec4 world = model * vec4(position, 1.0f);
+    gl_Position = viewProj * world;
+}
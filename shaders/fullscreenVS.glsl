@@ -0,0 +1,9 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// A single triangle that covers the screen, drawn with 3 vertices and no vertex buffer
+void main()
+{
+    vec2 corner = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
@@ -0,0 +1,132 @@
+// Specify OpenGL 4.3 with core functionality, the first version with compute shaders
+#version 430 core
+
+// One instance per invocation, must match sCullGroupSize in InstanceCuller.cpp
+layout (local_size_x = 64) in;
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances
+{
+    mat4 models[];
+};
+
+layout (std430, binding = 1) writeonly buffer Commands
+{
+    DrawCommand commands[];
+};
+
+layout (std430, binding = 2) buffer DrawCount
+{
+    uint drawCount;
+};
+
+uniform mat4 viewProj;
+
+// Model space bounding box of the mesh
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+uniform uint instanceCount;
+uniform uint indexCount;
+
+// Farthest depth pyramid of the previous frame (see DepthPyramid.h)
+uniform bool useOcclusion;
+uniform sampler2D depthPyramid;
+uniform mat4 pyramidViewProj;
+uniform int pyramidLevels;
+uniform int screenWidth;
+uniform int screenHeight;
+// Size of level 0, textureSize is not used because the level differs between invocations
+uniform int pyramidWidth;
+uniform int pyramidHeight;
+
+// Returns true if the box is hidden behind the depth of the previous frame
+bool IsOccluded(mat4 model)
+{
+    vec2 rectMin = vec2(1.0);
+    vec2 rectMax = vec2(-1.0);
+    float minDepth = 1.0;
+    for (int c = 0; c < 8; ++c)
+    {
+        vec3 corner = mix(boundsMin, boundsMax, vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+        vec4 clip = pyramidViewProj * model * vec4(corner, 1.0);
+
+        // Boxes crossing the near plane can not be tested
+        if (clip.w <= 0.0 || clip.z < -clip.w)
+        {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        rectMin = min(rectMin, ndc.xy);
+        rectMax = max(rectMax, ndc.xy);
+        minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+    }
+
+    // Off screen last frame, so nothing is known about what hides it
+    if (any(lessThan(rectMax, vec2(-1.0))) || any(greaterThan(rectMin, vec2(1.0))))
+    {
+        return false;
+    }
+
+    // Screen rectangle in pixels
+    vec2 screenSize = vec2(screenWidth, screenHeight);
+    vec2 pixelMin = (clamp(rectMin, -1.0, 1.0) * 0.5 + 0.5) * screenSize;
+    vec2 pixelMax = (clamp(rectMax, -1.0, 1.0) * 0.5 + 0.5) * screenSize;
+
+    // A texel of level n covers 2^(n+1) pixels, pick the level where the rectangle spans at most 2x2 texels
+    float extent = max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y);
+    int level = clamp(int(ceil(log2(max(extent, 1.0) * 0.5))), 0, pyramidLevels - 1);
+    float texelSize = exp2(float(level + 1));
+    ivec2 last = max(ivec2(pyramidWidth, pyramidHeight) >> level, 1) - 1;
+    ivec2 texelMin = min(ivec2(pixelMin / texelSize), last);
+    ivec2 texelMax = min(ivec2(pixelMax / texelSize), last);
+
+    float d0 = texelFetch(depthPyramid, texelMin, level).r;
+    float d1 = texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r;
+    float d2 = texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r;
+    float d3 = texelFetch(depthPyramid, texelMax, level).r;
+
+    return minDepth > max(max(d0, d1), max(d2, d3));
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= instanceCount)
+    {
+        return;
+    }
+    mat4 model = models[index];
+    mat4 modelViewProj = viewProj * model;
+
+    // Outside if every corner is outside of the same frustum plane
+    bvec3 allBelow = bvec3(true), allAbove = bvec3(true);
+    for (int c = 0; c < 8; ++c)
+    {
+        vec3 corner = mix(boundsMin, boundsMax, vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+        vec4 clip = modelViewProj * vec4(corner, 1.0);
+        allBelow = bvec3(allBelow.x && clip.x < -clip.w, allBelow.y && clip.y < -clip.w, allBelow.z && clip.z < -clip.w);
+        allAbove = bvec3(allAbove.x && clip.x > clip.w, allAbove.y && clip.y > clip.w, allAbove.z && clip.z > clip.w);
+    }
+    if (any(allBelow) || any(allAbove))
+    {
+        return;
+    }
+
+    if (useOcclusion && IsOccluded(model))
+    {
+        return;
+    }
+
+    // The command's baseInstance is read back as the instance index by the vertex shader
+    uint slot = atomicAdd(drawCount, 1u);
+    commands[slot] = DrawCommand(indexCount, 1u, 0u, 0, index);
+}
@@ -0,0 +1,26 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// position variable has attribute position 0
+layout (location = 0) in vec3 position;
+
+// Index of the instance, set by the draw's base instance (InstanceCuller::sInstanceIndexLocation)
+layout (location = 2) in uint instanceIndex;
+
+// Model matrices of all instances, written by InstanceCuller
+layout (std430, binding = 0) readonly buffer Instances
+{
+    mat4 models[];
+};
+
+// viewProj of the shadow or depth pre-pass being rendered, only the depth is written
+uniform mat4 viewProj;
+
+// Computed exactly like shaders/instancedVS.glsl, so the depth pre-pass matches the shading pass
+invariant gl_Position;
+
+void main()
+{
+    vec4 world = models[instanceIndex] * vec4(position, 1.0f);
+    gl_Position = viewProj * world;
+}
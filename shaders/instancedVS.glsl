@@ -0,0 +1,56 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// position variable has attribute position 0
+layout (location = 0) in vec3 position;
+
+// texture variable has attribute position 1
+layout (location = 1) in vec2 texCoord;
+
+// Index of the instance, set by the draw command's baseInstance (InstanceCuller::sInstanceIndexLocation)
+layout (location = 2) in uint instanceIndex;
+
+// Texture array layers of the instance, one per sampler, or the slots of its bindless texture handles
+layout (location = 3) in uvec4 instanceTextureLayers;
+
+// Model matrices of all instances, written by InstanceCuller
+layout (std430, binding = 0) readonly buffer Instances
+{
+    mat4 models[];
+};
+
+// viewProj takes both view and projection matrices
+uniform mat4 viewProj;
+
+// View projections of this and the last frame without the sub-pixel jitter, for the motion
+// vectors of the TemporalUpsampler. Instances don't move
+uniform mat4 unjitteredViewProj;
+uniform mat4 previousViewProj;
+
+// Specify a vec2 texture output to the fragment shader
+out vec2 textureCoord;
+
+// World position for the lighting
+out vec3 worldPosition;
+
+// Clip positions of this and the last frame, read by shaders/surface.glsl
+out vec4 currentClip;
+out vec4 previousClip;
+
+// Integer outputs can't be interpolated, every vertex of the instance has the same layers
+flat out uvec4 textureLayers;
+
+// Computed exactly like shaders/instancedDepthVS.glsl, so the depth pre-pass matches the shading pass
+invariant gl_Position;
+
+void main()
+{
+    vec4 world = models[instanceIndex] * vec4(position, 1.0f);
+    gl_Position = viewProj * world;
+    worldPosition = world.xyz;
+    currentClip = unjitteredViewProj * world;
+    previousClip = previousViewProj * world;
+
+    textureCoord = texCoord;
+    textureLayers = instanceTextureLayers;
+}
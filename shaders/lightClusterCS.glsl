@@ -0,0 +1,108 @@
+// Specify OpenGL 4.3 with core functionality, the first version with compute shaders
+#version 430 core
+
+// One cluster per invocation, must match sClusterGroupSize in ClusteredLighting.cpp
+layout (local_size_x = 64) in;
+
+struct PointLight
+{
+    // World position and radius
+    vec4 positionRadius;
+    // Color scaled by the intensity
+    vec4 color;
+};
+
+layout (std430, binding = 4) readonly buffer Lights
+{
+    PointLight lights[];
+};
+
+layout (std430, binding = 5) writeonly buffer ClusterRanges
+{
+    uvec2 clusterRanges[];
+};
+
+layout (std430, binding = 6) writeonly buffer LightIndices
+{
+    uint lightIndices[];
+};
+
+// Number of indices reserved so far, and the view space min and max corner of every cluster
+layout (std430, binding = 7) buffer ClusterGrid
+{
+    uint indexCount;
+    uint clusterCount;
+    uint maxLightsPerCluster;
+    uint pad;
+    vec4 clusterBounds[];
+};
+
+uniform mat4 view;
+uniform uint lightCount;
+
+// The group's lights in view space, loaded once for all of the group's clusters
+shared vec4 groupLights[64];
+
+// Loads the view space spheres of the lights from first on, one per invocation
+void LoadLights(uint first)
+{
+    uint light = first + gl_LocalInvocationID.x;
+    if (light < lightCount)
+    {
+        vec4 sphere = lights[light].positionRadius;
+        groupLights[gl_LocalInvocationID.x] = vec4((view * vec4(sphere.xyz, 1.0)).xyz, sphere.w);
+    }
+}
+
+// Returns true if the sphere touches the bounds, the closest point of the bounds is within its radius
+bool Touches(vec4 sphere, vec3 boundsMin, vec3 boundsMax)
+{
+    vec3 delta = max(max(boundsMin - sphere.xyz, sphere.xyz - boundsMax), vec3(0.0));
+    return dot(delta, delta) <= sphere.w * sphere.w;
+}
+
+void main()
+{
+    uint cluster = gl_GlobalInvocationID.x;
+    bool valid = cluster < clusterCount;
+    vec3 boundsMin = valid ? clusterBounds[cluster * 2u].xyz : vec3(0.0);
+    vec3 boundsMax = valid ? clusterBounds[cluster * 2u + 1u].xyz : vec3(-1.0);
+
+    // Count the cluster's lights first to reserve its indices, then write them in the same order
+    uint count = 0u;
+    for (uint first = 0u; first < lightCount; first += 64u)
+    {
+        LoadLights(first);
+        barrier();
+        uint groupCount = min(lightCount - first, 64u);
+        for (uint i = 0u; i < groupCount && valid && count < maxLightsPerCluster; ++i)
+        {
+            count += Touches(groupLights[i], boundsMin, boundsMax) ? 1u : 0u;
+        }
+        barrier();
+    }
+
+    uint offset = 0u;
+    if (valid)
+    {
+        offset = atomicAdd(indexCount, count);
+        clusterRanges[cluster] = uvec2(offset, count);
+    }
+
+    uint written = 0u;
+    for (uint first = 0u; first < lightCount; first += 64u)
+    {
+        LoadLights(first);
+        barrier();
+        uint groupCount = min(lightCount - first, 64u);
+        for (uint i = 0u; i < groupCount && written < count; ++i)
+        {
+            if (Touches(groupLights[i], boundsMin, boundsMax))
+            {
+                lightIndices[offset + written] = first + i;
+                ++written;
+            }
+        }
+        barrier();
+    }
+}
@@ -0,0 +1,166 @@
+// Clustered point lights, included by the fragment shaders of lit objects. The fragment
+// finds its cluster from its window position and depth, and only loops over the lights
+// ClusteredLighting binned into that cluster. Needs OpenGL 4.3 for storage buffers
+
+// Grid of the clusters, written by ClusteredLighting
+layout (std140, binding = 0) uniform LightingParams
+{
+    // Clusters along x, y and z, and the number of lights in w
+    uvec4 clusterCount;
+    // Near and far plane distance, and the scale and bias from log(depth) to the slice
+    vec4 depthParams;
+    // Tile size in pixels in xy
+    vec4 tileSize;
+    // Light every surface gets without any point light
+    vec4 ambient;
+};
+
+// Sun and its cascaded shadow maps, written by CascadedShadows
+layout (std140, binding = 1) uniform SunParams
+{
+    // World position to shadow map uv in xy and depth in z of each cascade
+    mat4 cascadeWorldToShadow[4];
+    // View depth each cascade reaches, and the world size of its texels
+    vec4 cascadeSplits;
+    vec4 cascadeTexelSizes;
+    // Direction the sunlight travels in, w is the number of cascades
+    vec4 sunDirection;
+    vec4 sunColor;
+};
+
+// Texture unit 5, a layer per cascade
+layout (binding = 5) uniform sampler2DArrayShadow sunShadowMap;
+
+struct PointLight
+{
+    // World position and radius
+    vec4 positionRadius;
+    // Color scaled by the intensity, w is the light's slot in shadowTiles or -1 without shadow
+    vec4 color;
+};
+
+layout (std430, binding = 4) readonly buffer Lights
+{
+    PointLight lights[];
+};
+
+// Offset and count of every cluster's lights in lightIndices
+layout (std430, binding = 5) readonly buffer ClusterRanges
+{
+    uvec2 clusterRanges[];
+};
+
+layout (std430, binding = 6) readonly buffer LightIndices
+{
+    uint lightIndices[];
+};
+
+// Cube face of a light's shadow in the shadow atlas, written by ShadowAtlas
+struct ShadowTile
+{
+    // World position to atlas uv in xy and depth in z
+    mat4 worldToAtlas;
+    // Atlas uv bounds of the tile, min in xy and max in zw
+    vec4 bounds;
+};
+
+// Six tiles per slot, +X, -X, +Y, -Y, +Z, -Z. Binding 7 is free while drawing, the light
+// binning only uses it in compute
+layout (std430, binding = 7) readonly buffer ShadowTiles
+{
+    ShadowTile shadowTiles[];
+};
+
+// Texture unit 6, unit 7 holds the depth pyramid of the instance culling
+layout (binding = 6) uniform sampler2DShadow shadowAtlas;
+
+// Returns how much of a point light reaches a surface, from 0 in shadow to 1 lit
+float PointShadow(int slot, vec3 lightPosition, vec3 worldPosition, vec3 normal)
+{
+    // Move the position off the surface by about a texel of the face it falls in, against acne
+    vec3 fromLight = worldPosition - lightPosition;
+    vec3 axis = abs(fromLight);
+    float distance = max(axis.x, max(axis.y, axis.z));
+    int face = axis.x >= axis.y && axis.x >= axis.z ? (fromLight.x > 0.0 ? 0 : 1) : (axis.y >= axis.z ? (fromLight.y > 0.0 ? 2 : 3) : (fromLight.z > 0.0 ? 4 : 5));
+    ShadowTile tile = shadowTiles[slot * 6 + face];
+    float texels = (tile.bounds.z - tile.bounds.x) * float(textureSize(shadowAtlas, 0).x) + 1.0;
+    vec3 position = worldPosition + normal * (3.0 * distance / texels);
+
+    // The filter must not read the neighbouring tiles
+    vec4 atlas = tile.worldToAtlas * vec4(position, 1.0);
+    atlas.xyz /= atlas.w;
+    return texture(shadowAtlas, vec3(clamp(atlas.xy, tile.bounds.xy, tile.bounds.zw), atlas.z));
+}
+
+// Returns how much sunlight reaches a surface at a view depth, from 0 in shadow to 1 lit.
+// Surfaces past the last cascade are lit
+float SunShadow(vec3 worldPosition, vec3 normal, float depth)
+{
+    int cascadeCount = int(sunDirection.w);
+    int cascade = 0;
+    while (cascade < cascadeCount && depth > cascadeSplits[cascade])
+    {
+        ++cascade;
+    }
+    if (cascade == cascadeCount)
+    {
+        return 1.0;
+    }
+
+    // Move the position off the surface by about two texels of the cascade, against acne
+    vec3 position = worldPosition + normal * (2.0 * cascadeTexelSizes[cascade]);
+    vec3 shadow = (cascadeWorldToShadow[cascade] * vec4(position, 1.0)).xyz;
+    return texture(sunShadowMap, vec4(shadow.xy, float(cascade), shadow.z));
+}
+
+// Returns the face normal of a triangle from the screen derivatives of its world position,
+// the meshes have no vertex normals
+vec3 FaceNormal(vec3 worldPosition)
+{
+    return normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+}
+
+// Returns the albedo lit by the ambient light and the point lights of the cluster of a window position
+vec3 LightSurface(vec3 albedo, vec3 worldPosition, vec3 normal, vec3 windowPosition)
+{
+    // View depth from the window depth of a perspective projection
+    float near = depthParams.x;
+    float far = depthParams.y;
+    float depth = near * far / (far - windowPosition.z * (far - near));
+
+    uvec3 cluster;
+    cluster.xy = min(uvec2(windowPosition.xy / tileSize.xy), clusterCount.xy - 1u);
+    cluster.z = uint(clamp(floor(log(depth) * depthParams.z + depthParams.w), 0.0, float(clusterCount.z - 1u)));
+    uvec2 range = clusterRanges[(cluster.z * clusterCount.y + cluster.y) * clusterCount.x + cluster.x];
+
+    vec3 light = ambient.rgb;
+    float sunLambert = max(dot(normal, -sunDirection.xyz), 0.0);
+    if (sunLambert > 0.0)
+    {
+        light += sunColor.rgb * sunLambert * SunShadow(worldPosition, normal, depth);
+    }
+
+    for (uint i = 0u; i < range.y; ++i)
+    {
+        PointLight pointLight = lights[lightIndices[range.x + i]];
+        vec3 toLight = pointLight.positionRadius.xyz - worldPosition;
+        float distanceSquared = dot(toLight, toLight);
+        float radiusSquared = pointLight.positionRadius.w * pointLight.positionRadius.w;
+
+        // Inverse square falloff windowed to reach zero at the radius
+        float window = clamp(1.0 - (distanceSquared * distanceSquared) / (radiusSquared * radiusSquared), 0.0, 1.0);
+        float attenuation = window * window / (distanceSquared + 1.0) * max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-8))), 0.0);
+        if (attenuation > 0.0 && pointLight.color.w >= 0.0)
+        {
+            attenuation *= PointShadow(int(pointLight.color.w), pointLight.positionRadius.xyz, worldPosition, normal);
+        }
+        light += pointLight.color.rgb * attenuation;
+    }
+    return albedo * light;
+}
+
+// Returns the albedo of the fragment being drawn lit by the lights of its cluster
+vec3 ApplyLighting(vec3 albedo, vec3 worldPosition)
+{
+    return LightSurface(albedo, worldPosition, FaceNormal(worldPosition), gl_FragCoord.xyz);
+}
@@ -0,0 +1,76 @@
+// Specify OpenGL 4.3 with core functionality, the first version with compute shaders
+#version 430 core
+
+// One meshlet per invocation, must match sCullGroupSize in MeshletCuller.cpp
+layout (local_size_x = 64) in;
+
+struct Meshlet
+{
+    // Bounding sphere: center and radius
+    vec4 sphere;
+    // Normal cone: axis and the sine of its half angle (larger than 1 never culls)
+    vec4 cone;
+    // First index, index count and padding
+    uvec4 range;
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Meshlets
+{
+    Meshlet meshlets[];
+};
+
+layout (std430, binding = 1) writeonly buffer Commands
+{
+    DrawCommand commands[];
+};
+
+layout (std430, binding = 2) buffer DrawCount
+{
+    uint drawCount;
+};
+
+// Frustum planes and camera position in the mesh's model space
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform uint meshletCount;
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= meshletCount)
+    {
+        return;
+    }
+    Meshlet meshlet = meshlets[index];
+    vec3 center = meshlet.sphere.xyz;
+    float radius = meshlet.sphere.w;
+
+    // Outside if the sphere is fully behind any plane
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w <= -radius)
+        {
+            return;
+        }
+    }
+
+    // Back facing if every triangle normal points away from the camera over the whole sphere
+    vec3 toCenter = center - cameraPosition;
+    float cutoff = meshlet.cone.w;
+    if (dot(toCenter, meshlet.cone.xyz) >= cutoff * length(toCenter) + radius * (1.0 + cutoff))
+    {
+        return;
+    }
+
+    uint slot = atomicAdd(drawCount, 1u);
+    commands[slot] = DrawCommand(meshlet.range.y, 1u, meshlet.range.x, 0, 0u);
+}
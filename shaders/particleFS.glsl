@@ -0,0 +1,15 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+in vec2 corner;
+in vec4 color;
+
+// Final vector4 pixel color output
+out vec4 fragColor;
+
+void main()
+{
+    // A round particle that fades out towards its edge
+    float fade = 1.0 - smoothstep(0.5, 1.0, length(corner));
+    fragColor = vec4(color.rgb, color.a * fade);
+}
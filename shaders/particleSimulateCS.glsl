@@ -0,0 +1,110 @@
+// Specify OpenGL 4.3 with core functionality, the first version with compute shaders
+#version 430 core
+
+// One particle slot per invocation, must match sSimulateGroupSize in ParticleSystem.cpp
+layout (local_size_x = 64) in;
+
+struct Particle
+{
+    // xyz position, w age in seconds, negative when dead
+    vec4 positionAge;
+    // xyz velocity, w index of the emitter
+    vec4 velocityEmitter;
+};
+
+struct Emitter
+{
+    // xyz center, w half size of the box particles spawn in
+    vec4 position;
+    // xyz velocity at birth, w random spread of each axis
+    vec4 velocity;
+    vec4 startColor;
+    vec4 endColor;
+    // x lifetime, y start size, z end size, w drag
+    vec4 params;
+    // x first slot, y slot count, z slot the first particle of this frame spawns in, w particles spawned
+    uvec4 range;
+};
+
+// Last frame's particles are read from one buffer and written to the other
+layout (std430, binding = 0) readonly buffer Source
+{
+    Particle source[];
+};
+
+layout (std430, binding = 1) writeonly buffer Destination
+{
+    Particle destination[];
+};
+
+layout (std430, binding = 2) readonly buffer Emitters
+{
+    Emitter emitters[];
+};
+
+uniform uint particleCount;
+uniform uint emitterCount;
+uniform float deltaTime;
+uniform vec3 gravity;
+uniform uint frameSeed;
+
+// Scrambles a number, the same hash as in ParticleSystem.cpp
+uint Hash(uint x)
+{
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Returns a number in [0, 1) and moves the seed on
+float Random(inout uint seed)
+{
+    seed = Hash(seed);
+    return float(seed >> 8u) / 16777216.0;
+}
+
+void main()
+{
+    uint slot = gl_GlobalInvocationID.x;
+    if (slot >= particleCount)
+    {
+        return;
+    }
+    Particle particle = source[slot];
+
+    // The emitter whose ring the slot is in
+    for (uint e = 0u; e < emitterCount; ++e)
+    {
+        Emitter emitter = emitters[e];
+        uint local = slot - emitter.range.x;
+        if (slot < emitter.range.x || local >= emitter.range.y)
+        {
+            continue;
+        }
+
+        // Particles spawn into the ring from the cursor on, replacing the oldest
+        uint order = (local + emitter.range.y - emitter.range.z) % emitter.range.y;
+        if (order < emitter.range.w)
+        {
+            // Same random numbers in the same order as the CPU simulation
+            uint seed = Hash(slot ^ frameSeed);
+            vec3 offset = vec3(Random(seed), Random(seed), Random(seed)) * 2.0 - 1.0;
+            vec3 jitter = vec3(Random(seed), Random(seed), Random(seed)) * 2.0 - 1.0;
+            vec3 velocity = emitter.velocity.xyz + jitter * emitter.velocity.w;
+
+            // The particles of a frame spawned over its whole time, so they don't leave in bursts
+            float age = deltaTime * (1.0 - (float(order) + 0.5) / float(emitter.range.w));
+            particle.positionAge = vec4(emitter.position.xyz + offset * emitter.position.w + velocity * age, age);
+            particle.velocityEmitter = vec4(velocity, float(e));
+        }
+        else if (particle.positionAge.w >= 0.0)
+        {
+            vec3 velocity = (particle.velocityEmitter.xyz + gravity * deltaTime) * max(1.0 - emitter.params.w * deltaTime, 0.0);
+            float age = particle.positionAge.w + deltaTime;
+            particle.positionAge = vec4(particle.positionAge.xyz + velocity * deltaTime, age < emitter.params.x ? age : -1.0);
+            particle.velocityEmitter.xyz = velocity;
+        }
+        break;
+    }
+    destination[slot] = particle;
+}
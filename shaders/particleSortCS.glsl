@@ -0,0 +1,115 @@
+// Specify OpenGL 4.3 with core functionality, the first version with compute shaders
+#version 430 core
+
+// Two entries per invocation, must match sSortGroupSize in ParticleSystem.cpp
+layout (local_size_x = 512) in;
+
+const uint blockEntries = 1024u;
+
+struct Particle
+{
+    vec4 positionAge;
+    vec4 velocityEmitter;
+};
+
+layout (std430, binding = 0) readonly buffer Particles
+{
+    Particle particles[];
+};
+
+// x squared distance to the camera as uint bits, 0 for dead particles, y particle index
+layout (std430, binding = 1) buffer Entries
+{
+    uvec2 entries[];
+};
+
+// 0 writes the keys, 1 sorts every block, 2 runs one merge step over all entries,
+// 3 runs the merge steps with strides within a block
+uniform int mode;
+uniform uint particleCount;
+uniform vec3 cameraPosition;
+
+// Size of the sequences being merged and distance of the entries compared
+uniform uint blockSize;
+uniform uint stride;
+
+shared uvec2 blockEntriesShared[blockEntries];
+
+// Index of the first entry of the pair an invocation compares at a stride
+uint PairIndex(uint invocation, uint pairStride)
+{
+    return (invocation / pairStride) * 2u * pairStride + invocation % pairStride;
+}
+
+// Orders a pair, far first where the index falls into a descending half of the merge.
+// Positive floats order the same as their bits, so the keys compare as uints
+void CompareSwap(inout uvec2 a, inout uvec2 b, uint index, uint size)
+{
+    bool descending = (index & size) == 0u;
+    if (descending ? a.x < b.x : a.x > b.x)
+    {
+        uvec2 swap = a;
+        a = b;
+        b = swap;
+    }
+}
+
+// Runs the merge steps of sizes from firstSize to lastSize on the group's block in shared
+// memory, the first size from firstStride down
+void SortBlock(uint firstSize, uint lastSize, uint firstStride)
+{
+    uint base = gl_WorkGroupID.x * blockEntries;
+    uint invocation = gl_LocalInvocationID.x;
+    blockEntriesShared[invocation] = entries[base + invocation];
+    blockEntriesShared[invocation + blockEntries / 2u] = entries[base + invocation + blockEntries / 2u];
+    barrier();
+
+    for (uint size = firstSize; size <= lastSize; size *= 2u)
+    {
+        for (uint pairStride = size == firstSize ? firstStride : size / 2u; pairStride > 0u; pairStride /= 2u)
+        {
+            uint i = PairIndex(invocation, pairStride);
+            uvec2 a = blockEntriesShared[i];
+            uvec2 b = blockEntriesShared[i + pairStride];
+            CompareSwap(a, b, base + i, size);
+            blockEntriesShared[i] = a;
+            blockEntriesShared[i + pairStride] = b;
+            barrier();
+        }
+    }
+
+    entries[base + invocation] = blockEntriesShared[invocation];
+    entries[base + invocation + blockEntries / 2u] = blockEntriesShared[invocation + blockEntries / 2u];
+}
+
+void main()
+{
+    if (mode == 0)
+    {
+        uint index = gl_GlobalInvocationID.x;
+        uint key = 0u;
+        if (index < particleCount && particles[index].positionAge.w >= 0.0)
+        {
+            vec3 offset = particles[index].positionAge.xyz - cameraPosition;
+            key = max(floatBitsToUint(dot(offset, offset)), 1u);
+        }
+        entries[index] = uvec2(key, index);
+    }
+    else if (mode == 1)
+    {
+        SortBlock(2u, blockEntries, 1u);
+    }
+    else if (mode == 2)
+    {
+        uint i = PairIndex(gl_GlobalInvocationID.x, stride);
+        uvec2 a = entries[i];
+        uvec2 b = entries[i + stride];
+        CompareSwap(a, b, i, blockSize);
+        entries[i] = a;
+        entries[i + stride] = b;
+    }
+    else
+    {
+        SortBlock(blockSize, blockSize, blockEntries / 2u);
+    }
+}
@@ -0,0 +1,69 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+struct Particle
+{
+    vec4 positionAge;
+    vec4 velocityEmitter;
+};
+
+struct Emitter
+{
+    vec4 position;
+    vec4 velocity;
+    vec4 startColor;
+    vec4 endColor;
+    // x lifetime, y start size, z end size, w drag
+    vec4 params;
+    uvec4 range;
+};
+
+layout (std430, binding = 0) readonly buffer Particles
+{
+    Particle particles[];
+};
+
+// Particles sorted far to near, x is 0 for dead particles (see shaders/particleSortCS.glsl)
+layout (std430, binding = 1) readonly buffer Entries
+{
+    uvec2 entries[];
+};
+
+layout (std430, binding = 2) readonly buffer Emitters
+{
+    Emitter emitters[];
+};
+
+uniform mat4 viewProj;
+
+// Camera axes the quads are spanned along
+uniform vec3 cameraRight;
+uniform vec3 cameraUp;
+
+// Corner of the quad from -1 to 1, and the particle's color at its age
+out vec2 corner;
+out vec4 color;
+
+// One quad of two triangles per instance, drawn with 6 vertices and no vertex buffer
+const vec2 corners[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main()
+{
+    // Dead particles are moved outside of the clip volume
+    uvec2 entry = entries[gl_InstanceID];
+    if (entry.x == 0u)
+    {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+    Particle particle = particles[entry.y];
+    Emitter emitter = emitters[uint(particle.velocityEmitter.w)];
+
+    float life = clamp(particle.positionAge.w / emitter.params.x, 0.0, 1.0);
+    float size = mix(emitter.params.y, emitter.params.z, life);
+    color = mix(emitter.startColor, emitter.endColor, life);
+    corner = corners[gl_VertexID];
+
+    vec3 world = particle.positionAge.xyz + (cameraRight * corner.x + cameraUp * corner.y) * (size * 0.5);
+    gl_Position = viewProj * vec4(world, 1.0);
+}
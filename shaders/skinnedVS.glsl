@@ -0,0 +1,75 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// position variable has attribute position 0
+layout (location = 0) in vec3 position;
+
+// texture variable has attribute position 1
+layout (location = 1) in vec2 texCoord;
+
+// Indices of the bones that move the vertex, unsigned bytes that arrive as floats holding the exact index
+layout (location = 2) in vec4 boneIndices;
+
+// Weights of the bones, they sum up to 1
+layout (location = 3) in vec4 boneWeights;
+
+// Character of the instance, the InstanceCuller's draw commands only hold the visible characters
+layout (location = 4) in uint characterIndex;
+
+// Skinning matrices of every character, written by AnimatedCrowd. They already hold the
+// character's model matrix, so they move the vertex straight into the world
+layout (std430, binding = 0) readonly buffer Bones
+{
+    mat4 bones[];
+};
+
+// Bones of a character
+uniform int boneCount;
+
+// viewProj takes both view and projection matrices, or the ones of the depth pass
+uniform mat4 viewProj;
+
+#ifndef DEPTH_ONLY
+
+// Skinning matrices of the last frame, and the view projections of this and the last frame
+// without the sub-pixel jitter, for the motion vectors of the TemporalUpsampler
+layout (std430, binding = 1) readonly buffer PreviousBones
+{
+    mat4 previousBones[];
+};
+
+uniform mat4 unjitteredViewProj;
+uniform mat4 previousViewProj;
+
+// Specify a vec2 texture output to the fragment shader
+out vec2 textureCoord;
+
+// World position for the lighting
+out vec3 worldPosition;
+
+// Clip positions of this and the last frame, read by shaders/surface.glsl
+out vec4 currentClip;
+out vec4 previousClip;
+
+#endif
+
+// Compiled with DEPTH_ONLY for the depth passes, which compute the position exactly the same way
+invariant gl_Position;
+
+void main()
+{
+    ivec4 index = ivec4(boneIndices) + int(characterIndex) * boneCount;
+    mat4 skin = bones[index.x] * boneWeights.x + bones[index.y] * boneWeights.y + bones[index.z] * boneWeights.z + bones[index.w] * boneWeights.w;
+    vec4 world = skin * vec4(position, 1.0f);
+    gl_Position = viewProj * world;
+
+#ifndef DEPTH_ONLY
+    mat4 previousSkin = previousBones[index.x] * boneWeights.x + previousBones[index.y] * boneWeights.y + previousBones[index.z] * boneWeights.z +
+                        previousBones[index.w] * boneWeights.w;
+    worldPosition = world.xyz;
+    currentClip = unjitteredViewProj * world;
+    previousClip = previousViewProj * previousSkin * vec4(position, 1.0f);
+
+    textureCoord = texCoord;
+#endif
+}
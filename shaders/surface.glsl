@@ -0,0 +1,78 @@
+// Output of the lit fragment shaders, included after their inputs. Drawing forward, the
+// surface is lit with the clustered lights right away. Compiled with DEFERRED for the
+// DeferredRenderer, it is written to the G-buffer and lit once per pixel afterwards.
+// Both also write how far the surface moved on screen since the last frame, for the
+// TemporalUpsampler. Without a motion target the write is dropped. Compiled with
+// TRANSPARENT for the TransparencyRenderer, the lit color is added to its weighted sums
+
+#include "lighting.glsl"
+
+// Clip positions of this and the last frame without the sub-pixel jitter
+in vec4 currentClip;
+in vec4 previousClip;
+
+// Screen uv the surface moved by since the last frame
+vec2 Motion()
+{
+    return (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
+}
+
+#ifdef DEFERRED
+
+// RGBA8 albedo and the octahedral normal in two snorm16 channels
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec2 gNormal;
+layout (location = 2) out vec2 gMotion;
+
+// Folds a unit vector onto the octahedron and unfolds it into a square, two channels keep its direction
+vec2 EncodeOctahedral(vec3 normal)
+{
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+    vec2 encoded = normal.xy;
+    if (normal.z < 0.0)
+    {
+        encoded = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return encoded;
+}
+
+void WriteSurface(vec4 color, vec3 worldPosition)
+{
+    gAlbedo = vec4(color.rgb, 1.0);
+    gNormal = EncodeOctahedral(FaceNormal(worldPosition));
+    gMotion = Motion();
+}
+
+#elif defined(TRANSPARENT)
+
+// Weighted premultiplied color and weight, and the alpha the revealage is multiplied by
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float revealage;
+
+// Share of the texture's alpha the surface covers
+uniform float opacity;
+
+void WriteSurface(vec4 color, vec3 worldPosition)
+{
+    // Closer surfaces weigh more, so the nearest ones dominate the average like they would
+    // when blended in order
+    float alpha = color.a * opacity;
+    float weight = alpha * clamp(3e3 * pow(1.0 - gl_FragCoord.z, 3.0), 1e-2, 3e3);
+    accumulation = vec4(ApplyLighting(color.rgb, worldPosition) * alpha, alpha) * weight;
+    revealage = alpha;
+}
+
+#else
+
+// Final vector4 pixel color output
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec2 motion;
+
+void WriteSurface(vec4 color, vec3 worldPosition)
+{
+    // Light the color with the lights of the fragment's cluster
+    fragColor = vec4(ApplyLighting(color.rgb, worldPosition), color.a);
+    motion = Motion();
+}
+
+#endif
@@ -0,0 +1,112 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// This frame's jittered samples at the render resolution, read with texelFetch
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+uniform sampler2D sceneMotion;
+
+// Resolved color of the last frame at the output resolution, bilinear filtered
+uniform sampler2D history;
+
+// Size of the output in pixels
+uniform vec2 outputSize;
+
+// Sub-pixel offset of this frame's samples in render pixels
+uniform vec2 jitter;
+
+// Share of this frame in the result where a sample lands on the pixel, and false when
+// there is no history to blend with
+uniform float blend;
+uniform bool historyValid;
+
+// Final vector4 pixel color output
+out vec4 fragColor;
+
+// Samples the history with a Catmull-Rom filter in 5 bilinear taps, sharper than a bilinear
+// sample so reprojecting every frame doesn't blur the history
+vec3 SampleHistory(vec2 uv)
+{
+    vec2 size = vec2(textureSize(history, 0));
+    vec2 position = uv * size;
+    vec2 center = floor(position - 0.5) + 0.5;
+    vec2 f = position - center;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    // The two middle taps of each axis are one bilinear sample between them
+    vec2 w12 = w1 + w2;
+    vec2 uv0 = (center - 1.0) / size;
+    vec2 uv3 = (center + 2.0) / size;
+    vec2 uv12 = (center + w2 / w12) / size;
+
+    vec3 result = texture(history, vec2(uv12.x, uv0.y)).rgb * (w12.x * w0.y) + texture(history, vec2(uv0.x, uv12.y)).rgb * (w0.x * w12.y) +
+                  texture(history, uv12).rgb * (w12.x * w12.y) + texture(history, vec2(uv3.x, uv12.y)).rgb * (w3.x * w12.y) +
+                  texture(history, vec2(uv12.x, uv3.y)).rgb * (w12.x * w3.y);
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    return max(result / weight, 0.0);
+}
+
+void main()
+{
+    ivec2 renderSize = textureSize(sceneColor, 0);
+    vec2 uv = gl_FragCoord.xy / outputSize;
+
+    // The sample of render pixel p lies at p + 0.5 - jitter in the unjittered image
+    vec2 position = uv * vec2(renderSize);
+    ivec2 nearest = ivec2(floor(position + jitter));
+
+    // Filter the 3x3 samples around the pixel by their distance, and gather their range
+    // and the motion of the closest surface, so edges move with the object in front
+    vec3 color = vec3(0.0);
+    float weightSum = 0.0;
+    float nearestWeight = 0.0;
+    vec3 lowest = vec3(1e9);
+    vec3 highest = vec3(-1e9);
+    float closestDepth = 2.0;
+    ivec2 closest = nearest;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            ivec2 pixel = clamp(nearest + ivec2(x, y), ivec2(0), renderSize - 1);
+            vec3 sampleColor = texelFetch(sceneColor, pixel, 0).rgb;
+            vec2 offset = vec2(nearest + ivec2(x, y)) + 0.5 - jitter - position;
+            float weight = exp(-2.29 * dot(offset, offset));
+            color += sampleColor * weight;
+            weightSum += weight;
+            if (x == 0 && y == 0)
+            {
+                nearestWeight = weight;
+            }
+            lowest = min(lowest, sampleColor);
+            highest = max(highest, sampleColor);
+
+            float depth = texelFetch(sceneDepth, pixel, 0).r;
+            if (depth < closestDepth)
+            {
+                closestDepth = depth;
+                closest = pixel;
+            }
+        }
+    }
+    color /= weightSum;
+
+    // Where the pixel was last frame. History off screen or missing is replaced
+    vec2 previousUv = uv - texelFetch(sceneMotion, closest, 0).xy;
+    if (!historyValid || any(lessThan(previousUv, vec2(0.0))) || any(greaterThan(previousUv, vec2(1.0))))
+    {
+        fragColor = vec4(color, 1.0);
+        return;
+    }
+
+    // History outside the range of this frame's neighbourhood belongs to a surface that is
+    // gone or changed, clamping it keeps it from ghosting
+    vec3 previous = clamp(SampleHistory(previousUv), lowest, highest);
+
+    // Pixels far from this frame's samples keep more of the history
+    fragColor = vec4(mix(previous, color, blend * nearestWeight), 1.0);
+}
@@ -0,0 +1,24 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// Input variables from vertex shader (same name and same type as in vertex shader so it is linked to variable in vertex shader)
+in vec2 textureCoord;
+
+// World position of the fragment for the lighting
+in vec3 worldPosition;
+
+// Layer of each sampler's texture array, the same for the whole instance
+flat in uvec4 textureLayers;
+
+// Set samplers for 2d texture arrays as a uniform, every instance picks its own layers
+uniform sampler2DArray textureSampler;
+uniform sampler2DArray textureSampler2;
+
+// Writes the lit color, or the G-buffer of the deferred path
+#include "surface.glsl"
+
+void main()
+{
+    // The third texture coordinate of an array is the layer
+    WriteSurface(mix(texture(textureSampler, vec3(textureCoord, textureLayers.x)), texture(textureSampler2, vec3(textureCoord, textureLayers.y)), 0.3), worldPosition);
+}
@@ -0,0 +1,31 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// Samplers are built from 64-bit handles instead of being bound to texture units
+#extension GL_ARB_bindless_texture : require
+
+// Input variables from vertex shader (same name and same type as in vertex shader so it is linked to variable in vertex shader)
+in vec2 textureCoord;
+
+// World position of the fragment for the lighting
+in vec3 worldPosition;
+
+// Slot of each texture's handle, the same for the whole instance
+flat in uvec4 textureLayers;
+
+// Handles of every resident texture, written by TextureResidency. Each indirect command draws
+// a single instance, so the handle is dynamically uniform within a draw
+layout (std430, binding = 3) readonly buffer TextureHandles
+{
+    uvec2 handles[];
+};
+
+// Writes the lit color, or the G-buffer of the deferred path
+#include "surface.glsl"
+
+void main()
+{
+    sampler2D textureSampler = sampler2D(handles[textureLayers.x]);
+    sampler2D textureSampler2 = sampler2D(handles[textureLayers.y]);
+    WriteSurface(mix(texture(textureSampler, textureCoord), texture(textureSampler2, textureCoord), 0.3), worldPosition);
+}
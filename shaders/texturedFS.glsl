@@ -1,15 +1,18 @@
-// Specify OpenGL 4.2 with core functionality
-#version 420 core
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
 
 // Input variables from vertex shader (same name and same type as in vertex shader so it is linked to variable in vertex shader)
 in vec2 textureCoord;
 
+// World position of the fragment for the lighting
+in vec3 worldPosition;
+
 // Set samplers for 2d textures as a uniform
 uniform sampler2D textureSampler;
 uniform sampler2D textureSampler2;
 
-// Final vector4 pixel color output
-out vec4 fragColor; 
+// Writes the lit color, or the G-buffer of the deferred path
+#include "surface.glsl"
 
 void main()
 {
@@ -18,5 +21,5 @@ void main()
 
     // Sample colors of a texture with texture function:
     // - Takes in a texture sampler and a texture coordinate
-    fragColor = mix(texture(textureSampler, textureCoord), texture(textureSampler2, textureCoord), 0.3);
+    WriteSurface(mix(texture(textureSampler, textureCoord), texture(textureSampler2, textureCoord), 0.3), worldPosition);
 }
\ No newline at end of file
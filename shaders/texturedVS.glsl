@@ -1,11 +1,15 @@
-// Specify OpenGL 4.2 with core functionality
-#version 420 core
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
 
 // position variable has attribute position 0
 layout (location = 0) in vec3 position; 
 
-// texture variable has attribute position 1
+// texture variable has attribute position 1, or 2 after the normal of an imported Model
+#ifdef VERTEX_NORMALS
+layout (location = 2) in vec2 texCoord;
+#else
 layout (location = 1) in vec2 texCoord;
+#endif
 
 // Uniforms for model to world
 uniform mat4 model;
@@ -13,14 +17,34 @@ uniform mat4 model;
 // viewProj takes both view and projection matrices
 uniform mat4 viewProj;
 
+// Model matrix of the last frame, and the view projections of this and the last frame without
+// the sub-pixel jitter, for the motion vectors of the TemporalUpsampler
+uniform mat4 previousModel;
+uniform mat4 unjitteredViewProj;
+uniform mat4 previousViewProj;
+
 // Specify a vec2 texture output to the fragment shader
 out vec2 textureCoord;
 
+// World position for the lighting
+out vec3 worldPosition;
+
+// Clip positions of this and the last frame, read by shaders/surface.glsl
+out vec4 currentClip;
+out vec4 previousClip;
+
+// Computed exactly like shaders/depthVS.glsl, so the depth pre-pass matches the shading pass
+invariant gl_Position;
+
 void main()
 {
     // Directly give a vec3 to vec4 constructor
     // Multiply by transform matrices
-    gl_Position = viewProj * model * vec4(position, 1.0f); 
+    vec4 world = model * vec4(position, 1.0f);
+    gl_Position = viewProj * world;
+    worldPosition = world.xyz;
+    currentClip = unjitteredViewProj * world;
+    previousClip = previousViewProj * previousModel * vec4(position, 1.0f);
     
     textureCoord = texCoord;
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// Weighted sums of the transparent colors in rgb and of their weights in a, and the
+// share of the scene that still shows through, one texel per pixel
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+// Average transparent color, and the revealage the blend weighs the scene with
+out vec4 fragColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float revealed = texelFetch(revealage, pixel, 0).r;
+
+    // Pixels without transparent surfaces keep the scene as it is
+    if (revealed >= 1.0)
+    {
+        discard;
+    }
+    vec4 sum = texelFetch(accumulation, pixel, 0);
+
+    // Half floats overflow to infinity under a lot of bright overlapping surfaces
+    if (isinf(max(max(sum.r, sum.g), max(sum.b, sum.a))))
+    {
+        sum.rgb = vec3(sum.a);
+    }
+    fragColor = vec4(sum.rgb / max(sum.a, 1e-5), revealed);
+}
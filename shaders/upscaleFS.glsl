@@ -0,0 +1,33 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// Scene rendered at the dynamic resolution, sampled bilinearly
+uniform sampler2D scene;
+
+// Size of the backbuffer in pixels
+uniform vec2 outputSize;
+
+// How much of the difference to the neighbours is added back, 0 to 1
+uniform float sharpness;
+
+// Final vector4 pixel color output
+out vec4 fragColor;
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / outputSize;
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+
+    vec3 center = texture(scene, uv).rgb;
+    vec3 north = texture(scene, uv + vec2(0.0, texel.y)).rgb;
+    vec3 south = texture(scene, uv - vec2(0.0, texel.y)).rgb;
+    vec3 east = texture(scene, uv + vec2(texel.x, 0.0)).rgb;
+    vec3 west = texture(scene, uv - vec2(texel.x, 0.0)).rgb;
+
+    // Undo some of the blur of the bilinear upscale, limited to the range of the
+    // neighbourhood so edges don't get halos
+    vec3 sharpened = center + sharpness * (center - (north + south + east + west) * 0.25);
+    vec3 lowest = min(center, min(min(north, south), min(east, west)));
+    vec3 highest = max(center, max(max(north, south), max(east, west)));
+    fragColor = vec4(clamp(sharpened, lowest, highest), 1.0);
+}
@@ -0,0 +1,31 @@
+// Specify OpenGL 4.2 with core functionality
+#version 420 core
+
+// Input variables from vertex shader (same name and same type as in vertex shader so it is linked to variable in vertex shader)
+in vec2 textureCoord;
+
+// Size of the virtual texture in texels, pages along a side of its finest level and number of levels
+uniform float virtualSize;
+uniform int pageCount;
+uniform int levelCount;
+
+// Makes up for the lower resolution of the feedback, see VirtualTexture::BeginFeedback
+uniform float lodBias;
+
+// Id of the page the pixel needs: a valid bit, the level, then the row and column of the page
+layout (location = 0) out uint pageId;
+
+void main()
+{
+    vec2 uv = clamp(textureCoord, 0.0, 1.0);
+
+    // Same level selection as shaders/virtualTextureFS.glsl
+    vec2 dx = dFdx(textureCoord * virtualSize);
+    vec2 dy = dFdy(textureCoord * virtualSize);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + lodBias;
+    int level = clamp(int(floor(lod)), 0, levelCount - 1);
+
+    int levelPages = max(pageCount >> level, 1);
+    uvec2 page = uvec2(min(ivec2(uv * levelPages), ivec2(levelPages - 1)));
+    pageId = 0x80000000u | (uint(level) << 24) | (page.y << 12) | page.x;
+}
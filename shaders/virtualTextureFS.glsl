@@ -0,0 +1,48 @@
+// Specify OpenGL 4.3 with core functionality, the first version with storage buffers
+#version 430 core
+
+// Input variables from vertex shader (same name and same type as in vertex shader so it is linked to variable in vertex shader)
+in vec2 textureCoord;
+
+// World position of the fragment for the lighting
+in vec3 worldPosition;
+
+// Tiles of the resident pages, and the tile and level that every page of every level is drawn from
+uniform sampler2D pageCache;
+uniform usampler2D pageTable;
+
+// Size of the virtual texture in texels, pages along a side of its finest level and number of levels
+uniform float virtualSize;
+uniform int pageCount;
+uniform int levelCount;
+uniform float lodBias;
+
+// Texels along the side of a page without and with its borders, and size of the page cache in texels
+uniform int pageSize;
+uniform int pageBorder;
+uniform float cacheSize;
+
+// Writes the lit color, or the G-buffer of the deferred path
+#include "surface.glsl"
+
+void main()
+{
+    vec2 uv = clamp(textureCoord, 0.0, 1.0);
+
+    // Level with about one virtual texel per pixel, the same one the feedback requested
+    vec2 dx = dFdx(textureCoord * virtualSize);
+    vec2 dy = dFdy(textureCoord * virtualSize);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + lodBias;
+    int level = clamp(int(floor(lod)), 0, levelCount - 1);
+
+    // The page's entry holds its own tile, or the tile of the closest parent in the cache
+    int levelPages = max(pageCount >> level, 1);
+    uvec4 entry = texelFetch(pageTable, min(ivec2(uv * levelPages), ivec2(levelPages - 1)), level);
+
+    // Position inside the page of the level the tile really has
+    float residentPages = float(max(pageCount >> int(entry.z), 1));
+    vec2 inPage = fract(min(uv * residentPages, vec2(residentPages - 0.0001)));
+    vec2 texel = vec2(entry.xy) * float(pageSize + 2 * pageBorder) + float(pageBorder) + inPage * float(pageSize);
+
+    WriteSurface(textureLod(pageCache, texel / cacheSize, 0.0), worldPosition);
+}
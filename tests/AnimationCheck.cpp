@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "AnimationClip.h"
+#include "Skeleton.h"
+
+// Samples and blends a quantized AnimationClip and compares the poses with the same keys
+// interpolated as floats, then checks the Skeleton's skinning matrices against plain matrix
+// products. Whichever of the SSE or scalar paths the engine is built with is the one checked.
+// Runs without a window, returns 1 if any check fails
+
+// Bones of the clip, not a multiple of 4 so the padding of the poses is checked too
+static const size_t sBoneCount = 6;
+
+// Keyframes and keyframes per second of the clip
+static const size_t sFrameCount = 8;
+static const float sSampleRate = 4.0f;
+
+// Largest difference of a rotation component that passes: a few units of the 16 bit keys,
+// which the interpolation and normalization can grow a little
+static const float sRotationTolerance = 4.0f / 32767.0f;
+
+// Largest difference of a matrix element that passes
+static const float sMatrixTolerance = 1e-4f;
+
+// Counts the checks that failed
+static int sFailures = 0;
+
+//   Check prints a failed check and counts it:
+// - bool for the result of the check
+// - const std::string& for what was checked
+static void Check(bool passed, const std::string &what)
+{
+    if (!passed)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        ++sFailures;
+    }
+}
+
+//   Nlerp interpolates two rotations the short way and normalizes the result, like the clip does:
+// - const glm::quat& for the rotation at weight 0
+// - glm::quat for the rotation at weight 1
+// - float for the weight
+static glm::quat Nlerp(const glm::quat &from, glm::quat to, float weight)
+{
+    if (glm::dot(from, to) < 0.0f)
+    {
+        to = -to;
+    }
+    return glm::normalize(glm::quat(from.w + (to.w - from.w) * weight, from.x + (to.x - from.x) * weight,
+                                    from.y + (to.y - from.y) * weight, from.z + (to.z - from.z) * weight));
+}
+
+// A pose of float keys to compare the clip's poses with
+struct ReferencePose
+{
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> translations;
+};
+
+//   CreateKeys fills the keys of every bone of every frame. Each bone turns around its own axis
+//   and moves along a curve, some of them swing past the half turn so the short way is taken:
+// - std::vector<glm::quat>& for the rotations
+// - std::vector<glm::vec3>& for the translations
+static void CreateKeys(std::vector<glm::quat> &rotations, std::vector<glm::vec3> &translations)
+{
+    for (size_t frame = 0; frame < sFrameCount; ++frame)
+    {
+        for (size_t bone = 0; bone < sBoneCount; ++bone)
+        {
+            glm::vec3 axis = glm::normalize(glm::vec3(1.0f + bone, 2.0f - 0.5f * bone, 0.5f + 0.25f * bone * bone));
+            float angle = 0.35f * frame * (1.0f + 0.5f * bone) + 0.1f * bone;
+            rotations.emplace_back(glm::angleAxis(angle, axis));
+            translations.emplace_back(std::sin(0.7f * frame + bone), 0.25f * frame - 1.0f, bone == 2 ? 3.0f : std::cos(1.3f * frame) * (bone + 1.0f));
+        }
+    }
+}
+
+//   SampleReference interpolates the float keys around a time like the clip does:
+// - const std::vector<glm::quat>& for the rotations
+// - const std::vector<glm::vec3>& for the translations
+// - float for the time in seconds
+static ReferencePose SampleReference(const std::vector<glm::quat> &rotations, const std::vector<glm::vec3> &translations, float time)
+{
+    float frameCount = static_cast<float>(sFrameCount);
+    float frame = time * sSampleRate;
+    frame -= std::floor(frame / frameCount) * frameCount;
+    size_t first = std::min(static_cast<size_t>(frame), sFrameCount - 1);
+    size_t second = (first + 1) % sFrameCount;
+    float weight = std::clamp(frame - static_cast<float>(first), 0.0f, 1.0f);
+
+    ReferencePose pose;
+    for (size_t bone = 0; bone < sBoneCount; ++bone)
+    {
+        pose.rotations.emplace_back(Nlerp(rotations[first * sBoneCount + bone], rotations[second * sBoneCount + bone], weight));
+        glm::vec3 from = translations[first * sBoneCount + bone], to = translations[second * sBoneCount + bone];
+        pose.translations.emplace_back(from + (to - from) * weight);
+    }
+    return pose;
+}
+
+//   ComparePose checks a pose against a reference, and that the padding bones are the identity:
+// - const Pose& for the pose of the clip
+// - const ReferencePose& for the float pose
+// - const std::vector<glm::vec3>& for the largest difference of each bone's translation
+// - const std::string& for the name of the pose in the failures
+static void ComparePose(const Pose &pose, const ReferencePose &reference, const std::vector<glm::vec3> &tolerances, const std::string &name)
+{
+    Check(pose.boneCount == sBoneCount, name + ": bone count");
+    for (size_t bone = 0; bone < sBoneCount && bone < pose.boneCount; ++bone)
+    {
+        // q and -q are the same rotation
+        glm::quat rotation = glm::quat(pose.rotationW[bone], pose.rotationX[bone], pose.rotationY[bone], pose.rotationZ[bone]);
+        glm::quat expected = reference.rotations[bone];
+        if (glm::dot(rotation, expected) < 0.0f)
+        {
+            expected = -expected;
+        }
+        float rotationError = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            rotationError = std::max(rotationError, std::abs(rotation[c] - expected[c]));
+        }
+        Check(rotationError <= sRotationTolerance, name + ": rotation of bone " + std::to_string(bone) + " is off by " + std::to_string(rotationError));
+
+        glm::vec3 translation = glm::vec3(pose.translationX[bone], pose.translationY[bone], pose.translationZ[bone]);
+        glm::vec3 error = glm::abs(translation - reference.translations[bone]);
+        Check(glm::all(glm::lessThanEqual(error, tolerances[bone])), name + ": translation of bone " + std::to_string(bone) + " is off by " +
+                                                                         std::to_string(std::max(error.x, std::max(error.y, error.z))));
+    }
+
+    for (size_t bone = sBoneCount; bone < pose.rotationX.size(); ++bone)
+    {
+        bool identity = pose.rotationX[bone] == 0.0f && pose.rotationY[bone] == 0.0f && pose.rotationZ[bone] == 0.0f && pose.rotationW[bone] == 1.0f &&
+                        pose.translationX[bone] == 0.0f && pose.translationY[bone] == 0.0f && pose.translationZ[bone] == 0.0f;
+        Check(identity, name + ": padding bone " + std::to_string(bone) + " is not the identity");
+    }
+}
+
+//   BlendReference interpolates two float poses like AnimationClip::Blend:
+// - const ReferencePose& for the pose at weight 0
+// - const ReferencePose& for the pose at weight 1
+// - float for the weight
+static ReferencePose BlendReference(const ReferencePose &from, const ReferencePose &to, float weight)
+{
+    ReferencePose pose;
+    for (size_t bone = 0; bone < sBoneCount; ++bone)
+    {
+        pose.rotations.emplace_back(Nlerp(from.rotations[bone], to.rotations[bone], weight));
+        pose.translations.emplace_back(from.translations[bone] + (to.translations[bone] - from.translations[bone]) * weight);
+    }
+    return pose;
+}
+
+static void CheckClip()
+{
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> translations;
+    CreateKeys(rotations, translations);
+    AnimationClip clip(sBoneCount, sSampleRate, rotations, translations);
+    Check(clip.GetFrameCount() == sFrameCount, "clip: frame count");
+    Check(clip.GetDuration() == sFrameCount / sSampleRate, "clip: duration");
+
+    // A translation is off by at most half a step of its keys, a step spreads the bone's range over 16 bits
+    std::vector<glm::vec3> tolerances(sBoneCount);
+    for (size_t bone = 0; bone < sBoneCount; ++bone)
+    {
+        glm::vec3 minimum = translations[bone], maximum = translations[bone];
+        for (size_t frame = 1; frame < sFrameCount; ++frame)
+        {
+            minimum = glm::min(minimum, translations[frame * sBoneCount + bone]);
+            maximum = glm::max(maximum, translations[frame * sBoneCount + bone]);
+        }
+        tolerances[bone] = (maximum - minimum) / 65535.0f + glm::vec3(1e-5f);
+    }
+
+    // On the keys, between them, from the last key into the first, and wrapped from outside the clip
+    float duration = clip.GetDuration();
+    Pose pose;
+    for (size_t frame = 0; frame < sFrameCount; ++frame)
+    {
+        for (float fraction : {0.0f, 0.25f, 0.5f, 0.875f})
+        {
+            float time = (frame + fraction) / sSampleRate;
+            for (float wrap : {0.0f, 3.0f * duration, -2.0f * duration})
+            {
+                clip.Sample(time + wrap, pose);
+                ComparePose(pose, SampleReference(rotations, translations, time), tolerances, "sample at " + std::to_string(time + wrap) + "s");
+            }
+        }
+    }
+
+    // Blends of two poses, the output of the last one is its first input
+    Pose from, to, blended;
+    for (float weight : {0.0f, 0.3f, 0.5f, 1.0f})
+    {
+        float fromTime = 0.375f, toTime = 1.625f;
+        clip.Sample(fromTime, from);
+        clip.Sample(toTime, to);
+        ReferencePose expected = BlendReference(SampleReference(rotations, translations, fromTime), SampleReference(rotations, translations, toTime), weight);
+
+        AnimationClip::Blend(from, to, weight, blended);
+        ComparePose(blended, expected, tolerances, "blend at weight " + std::to_string(weight));
+        AnimationClip::Blend(from, to, weight, from);
+        ComparePose(from, expected, tolerances, "blend into its input at weight " + std::to_string(weight));
+    }
+
+    // Keys that don't make whole frames leave an empty clip, which samples the identity
+    AnimationClip broken(sBoneCount, sSampleRate, std::vector<glm::quat>(sBoneCount + 1), std::vector<glm::vec3>(sBoneCount + 1));
+    Pose empty;
+    broken.Sample(0.5f, empty);
+    Check(broken.GetFrameCount() == 0, "broken clip: no frames");
+    ReferencePose identity;
+    identity.rotations.assign(sBoneCount, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    identity.translations.assign(sBoneCount, glm::vec3(0.0f));
+    ComparePose(empty, identity, tolerances, "broken clip");
+}
+
+//   CompareMatrix returns the largest difference of the elements of two matrices:
+// - const glm::mat4& for the first matrix
+// - const glm::mat4& for the second matrix
+static float CompareMatrix(const glm::mat4 &a, const glm::mat4 &b)
+{
+    float error = 0.0f;
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            error = std::max(error, std::abs(a[column][row] - b[column][row]));
+        }
+    }
+    return error;
+}
+
+static void CheckSkeleton()
+{
+    // Two chains from one root, so a bone's parent is not always the bone before it
+    Skeleton skeleton;
+    skeleton.AddBone(-1, glm::vec3(0.0f, 1.0f, 0.0f));
+    skeleton.AddBone(0, glm::vec3(0.0f, 0.5f, 0.0f), glm::angleAxis(0.3f, glm::vec3(0.0f, 0.0f, 1.0f)));
+    skeleton.AddBone(0, glm::vec3(0.25f, 0.0f, 0.0f), glm::angleAxis(-0.6f, glm::vec3(1.0f, 0.0f, 0.0f)));
+    skeleton.AddBone(1, glm::vec3(0.0f, 0.5f, 0.0f));
+    skeleton.AddBone(2, glm::vec3(0.5f, 0.0f, 0.0f), glm::angleAxis(1.1f, glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f))));
+    skeleton.AddBone(4, glm::vec3(0.5f, 0.0f, 0.25f));
+    Check(skeleton.GetBoneCount() == sBoneCount, "skeleton: bone count");
+
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, -1.0f, 2.0f)) * glm::mat4_cast(glm::angleAxis(0.8f, glm::vec3(0.0f, 1.0f, 0.0f)));
+    std::vector<glm::mat4> matrices(sBoneCount);
+
+    // In the bind pose the vertices only move by the model matrix
+    Pose pose;
+    skeleton.GetBindPose(pose);
+    skeleton.ComputeSkinningMatrices(pose, model, matrices.data());
+    for (size_t bone = 0; bone < sBoneCount; ++bone)
+    {
+        float error = CompareMatrix(matrices[bone], model);
+        Check(error <= sMatrixTolerance, "skeleton: bind pose matrix of bone " + std::to_string(bone) + " is off by " + std::to_string(error));
+    }
+
+    // An animated pose against the products of the local transforms
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> translations;
+    CreateKeys(rotations, translations);
+    AnimationClip clip(sBoneCount, sSampleRate, rotations, translations);
+    clip.Sample(0.7f, pose);
+    skeleton.ComputeSkinningMatrices(pose, model, matrices.data());
+
+    std::vector<glm::mat4> world(sBoneCount);
+    for (size_t bone = 0; bone < sBoneCount; ++bone)
+    {
+        glm::mat4 local = glm::mat4_cast(glm::quat(pose.rotationW[bone], pose.rotationX[bone], pose.rotationY[bone], pose.rotationZ[bone]));
+        local[3] = glm::vec4(pose.translationX[bone], pose.translationY[bone], pose.translationZ[bone], 1.0f);
+        int parent = skeleton.GetParent(bone);
+        world[bone] = (parent < 0 ? model : world[parent]) * local;
+
+        float error = CompareMatrix(matrices[bone], world[bone] * skeleton.GetInverseBindMatrix(bone));
+        Check(error <= sMatrixTolerance, "skeleton: skinning matrix of bone " + std::to_string(bone) + " is off by " + std::to_string(error));
+    }
+}
+
+int main()
+{
+    CheckClip();
+    CheckSkeleton();
+
+    if (sFailures > 0)
+    {
+        std::cout << sFailures << " animation checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Every animation check passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "AtlasAllocator.h"
+
+// Allocates and frees tiles of an AtlasAllocator and checks the tiles it hands out: sizes are
+// rounded to powers of two, tiles never overlap or leave the atlas, a full atlas refuses more,
+// and freeing the four siblings of a node merges them so the larger node can be allocated again.
+// Runs without a window, returns 1 if any check fails
+
+// Size of the atlas and of its smallest tile
+static const int sAtlasSize = 1024;
+static const int sMinTileSize = 64;
+
+// Smallest tiles along each side of the atlas
+static const int sCellCount = sAtlasSize / sMinTileSize;
+
+// Counts the checks that failed
+static int sFailures = 0;
+
+//   Check prints a failed check and counts it:
+// - bool for the result of the check
+// - const std::string& for what was checked
+static void Check(bool passed, const std::string &what)
+{
+    if (!passed)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        ++sFailures;
+    }
+}
+
+//   Describe returns a tile as text for the failures:
+// - const AtlasTile& for the tile
+static std::string Describe(const AtlasTile &tile)
+{
+    return std::to_string(tile.size) + " tile at " + std::to_string(tile.x) + ", " + std::to_string(tile.y);
+}
+
+// Owner of every smallest cell of the atlas, to find tiles that overlap
+class Coverage
+{
+public:
+    Coverage()
+        : mOwners(sCellCount * sCellCount, -1)
+    {
+    }
+
+    //   Add marks the cells of a tile as taken, checking that the tile is inside the atlas and on free cells:
+    // - const AtlasTile& for the tile
+    // - int for the owner of the tile
+    void Add(const AtlasTile &tile, int owner)
+    {
+        bool inside = tile.size >= sMinTileSize && tile.x >= 0 && tile.y >= 0 && tile.x + tile.size <= sAtlasSize && tile.y + tile.size <= sAtlasSize &&
+                      tile.x % tile.size == 0 && tile.y % tile.size == 0;
+        Check(inside, Describe(tile) + " is outside the atlas or not aligned to its size");
+        if (!inside)
+        {
+            return;
+        }
+        for (int y = tile.y / sMinTileSize; y < (tile.y + tile.size) / sMinTileSize; ++y)
+        {
+            for (int x = tile.x / sMinTileSize; x < (tile.x + tile.size) / sMinTileSize; ++x)
+            {
+                int &cell = mOwners[y * sCellCount + x];
+                Check(cell < 0, Describe(tile) + " overlaps tile " + std::to_string(cell));
+                cell = owner;
+            }
+        }
+    }
+
+    //   Remove frees the cells of a tile:
+    // - const AtlasTile& for the tile
+    void Remove(const AtlasTile &tile)
+    {
+        for (int y = tile.y / sMinTileSize; y < (tile.y + tile.size) / sMinTileSize; ++y)
+        {
+            for (int x = tile.x / sMinTileSize; x < (tile.x + tile.size) / sMinTileSize; ++x)
+            {
+                mOwners[y * sCellCount + x] = -1;
+            }
+        }
+    }
+
+private:
+    std::vector<int> mOwners;
+};
+
+static void CheckSizes()
+{
+    AtlasAllocator atlas(sAtlasSize, sMinTileSize);
+
+    // Sizes round up to a power of two and never go below the smallest tile
+    AtlasTile rounded = atlas.Allocate(100);
+    Check(rounded.level >= 0 && rounded.size == 128, "size 100 rounds up to 128, got " + Describe(rounded));
+    AtlasTile smallest = atlas.Allocate(1);
+    Check(smallest.level >= 0 && smallest.size == sMinTileSize, "size 1 rounds up to the smallest tile, got " + Describe(smallest));
+    Check(atlas.GetUsedArea() == 128 * 128 + sMinTileSize * sMinTileSize, "used area of a 128 and a smallest tile");
+
+    // The small tile fills the gap the first split left instead of breaking up another quadrant
+    Check(smallest.x < sAtlasSize / 2 && smallest.y < sAtlasSize / 2, "smallest tile reuses the split quadrant, got " + Describe(smallest));
+
+    // Nothing larger than the atlas fits, and the whole atlas doesn't fit while a tile is used
+    Check(atlas.Allocate(sAtlasSize * 2).level < 0, "a tile larger than the atlas is refused");
+    Check(atlas.Allocate(sAtlasSize).level < 0, "the whole atlas is refused while tiles are used");
+
+    // Freeing an unallocated tile does nothing
+    AtlasTile unallocated;
+    atlas.Free(unallocated);
+    Check(atlas.GetUsedArea() == 128 * 128 + sMinTileSize * sMinTileSize, "freeing an unallocated tile keeps the used area");
+
+    // Freeing both merges the quadtree back to its root
+    atlas.Free(rounded);
+    atlas.Free(smallest);
+    Check(rounded.level < 0 && smallest.level < 0, "freed tiles are marked unallocated");
+    Check(atlas.GetUsedArea() == 0, "used area is 0 after freeing every tile");
+    AtlasTile whole = atlas.Allocate(sAtlasSize);
+    Check(whole.level == 0 && whole.size == sAtlasSize && whole.x == 0 && whole.y == 0, "the whole atlas fits once every tile is freed, got " + Describe(whole));
+}
+
+static void CheckFull()
+{
+    AtlasAllocator atlas(sAtlasSize, sMinTileSize);
+    Coverage coverage;
+
+    // Fill the atlas with the smallest tiles, then nothing fits any more
+    std::vector<AtlasTile> tiles;
+    for (int i = 0; i < sCellCount * sCellCount; ++i)
+    {
+        AtlasTile tile = atlas.Allocate(sMinTileSize);
+        Check(tile.level >= 0, "smallest tile " + std::to_string(i) + " fits before the atlas is full");
+        coverage.Add(tile, i);
+        tiles.emplace_back(tile);
+    }
+    Check(atlas.GetUsedArea() == static_cast<int64_t>(sAtlasSize) * sAtlasSize, "a full atlas uses all of its area");
+    Check(atlas.Allocate(sMinTileSize).level < 0, "a full atlas refuses the smallest tile");
+    Check(atlas.Allocate(sAtlasSize / 2).level < 0, "a full atlas refuses a quadrant");
+
+    // A freed tile is handed out again
+    AtlasTile freed = tiles[37];
+    atlas.Free(tiles[37]);
+    AtlasTile again = atlas.Allocate(sMinTileSize);
+    Check(again.x == freed.x && again.y == freed.y, "the only free cell is allocated again, got " + Describe(again));
+    tiles[37] = again;
+
+    // Three free siblings don't merge into their parent, the fourth does
+    for (auto &tile : tiles)
+    {
+        if (tile.x < 2 * sMinTileSize && tile.y < 2 * sMinTileSize && !(tile.x == 0 && tile.y == 0))
+        {
+            atlas.Free(tile);
+        }
+    }
+    Check(atlas.Allocate(2 * sMinTileSize).level < 0, "three free siblings don't make room for their parent");
+    AtlasTile sibling = atlas.Allocate(sMinTileSize);
+    Check(sibling.level >= 0 && sibling.x < 2 * sMinTileSize && sibling.y < 2 * sMinTileSize, "one of three free siblings is allocated, got " + Describe(sibling));
+    atlas.Free(sibling);
+    for (auto &tile : tiles)
+    {
+        if (tile.x == 0 && tile.y == 0)
+        {
+            atlas.Free(tile);
+        }
+    }
+    AtlasTile parent = atlas.Allocate(2 * sMinTileSize);
+    Check(parent.level >= 0 && parent.x == 0 && parent.y == 0, "four free siblings merge into their parent, got " + Describe(parent));
+    atlas.Free(parent);
+
+    // Freeing the rest merges the quadtree back to its root
+    for (auto &tile : tiles)
+    {
+        atlas.Free(tile);
+    }
+    Check(atlas.GetUsedArea() == 0, "used area is 0 after freeing the full atlas");
+    Check(atlas.Allocate(sAtlasSize).level == 0, "the whole atlas fits after freeing the full atlas");
+    atlas.Clear();
+    Check(atlas.GetUsedArea() == 0 && atlas.Allocate(sAtlasSize).level == 0, "Clear frees the whole atlas");
+}
+
+static void CheckSiblings()
+{
+    // Four quadrants fill the atlas
+    AtlasAllocator atlas(sAtlasSize, sMinTileSize);
+    AtlasTile quadrants[4];
+    for (auto &quadrant : quadrants)
+    {
+        quadrant = atlas.Allocate(sAtlasSize / 2);
+        Check(quadrant.level == 1, "quadrant fits, got " + Describe(quadrant));
+    }
+    Check(atlas.Allocate(sMinTileSize).level < 0, "four quadrants fill the atlas");
+
+    // Split the freed quadrant into its four children, then free them one at a time
+    AtlasTile freed = quadrants[2];
+    atlas.Free(quadrants[2]);
+    AtlasTile children[4];
+    for (auto &child : children)
+    {
+        child = atlas.Allocate(sAtlasSize / 4);
+        bool inside = child.level == 2 && child.x >= freed.x && child.x < freed.x + freed.size && child.y >= freed.y && child.y < freed.y + freed.size;
+        Check(inside, "child is inside the freed quadrant, got " + Describe(child));
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        Check(atlas.Allocate(sAtlasSize / 2).level < 0, "quadrant doesn't fit with " + std::to_string(4 - i) + " children used");
+        atlas.Free(children[i]);
+    }
+    AtlasTile merged = atlas.Allocate(sAtlasSize / 2);
+    Check(merged.x == freed.x && merged.y == freed.y && merged.size == freed.size, "the four freed children merge into their quadrant, got " + Describe(merged));
+}
+
+static void CheckRandom()
+{
+    // Random allocations and frees never hand out overlapping tiles, and the used area adds up
+    AtlasAllocator atlas(sAtlasSize, sMinTileSize);
+    Coverage coverage;
+    std::vector<AtlasTile> tiles;
+    std::vector<int> owners;
+    int64_t area = 0;
+    uint32_t random = 12345;
+    for (int step = 0; step < 20000; ++step)
+    {
+        random = random * 1664525u + 1013904223u;
+        if (!tiles.empty() && (random >> 16) % 3 == 0)
+        {
+            size_t index = (random >> 8) % tiles.size();
+            coverage.Remove(tiles[index]);
+            area -= static_cast<int64_t>(tiles[index].size) * tiles[index].size;
+            atlas.Free(tiles[index]);
+            tiles[index] = tiles.back();
+            tiles.pop_back();
+            continue;
+        }
+
+        AtlasTile tile = atlas.Allocate(sMinTileSize << ((random >> 20) % 4));
+        if (tile.level >= 0)
+        {
+            coverage.Add(tile, step);
+            area += static_cast<int64_t>(tile.size) * tile.size;
+            tiles.emplace_back(tile);
+        }
+        if (sFailures > 0)
+        {
+            return;
+        }
+    }
+    Check(atlas.GetUsedArea() == area, "used area matches the allocated tiles after random steps");
+    for (auto &tile : tiles)
+    {
+        atlas.Free(tile);
+    }
+    Check(atlas.GetUsedArea() == 0 && atlas.Allocate(sAtlasSize).level == 0, "the whole atlas fits after freeing the random tiles");
+}
+
+int main()
+{
+    CheckSizes();
+    CheckFull();
+    CheckSiblings();
+    CheckRandom();
+
+    if (sFailures > 0)
+    {
+        std::cout << sFailures << " atlas checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Every atlas check passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "Json.h"
+#include "MeshImporter.h"
+
+// Writes a mesh out as a Wavefront .obj, a .gltf with an external buffer and a binary .glb,
+// imports every file again and checks that the same triangles come back. The JSON parser
+// is checked on its own first. Runs without a window, returns 1 if any check fails
+
+// Quads along each side of the grid. The .obj is larger than a chunk of the importer,
+// so its faces are parsed in parallel and some refer to vertices of earlier chunks
+static const int sGridSize = 128;
+
+// Node translation of the glTF files, the importers bake it into the vertices
+static const glm::vec3 sGltfTranslation = glm::vec3(1.0f, 2.0f, 3.0f);
+
+// Largest difference of a normal or texture coordinate that passes
+static const float sTolerance = 1e-4f;
+
+// Mesh that is written out and compared against what is imported
+struct SourceMesh
+{
+    std::vector<VertexNormalTexture> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Counts the checks that failed
+static int sFailures = 0;
+
+//   Check prints a failed check and counts it:
+// - bool for the result of the check
+// - const std::string& for what was checked
+static void Check(bool passed, const std::string &what)
+{
+    if (!passed)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        ++sFailures;
+    }
+}
+
+//   CreateGrid builds a bumpy grid whose positions and texture coordinates are multiples
+//   of a power of two, so they are written and read back exactly:
+// - int for the quads along each side
+static SourceMesh CreateGrid(int size)
+{
+    SourceMesh mesh;
+    for (int z = 0; z <= size; ++z)
+    {
+        for (int x = 0; x <= size; ++x)
+        {
+            VertexNormalTexture v;
+            v.pos = glm::vec3(x * 0.125f, ((x * 7 + z * 3) % 16) * 0.0625f, z * 0.125f);
+            v.normal = glm::normalize(glm::vec3(std::sin(x * 0.5f), 4.0f, std::cos(z * 0.5f)));
+            v.uv = glm::vec2(static_cast<float>(x) / size, static_cast<float>(z) / size);
+            mesh.vertices.emplace_back(v);
+        }
+    }
+    for (int z = 0; z < size; ++z)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            uint32_t i = z * (size + 1) + x;
+            uint32_t below = i + size + 1;
+            mesh.indices.insert(mesh.indices.end(), {i, below, below + 1, i, below + 1, i + 1});
+        }
+    }
+    return mesh;
+}
+
+//   CompareTriangles checks that the finest level of an imported mesh has exactly the
+//   triangles of the source with the same winding, in any order and starting at any corner:
+// - const SourceMesh& for the mesh that was written
+// - const MeshData& for the imported mesh
+// - const glm::vec3& for the offset the importer adds to the positions
+// - const std::string& for the name of the file in the messages
+static void CompareTriangles(const SourceMesh &source, const MeshData &mesh, const glm::vec3 &offset, const std::string &name)
+{
+    // The positions of the grid are unique and exact, so they identify the source vertex
+    std::map<std::array<int, 3>, uint32_t> sourceVertex;
+    auto key = [](const glm::vec3 &pos)
+    {
+        return std::array<int, 3>{static_cast<int>(std::lround(pos.x * 1024.0f)), static_cast<int>(std::lround(pos.y * 1024.0f)),
+                                  static_cast<int>(std::lround(pos.z * 1024.0f))};
+    };
+    for (uint32_t i = 0; i < source.vertices.size(); ++i)
+    {
+        sourceVertex[key(source.vertices[i].pos)] = i;
+    }
+
+    // Each triangle starts at its smallest index, which keeps the winding
+    auto canonical = [](std::array<uint32_t, 3> t)
+    {
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        return t;
+    };
+    std::vector<std::array<uint32_t, 3>> expected, imported;
+    for (size_t i = 0; i + 2 < source.indices.size(); i += 3)
+    {
+        expected.emplace_back(canonical({source.indices[i], source.indices[i + 1], source.indices[i + 2]}));
+    }
+
+    size_t finestCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+    size_t wrongVertices = 0;
+    for (size_t i = 0; i + 2 < finestCount; i += 3)
+    {
+        std::array<uint32_t, 3> triangle;
+        for (int c = 0; c < 3; ++c)
+        {
+            const VertexNormalTexture &v = mesh.vertices[mesh.indices[i + c]];
+            auto found = sourceVertex.find(key(v.pos - offset));
+            if (found == sourceVertex.end())
+            {
+                ++wrongVertices;
+                triangle[c] = ~0u;
+                continue;
+            }
+            const VertexNormalTexture &s = source.vertices[found->second];
+            if (glm::any(glm::greaterThan(glm::abs(v.normal - s.normal), glm::vec3(sTolerance))) ||
+                glm::any(glm::greaterThan(glm::abs(v.uv - s.uv), glm::vec2(sTolerance))))
+            {
+                ++wrongVertices;
+            }
+            triangle[c] = found->second;
+        }
+        imported.emplace_back(canonical(triangle));
+    }
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(imported.begin(), imported.end());
+    Check(wrongVertices == 0, name + ": " + std::to_string(wrongVertices) + " corners don't match a source vertex");
+    Check(imported == expected, name + ": " + std::to_string(imported.size()) + " triangles imported, " + std::to_string(expected.size()) + " written");
+}
+
+// Parses a document with every kind of value and escape, and rejects broken ones
+static void CheckJson()
+{
+    std::string text = R"({"name": "caf\u00e9 \"quoted\"\n", "emoji": "\uD83D\uDE00", "plain": "text",
+                          "values": [1, -2.5, 3e2, true, false, null], "nested": {"empty": [], "deep": [[{"x": 7}]]},
+                          "ints": [2147483647, -2147483648, 2147483648, -2147483649, 1.5, 1e300]})";
+    JsonValue root;
+    Check(JsonValue::Parse(text, root), "JSON: valid document is parsed");
+    Check(root.IsObject() && root.Size() == 6, "JSON: root object has 6 members");
+    Check(root["name"].GetString() == "caf\xC3\xA9 \"quoted\"\n", "JSON: escapes are decoded");
+    Check(root["emoji"].GetString() == "\xF0\x9F\x98\x80", "JSON: surrogate pair is decoded into one code point");
+    Check(root["plain"].GetString() == "text", "JSON: plain string");
+
+    const JsonValue &values = root["values"];
+    Check(values.IsArray() && values.Size() == 6, "JSON: array has 6 elements");
+    Check(values[0].GetInt() == 1 && values[1].GetNumber() == -2.5 && values[2].GetNumber() == 300.0, "JSON: numbers");
+    Check(values[3].GetBool() && !values[4].GetBool(true) && values[5].IsNull(), "JSON: true, false and null");
+    Check(values[6].IsNull() && root["missing"].IsNull(), "JSON: missing index and key are null");
+    Check(root["nested"]["empty"].IsArray() && root["nested"]["empty"].Size() == 0, "JSON: empty array");
+    Check(root["nested"]["deep"][0][0]["x"].GetInt() == 7, "JSON: nested values");
+
+    // Numbers that aren't whole or don't fit an int read as the default
+    const JsonValue &ints = root["ints"];
+    Check(ints[0].GetInt() == 2147483647 && ints[1].GetInt() == -2147483647 - 1, "JSON: int limits");
+    Check(ints[2].GetInt(-1) == -1 && ints[3].GetInt(-1) == -1 && ints[4].GetInt(-1) == -1 && ints[5].GetInt(-1) == -1, "JSON: numbers that aren't ints");
+
+    for (const char *broken : {R"({"a": "\uD83D"})", R"({"a": "\uDE00"})", R"({"a": "\u12G4"})", R"([1, 2)", R"({"a" 1})"})
+    {
+        JsonValue value;
+        Check(!JsonValue::Parse(broken, value), std::string("JSON: rejects ") + broken);
+    }
+}
+
+//   CheckObj writes the grid as an .obj and imports it, along with a group where only some
+//   corners have a normal:
+// - const SourceMesh& for the grid
+// - const std::filesystem::path& for the directory of the file
+static void CheckObj(const SourceMesh &grid, const std::filesystem::path &directory)
+{
+    std::string fileName = (directory / "grid.obj").string();
+    FILE *file = std::fopen(fileName.c_str(), "w");
+    if (!file)
+    {
+        Check(false, "OBJ: can't write " + fileName);
+        return;
+    }
+    std::fprintf(file, "o Grid\n");
+    for (const VertexNormalTexture &v : grid.vertices)
+    {
+        std::fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", v.pos.x, v.pos.y, v.pos.z, v.uv.x, v.uv.y, v.normal.x, v.normal.y, v.normal.z);
+    }
+
+    // Every other triangle refers to the vertices relative to the end of the list
+    int count = static_cast<int>(grid.vertices.size());
+    for (size_t i = 0; i + 2 < grid.indices.size(); i += 3)
+    {
+        std::fprintf(file, "f");
+        for (int c = 0; c < 3; ++c)
+        {
+            int index = (i / 3) % 2 ? static_cast<int>(grid.indices[i + c]) - count : static_cast<int>(grid.indices[i + c]) + 1;
+            std::fprintf(file, " %d/%d/%d", index, index, index);
+        }
+        std::fprintf(file, "\n");
+    }
+
+    // A flat square whose authored normals point sideways, two corners of the last triangle have none
+    std::fprintf(file, "o Partial\nv 0 0 0\nv -1 0 -1\nv 1 0 -1\nv 1 0 1\nv -1 0 1\nvn 1 0 0\n");
+    std::fprintf(file, "f -5//-1 -4//-1 -1//-1\nf -5//-1 -1//-1 -2//-1\nf -5//-1 -2//-1 -3//-1\nf -5 -3 -4//-1\n");
+    std::fclose(file);
+
+    std::vector<MeshData> meshes;
+    Check(MeshImporter::Load(fileName, meshes), "OBJ: file is imported");
+    Check(meshes.size() == 2, "OBJ: 2 groups give 2 meshes");
+    if (meshes.size() != 2)
+    {
+        return;
+    }
+    Check(meshes[0].name == "Grid" && meshes[1].name == "Partial", "OBJ: group names");
+    CompareTriangles(grid, meshes[0], glm::vec3(0.0f), "OBJ");
+
+    // The corners with a normal keep it, only the two without one get the square's normal
+    size_t authored = 0, generated = 0;
+    for (const VertexNormalTexture &v : meshes[1].vertices)
+    {
+        authored += glm::all(glm::lessThan(glm::abs(v.normal - glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(sTolerance)));
+        generated += glm::all(glm::lessThan(glm::abs(v.normal - glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(sTolerance)));
+    }
+    Check(authored == 5 && generated == 2, "OBJ: " + std::to_string(authored) + " authored and " + std::to_string(generated) + " generated normals, expected 5 and 2");
+}
+
+//   CheckGltf writes the grid as a .gltf with its buffer in a file whose name needs escaping,
+//   and as a .glb with the buffer in its binary chunk, and imports both:
+// - const SourceMesh& for the grid
+// - const std::filesystem::path& for the directory of the files
+static void CheckGltf(const SourceMesh &grid, const std::filesystem::path &directory)
+{
+    // Positions, normals, texture coordinates with the origin at the top left, then the indices
+    std::vector<char> buffer;
+    auto append = [&buffer](const void *data, size_t size)
+    {
+        buffer.insert(buffer.end(), static_cast<const char *>(data), static_cast<const char *>(data) + size);
+    };
+    size_t count = grid.vertices.size();
+    for (const VertexNormalTexture &v : grid.vertices)
+    {
+        append(&v.pos, sizeof(glm::vec3));
+    }
+    for (const VertexNormalTexture &v : grid.vertices)
+    {
+        append(&v.normal, sizeof(glm::vec3));
+    }
+    for (const VertexNormalTexture &v : grid.vertices)
+    {
+        glm::vec2 uv = glm::vec2(v.uv.x, 1.0f - v.uv.y);
+        append(&uv, sizeof(glm::vec2));
+    }
+    append(grid.indices.data(), grid.indices.size() * sizeof(uint32_t));
+
+    size_t normalOffset = count * sizeof(glm::vec3), uvOffset = normalOffset * 2, indexOffset = uvOffset + count * sizeof(glm::vec2);
+    auto json = [&](const std::string &uri)
+    {
+        glm::vec3 min = grid.vertices[0].pos, max = grid.vertices[0].pos;
+        for (const VertexNormalTexture &v : grid.vertices)
+        {
+            min = glm::min(min, v.pos);
+            max = glm::max(max, v.pos);
+        }
+        char text[2048];
+        std::snprintf(text, sizeof(text),
+                      R"({"asset": {"version": "2.0"}, "scene": 0, "scenes": [{"nodes": [0]}],)"
+                      R"("nodes": [{"mesh": 0, "translation": [%g, %g, %g]}],)"
+                      R"("meshes": [{"name": "Grid", "primitives": [{"attributes": {"POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2}, "indices": 3}]}],)"
+                      R"("buffers": [{%s"byteLength": %zu}],)"
+                      R"("bufferViews": [{"buffer": 0, "byteOffset": 0, "byteLength": %zu}, {"buffer": 0, "byteOffset": %zu, "byteLength": %zu},)"
+                      R"({"buffer": 0, "byteOffset": %zu, "byteLength": %zu}, {"buffer": 0, "byteOffset": %zu, "byteLength": %zu}],)"
+                      R"("accessors": [{"bufferView": 0, "componentType": 5126, "count": %zu, "type": "VEC3", "min": [%g, %g, %g], "max": [%g, %g, %g]},)"
+                      R"({"bufferView": 1, "componentType": 5126, "count": %zu, "type": "VEC3"}, {"bufferView": 2, "componentType": 5126, "count": %zu, "type": "VEC2"},)"
+                      R"({"bufferView": 3, "componentType": 5125, "count": %zu, "type": "SCALAR"}]})",
+                      sGltfTranslation.x, sGltfTranslation.y, sGltfTranslation.z, uri.c_str(), buffer.size(), normalOffset, normalOffset, normalOffset, uvOffset,
+                      indexOffset - uvOffset, indexOffset, buffer.size() - indexOffset, count, min.x, min.y, min.z, max.x,
+                      max.y, max.z, count, count, grid.indices.size());
+        return std::string(text);
+    };
+
+    // The .gltf refers to "grid data.bin" with the space escaped
+    std::string gltfName = (directory / "grid.gltf").string();
+    std::ofstream(directory / "grid data.bin", std::ios::binary).write(buffer.data(), buffer.size());
+    std::ofstream(gltfName, std::ios::binary) << json(R"("uri": "grid%20data.bin", )");
+
+    // The .glb's chunks are padded to 4 bytes, the JSON with spaces
+    std::string glbJson = json("");
+    glbJson.resize((glbJson.size() + 3) & ~size_t(3), ' ');
+    buffer.resize((buffer.size() + 3) & ~size_t(3), 0);
+    uint32_t header[5] = {0x46546C67, 2, static_cast<uint32_t>(12 + 8 + glbJson.size() + 8 + buffer.size()), static_cast<uint32_t>(glbJson.size()), 0x4E4F534A};
+    uint32_t binHeader[2] = {static_cast<uint32_t>(buffer.size()), 0x004E4942};
+    std::string glbName = (directory / "grid.glb").string();
+    std::ofstream glb(glbName, std::ios::binary);
+    glb.write(reinterpret_cast<const char *>(header), sizeof(header));
+    glb.write(glbJson.data(), glbJson.size());
+    glb.write(reinterpret_cast<const char *>(binHeader), sizeof(binHeader));
+    glb.write(buffer.data(), buffer.size());
+    glb.close();
+
+    for (const std::string &fileName : {gltfName, glbName})
+    {
+        std::string format = fileName.substr(fileName.find_last_of('.'));
+        std::vector<MeshData> meshes;
+        Check(MeshImporter::Load(fileName, meshes), format + ": file is imported");
+        Check(meshes.size() == 1 && meshes[0].name == "Grid", format + ": one mesh named Grid");
+        if (meshes.size() == 1)
+        {
+            CompareTriangles(grid, meshes[0], sGltfTranslation, format);
+        }
+    }
+}
+
+//   CheckHostileGltf imports a triangle with accessors and buffer views whose numbers are broken or
+//   wrap around when added up, which have to be rejected instead of reading past the buffer:
+// - const std::filesystem::path& for the directory of the files
+static void CheckHostileGltf(const std::filesystem::path &directory)
+{
+    // 48 zero bytes in a data uri, the triangle's positions use the first 36
+    auto json = [](const std::string &view, const std::string &accessor)
+    {
+        return R"({"asset": {"version": "2.0"}, "meshes": [{"primitives": [{"attributes": {"POSITION": 0}}]}],)"
+               R"("buffers": [{"uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA", "byteLength": 48}],)"
+               R"("bufferViews": [{"buffer": 0, )" +
+               view + R"(}], "accessors": [{"componentType": 5126, )" + accessor + "}]}";
+    };
+    auto import = [&directory](const std::string &text)
+    {
+        std::string fileName = (directory / "hostile.gltf").string();
+        std::ofstream(fileName, std::ios::binary) << text;
+        std::vector<MeshData> meshes;
+        MeshImporter::Load(fileName, meshes);
+        return meshes.size() == 1 ? meshes[0].indices.size() : 0;
+    };
+
+    const std::string view = R"("byteOffset": 0, "byteLength": 48)";
+    const std::string accessor = R"("bufferView": 0, "count": 3, "type": "VEC3")";
+    Check(import(json(view, accessor)) == 3, "hostile glTF: the valid triangle is imported");
+
+    // 2^62 elements of 4 bytes, or a view of 2^63 bytes at an offset of 2^63, add up to 0
+    const std::pair<std::string, std::string> broken[] = {
+        {R"("byteOffset": 0, "byteLength": 48, "byteStride": 4)", R"("bufferView": 0, "count": 4611686018427387904, "type": "SCALAR")"},
+        {R"("byteOffset": 9223372036854775808, "byteLength": 9223372036854775808)", accessor},
+        {view, R"("bufferView": 0, "count": 5, "type": "VEC3")"},
+        {view, R"("bufferView": 0, "count": 3, "type": "VEC3", "byteOffset": 40)"},
+        {view, R"("bufferView": 0, "count": -1, "type": "VEC3")"},
+        {view, R"("bufferView": 0, "count": 1.5, "type": "VEC3")"},
+        {view, R"("bufferView": 0, "count": 1e300, "type": "VEC3")"},
+        {view, R"("bufferView": 0, "count": 3, "type": "VEC3", "byteOffset": -12)"},
+        {view, R"("bufferView": -1, "count": 3, "type": "VEC3")"},
+        {view, R"("bufferView": 1e20, "count": 3, "type": "VEC3")"},
+        {R"("byteOffset": 0, "byteLength": 48, "byteStride": 2)", accessor},
+        {R"("byteOffset": 0, "byteLength": 48, "byteStride": 0)", accessor},
+    };
+    for (const auto &[brokenView, brokenAccessor] : broken)
+    {
+        Check(import(json(brokenView, brokenAccessor)) == 0, "hostile glTF: rejects view {" + brokenView + "} with accessor {" + brokenAccessor + "}");
+    }
+}
+
+int main()
+{
+    // The importers parse and assemble the meshes on the workers
+    JobSystem jobSystem;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "importer_check";
+    std::filesystem::create_directories(directory);
+
+    SourceMesh grid = CreateGrid(sGridSize);
+    CheckJson();
+    CheckObj(grid, directory);
+    CheckGltf(grid, directory);
+    CheckHostileGltf(directory);
+
+    std::filesystem::remove_all(directory);
+
+    if (sFailures > 0)
+    {
+        std::cout << sFailures << " importer checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Every importer check passed" << std::endl;
+    return 0;
+}